@@ -0,0 +1,53 @@
+/**
+ * @file benchmark.hpp
+ *
+ * @brief Shared pieces of the benchmark runner, every benchmark is a function taking its own arguments
+ */
+
+#pragma once
+#include "src/log.hpp"
+#include <charconv>
+#include <chrono>
+#include <optional>
+#include <span>
+#include <string>
+
+namespace bloom::benchmark {
+
+using Arguments = std::span<const std::string>;
+using Clock = std::chrono::steady_clock;
+
+/**
+ * @brief Parses the argument at @c index, or returns @c fallback when there are fewer arguments
+ * @return Nothing if the argument isn't a whole number of type @c T
+ */
+template <typename T>
+std::optional<T> ParseArgument(Arguments args, size_t index, T fallback) {
+  if (index >= args.size()) return fallback;
+  const std::string& arg = args[index];
+  T value{};
+  auto [end, error] = std::from_chars(arg.data(), arg.data() + arg.size(), value);
+  if (error != std::errc() || end != arg.data() + arg.size()) {
+    BLOOM_WARN("Invalid argument '{0}'", arg);
+    return std::nullopt;
+  }
+  return value;
+}
+
+inline double MillisecondsSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Entry points, return the process exit code
+
+int RunQuantization(Arguments args);
+int RunOverdraw(Arguments args);
+int RunProfiler(Arguments args);
+int RunLogging(Arguments args);
+int RunEventBus(Arguments args);
+int RunImport(Arguments args);
+int RunLod(Arguments args);
+int RunOcclusion(Arguments args);
+int RunClusters(Arguments args);
+
+}
@@ -0,0 +1,55 @@
+#include "meshes.hpp"
+#include "scene_benchmark.hpp"
+#include "src/render/mesh_optimizer.hpp"
+#include <cmath>
+
+namespace bloom::benchmark {
+
+/**
+ * Draws a grid of @c objects tori of about @c triangles triangles through the GPU scene, once culled object by object
+ * and once split in meshlets and culled cluster by cluster. The grid spans twice the height of the view, so the tori on
+ * its edges are only partly visible, which is where clusters pay off. Logs the frame times and the primitives reaching
+ * the rasterizer of both.
+ */
+int RunClusters(Arguments args) {
+  const auto frames = ParseArgument<uint64_t>(args, 0, 300);
+  const auto objects = ParseArgument<uint32_t>(args, 1, 128);
+  const auto triangles = ParseArgument<uint32_t>(args, 2, 50'000);
+  if (!frames || !objects || !triangles || *objects == 0) return 1;
+
+  const auto sides = std::max(3u, static_cast<uint32_t>(std::sqrt(*triangles / 4.0)));
+  const auto columns = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(*objects))));
+
+  SceneBenchmark::Settings settings{};
+  settings.frames = *frames;
+  settings.device = args.size() > 3 ? args[3] : "";
+
+  for (bool meshlets : {false, true}) {
+    // Only the finest level is split, a single level keeps every object drawn with its meshlets
+    auto mesh = CreateTorus(sides * 2, sides, 1.0f, 0.35f);
+    render::MeshOptimizer::Settings optimizer{};
+    optimizer.lodCount = 1;
+    optimizer.buildMeshlets = meshlets;
+    const auto statistics = render::MeshOptimizer::Optimize(mesh, optimizer);
+
+    const auto result = SceneBenchmark::Run(settings, [&](SceneBenchmark& scene) {
+      auto model = std::make_shared<render::Model>(&scene.GetGeometryPool(), scene.GetDevices(), mesh);
+      const float spacing = 16.0f / static_cast<float>(columns);
+      for (uint32_t i = 0; i < *objects; i++) {
+        Transform transform{};
+        transform.position = {(static_cast<float>(i % columns) - (columns - 1) * 0.5f) * spacing,
+                              (static_cast<float>(i / columns) - (columns - 1) * 0.5f) * spacing, -4.0f};
+        transform.scale = glm::vec3(spacing * 0.35f);
+        scene.AddObject(model, transform);
+      }
+    }, [](SceneBenchmark& scene) {
+      scene.GetRenderSystem().SetGpuDriven(true);
+    });
+    const auto name = meshlets ? fmt::format("Clusters, {0} meshlets per torus", statistics.meshlets)
+                               : std::string("Objects");
+    LogResult(name, result);
+  }
+  return 0;
+}
+
+}
@@ -0,0 +1,85 @@
+#include "benchmark.hpp"
+#include "src/events/event_bus.hpp"
+#include "src/events/event_queue.hpp"
+#include <thread>
+
+namespace bloom::benchmark {
+
+namespace {
+
+struct Throughput {
+  double eventsPerSecond = 0.0;
+  uint64_t rejected = 0; ///< Posts that found the bus full and were retried
+  uint64_t batches = 0;  ///< Drain calls that returned at least one event
+};
+
+/**
+ * @brief Each producer posts @c events events while this thread drains, like the main loop would, until all arrive
+ */
+Throughput Measure(uint32_t producerCount, uint64_t events, size_t capacity) {
+  EventBus bus(capacity);
+  std::atomic<bool> go = false;
+  std::vector<std::thread> producers;
+  for (uint32_t p = 0; p < producerCount; p++) {
+    producers.emplace_back([&, p] {
+      while (!go.load()) std::this_thread::yield();
+      for (uint64_t i = 0; i < events; i++) {
+        // Workers are expected to size the bus for their bursts, here it's kept full on purpose, so retry
+        while (!bus.Post(GameCustomEvent(p, i))) std::this_thread::yield();
+      }
+    });
+  }
+
+  Throughput result{};
+  const uint64_t total = events * producerCount;
+  uint64_t received = 0;
+  uint64_t checksum = 0;
+  const auto start = Clock::now();
+  go = true;
+  while (received < total) {
+    const size_t drained = bus.Drain(EventHandlers{
+      [&](const GameCustomEvent& event) { checksum += event.GetPayload(); },
+      [](const auto&) {}
+    });
+    received += drained;
+    if (drained > 0) {
+      result.batches++;
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  const double seconds = MillisecondsSince(start) / 1000.0;
+  for (auto& producer : producers) producer.join();
+
+  // Every producer posts 0..events-1, anything lost or duplicated shows up here
+  if (checksum != producerCount * (events * (events - 1) / 2)) {
+    BLOOM_WARN("{0} producers: payload checksum mismatch", producerCount);
+  }
+  result.eventsPerSecond = static_cast<double>(total) / seconds;
+  result.rejected = bus.GetDroppedCount();
+  return result;
+}
+
+}
+
+/**
+ * Posts @c events events from each of 1, 2, 4, 8 and 16 producer threads into one bus drained by a single consumer and
+ * logs the throughput. The bus capacity is small enough that producers keep running into a full bus.
+ */
+int RunEventBus(Arguments args) {
+  const auto events = ParseArgument<uint64_t>(args, 0, 1'000'000);
+  const auto capacity = ParseArgument<size_t>(args, 1, 4096);
+  if (!events || !capacity || *events == 0 || *capacity < 2) return 1;
+
+  BLOOM_INFO("{0} events per producer, capacity {1}, {2} hardware threads", *events, *capacity,
+             std::thread::hardware_concurrency());
+  for (uint32_t producers = 1; producers <= 16; producers *= 2) {
+    const auto result = Measure(producers, *events, *capacity);
+    BLOOM_INFO("{0:>2} producers: {1:.2f}M events/s, {2} full bus retries, {3:.0f} events per drain", producers,
+               result.eventsPerSecond / 1e6, result.rejected,
+               static_cast<double>(*events * producers) / static_cast<double>(std::max<uint64_t>(result.batches, 1)));
+  }
+  return 0;
+}
+
+}
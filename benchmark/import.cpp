@@ -0,0 +1,56 @@
+#include "meshes.hpp"
+#include "scene_benchmark.hpp"
+#include <cmath>
+#include <filesystem>
+
+namespace bloom::benchmark {
+
+/**
+ * Imports a mesh from its source, which cooks it, then @c loads more times from the cooked file. The importer logs
+ * both paths at the end, each load timed from opening the file until its model is uploaded. Without a path a torus of
+ * about @c triangles triangles is written as an OBJ first. The cache gets a directory of its own, emptied at the start,
+ * so the first load always parses.
+ */
+int RunImport(Arguments args) {
+  const auto loads = ParseArgument<uint32_t>(args, 0, 10);
+  const auto triangles = ParseArgument<uint32_t>(args, 1, 1'000'000);
+  if (!loads || !triangles || *loads == 0) return 1;
+
+  const std::filesystem::path directory = "cache/benchmark";
+  std::error_code error;
+  std::filesystem::remove_all(directory, error);
+  std::filesystem::create_directories(directory, error);
+
+  std::string path = args.size() > 2 ? args[2] : "";
+  if (path.empty()) {
+    const auto sides = std::max(3u, static_cast<uint32_t>(std::sqrt(*triangles / 4.0)));
+    path = (directory / "torus.obj").string();
+    if (!WriteObj(CreateTorus(sides * 2, sides, 1.0f, 0.35f), path)) {
+      BLOOM_WARN("Could not write {0}", path);
+      return 1;
+    }
+  }
+
+  // Loading is what's measured, a single frame only checks the last model draws
+  SceneBenchmark::Settings settings{};
+  settings.frames = 1;
+  settings.warmupFrames = 0;
+  settings.device = args.size() > 3 ? args[3] : "";
+  settings.importer.cacheDirectory = (directory / "meshes").string();
+
+  bool loaded = true;
+  SceneBenchmark::Run(settings, [&](SceneBenchmark& scene) {
+    std::shared_ptr<render::Model> model;
+    for (uint32_t i = 0; i <= *loads && loaded; i++) {
+      model = scene.GetMeshImporter().Load(path);
+      loaded = model != nullptr;
+    }
+    if (!loaded) return;
+    Transform transform{};
+    transform.position = {0.0f, 0.0f, -3.5f};
+    scene.AddObject(std::move(model), transform);
+  });
+  return loaded ? 0 : 1;
+}
+
+}
@@ -0,0 +1,47 @@
+#include "meshes.hpp"
+#include "benchmark.hpp"
+#include "src/render/mesh_optimizer.hpp"
+#include <cmath>
+
+namespace bloom::benchmark {
+
+/**
+ * Generates the levels of detail of tori of @c triangles / 100, @c triangles / 10 and @c triangles triangles, with the
+ * importer settings, and logs the triangles and error of every level. CPU only, no device needed.
+ */
+int RunLod(Arguments args) {
+  const auto triangles = ParseArgument<uint32_t>(args, 0, 1'000'000);
+  const auto levels = ParseArgument<uint32_t>(args, 1, 4);
+  if (!triangles || !levels || *triangles < 100 || *levels == 0) return 1;
+
+  render::MeshOptimizer::Settings settings{};
+  settings.lodCount = *levels;
+  // Only the simplifier is measured, meshlets would just add to the time
+  settings.buildMeshlets = false;
+
+  for (uint32_t target : {*triangles / 100, *triangles / 10, *triangles}) {
+    const auto sides = std::max(3u, static_cast<uint32_t>(std::sqrt(target / 4.0)));
+    auto mesh = CreateTorus(sides * 2, sides, 1.0f, 0.35f);
+    // Same radius the simplifier bounds the error with, half the diagonal of the bounds
+    glm::vec3 min = mesh.vertices[0].position;
+    glm::vec3 max = min;
+    for (const auto& v : mesh.vertices) {
+      min = glm::min(min, v.position);
+      max = glm::max(max, v.position);
+    }
+    const float radius = glm::length(max - min) * 0.5f;
+
+    const auto statistics = render::MeshOptimizer::Optimize(mesh, settings);
+    const uint32_t finest = statistics.lodTriangles.empty() ? 0 : statistics.lodTriangles[0];
+    BLOOM_INFO("Torus of {0} triangles: {1} levels in {2:.2f}ms", finest, mesh.lods.size(), statistics.milliseconds);
+    for (size_t i = 0; i < mesh.lods.size(); i++) {
+      const auto& lod = mesh.lods[i];
+      BLOOM_INFO("  LOD {0}: {1} triangles ({2:.1f}% of LOD 0), error {3:.3g} ({4:.3f}% of the radius)", i,
+                 lod.indexCount / 3, 100.0 * lod.indexCount / 3 / std::max(finest, 1u), lod.error,
+                 100.0 * lod.error / radius);
+    }
+  }
+  return 0;
+}
+
+}
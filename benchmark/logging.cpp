@@ -0,0 +1,111 @@
+#include "benchmark.hpp"
+#include <thread>
+
+namespace bloom::benchmark {
+
+namespace {
+
+struct Latency {
+  double average = 0.0; ///< Nanoseconds, from timing the whole batch
+  double p50 = 0.0;
+  double p99 = 0.0;
+  double max = 0.0;
+  double drain = 0.0;   ///< Milliseconds Shutdown() took to write out what was still queued
+};
+
+/**
+ * @brief Logs @c messages lines from each of @c threadCount threads into a file and times the calls
+ *
+ * The console sink is left out, a terminal would measure itself instead of the backend
+ */
+Latency Measure(const Log::Settings& settings, uint32_t threadCount, uint32_t messages) {
+  Log::Init(settings);
+  std::vector<std::vector<double>> samples(threadCount);
+  std::vector<double> batches(threadCount);
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < threadCount; t++) {
+    threads.emplace_back([&, t] {
+      // Every call timed on its own for the percentiles, a second untimed pass gives the average without the clock
+      auto& times = samples[t];
+      times.reserve(messages);
+      for (uint32_t i = 0; i < messages; i++) {
+        const auto start = Clock::now();
+        BLOOM_INFO("Frame {0} on thread {1} took {2:.3f}ms, {3} draws", i, t, 16.6 + i * 1e-4, i % 1000);
+        times.push_back(MillisecondsSince(start) * 1e6);
+      }
+      const auto start = Clock::now();
+      for (uint32_t i = 0; i < messages; i++) {
+        BLOOM_INFO("Frame {0} on thread {1} took {2:.3f}ms, {3} draws", i, t, 16.6 + i * 1e-4, i % 1000);
+      }
+      batches[t] = MillisecondsSince(start) * 1e6 / messages;
+    });
+  }
+  for (auto& thread : threads) thread.join();
+
+  const auto drainStart = Clock::now();
+  Log::Shutdown();
+  Latency latency{};
+  latency.drain = MillisecondsSince(drainStart);
+
+  std::vector<double> all;
+  for (const auto& times : samples) all.insert(all.end(), times.begin(), times.end());
+  std::sort(all.begin(), all.end());
+  for (double batch : batches) latency.average += batch / threadCount;
+  latency.p50 = all[all.size() / 2];
+  latency.p99 = all[all.size() * 99 / 100];
+  latency.max = all.back();
+  return latency;
+}
+
+}
+
+/**
+ * Times @c BLOOM_INFO calls that end up on a rotating file, synchronous and asynchronous with both overflow policies,
+ * from 1 and from @c threads threads at once.
+ */
+int RunLogging(Arguments args) {
+  const auto messages = ParseArgument<uint32_t>(args, 0, 200'000);
+  const auto maxThreads = ParseArgument<uint32_t>(args, 1, 4);
+  if (!messages || !maxThreads || *messages == 0 || *maxThreads == 0) return 1;
+
+  Log::Settings base{};
+  base.bloom = {false, "logs/benchmark.log"};
+  base.game = {false, ""};
+  // Rotate often enough that the run doesn't leave gigabytes behind
+  base.maxFileSize = 64 * 1024 * 1024;
+  base.maxFiles = 1;
+
+  struct Case {
+    const char* name;
+    bool async;
+    Log::OverflowPolicy overflow;
+  };
+  constexpr Case CASES[] = {
+    {"sync", false, Log::OverflowPolicy::Block},
+    {"async, block", true, Log::OverflowPolicy::Block},
+    {"async, drop oldest", true, Log::OverflowPolicy::DropOldest},
+  };
+
+  std::vector<std::pair<std::string, Latency>> results;
+  for (uint32_t threads : {1u, *maxThreads}) {
+    for (const auto& test : CASES) {
+      Log::Settings settings = base;
+      settings.async = test.async;
+      settings.overflow = test.overflow;
+      results.emplace_back(fmt::format("{0}, {1} threads", test.name, threads),
+                           Measure(settings, threads, *messages));
+    }
+    if (*maxThreads == 1) break;
+  }
+
+  // The measured runs logged to the file only, back to the console for the results
+  Log::Init();
+  BLOOM_INFO("{0} messages per thread, {1} hardware threads", *messages, std::thread::hardware_concurrency());
+  for (const auto& [name, latency] : results) {
+    BLOOM_INFO("{0}: {1:.0f}ns average, p50 {2:.0f}ns, p99 {3:.0f}ns, max {4:.0f}ns, {5:.1f}ms to drain", name,
+               latency.average, latency.p50, latency.p99, latency.max, latency.drain);
+  }
+  return 0;
+}
+
+}
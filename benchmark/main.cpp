@@ -0,0 +1,60 @@
+/**
+ * @file main.cpp
+ *
+ * @brief Runs one of the engine benchmarks, `benchmark <name> [args...]`
+ *
+ * Scene benchmarks render headless, so they run on machines without a display and on lavapipe. Results are logged.
+ */
+
+#include "benchmark.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+struct Entry {
+  const char* name;
+  const char* usage;
+  int (*run)(bloom::benchmark::Arguments);
+};
+
+constexpr Entry BENCHMARKS[] = {
+  {"quantization", "[frames] [triangles] [size] [device]", bloom::benchmark::RunQuantization},
+  {"overdraw", "[frames] [layers] [device]", bloom::benchmark::RunOverdraw},
+  {"profiler", "[scopes] [threads]", bloom::benchmark::RunProfiler},
+  {"logging", "[messages] [threads]", bloom::benchmark::RunLogging},
+  {"eventbus", "[events] [capacity]", bloom::benchmark::RunEventBus},
+  {"import", "[loads] [triangles] [path] [device]", bloom::benchmark::RunImport},
+  {"lod", "[triangles] [levels]", bloom::benchmark::RunLod},
+  {"occlusion", "[frames] [objects] [triangles] [device]", bloom::benchmark::RunOcclusion},
+  {"clusters", "[frames] [objects] [triangles] [device]", bloom::benchmark::RunClusters},
+};
+
+void PrintUsage() {
+  BLOOM_INFO("Usage: benchmark <name> [args...]");
+  for (const auto& entry : BENCHMARKS) {
+    BLOOM_INFO("  {0} {1}", entry.name, entry.usage);
+  }
+}
+
+}
+
+int main(int argc, char** argv) {
+  bloom::Log::Init();
+
+  int result = 1;
+  const std::vector<std::string> args(argv + std::min(argc, 2), argv + argc);
+  const Entry* entry = nullptr;
+  for (const auto& candidate : BENCHMARKS) {
+    if (argc > 1 && std::string_view(argv[1]) == candidate.name) entry = &candidate;
+  }
+  if (entry != nullptr) {
+    result = entry->run(args);
+    if (result != 0) BLOOM_INFO("Usage: benchmark {0} {1}", entry->name, entry->usage);
+  } else {
+    PrintUsage();
+  }
+
+  bloom::Log::Shutdown();
+  return result;
+}
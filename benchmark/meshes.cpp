@@ -0,0 +1,71 @@
+#include "meshes.hpp"
+#include "glm/gtc/constants.hpp"
+#include <fstream>
+
+namespace bloom::benchmark {
+
+render::MeshData CreateTorus(uint32_t rings, uint32_t sides, float radius, float tube) {
+  render::MeshData mesh;
+  mesh.vertices.reserve(static_cast<size_t>(rings + 1) * (sides + 1));
+  for (uint32_t i = 0; i <= rings; i++) {
+    const float u = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(rings);
+    for (uint32_t j = 0; j <= sides; j++) {
+      const float v = glm::two_pi<float>() * static_cast<float>(j) / static_cast<float>(sides);
+      const float distance = radius + tube * glm::cos(v);
+      render::Model::Vertex vertex{};
+      vertex.position = {distance * glm::cos(u), distance * glm::sin(u), tube * glm::sin(v)};
+      vertex.texCoord = {static_cast<float>(i) / static_cast<float>(rings),
+                         static_cast<float>(j) / static_cast<float>(sides)};
+      vertex.color = glm::vec4(1.0f);
+      mesh.vertices.push_back(vertex);
+    }
+  }
+
+  // Seam vertices are duplicated so the texture coordinates wrap, the grid is walked ring by ring
+  mesh.indices.reserve(static_cast<size_t>(rings) * sides * 6);
+  for (uint32_t i = 0; i < rings; i++) {
+    for (uint32_t j = 0; j < sides; j++) {
+      const uint32_t a = i * (sides + 1) + j;
+      const uint32_t b = a + sides + 1;
+      mesh.indices.insert(mesh.indices.end(), {a, b, a + 1, b, b + 1, a + 1});
+    }
+  }
+  return mesh;
+}
+
+render::MeshData CreateLayers(uint32_t count, float nearest, float spacing) {
+  render::MeshData mesh;
+  mesh.vertices.reserve(static_cast<size_t>(count) * 4);
+  mesh.indices.reserve(static_cast<size_t>(count) * 6);
+  for (uint32_t i = 0; i < count; i++) {
+    const float depth = nearest + static_cast<float>(count - 1 - i) * spacing;
+    // Slightly tinted per layer so a screenshot shows which one won
+    const glm::vec4 color(1.0f, 1.0f - 0.5f * static_cast<float>(i) / static_cast<float>(count), 1.0f, 1.0f);
+    const auto first = static_cast<uint32_t>(mesh.vertices.size());
+    for (const auto& corner : {glm::vec2(-1.0f, -1.0f), glm::vec2(1.0f, -1.0f), glm::vec2(1.0f, 1.0f),
+                               glm::vec2(-1.0f, 1.0f)}) {
+      mesh.vertices.push_back({glm::vec3(corner * depth, -depth), corner * 0.5f + 0.5f, color});
+    }
+    mesh.indices.insert(mesh.indices.end(), {first, first + 1, first + 2, first, first + 2, first + 3});
+  }
+  return mesh;
+}
+
+bool WriteObj(const render::MeshData& mesh, const std::string& path) {
+  std::ofstream file(path);
+  if (!file) return false;
+  for (const auto& v : mesh.vertices) {
+    file << fmt::format("v {0} {1} {2}\nvt {3} {4}\n", v.position.x, v.position.y, v.position.z, v.texCoord.x,
+                        v.texCoord.y);
+  }
+  // OBJ indices start at 1, texture coordinates share the vertex index
+  for (size_t i = 0; i + 3 <= mesh.indices.size(); i += 3) {
+    const uint32_t a = mesh.indices[i] + 1;
+    const uint32_t b = mesh.indices[i + 1] + 1;
+    const uint32_t c = mesh.indices[i + 2] + 1;
+    file << fmt::format("f {0}/{0} {1}/{1} {2}/{2}\n", a, b, c);
+  }
+  return static_cast<bool>(file);
+}
+
+}
@@ -0,0 +1,33 @@
+/**
+ * @file meshes.hpp
+ *
+ * @brief Procedural meshes for the benchmarks, so they don't depend on assets of a given size
+ */
+
+#pragma once
+#include "src/render/model.hpp"
+
+namespace bloom::benchmark {
+
+/**
+ * @brief Torus around the z axis with outward facing triangles, @c 2 * rings * sides of them
+ * @param radius Distance from the center to the middle of the tube
+ * @param tube Radius of the tube
+ */
+render::MeshData CreateTorus(uint32_t rings, uint32_t sides, float radius, float tube);
+
+/**
+ * @brief Stack of @c count quads facing +z, the worst case for overdraw when viewed from +z
+ *
+ * Layers are ordered back to front, the first one drawn sits at @c -nearest - (count - 1) * spacing and the last at
+ * @c -nearest. Each quad is wide enough to cover a 90 degree field of view from the origin.
+ */
+render::MeshData CreateLayers(uint32_t count, float nearest, float spacing);
+
+/**
+ * @brief Writes positions, texture coordinates and triangles of @c mesh as an OBJ file, for the import benchmark
+ * @return False if the file couldn't be written
+ */
+bool WriteObj(const render::MeshData& mesh, const std::string& path);
+
+}
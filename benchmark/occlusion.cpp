@@ -0,0 +1,57 @@
+#include "meshes.hpp"
+#include "scene_benchmark.hpp"
+#include <cmath>
+
+namespace bloom::benchmark {
+
+/**
+ * Draws a wall covering the whole view with @c objects tori of about @c triangles triangles each, one in eight in front
+ * of it and the rest hidden behind, through the GPU scene with occlusion culling off and on. Logs the frame times and
+ * the primitives reaching the rasterizer, with occlusion culling on they should drop to about the visible eighth.
+ */
+int RunOcclusion(Arguments args) {
+  const auto frames = ParseArgument<uint64_t>(args, 0, 300);
+  const auto objects = ParseArgument<uint32_t>(args, 1, 1024);
+  const auto triangles = ParseArgument<uint32_t>(args, 2, 20'000);
+  if (!frames || !objects || !triangles || *objects == 0) return 1;
+
+  const auto sides = std::max(3u, static_cast<uint32_t>(std::sqrt(*triangles / 4.0)));
+  const auto torus = CreateTorus(sides * 2, sides, 0.4f, 0.15f);
+  constexpr float WALL = 10.0f;
+  const auto wall = CreateLayers(1, WALL, 0.0f);
+
+  SceneBenchmark::Settings settings{};
+  settings.frames = *frames;
+  settings.device = args.size() > 3 ? args[3] : "";
+
+  // Rows of 16 spread across the view, so visible tori don't hide each other either
+  const auto build = [&](SceneBenchmark& scene) {
+    scene.AddObject(std::make_shared<render::Model>(&scene.GetGeometryPool(), scene.GetDevices(), wall), {});
+    auto model = std::make_shared<render::Model>(&scene.GetGeometryPool(), scene.GetDevices(), torus);
+    for (uint32_t i = 0; i < *objects; i++) {
+      const bool visible = i % 8 == 0;
+      const float depth = visible ? 4.0f : WALL + 2.0f + static_cast<float>(i % 7) * 2.0f;
+      const float x = (static_cast<float>(i % 16) / 15.0f - 0.5f) * 1.6f;
+      const float y = (static_cast<float>(i / 16 % 16) / 15.0f - 0.5f) * 1.6f;
+      Transform transform{};
+      transform.position = {x * depth * 0.5f, y * depth * 0.5f, -depth};
+      scene.AddObject(model, transform);
+    }
+  };
+
+  const double trianglesPerObject = static_cast<double>(torus.indices.size() / 3);
+  BLOOM_INFO("{0} tori of {1:.0f} triangles, {2} in front of the wall", *objects, trianglesPerObject,
+             (*objects + 7) / 8);
+  for (bool occlusion : {false, true}) {
+    const auto result = SceneBenchmark::Run(settings, build, [&](SceneBenchmark& scene) {
+      scene.GetRenderSystem().SetGpuDriven(true);
+      scene.GetRenderSystem().SetOcclusionCulling(occlusion);
+    });
+    const auto name = fmt::format("Occlusion culling {0}", occlusion ? "on" : "off");
+    LogResult(name, result);
+    BLOOM_INFO("{0}: {1:.1f} tori worth of primitives", name, result.primitives / trianglesPerObject);
+  }
+  return 0;
+}
+
+}
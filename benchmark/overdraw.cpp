@@ -0,0 +1,34 @@
+#include "meshes.hpp"
+#include "scene_benchmark.hpp"
+
+namespace bloom::benchmark {
+
+/**
+ * Draws @c layers full screen quads back to front, every pixel is shaded once per layer without the depth pre-pass
+ * and once in total with it. Logs the frame times and the fragment shader invocations per pixel of both modes.
+ */
+int RunOverdraw(Arguments args) {
+  const auto frames = ParseArgument<uint64_t>(args, 0, 300);
+  const auto layers = ParseArgument<uint32_t>(args, 1, 16);
+  if (!frames || !layers || *layers == 0) return 1;
+
+  const auto mesh = CreateLayers(*layers, 1.0f, 0.25f);
+  SceneBenchmark::Settings settings{};
+  settings.frames = *frames;
+  settings.device = args.size() > 2 ? args[2] : "";
+  const double pixels = static_cast<double>(settings.target.extent.width) * settings.target.extent.height;
+
+  for (bool prepass : {false, true}) {
+    const auto result = SceneBenchmark::Run(settings, [&](SceneBenchmark& scene) {
+      scene.AddObject(std::make_shared<render::Model>(&scene.GetGeometryPool(), scene.GetDevices(), mesh), {});
+    }, [&](SceneBenchmark& scene) {
+      scene.GetRenderSystem().SetDepthPrepass(prepass);
+    });
+    const auto name = fmt::format("{0} layers, pre-pass {1}", *layers, prepass ? "on" : "off");
+    LogResult(name, result);
+    BLOOM_INFO("{0}: {1:.2f} fragments per pixel", name, result.fragments / pixels);
+  }
+  return 0;
+}
+
+}
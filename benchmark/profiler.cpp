@@ -0,0 +1,75 @@
+#include "benchmark.hpp"
+#include "src/profiler.hpp"
+#include <thread>
+
+namespace bloom::benchmark {
+
+namespace {
+
+enum class Mode {
+  None,     ///< Just the loop, what the macros compile to without BLOOM_ENABLE_CPU_PROFILER
+  Disabled, ///< Scopes while the profiler is paused, the clock is still read
+  Enabled,
+};
+
+/**
+ * @return Wall time per scope in nanoseconds, over every thread
+ */
+double Measure(Mode mode, uint32_t threadCount, uint64_t scopes) {
+  Profiler::SetEnabled(mode == Mode::Enabled);
+  std::atomic<uint32_t> ready = 0;
+  std::atomic<bool> go = false;
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < threadCount; t++) {
+    threads.emplace_back([&] {
+      // Takes the ring before the clock starts, the first scope of a thread is the only one that allocates
+      Profiler::Record("Warm up", Profiler::Now(), Profiler::Now());
+      ready++;
+      while (!go.load()) std::this_thread::yield();
+
+      // Volatile so the loop body can't be folded away, about the cheapest work a scope can wrap
+      volatile uint64_t value = 0;
+      for (uint64_t i = 0; i < scopes; i++) {
+        if (mode == Mode::None) {
+          value = value + i;
+        } else {
+          Profiler::Scope scope("Benchmark scope");
+          value = value + i;
+        }
+      }
+    });
+  }
+  while (ready.load() != threadCount) std::this_thread::yield();
+
+  const auto start = Clock::now();
+  go = true;
+  for (auto& thread : threads) thread.join();
+  const double nanoseconds = MillisecondsSince(start) * 1e6;
+  Profiler::SetEnabled(true);
+  return nanoseconds / static_cast<double>(scopes * threadCount);
+}
+
+}
+
+/**
+ * Times a tight loop of scopes without the profiler, paused and recording, on 1 up to @c threads threads. The
+ * difference with the bare loop is the cost of a scope, rings are per thread so it shouldn't grow with the threads
+ * until they outnumber the cores.
+ */
+int RunProfiler(Arguments args) {
+  const auto scopes = ParseArgument<uint64_t>(args, 0, 10'000'000);
+  const auto maxThreads = ParseArgument<uint32_t>(args, 1, 8);
+  if (!scopes || !maxThreads || *scopes == 0 || *maxThreads == 0) return 1;
+
+  BLOOM_INFO("{0} scopes per thread, {1} hardware threads", *scopes, std::thread::hardware_concurrency());
+  for (uint32_t threads = 1; threads <= *maxThreads; threads *= 2) {
+    const double none = Measure(Mode::None, threads, *scopes);
+    const double disabled = Measure(Mode::Disabled, threads, *scopes);
+    const double enabled = Measure(Mode::Enabled, threads, *scopes);
+    BLOOM_INFO("{0:>2} threads: loop {1:.2f}ns, paused {2:.2f}ns (+{3:.2f}), recording {4:.2f}ns (+{5:.2f}) per scope",
+               threads, none, disabled, disabled - none, enabled, enabled - none);
+  }
+  return 0;
+}
+
+}
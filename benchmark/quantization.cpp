@@ -0,0 +1,94 @@
+#include "meshes.hpp"
+#include "scene_benchmark.hpp"
+#include "glm/gtc/packing.hpp"
+#include <cmath>
+#include <limits>
+
+namespace bloom::benchmark {
+
+namespace {
+
+/**
+ * @brief Largest distance between a vertex and its position after a round trip through @c format, in model units
+ *
+ * Follows @c Model::Quantize(), @c normalize false gives the old half float path that only recentered the mesh
+ */
+float MaxPositionError(const render::MeshData& mesh, render::Model::VertexFormat format, bool normalize = true) {
+  if (format == render::Model::VertexFormat::Float) return 0.0f;
+
+  glm::vec3 min(std::numeric_limits<float>::max());
+  glm::vec3 max(std::numeric_limits<float>::lowest());
+  for (const auto& v : mesh.vertices) {
+    min = glm::min(min, v.position);
+    max = glm::max(max, v.position);
+  }
+  const glm::vec3 center = (min + max) * 0.5f;
+  const glm::vec3 extent = normalize ? glm::max((max - min) * 0.5f, glm::vec3(1e-6f)) : glm::vec3(1.0f);
+
+  float error = 0.0f;
+  for (const auto& v : mesh.vertices) {
+    const glm::vec4 position((v.position - center) / extent, 0.0f);
+    const glm::vec4 decoded = format == render::Model::VertexFormat::Half
+                                ? glm::unpackHalf4x16(glm::packHalf4x16(position))
+                                : glm::unpackSnorm4x16(glm::packSnorm4x16(position));
+    error = std::max(error, glm::length(glm::vec3(decoded) * extent + center - v.position));
+  }
+  return error;
+}
+
+const char* FormatName(render::Model::VertexFormat format) {
+  switch (format) {
+    case render::Model::VertexFormat::Float: return "Float";
+    case render::Model::VertexFormat::Half: return "Half";
+    case render::Model::VertexFormat::Snorm16: return "Snorm16";
+  }
+  return "Unknown";
+}
+
+}
+
+/**
+ * Draws a single torus of about @c triangles triangles filling the view once per vertex format, and logs the vertex
+ * memory, the worst position error and the frame times. @c size is the torus radius in model units, the object is
+ * scaled back down so every size draws the same image, only the quantization error changes.
+ */
+int RunQuantization(Arguments args) {
+  const auto frames = ParseArgument<uint64_t>(args, 0, 300);
+  const auto triangles = ParseArgument<uint32_t>(args, 1, 1'000'000);
+  const auto size = ParseArgument<float>(args, 2, 1.0f);
+  if (!frames || !triangles || !size || *size <= 0.0f) return 1;
+
+  // Twice as many rings as sides keeps the triangles close to square
+  const auto sides = std::max(3u, static_cast<uint32_t>(std::sqrt(*triangles / 4.0)));
+  const auto mesh = CreateTorus(sides * 2, sides, *size, *size * 0.35f);
+  BLOOM_INFO("Torus of {0} triangles, {1} vertices, radius {2}", mesh.indices.size() / 3, mesh.vertices.size(), *size);
+
+  SceneBenchmark::Settings settings{};
+  settings.frames = *frames;
+  settings.device = args.size() > 3 ? args[3] : "";
+
+  for (auto format : {render::Model::VertexFormat::Float, render::Model::VertexFormat::Half,
+                      render::Model::VertexFormat::Snorm16}) {
+    const render::Model::Layout layout{format, false};
+    const auto result = SceneBenchmark::Run(settings, [&](SceneBenchmark& scene) {
+      Transform transform{};
+      transform.position = {0.0f, 0.0f, -3.5f};
+      transform.scale = glm::vec3(1.0f / *size);
+      scene.AddObject(std::make_shared<render::Model>(&scene.GetGeometryPool(), scene.GetDevices(), mesh, layout),
+                      transform);
+    });
+
+    const float error = MaxPositionError(mesh, format);
+    BLOOM_INFO("{0}: {1:.2f}MB of vertices, max error {2:.3g} ({3:.3g} of the radius)", FormatName(format),
+               mesh.vertices.size() * render::Model::GetVertexStride(format) / (1024.0 * 1024.0), error,
+               error / *size);
+    if (format == render::Model::VertexFormat::Half) {
+      const float recentered = MaxPositionError(mesh, format, false);
+      BLOOM_INFO("Half recentered only: max error {0:.3g} ({1:.3g} of the radius)", recentered, recentered / *size);
+    }
+    LogResult(FormatName(format), result);
+  }
+  return 0;
+}
+
+}
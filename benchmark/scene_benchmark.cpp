@@ -0,0 +1,75 @@
+#include "scene_benchmark.hpp"
+#include "src/render/texture.hpp"
+
+namespace bloom::benchmark {
+
+SceneBenchmark::Result SceneBenchmark::Run(const Settings& settings, const Build& build, const Build& configure) {
+  SceneBenchmark scene(build);
+  scene.SetHeadless(settings.target, settings.warmupFrames + settings.frames, settings.device);
+  scene.SetMeshImporterSettings(settings.importer);
+  scene.Begin();
+  scene.m_renderer->SetPipelineStatistics(render::PipelineStatistics::Mode::Frame);
+  if (configure) configure(scene);
+
+  Result result{};
+  uint64_t counted = 0;
+  double cpu = 0.0;
+  double gpu = 0.0;
+  uint64_t gpuSamples = 0;
+  uint64_t gpuFramesSeen = 0;
+  while (!scene.ShouldClose()) {
+    scene.Tick();
+    // Tick sweeps the camera around, put it back so every frame draws the same view
+    scene.m_camera.SetViewDirection(settings.cameraPosition, settings.cameraDirection);
+    const auto start = Clock::now();
+    scene.Render();
+    if (scene.m_renderer->GetFrameNumber() <= settings.warmupFrames) continue;
+
+    cpu += MillisecondsSince(start);
+    result.frames++;
+    auto profiler = scene.m_renderer->GetGpuProfiler();
+    if (profiler && profiler->GetCollectedFrames() != gpuFramesSeen) {
+      gpuFramesSeen = profiler->GetCollectedFrames();
+      gpu += profiler->GetLastFrameTime();
+      gpuSamples++;
+    }
+    // Results trail a few frames behind, each one read belongs to a frame that already finished
+    if (auto statistics = scene.m_renderer->GetPipelineStatistics()) {
+      for (const auto& scope : statistics->GetLastFrame()) {
+        result.primitives += static_cast<double>(scope.counts.clippingPrimitives);
+        result.fragments += static_cast<double>(scope.counts.fragmentInvocations);
+        counted++;
+      }
+    }
+  }
+  scene.End();
+
+  if (result.frames > 0) result.cpuFrame = cpu / static_cast<double>(result.frames);
+  if (gpuSamples > 0) result.gpuFrame = gpu / static_cast<double>(gpuSamples);
+  if (counted > 0) {
+    result.primitives /= static_cast<double>(counted);
+    result.fragments /= static_cast<double>(counted);
+  }
+  return result;
+}
+
+Object& SceneBenchmark::AddObject(std::shared_ptr<render::Model> model, const Transform& transform) {
+  auto object = factory->CreateObject<Object>();
+  object.model = std::move(model);
+  object.transform = transform;
+  object.texture = m_texture.get();
+  gameObjects.push_back(std::move(object));
+  return gameObjects.back();
+}
+
+void SceneBenchmark::LoadObjects() {
+  m_texture = std::make_unique<render::Texture>(m_devices.get(), "resources/textures/cat.png");
+  m_build(*this);
+}
+
+void LogResult(std::string_view name, const SceneBenchmark::Result& result) {
+  BLOOM_INFO("{0}: {1:.3f}ms CPU, {2:.3f}ms GPU, {3:.0f} primitives, {4:.0f} fragments over {5} frames", name,
+             result.cpuFrame, result.gpuFrame, result.primitives, result.fragments, result.frames);
+}
+
+}
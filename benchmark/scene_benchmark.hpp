@@ -0,0 +1,73 @@
+/**
+ * @file scene_benchmark.hpp
+ *
+ * @brief Headless engine rendering a scene built by the benchmark, measuring its frames
+ */
+
+#pragma once
+#include "benchmark.hpp"
+#include "src/engine.hpp"
+#include <functional>
+
+namespace bloom::benchmark {
+
+/**
+ * @class SceneBenchmark
+ * @brief Engine whose objects come from the benchmark instead of the default scene
+ *
+ * The camera stays put so every frame draws the same thing, a few warm up frames let pipelines and caches settle
+ * before anything is measured. Pipeline statistics are always on, they count the whole frame.
+ */
+class SceneBenchmark : public Engine {
+public:
+  struct Settings {
+    uint64_t frames = 300;
+    uint64_t warmupFrames = 30;
+    render::OffscreenTarget::Settings target{};
+    std::string device; ///< Substring of the device name, like @c Engine::SetHeadless()
+    render::MeshImporter::Settings importer{};
+    glm::vec3 cameraPosition{0.0f};
+    glm::vec3 cameraDirection{0.0f, 0.0f, -1.0f};
+  };
+
+  /**
+   * @struct Result
+   * @brief Averages over the measured frames
+   */
+  struct Result {
+    double cpuFrame = 0.0;      ///< Milliseconds
+    double gpuFrame = 0.0;      ///< Milliseconds, 0 without the GPU profiler
+    double primitives = 0.0;    ///< Primitives reaching the rasterizer
+    double fragments = 0.0;     ///< Fragment shader invocations
+    uint64_t frames = 0;
+  };
+
+  using Build = std::function<void(SceneBenchmark&)>;
+
+  /**
+   * @brief Creates an engine, fills the scene with @c build and renders @c settings.frames measured frames
+   * @param configure Called once the engine began, to set the render system options being compared
+   */
+  static Result Run(const Settings& settings, const Build& build, const Build& configure = {});
+
+  /**
+   * @brief Adds an object with the shared texture, only valid from @c build
+   */
+  Object& AddObject(std::shared_ptr<render::Model> model, const Transform& transform);
+
+  render::Devices* GetDevices() { return m_devices.get(); }
+
+protected:
+  explicit SceneBenchmark(Build build) : m_build(std::move(build)) {}
+
+  void LoadObjects() override;
+
+private:
+  Build m_build;
+  std::unique_ptr<render::Texture> m_texture = nullptr;
+};
+
+/// Logs a result on one line, prefixed with @c name
+void LogResult(std::string_view name, const SceneBenchmark::Result& result);
+
+}
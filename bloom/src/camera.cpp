@@ -15,6 +15,7 @@ void Camera::SetPerspectiveProjection(float fov, float aspect, float near, float
 
 void Camera::SetViewDirection(glm::vec3 position, glm::vec3 direction, glm::vec3 up) {
   m_viewMatrix = glm::lookAt(position, position + direction, up);
+  m_position = position;
 }
 
 void Camera::SetViewTarget(glm::vec3 position, glm::vec3 target, glm::vec3 up) {
@@ -29,6 +30,7 @@ void Camera::SetViewYXZ(glm::vec3 position, glm::vec3 rotation) {
   glm::mat4 translationMatrix = glm::translate(glm::mat4(1.0f), -position);
 
   m_viewMatrix = rotationMatrix * translationMatrix;
+  m_position = position;
 }
 
 } // namespace bloom
@@ -29,10 +29,12 @@ public:
 
   const glm::mat4& GetProjection() const { return m_projectionMatrix; }
   const glm::mat4& GetView() const { return m_viewMatrix; }
+  const glm::vec3& GetPosition() const { return m_position; }
     
 private:
   glm::mat4 m_projectionMatrix = glm::mat4(1.0f);
   glm::mat4 m_viewMatrix = glm::mat4(1.0f);
+  glm::vec3 m_position = glm::vec3(0.0f);
 };
 
 }
@@ -15,12 +15,24 @@
     #define BLOOM_API __declspec(dllimport)
   #endif
 
+  #define BLOOM_DEBUGBREAK() __debugbreak()
+
+#elif defined(BLOOM_PLATFORM_LINUX)
+  // Only meant for headless runs on CI, the window path is still only tested on Windows
+  #define BLOOM_API __attribute__((visibility("default")))
+  #include <csignal>
+  #define BLOOM_DEBUGBREAK() std::raise(SIGTRAP)
+
 #else
-  #error Bloom only supports windows!
+  #error Bloom only supports Windows and Linux!
 #endif
 
 #define BIT(x) (1 << x)
 
+#define BLOOM_CONCAT_IMPL(a, b) a##b
+/// Pastes two tokens after expanding them, used to make unique names with __LINE__
+#define BLOOM_CONCAT(a, b) BLOOM_CONCAT_IMPL(a, b)
+
 enum megabool {
   FALSE, TRUE, NEITHER, BOTH,
   MAYBE, TRUEISH, FALSEISH,
@@ -1,6 +1,7 @@
 #include "engine.hpp"
 #include "render/model.hpp"
 #include "render/texture.hpp"
+#include "render/frame_info.hpp"
 #include "glm/gtc/constants.hpp"
 
 namespace bloom {
@@ -8,19 +9,50 @@ namespace bloom {
 #pragma region Game Loop
 
 void Engine::Begin() {
-  glfwInit();
-	Log::Init();
-
-  m_window = new Window(800, 800, "Bloom");
-  m_window->SetEventCallback(std::bind(&Engine::OnEvent, this, std::placeholders::_1));
-  m_window->OnInit();
+	Log::Init(m_logSettings);
+  BLOOM_PROFILE_THREAD("Main");
+  BLOOM_PROFILE_FUNCTION();
 
   factory = std::make_unique<Factory>();
 
-  m_devices = std::make_unique<render::Devices>(*m_window);
-  m_renderer = std::make_unique<render::Renderer>(m_window, m_devices.get());
+  if (m_headless) {
+    BLOOM_INFO("Running headless");
+    m_devices = std::make_unique<render::Devices>(m_preferredDevice);
+    m_renderer = std::make_unique<render::Renderer>(m_devices.get(), m_headlessSettings);
+  } else {
+    // Only windows need GLFW, headless runs go without it so they work on machines without a display
+    if (glfwInit() != GLFW_TRUE) {
+      BLOOM_CRITICAL("Failed to initialize GLFW");
+    }
+    m_window = new Window(800, 800, "Bloom");
+    m_window->SetEventQueue(&m_events);
+    m_window->OnInit();
+
+    m_devices = std::make_unique<render::Devices>(*m_window);
+    m_renderer = std::make_unique<render::Renderer>(m_window, m_devices.get());
+  }
+  // Which path is set decides the mode, a failed playback must not turn into a recording or a run with live input
+  if (!m_inputPlaybackPath.empty()) {
+    if (!m_inputRecordingPath.empty()) {
+      BLOOM_WARN("Both an input recording and a playback were requested, only playing back {0}", m_inputPlaybackPath);
+    }
+    if (!m_inputRecorder.StartPlayback(m_inputPlaybackPath)) {
+      BLOOM_ERROR("Could not start the input playback of {0}", m_inputPlaybackPath);
+      std::abort();
+    }
+    if (m_window) m_window->SetInputEnabled(false);
+  } else if (!m_inputRecordingPath.empty()) {
+    m_inputRecorder.StartRecording(m_inputRecordingPath);
+  }
+  m_geometryPool = std::make_unique<render::GeometryPool>(m_devices.get(), m_geometryPoolSettings);
+  m_geometryPool->SetRenderer(m_renderer.get());
+  m_meshImporter = std::make_unique<render::MeshImporter>(m_devices.get(), m_meshImporterSettings);
+  m_meshImporter->SetGeometryPool(m_geometryPool.get());
+  m_startTime = FrameLimiter::Clock::now();
   LoadObjects();
-  m_simpleRenderSystem = new SimpleRenderSystem(m_devices.get());
+  CreateGlobalDescriptors();
+  m_simpleRenderSystem = std::make_unique<SimpleRenderSystem>(m_devices.get(),
+                                                              m_globalSetLayout->getDescriptorSetLayout());
   m_simpleRenderSystem->Begin(m_renderer->GetRenderPass());
 
   m_camera = Camera();
@@ -28,12 +60,55 @@ void Engine::Begin() {
 }
 
 void Engine::Tick() {
+  BLOOM_PROFILE_FRAME(m_renderer->GetFrameNumber() + 1);
+  BLOOM_PROFILE_FUNCTION();
+
+  // Only rebuild the projection when the swap chain changed size
   float aspect = m_renderer->GetAspectRatio();
-  m_camera.SetPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 100.0f);
+  if (aspect != m_aspectRatio) {
+    m_aspectRatio = aspect;
+    m_camera.SetPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 100.0f);
+  }
 
-  m_deltaTime = m_window->GetDeltaTime();
-  m_window->OnTick();
-  BLOOM_LOG("{0}FPS", 1/m_deltaTime);
+  {
+    BLOOM_PROFILE_SCOPE("Frame limiter");
+    m_frameLimiter.Wait();
+  }
+  if (m_lowLatency) {
+    BLOOM_PROFILE_SCOPE("Wait for last frame");
+    m_renderer->WaitForLastFrame();
+  }
+  TrackInputLatency();
+
+  m_events.Clear();
+  if (m_headless) {
+    // Fixed step so the rendered frames, and their checksum, don't depend on how fast the machine is
+    m_deltaTime = 1.0 / 60.0;
+  } else {
+    m_deltaTime = m_window->GetDeltaTime();
+    m_window->OnTick();
+  }
+  if (m_inputRecorder.GetMode() == InputRecorder::Mode::Playback) {
+    // The recording decides what happens each frame, the delta time can't depend on the machine either
+    m_deltaTime = m_playbackDeltaTime;
+    m_inputRecorder.Playback(m_events);
+  } else {
+    m_inputRecorder.Record(m_events);
+  }
+  // Only take what fits, the rest stays on the bus for the next frame instead of being dropped
+  m_eventBus.Drain([this](const auto& event) { m_events.Push(event); }, m_events.Capacity() - m_events.Size());
+  DispatchEvents();
+  m_input.Update(m_events);
+  m_time += m_deltaTime;
+  m_inputTime = FrameLimiter::Clock::now();
+
+  if (auto profiler = m_renderer->GetGpuProfiler(); profiler && profiler->GetCollectedFrames() != m_gpuFramesSeen) {
+    m_gpuFramesSeen = profiler->GetCollectedFrames();
+    m_frameStatistics.AddSample(FrameStatistics::Series::GpuFrame, profiler->GetLastFrameTime());
+  }
+  if (m_frameStatistics.Update(m_deltaTime)) {
+    Report();
+  }
 
   m_rotation += m_deltaTime * 0.1f;
   if (m_rotation > .7f) m_rotation = -.7f;
@@ -41,30 +116,178 @@ void Engine::Tick() {
 }
 
 void Engine::Render() {
+  BLOOM_PROFILE_FUNCTION();
+  // Recreates the target at the start of the frame when occlusion culling is toggled
+  m_renderer->SetSampledDepth(m_simpleRenderSystem->NeedsSampledDepth());
   if (auto commandBuffer = m_renderer->BeginFrame()) {
-    m_renderer->BeginRenderPass(commandBuffer);
-    m_simpleRenderSystem->RenderObjects(commandBuffer, gameObjects, m_camera);
-    m_renderer->EndRenderPass(commandBuffer);
+    int frameIndex = m_renderer->GetFrameIndex();
+    render::FrameInfo frameInfo{
+      frameIndex,
+      static_cast<float>(m_deltaTime),
+      commandBuffer,
+      m_camera,
+      m_globalDescriptorSets[frameIndex],
+      m_renderer->GetGpuProfiler(),
+      m_renderer->GetPipelineStatistics(),
+      m_renderer->GetExtent()
+    };
+
+    render::GlobalUbo ubo{};
+    ubo.projection = m_camera.GetProjection();
+    ubo.view = m_camera.GetView();
+    ubo.projectionView = ubo.projection * ubo.view;
+    ubo.cameraPosition = glm::vec4(m_camera.GetPosition(), 1.0f);
+    ubo.time = static_cast<float>(m_time);
+    m_uboBuffers[frameIndex]->WriteToBuffer(&ubo);
+
+    // Culling dispatches can't be recorded inside the render pass
+    m_simpleRenderSystem->Prepare(frameInfo, gameObjects, m_renderer->HasSampledDepth());
+    {
+      // Has to close before EndFrame ends the command buffer
+      BLOOM_GPU_SCOPE(frameInfo.gpuProfiler, commandBuffer, "Main pass");
+      m_renderer->BeginRenderPass(commandBuffer);
+      m_simpleRenderSystem->RenderObjects(frameInfo, gameObjects);
+      m_renderer->EndRenderPass(commandBuffer);
+    }
+    if (m_simpleRenderSystem->HasLatePass()) {
+      // Occlusion culling needs the depth of the main pass, which can only be read with the render pass closed
+      m_simpleRenderSystem->CullOccluded(frameInfo, m_renderer->GetDepthAttachment());
+      BLOOM_GPU_SCOPE(frameInfo.gpuProfiler, commandBuffer, "Late pass");
+      m_renderer->ResumeRenderPass(commandBuffer);
+      m_simpleRenderSystem->RenderLateObjects(frameInfo);
+      m_renderer->EndRenderPass(commandBuffer);
+    }
     m_renderer->EndFrame();
+    m_pendingInputs.emplace_back(m_renderer->GetFrameNumber(), m_inputTime);
+
+    auto now = FrameLimiter::Clock::now();
+    m_frameStatistics.AddSample(FrameStatistics::Series::CpuFrame,
+                                std::chrono::duration<double, std::milli>(now - m_inputTime).count());
+    if (m_lastPresent != FrameLimiter::Clock::time_point{}) {
+      m_frameStatistics.AddSample(FrameStatistics::Series::PresentInterval,
+                                  std::chrono::duration<double, std::milli>(now - m_lastPresent).count());
+    }
+    m_lastPresent = now;
+  }
+}
+
+void Engine::Report() const {
+  // Info so the summary survives release builds, the breakdowns below are for debugging
+  BLOOM_INFO("{0}, input latency {1:.2f}ms, {2}", m_frameStatistics.FormatSummary(), m_inputLatency * 1000.0,
+             render::SwapChain::PresentModeName(m_renderer->GetPresentMode()));
+  if (auto profiler = m_renderer->GetGpuProfiler()) {
+    for (const auto& scope : profiler->GetLastFrame()) {
+      BLOOM_LOG("  GPU {0:>{1}}{2}: {3:.3f}ms (avg {4:.3f}ms)", "", scope.depth * 2, scope.name,
+                scope.milliseconds, profiler->GetAverage(scope.name));
+    }
+  }
+  if (auto statistics = m_renderer->GetPipelineStatistics()) {
+    for (const auto& scope : statistics->GetLastFrame()) {
+      const auto& counts = scope.counts;
+      BLOOM_LOG("  {0}: {1} vertices, {2} VS, {3}/{4} primitives clipped in/out, {5} FS, {6} samples",
+                scope.name, counts.inputVertices, counts.vertexInvocations, counts.clippingInvocations,
+                counts.clippingPrimitives, counts.fragmentInvocations, counts.samplesPassed);
+    }
+  }
+}
+
+void Engine::TrackInputLatency() {
+  if (m_pendingInputs.empty()) return;
+
+  auto now = FrameLimiter::Clock::now();
+  uint64_t completed = m_renderer->GetCompletedFrameNumber();
+  while (!m_pendingInputs.empty() && m_pendingInputs.front().first <= completed) {
+    m_inputLatency = std::chrono::duration<double>(now - m_pendingInputs.front().second).count();
+    m_pendingInputs.pop_front();
   }
 }
 
 void Engine::End() const {
   vkDeviceWaitIdle(m_devices->device());
+  if (m_headless) {
+    ReportHeadlessRun();
+  }
+  m_meshImporter->LogLoadStatistics();
+  if (!m_traceOutput.empty()) {
+    Profiler::WriteChromeTrace(m_traceOutput);
+  }
   delete m_window;
 }
 
+void Engine::SetHeadless(const render::OffscreenTarget::Settings& settings, uint64_t frameCount,
+                         const std::string& preferredDevice) {
+  if (m_devices != nullptr) {
+    BLOOM_WARN("SetHeadless must be called before Begin");
+    return;
+  }
+  m_headless = true;
+  m_headlessSettings = settings;
+  m_headlessFrames = frameCount;
+  m_preferredDevice = preferredDevice;
+}
+
+void Engine::SetInputRecording(const std::string& path) {
+  if (m_devices != nullptr) {
+    BLOOM_WARN("SetInputRecording must be called before Begin");
+    return;
+  }
+  m_inputRecordingPath = path;
+}
+
+void Engine::SetInputPlayback(const std::string& path, double fixedDeltaTime) {
+  if (m_devices != nullptr) {
+    BLOOM_WARN("SetInputPlayback must be called before Begin");
+    return;
+  }
+  m_inputPlaybackPath = path;
+  m_playbackDeltaTime = fixedDeltaTime;
+}
+
+void Engine::ReportHeadlessRun() const {
+  auto offscreen = m_renderer->GetOffscreenTarget();
+  uint64_t frames = m_renderer->GetFrameNumber();
+  if (offscreen == nullptr || frames == 0) return;
+
+  double seconds = std::chrono::duration<double>(FrameLimiter::Clock::now() - m_startTime).count();
+  BLOOM_INFO("Headless run: {0} frames in {1:.2f}s, {2:.3f}ms per frame", frames, seconds, seconds * 1000.0 / frames);
+  BLOOM_INFO("Last {0} frames: {1}", m_frameStatistics.GetSummary(FrameStatistics::Series::CpuFrame).samples,
+             m_frameStatistics.FormatSummary());
+
+  // FNV-1a, enough to spot a frame that stopped matching the reference
+  auto pixels = offscreen->ReadPixels(offscreen->GetLastImageIndex());
+  uint64_t hash = 14695981039346656037ull;
+  for (uint8_t byte : pixels) {
+    hash = (hash ^ byte) * 1099511628211ull;
+  }
+  BLOOM_INFO("Last frame checksum: {0:016x}", hash);
+}
+
 #pragma endregion // -------------------------------------------------------------------------------------------------
 
-void Engine::OnEvent(const Event &e) const {
-  BLOOM_INFO("{0}", e.ToString());
+void Engine::DispatchEvents() {
+  m_events.Dispatch(EventHandlers{
+    [this](const WindowCloseEvent&) { if (m_window) m_window->CloseWindow(); },
+    [this](const KeyPressedEvent& event) { OnKeyPressed(event); },
+    // Coalesced, but still one per frame, keep them out of the log
+    [](const MouseMovedEvent&) {},
+    [](const auto& event) { BLOOM_LOG("{0}", event.ToString()); }
+  });
+}
+
+void Engine::OnKeyPressed(const KeyPressedEvent& event) {
+  BLOOM_LOG("{0}", event.ToString());
+  if (event.GetRepeatCount() != 0) return;
 
-  if (e.GetEventType() == EventType::WindowClose) {
-    m_window->CloseWindow();
+  // F12 takes a screenshot, encoded off the render thread, F11 dumps the CPU trace
+  if (event.GetKeyCode() == GLFW_KEY_F12) {
+    m_renderer->GetFrameCapture().CaptureFrame(fmt::format("screenshot_{0}.png", m_renderer->GetFrameNumber() + 1));
+  }
+  if (event.GetKeyCode() == GLFW_KEY_F11) {
+    Profiler::WriteChromeTrace(fmt::format("trace_{0}.json", m_renderer->GetFrameNumber()));
   }
 }
 
-std::unique_ptr<render::Model> createCubeModel(render::Devices* device, glm::vec3 offset) {
+std::unique_ptr<render::Model> createCubeModel(render::Devices* device, render::GeometryPool* pool, glm::vec3 offset) {
   std::vector<render::Model::Vertex> vertices = {
       {{-.5f, -.5f, -.5f}, {0.0f, 0.0f}, {.9f, .9f, .9f, 1.0f}},
       {{-.5f, .5f, .5f}, {1.0f, 1.0f}, {0.9f, 0.9f, 0.9f, 1.0f}},
@@ -117,11 +340,49 @@ std::unique_ptr<render::Model> createCubeModel(render::Devices* device, glm::vec
   for (auto& v : vertices) {
     v.position += offset;
   }
-  return std::make_unique<render::Model>(device, vertices);
+  // Merges the 36 corners into 24 unique vertices and gives the cube an index buffer
+  render::MeshData mesh{std::move(vertices), {}};
+  auto statistics = render::MeshOptimizer::Optimize(mesh);
+  BLOOM_LOG("Cube model: {0}", render::MeshOptimizer::FormatStatistics(statistics));
+  return std::make_unique<render::Model>(pool, device, mesh);
+}
+
+void Engine::CreateGlobalDescriptors() {
+  constexpr auto frameCount = static_cast<uint32_t>(render::SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+  m_globalPool = std::make_unique<render::DescriptorPool>(m_devices.get(), frameCount,
+      std::vector<VkDescriptorPoolSize>{{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount}});
+  m_globalSetLayout = std::make_unique<render::DescriptorSetLayout>(m_devices.get(), std::vector<VkDescriptorSetLayoutBinding>{
+          {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr}
+      });
+
+  m_uboBuffers.resize(frameCount);
+  m_globalDescriptorSets.resize(frameCount);
+  for (uint32_t i = 0; i < frameCount; i++) {
+    // Host coherent and mapped for the whole lifetime, we write it once per frame
+    m_uboBuffers[i] = std::make_unique<render::Buffer>(m_devices.get(), sizeof(render::GlobalUbo), 1,
+        VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_uboBuffers[i]->Map();
+
+    if (!m_globalPool->allocateDescriptorSet(m_globalSetLayout->getDescriptorSetLayout(), m_globalDescriptorSets[i])) {
+      BLOOM_CRITICAL("Failed to allocate global descriptor set");
+    }
+
+    auto bufferInfo = m_uboBuffers[i]->DescriptorInfo();
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_globalDescriptorSets[i];
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(m_devices->device(), 1, &descriptorWrite, 0, nullptr);
+  }
 }
 
 void Engine::LoadObjects() {
-  std::shared_ptr<render::Model> model = createCubeModel(m_devices.get(), {0.0f, 0.0f, 0.0f});
+  std::shared_ptr<render::Model> model = createCubeModel(m_devices.get(), m_geometryPool.get(), {0.0f, 0.0f, 0.0f});
 
   auto cube = factory->CreateObject<Object>();
   cube.model = model;
@@ -14,9 +14,21 @@
 #include "object.hpp"
 #include "render/devices.hpp"
 #include "render/renderer.hpp"
+#include "render/buffer.hpp"
+#include "render/descriptor_pool.hpp"
+#include "render/descriptor_set_layout.hpp"
+#include "render/mesh_importer.hpp"
+#include "render/geometry_pool.hpp"
 #include "simple_render_system.hpp"
 #include "camera.hpp"
+#include "frame_limiter.hpp"
+#include "profiler.hpp"
+#include "frame_statistics.hpp"
+#include "input.hpp"
+#include "input_recorder.hpp"
+#include "events/event_bus.hpp"
 #include <bloom_header.hpp>
+#include <deque>
 
 namespace bloom {
 
@@ -25,6 +37,7 @@ class Factory;
 class BLOOM_API Engine {
 public:
   Engine() = default;
+  virtual ~Engine() = default;
 
   Engine(const Engine&) = delete;
   Engine& operator=(const Engine&) = delete;
@@ -35,25 +48,201 @@ public:
   void Render();
   void End() const;
 
-  bool ShouldClose() const { return m_window->ShouldClose(); }
-  void OnEvent(const Event & e) const;
+  bool ShouldClose() const {
+    // Without a frame count only a playback can end a headless run, with none there is nothing to run
+    if (m_headless && m_headlessFrames == 0) {
+      return m_inputRecorder.GetMode() != InputRecorder::Mode::Playback || m_inputRecorder.IsPlaybackFinished();
+    }
+    if (m_headless) return m_renderer->GetFrameNumber() >= m_headlessFrames;
+    return m_window->ShouldClose();
+  }
+  /**
+   * @brief Events the window queued this frame, games can dispatch them with their own @c EventHandlers
+   *
+   * Valid from @c Tick() until the next one, the queue is cleared right before polling
+   */
+  const EventQueue& GetEvents() const { return m_events; }
+  /**
+   * @brief Keyboard and mouse state of this frame, prefer it over events on gameplay code
+   *
+   * Other threads should take a copy through @c Input::GetSnapshot()
+   */
+  const InputSnapshot& GetInput() const { return m_input.Current(); }
+  /**
+   * @brief Bus worker threads post to, drained at the start of every @c Tick() into @c GetEvents()
+   */
+  EventBus& GetEventBus() { return m_eventBus; }
+  const Input& GetInputSystem() const { return m_input; }
+
+  /**
+   * @brief Runs without a window, rendering into offscreen images. Must be called before @c Begin()
+   *
+   * Meant for benchmarks on machines without a display. At the end the last frame is read back and its checksum
+   * logged so runs can be compared.
+   * @param settings Size and count of the offscreen images
+   * @param frameCount Frames to render before @c ShouldClose() returns true. 0 runs until the input playback ends,
+   *                   without one the run ends right away
+   * @param preferredDevice Substring of the device name to use, e.g. "llvmpipe" for lavapipe
+   */
+  void SetHeadless(const render::OffscreenTarget::Settings& settings, uint64_t frameCount = 0,
+                   const std::string& preferredDevice = "");
+  bool IsHeadless() const { return m_headless; }
+
+  /**
+   * @brief Records every input event to @c path from the first frame on. Must be called before @c Begin()
+   */
+  void SetInputRecording(const std::string& path);
+  /**
+   * @brief Replays a recording instead of the real input, at a fixed delta time. Must be called before @c Begin()
+   *
+   * Headless runs with a frame count of 0 stop when the recording ends. Takes precedence over
+   * @c SetInputRecording(), and @c Begin() aborts if the recording can't be played back.
+   */
+  void SetInputPlayback(const std::string& path, double fixedDeltaTime = 1.0 / 60.0);
+
+  /**
+   * @brief Caps the frame rate on the CPU, independent of the present mode
+   * @param framesPerSecond Target frame rate, 0 removes the cap
+   */
+  void SetFrameRateLimit(double framesPerSecond) { m_frameLimiter.SetTargetFrameRate(framesPerSecond); }
+  /**
+   * @brief Waits for the GPU to finish the previous frame before sampling input
+   *
+   * Trades throughput for latency, the CPU no longer records frames ahead of the GPU
+   */
+  void SetLowLatency(bool enabled) { m_lowLatency = enabled; }
+  bool GetLowLatency() const { return m_lowLatency; }
+
+  /// Achieved frame time in seconds
+  double GetFrameTime() const { return m_frameLimiter.GetFrameTime(); }
+  /**
+   * @brief Time from sampling input to the GPU finishing the frame that used it, in seconds
+   *
+   * Measured when the completion is observed at the start of a frame, so without low latency mode it can overshoot
+   * by up to a frame. Scan out adds up to one refresh on top depending on the present mode.
+   */
+  double GetInputLatency() const { return m_inputLatency; }
+
+  /**
+   * @brief Rolling CPU, GPU and present statistics, a summary is logged every report interval
+   */
+  FrameStatistics& GetFrameStatistics() { return m_frameStatistics; }
+
+  /**
+   * @brief Writes the CPU profiler trace to @c path when the engine ends, empty disables it
+   *
+   * F11 writes one on demand at any time
+   */
+  void SetTraceOutput(const std::string& path) { m_traceOutput = path; }
+
+  /**
+   * @brief Importer for OBJ and glTF meshes, available from @c Begin() on
+   */
+  render::MeshImporter& GetMeshImporter() { return *m_meshImporter; }
+  /**
+   * @brief Cache and threading options of the mesh importer, must be called before @c Begin()
+   */
+  void SetMeshImporterSettings(const render::MeshImporter::Settings& settings) { m_meshImporterSettings = settings; }
+
+  /**
+   * @brief Render system drawing the scene objects, available from @c Begin() on
+   */
+  SimpleRenderSystem& GetRenderSystem() { return *m_simpleRenderSystem; }
+
+  /**
+   * @brief Shared vertex and index buffers the static meshes of the scene live in, available from @c Begin() on
+   */
+  render::GeometryPool& GetGeometryPool() { return *m_geometryPool; }
+  /**
+   * @brief Capacities of the geometry pool, must be called before @c Begin()
+   */
+  void SetGeometryPoolSettings(const render::GeometryPool::Settings& settings) { m_geometryPoolSettings = settings; }
+
+  /**
+   * @brief Configures the logging backend, must be called before @c Begin()
+   */
+  void SetLogSettings(const Log::Settings& settings) { m_logSettings = settings; }
 
   std::unique_ptr<Factory> factory = nullptr;
 
 protected:
-  void LoadObjects();
+  /**
+   * @brief Fills the scene, called from @c Begin() once the devices and the geometry pool exist
+   */
+  virtual void LoadObjects();
+  /**
+   * @brief Handles the events of this frame that concern the engine, called from @c Tick() after polling
+   */
+  void DispatchEvents();
+  void OnKeyPressed(const KeyPressedEvent& event);
+  /**
+   * @brief Creates the per frame in flight @c GlobalUbo buffers and the set 0 descriptors pointing at them
+   */
+  void CreateGlobalDescriptors();
+  /**
+   * @brief Updates the input latency with the frames the GPU finished since the last call
+   */
+  void TrackInputLatency();
+  /**
+   * @brief Logs the frame statistics summary and the GPU and pipeline statistics breakdowns
+   */
+  void Report() const;
+
+  /**
+   * @brief Reads back the last offscreen frame and logs the run timings and a checksum of the pixels
+   */
+  void ReportHeadlessRun() const;
 
   Window* m_window = nullptr;
+  EventQueue m_events;
+  EventBus m_eventBus;
+  Input m_input;
+  InputRecorder m_inputRecorder;
+  std::string m_inputRecordingPath;
+  std::string m_inputPlaybackPath;
+  double m_playbackDeltaTime = 1.0 / 60.0;
+  bool m_headless = false;
+  render::OffscreenTarget::Settings m_headlessSettings{};
+  uint64_t m_headlessFrames = 0;
+  std::string m_preferredDevice;
+  FrameLimiter::Clock::time_point m_startTime{};
   std::unique_ptr<render::Devices> m_devices = nullptr;
+  // Declared before the objects and the renderer, so it outlives the models allocated from it and the frees it
+  // deferred, which the renderer runs when it's destroyed
+  std::unique_ptr<render::GeometryPool> m_geometryPool = nullptr;
+  render::GeometryPool::Settings m_geometryPoolSettings{};
   std::unique_ptr<render::Renderer> m_renderer = nullptr;
-  SimpleRenderSystem* m_simpleRenderSystem = nullptr;
+  std::unique_ptr<render::MeshImporter> m_meshImporter = nullptr;
+  render::MeshImporter::Settings m_meshImporterSettings{};
+  // Declared after the devices and the geometry pool, so its pipelines and GPU scene are released before them
+  std::unique_ptr<SimpleRenderSystem> m_simpleRenderSystem = nullptr;
+
+  std::unique_ptr<render::DescriptorPool> m_globalPool = nullptr;
+  std::unique_ptr<render::DescriptorSetLayout> m_globalSetLayout = nullptr;
+  std::vector<std::unique_ptr<render::Buffer>> m_uboBuffers;
+  std::vector<VkDescriptorSet> m_globalDescriptorSets;
 
   std::vector<Object> gameObjects;
 
   Camera m_camera;
 
   double m_deltaTime;
+  double m_time = 0.0;
+  float m_aspectRatio = 0.0f;
   float m_rotation;
+
+  FrameLimiter m_frameLimiter;
+  bool m_lowLatency = false;
+  FrameLimiter::Clock::time_point m_inputTime{};
+  /// Frame number and input time of the frames the GPU hasn't finished yet
+  std::deque<std::pair<uint64_t, FrameLimiter::Clock::time_point>> m_pendingInputs;
+  double m_inputLatency = 0.0;
+
+  FrameStatistics m_frameStatistics;
+  FrameLimiter::Clock::time_point m_lastPresent{};
+  uint64_t m_gpuFramesSeen = 0;
+  std::string m_traceOutput;
+  Log::Settings m_logSettings{};
 };
 
 /**
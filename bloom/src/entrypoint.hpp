@@ -10,16 +10,52 @@
 #include "engine.hpp"
 #include "log.hpp"
 #include <spdlog/spdlog.h>
+#include <charconv>
+#include <iostream>
 
-#define GLFW_INCLUDE_VULKAN
-#include <GLFW/glfw3.h>
-
-#ifdef BLOOM_PLATFORM_WINDOWS
+#if defined(BLOOM_PLATFORM_WINDOWS) || defined(BLOOM_PLATFORM_LINUX)
 
 int main(int argc, char** argv) {
   const auto _engine = bloom::CreateEngine();
 
-  glfwInit();
+  // --record <file> and --replay <file> go anywhere, the rest are positional
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--record" && i + 1 < argc) {
+      _engine->SetInputRecording(argv[++i]);
+    } else if (arg == "--replay" && i + 1 < argc) {
+      _engine->SetInputPlayback(argv[++i]);
+    } else {
+      args.push_back(arg);
+    }
+  }
+
+  // --headless [frames] [width]x[height] [device], used to benchmark without a display
+  if (!args.empty() && args[0] == "--headless") {
+    bloom::render::OffscreenTarget::Settings settings{};
+    uint64_t frames = 1000;
+    auto parse = [](std::string_view text, auto& value) {
+      auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+      return error == std::errc() && end == text.data() + text.size();
+    };
+    bool valid = args.size() < 2 || parse(args[1], frames);
+    if (valid && args.size() > 2) {
+      const std::string_view size = args[2];
+      const auto separator = size.find('x');
+      valid = separator != std::string_view::npos && parse(size.substr(0, separator), settings.extent.width) &&
+              parse(size.substr(separator + 1), settings.extent.height) && settings.extent.width > 0 &&
+              settings.extent.height > 0;
+    }
+    // The logger isn't up until Begin
+    if (!valid) {
+      std::cerr << "Usage: " << argv[0] << " [--record <file>] [--replay <file>]"
+                << " [--headless [frames] [width]x[height] [device]]" << std::endl;
+      return 1;
+    }
+    _engine->SetHeadless(settings, frames, args.size() > 3 ? args[3] : "");
+  }
+
   _engine->Begin();
 
   while (!_engine->ShouldClose()) {
@@ -28,6 +64,7 @@ int main(int argc, char** argv) {
   }
 
   _engine->End();
+  bloom::Log::Shutdown();
 }
 
 #endif
\ No newline at end of file
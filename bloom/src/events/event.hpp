@@ -30,6 +30,7 @@ enum class EventType {
   None = 0,
   WindowClose, WindowResize, WindowFocus, WindowLostFocus, WindowMoved,
   GameTick, GameUpdate, GameRender,
+  AssetLoaded, JobFinished, GameCustom,
   KeyPressed, KeyReleased,
   MouseButtonPressed, MouseButtonReleased, MouseMoved, MouseScrolled
 };
@@ -149,9 +150,6 @@ protected:
  * events are only handled by functions designed for their specific type.
  */
 class EventDispatcher {
-  template<typename T>
-  using EventFn = std::function<bool(T&)>; /**< Type alias for an event handler function. */
-
 public:
   /**
    * @brief Constructs an @c EventDispatcher for a given event.
@@ -167,11 +165,11 @@ public:
    * If they match, the handler function is called, and the event is marked as handled.
    *
    * @tparam T The type of event to handle.
-   * @param func The handler function to invoke.
+   * @param func The handler function to invoke, any callable taking a @c T& and returning @c bool.
    * @return @c true if the event was handled; otherwise, @c false.
    */
-  template<typename T>
-  bool Dispatch(EventFn<T> func) {
+  template<typename T, typename F>
+  bool Dispatch(const F& func) {
     if (_event.GetEventType() == T::GetStaticType()) {
       _event._handled = func(*static_cast<T*>(&_event));
       return true;
@@ -0,0 +1,73 @@
+/**
+ * @file event_bus.hpp
+ *
+ * @brief Cross thread events posted by workers and drained by the main loop
+ */
+
+#pragma once
+#include "game_event.hpp"
+#include "mpmc_queue.hpp"
+#include <bloom_header.hpp>
+#include <limits>
+#include <variant>
+
+namespace bloom {
+
+/**
+ * @brief Events any thread can post to the @c EventBus, @c std::monostate only stands for an empty slot
+ */
+using BusEvent = std::variant<std::monostate, AssetLoadedEvent, JobFinishedEvent, GameCustomEvent>;
+
+/**
+ * @class EventBus
+ * @brief Bounded lock-free bus, any number of threads post and the main loop drains in batches
+ *
+ * Posting never blocks, when the bus is full the event is dropped and counted, so size it for the worst burst the
+ * workers can produce in a frame. The engine drains it once per @c Tick into the frame @c EventQueue, games see the
+ * events next to the input ones.
+ */
+class EventBus {
+public:
+  explicit EventBus(size_t capacity = 4096) : m_queue(capacity) {}
+
+  /**
+   * @brief Posts an event from any thread
+   * @return False if the bus was full and the event got dropped
+   */
+  template<typename T>
+  bool Post(T&& event) {
+    if (m_queue.TryPush(BusEvent(std::forward<T>(event)))) return true;
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  /**
+   * @brief Pops up to @c maxEvents events and hands each one to @c handler
+   * @param handler Callable with an overload for each event type, see @c EventHandlers
+   * @return Events drained
+   */
+  template<typename Handler>
+  size_t Drain(Handler&& handler, size_t maxEvents = std::numeric_limits<size_t>::max()) {
+    BusEvent event;
+    size_t count = 0;
+    while (count < maxEvents && m_queue.TryPop(event)) {
+      std::visit([&handler](const auto& posted) {
+        if constexpr (!std::is_same_v<std::decay_t<decltype(posted)>, std::monostate>) {
+          handler(posted);
+        }
+      }, event);
+      count++;
+    }
+    return count;
+  }
+
+  size_t Capacity() const { return m_queue.Capacity(); }
+  /// Events lost because the bus was full since it was created
+  uint64_t GetDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+  MpmcQueue<BusEvent> m_queue;
+  std::atomic<uint64_t> m_dropped{0};
+};
+
+}
@@ -0,0 +1,142 @@
+/**
+ * @file event_queue.hpp
+ *
+ * @brief Per frame queue of window and input events
+ *
+ * The window pushes events while GLFW polls and the engine dispatches them once per @c Tick. Events are stored by
+ * value in a tagged union inside a buffer allocated once, and dispatching visits them with an overload set chosen at
+ * compile time, so there are no allocations and no virtual calls per event.
+ */
+
+#pragma once
+#include "event.hpp"
+#include "game_event.hpp"
+#include "key_event.hpp"
+#include "mouse_event.hpp"
+#include <bloom_header.hpp>
+#include <variant>
+
+namespace bloom {
+
+/**
+ * @brief Every event the frame can queue, the index of the variant is the tag
+ *
+ * Window and input events come from polling, the rest are forwarded from the @c EventBus
+ */
+using QueuedEvent = std::variant<WindowCloseEvent, WindowResizeEvent,
+                                 KeyPressedEvent, KeyReleasedEvent,
+                                 MouseButtonPressedEvent, MouseButtonReleasedEvent,
+                                 MouseMovedEvent, MouseScrolledEvent,
+                                 AssetLoadedEvent, JobFinishedEvent, GameCustomEvent>;
+
+/**
+ * @struct EventHandlers
+ * @brief Builds an overload set out of lambdas to pass to @c EventQueue::Dispatch()
+ *
+ * @code
+ * queue.Dispatch(EventHandlers{
+ *   [](const KeyPressedEvent& e) { ... },
+ *   [](const auto&) {} // Everything else
+ * });
+ * @endcode
+ */
+template<typename... Handlers>
+struct EventHandlers : Handlers... {
+  using Handlers::operator()...;
+};
+template<typename... Handlers>
+EventHandlers(Handlers...) -> EventHandlers<Handlers...>;
+
+/**
+ * @class EventQueue
+ * @brief Fixed capacity queue of events for one frame
+ *
+ * High rate events can be coalesced with the event right before them when it has the same type: mouse moves keep
+ * the newest position, scrolls add up and resizes keep the newest size. Only the tail is merged, so a move, a click
+ * and another move still arrive in that order.
+ */
+class EventQueue {
+public:
+  /**
+   * @param capacity Events kept per frame, once full new events are dropped
+   */
+  explicit EventQueue(size_t capacity = 1024) : m_events(capacity) {
+    SetCoalescing(EventType::MouseMoved, true);
+    SetCoalescing(EventType::MouseScrolled, true);
+    SetCoalescing(EventType::WindowResize, true);
+  }
+
+  template<typename T>
+  void Push(const T& event) {
+    if (m_count > 0 && IsCoalescing(T::GetStaticType())) {
+      if (auto last = std::get_if<T>(&m_events[m_count - 1]); last != nullptr && Coalesce(*last, event)) {
+        m_coalesced++;
+        return;
+      }
+    }
+    if (m_count == m_events.size()) {
+      m_dropped++;
+      return;
+    }
+    m_events[m_count++] = event;
+  }
+
+  /**
+   * @brief Calls @c handler with every queued event, in the order they were pushed
+   * @param handler Callable with an overload for each event type, see @c EventHandlers
+   */
+  template<typename Handler>
+  void Dispatch(Handler&& handler) const {
+    for (size_t i = 0; i < m_count; i++) {
+      std::visit(handler, m_events[i]);
+    }
+  }
+
+  /// Forgets the events of the last frame, the buffer is kept
+  void Clear() {
+    m_count = 0;
+  }
+
+  /**
+   * @brief Enables merging consecutive events of a type, only mouse moves, scrolls and resizes support it
+   */
+  void SetCoalescing(EventType type, bool enabled) {
+    if (enabled) m_coalescing |= BIT(static_cast<uint32_t>(type));
+    else m_coalescing &= ~BIT(static_cast<uint32_t>(type));
+  }
+  bool IsCoalescing(EventType type) const { return m_coalescing & BIT(static_cast<uint32_t>(type)); }
+
+  size_t Size() const { return m_count; }
+  size_t Capacity() const { return m_events.size(); }
+  bool Empty() const { return m_count == 0; }
+  /// Events merged into the previous one since the queue was created
+  uint64_t GetCoalescedCount() const { return m_coalesced; }
+  /// Events lost because the queue was full since the queue was created
+  uint64_t GetDroppedCount() const { return m_dropped; }
+
+private:
+  static bool Coalesce(MouseMovedEvent& last, const MouseMovedEvent& event) {
+    last = event;
+    return true;
+  }
+  static bool Coalesce(MouseScrolledEvent& last, const MouseScrolledEvent& event) {
+    last = MouseScrolledEvent(last.GetXOffset() + event.GetXOffset(), last.GetYOffset() + event.GetYOffset());
+    return true;
+  }
+  static bool Coalesce(WindowResizeEvent& last, const WindowResizeEvent& event) {
+    last = event;
+    return true;
+  }
+  template<typename T>
+  static bool Coalesce(T&, const T&) {
+    return false;
+  }
+
+  std::vector<QueuedEvent> m_events;
+  size_t m_count = 0;
+  uint32_t m_coalescing = 0;
+  uint64_t m_coalesced = 0;
+  uint64_t m_dropped = 0;
+};
+
+}
@@ -12,6 +12,7 @@
 
 #pragma once
 #include "event.hpp"
+#include "src/path_table.hpp"
 #include "bloom_header.hpp"
 
 namespace bloom {
@@ -23,7 +24,7 @@ namespace bloom {
  * This event is dispatched when the window's width or height changes. It contains information
  * about the new dimensions of the window and provides a string representation for debugging.
  */
-class BLOOM_API WindowResizeEvent : public Event {
+class BLOOM_API WindowResizeEvent final : public Event {
 public:
   /**
    * @brief Constructs a `WindowResizeEvent`.
@@ -69,7 +70,7 @@ private:
  *
  * This event is dispatched when the user or system initiates a window close action.
  */
-class BLOOM_API WindowCloseEvent : public Event {
+class BLOOM_API WindowCloseEvent final : public Event {
 public:
   /**
    * @brief Constructs a `WindowCloseEvent`.
@@ -87,7 +88,7 @@ public:
  * This event is dispatched every time the game performs an update tick, which is used for
  * logic updates, such as moving objects or processing game mechanics.
  */
-class BLOOM_API GameTickEvent : public Event {
+class BLOOM_API GameTickEvent final : public Event {
 public:
   /**
    * @brief Constructs a `GameTickEvent`.
@@ -105,7 +106,7 @@ public:
  * This event is dispatched every time the game renders a frame, which is used for drawing
  * the current state of the game to the screen.
  */
-class BLOOM_API GameRenderEvent : public Event {
+class BLOOM_API GameRenderEvent final : public Event {
 public:
   /**
    * @brief Constructs a `GameRenderEvent`.
@@ -116,4 +117,93 @@ public:
   EVENT_CLASS_CATEGORY(EventCategoryGame)
 };
 
+/**
+ * @class AssetLoadedEvent
+ * @brief Posted by a loader thread when an asset finished loading, successfully or not.
+ *
+ * The path is interned in the @c PathTable so the event stays fixed size and copying it through the queues never
+ * allocates.
+ */
+class BLOOM_API AssetLoadedEvent final : public Event {
+public:
+  /**
+   * @brief Constructs an `AssetLoadedEvent`.
+   * @param path Interned path the asset was loaded from.
+   * @param success Whether the asset is ready to be used.
+   */
+  AssetLoadedEvent(PathTable::Id path, bool success) : _path(path), _success(success) {}
+  /**
+   * @brief Constructs an `AssetLoadedEvent`, interning the path.
+   * @param path Path the asset was loaded from.
+   * @param success Whether the asset is ready to be used.
+   */
+  AssetLoadedEvent(std::string_view path, bool success) : AssetLoadedEvent(PathTable::Intern(path), success) {}
+
+  [[nodiscard]] PathTable::Id GetPathId() const { return _path; }
+  [[nodiscard]] const std::string& GetPath() const { return PathTable::Get(_path); }
+  [[nodiscard]] bool GetSuccess() const { return _success; }
+
+  [[nodiscard]] std::string ToString() const override {
+    return fmt::format("AssetLoadedEvent: {0} ({1})", GetPath(), _success ? "ok" : "failed");
+  }
+
+  EVENT_CLASS_TYPE(AssetLoaded)
+  EVENT_CLASS_CATEGORY(EventCategoryGame)
+
+private:
+  PathTable::Id _path; ///< Interned path the asset was loaded from.
+  bool _success;       ///< Whether the asset is ready to be used.
+};
+
+/**
+ * @class JobFinishedEvent
+ * @brief Posted by a worker thread when a job it was given is done.
+ */
+class BLOOM_API JobFinishedEvent final : public Event {
+public:
+  /**
+   * @brief Constructs a `JobFinishedEvent`.
+   * @param jobId Identifier handed out when the job was scheduled.
+   */
+  explicit JobFinishedEvent(uint64_t jobId) : _jobId(jobId) {}
+
+  [[nodiscard]] uint64_t GetJobId() const { return _jobId; }
+
+  [[nodiscard]] std::string ToString() const override { return fmt::format("JobFinishedEvent: {0}", _jobId); }
+
+  EVENT_CLASS_TYPE(JobFinished)
+  EVENT_CLASS_CATEGORY(EventCategoryGame)
+
+private:
+  uint64_t _jobId; ///< Identifier handed out when the job was scheduled.
+};
+
+/**
+ * @class GameCustomEvent
+ * @brief Game defined event, the game picks the ids and what the payload means.
+ */
+class BLOOM_API GameCustomEvent final : public Event {
+public:
+  /**
+   * @brief Constructs a `GameCustomEvent`.
+   * @param id Game defined identifier of the event.
+   * @param payload Game defined data, e.g. an entity id or an index into game owned storage.
+   */
+  GameCustomEvent(uint32_t id, uint64_t payload) : _id(id), _payload(payload) {}
+
+  [[nodiscard]] uint32_t GetId() const { return _id; }
+  [[nodiscard]] uint64_t GetPayload() const { return _payload; }
+
+  [[nodiscard]] std::string ToString() const override {
+    return fmt::format("GameCustomEvent: {0} ({1})", _id, _payload);
+  }
+
+  EVENT_CLASS_TYPE(GameCustom)
+  EVENT_CLASS_CATEGORY(EventCategoryGame)
+
+private:
+  uint32_t _id;      ///< Game defined identifier of the event.
+  uint64_t _payload; ///< Game defined data.
+};
+
 }
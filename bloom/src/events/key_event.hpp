@@ -51,7 +51,7 @@ protected:
  * The `KeyPressedEvent` class provides information about the key being pressed and
  * the number of times the key has been repeated while being held down.
  */
-class BLOOM_API KeyPressedEvent : public KeyEvent {
+class BLOOM_API KeyPressedEvent final : public KeyEvent {
 public:
   /**
    * @brief Constructs a `KeyPressedEvent`.
@@ -88,7 +88,7 @@ private:
  * @brief Represents an event triggered when a key is released.
  * The `KeyReleasedEvent` class provides information about the key that has been released.
  */
-class BLOOM_API KeyReleasedEvent : public KeyEvent {
+class BLOOM_API KeyReleasedEvent final : public KeyEvent {
 public:
   /**
    * @brief Constructs a `KeyReleasedEvent`.
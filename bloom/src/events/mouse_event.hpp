@@ -22,7 +22,7 @@ namespace bloom {
  *
  * The `MouseMovedEvent` class captures the new position of the mouse cursor.
  */
-class BLOOM_API MouseMovedEvent : public Event {
+class BLOOM_API MouseMovedEvent final : public Event {
 public:
   /**
    * @brief Constructs a `MouseMovedEvent`.
@@ -66,7 +66,7 @@ private:
  *
  * The `MouseScrolledEvent` class captures the offset values of the scroll action.
  */
-class BLOOM_API MouseScrolledEvent : public Event {
+class BLOOM_API MouseScrolledEvent final : public Event {
 public:
   /**
    * @brief Constructs a `MouseScrolledEvent`.
@@ -137,7 +137,7 @@ protected:
  * @class MouseButtonPressedEvent
  * @brief Represents an event triggered when a mouse button is pressed.
  */
-class BLOOM_API MouseButtonPressedEvent : public MouseButtonEvent {
+class BLOOM_API MouseButtonPressedEvent final : public MouseButtonEvent {
 public:
   /**
    * @brief Constructs a `MouseButtonPressedEvent`.
@@ -162,7 +162,7 @@ public:
  * @class MouseButtonReleasedEvent
  * @brief Represents an event triggered when a mouse button is released.
  */
-class BLOOM_API MouseButtonReleasedEvent : public MouseButtonEvent {
+class BLOOM_API MouseButtonReleasedEvent final : public MouseButtonEvent {
 public:
   /**
    * @brief Constructs a `MouseButtonReleasedEvent`.
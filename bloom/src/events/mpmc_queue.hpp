@@ -0,0 +1,118 @@
+/**
+ * @file mpmc_queue.hpp
+ *
+ * @brief Bounded lock-free multi producer multi consumer queue
+ */
+
+#pragma once
+#include <bloom_header.hpp>
+#include <atomic>
+#include <new>
+
+namespace bloom {
+
+/**
+ * @class MpmcQueue
+ * @brief Dmitry Vyukov's bounded MPMC queue
+ *
+ * Every cell carries a sequence number that tells producers and consumers whose turn it is, so a push or a pop is
+ * one CAS on the shared position plus a release store on the cell. Neither side ever waits on the other: a full
+ * queue fails the push and an empty one fails the pop.
+ *
+ * @tparam T Moved in and out of the cells
+ */
+template<typename T>
+class MpmcQueue {
+public:
+  /**
+   * @param capacity Rounded up to a power of two
+   */
+  explicit MpmcQueue(size_t capacity) {
+    size_t size = 2;
+    while (size < capacity) size <<= 1;
+    m_mask = size - 1;
+    m_cells = std::make_unique<Cell[]>(size);
+    for (size_t i = 0; i < size; i++) {
+      m_cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  ~MpmcQueue() {
+    // Nobody else can be using the queue by now, destroy whatever was never popped
+    size_t end = m_enqueuePosition.load(std::memory_order_relaxed);
+    for (size_t position = m_dequeuePosition.load(std::memory_order_relaxed); position != end; position++) {
+      std::launder(reinterpret_cast<T*>(m_cells[position & m_mask].storage))->~T();
+    }
+  }
+
+  MpmcQueue(const MpmcQueue&) = delete;
+  MpmcQueue& operator=(const MpmcQueue&) = delete;
+
+  /**
+   * @return False if the queue is full, @c value is left untouched then
+   */
+  template<typename U>
+  bool TryPush(U&& value) {
+    size_t position = m_enqueuePosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &m_cells[position & m_mask];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0) {
+        if (m_enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = m_enqueuePosition.load(std::memory_order_relaxed);
+      }
+    }
+    new (cell->storage) T(std::forward<U>(value));
+    cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * @param value Move assigned from the popped element
+   * @return False if the queue is empty
+   */
+  bool TryPop(T& value) {
+    size_t position = m_dequeuePosition.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &m_cells[position & m_mask];
+      size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+      if (difference == 0) {
+        if (m_dequeuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) break;
+      } else if (difference < 0) {
+        return false;
+      } else {
+        position = m_dequeuePosition.load(std::memory_order_relaxed);
+      }
+    }
+    T* stored = std::launder(reinterpret_cast<T*>(cell->storage));
+    value = std::move(*stored);
+    stored->~T();
+    cell->sequence.store(position + m_mask + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t Capacity() const { return m_mask + 1; }
+
+private:
+  // Keeps the positions and the cells off each other's cache lines, producers and consumers hammer different ones
+  static constexpr size_t CACHE_LINE = 64;
+
+  struct Cell {
+    std::atomic<size_t> sequence;
+    alignas(T) unsigned char storage[sizeof(T)];
+  };
+
+  alignas(CACHE_LINE) std::unique_ptr<Cell[]> m_cells;
+  size_t m_mask;
+  alignas(CACHE_LINE) std::atomic<size_t> m_enqueuePosition{0};
+  alignas(CACHE_LINE) std::atomic<size_t> m_dequeuePosition{0};
+};
+
+}
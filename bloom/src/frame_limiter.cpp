@@ -0,0 +1,85 @@
+#include "frame_limiter.hpp"
+#include <thread>
+
+namespace bloom {
+
+FrameLimiter::FrameLimiter() {
+#ifdef BLOOM_PLATFORM_WINDOWS
+  m_timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+  if (m_timer == nullptr) {
+    BLOOM_WARN("High resolution timer not available, frame limiter will spin more");
+  }
+#endif
+}
+
+FrameLimiter::~FrameLimiter() {
+#ifdef BLOOM_PLATFORM_WINDOWS
+  if (m_timer != nullptr) {
+    CloseHandle(m_timer);
+  }
+#endif
+}
+
+void FrameLimiter::SetTargetFrameRate(double framesPerSecond) {
+  m_targetFrameRate = std::max(framesPerSecond, 0.0);
+  m_targetFrameTime = m_targetFrameRate > 0.0
+      ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / m_targetFrameRate))
+      : Clock::duration::zero();
+  m_nextFrame = Clock::time_point{};
+}
+
+void FrameLimiter::Wait() {
+  auto start = Clock::now();
+
+  if (m_targetFrameTime > Clock::duration::zero()) {
+    if (m_nextFrame == Clock::time_point{} || start - m_nextFrame > m_targetFrameTime) {
+      m_nextFrame = start;
+    }
+
+    while (true) {
+      auto remaining = m_nextFrame - Clock::now();
+      if (remaining <= m_sleepMargin) break;
+
+      auto request = remaining - m_sleepMargin;
+      auto sleepStart = Clock::now();
+      Sleep(request);
+      auto overshoot = (Clock::now() - sleepStart) - request;
+
+      // Grow fast on a bad sleep, shrink slowly so a lucky one doesn't make us miss the next deadline
+      if (overshoot > m_sleepMargin) {
+        m_sleepMargin = overshoot;
+      } else {
+        m_sleepMargin -= (m_sleepMargin - std::max(overshoot, Clock::duration::zero())) / 64;
+      }
+    }
+
+    while (Clock::now() < m_nextFrame) {
+      // Spin
+    }
+    m_nextFrame += m_targetFrameTime;
+  }
+
+  auto now = Clock::now();
+  m_waitTime = std::chrono::duration<double>(now - start).count();
+  if (m_lastFrame != Clock::time_point{}) {
+    m_frameTime = std::chrono::duration<double>(now - m_lastFrame).count();
+  }
+  m_lastFrame = now;
+}
+
+void FrameLimiter::Sleep(Clock::duration duration) {
+#ifdef BLOOM_PLATFORM_WINDOWS
+  if (m_timer != nullptr) {
+    // Negative means relative, in 100ns units
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -std::chrono::duration_cast<std::chrono::duration<int64_t, std::ratio<1, 10000000>>>(duration).count();
+    if (SetWaitableTimerEx(m_timer, &dueTime, 0, nullptr, nullptr, nullptr, 0)) {
+      WaitForSingleObject(m_timer, INFINITE);
+      return;
+    }
+  }
+#endif
+  std::this_thread::sleep_for(duration);
+}
+
+}
@@ -0,0 +1,69 @@
+/**
+ * @file frame_limiter.hpp
+ *
+ * @brief CPU side frame rate cap
+ */
+
+#pragma once
+#include <bloom_header.hpp>
+#include <chrono>
+
+namespace bloom {
+
+/**
+ * @class FrameLimiter
+ * @brief Caps the frame rate by waiting at the start of each frame
+ *
+ * OS sleeps are coarse and tend to overshoot, so the limiter sleeps until it is close to the deadline and spins the
+ * rest. How close it dares to sleep is learnt from how much the previous sleeps overshot. On Windows it uses a high
+ * resolution waitable timer when available, the default timer resolution is ~15ms.
+ */
+class BLOOM_API FrameLimiter {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  FrameLimiter();
+  ~FrameLimiter();
+
+  FrameLimiter(const FrameLimiter&) = delete;
+  FrameLimiter& operator=(const FrameLimiter&) = delete;
+
+  /**
+   * @brief Sets the frame rate cap
+   * @param framesPerSecond Target frame rate, 0 disables the limiter
+   */
+  void SetTargetFrameRate(double framesPerSecond);
+  double GetTargetFrameRate() const { return m_targetFrameRate; }
+
+  /**
+   * @brief Waits until the next frame is due, call it once per frame before sampling input
+   *
+   * If a frame took longer than the target the schedule restarts from now instead of rushing to catch up
+   */
+  void Wait();
+
+  /// Achieved time between the last two frames in seconds, including the wait
+  double GetFrameTime() const { return m_frameTime; }
+  /// Time spent waiting on the last frame in seconds
+  double GetWaitTime() const { return m_waitTime; }
+
+private:
+  void Sleep(Clock::duration duration);
+
+  double m_targetFrameRate = 0.0;
+  Clock::duration m_targetFrameTime = Clock::duration::zero();
+  Clock::time_point m_nextFrame{};
+  Clock::time_point m_lastFrame{};
+
+  /// Expected oversleep, anything closer to the deadline than this is spun
+  Clock::duration m_sleepMargin = std::chrono::milliseconds(2);
+
+  double m_frameTime = 0.0;
+  double m_waitTime = 0.0;
+
+#ifdef BLOOM_PLATFORM_WINDOWS
+  HANDLE m_timer = nullptr;
+#endif
+};
+
+}
@@ -0,0 +1,113 @@
+#include "frame_statistics.hpp"
+#include <cmath>
+
+namespace bloom {
+
+FrameStatistics::FrameStatistics(uint32_t windowSize, double bucketWidth, uint32_t bucketCount) :
+    m_windowSize(std::max<uint32_t>(windowSize, 1)), m_bucketWidth(std::max(bucketWidth, 0.001)),
+    m_bucketCount(std::max<uint32_t>(bucketCount, 1)) {
+  for (auto& window : m_windows) {
+    window.samples.resize(m_windowSize);
+  }
+}
+
+void FrameStatistics::AddSample(Series series, double milliseconds) {
+  auto& window = m_windows[static_cast<size_t>(series)];
+  window.samples[window.next] = static_cast<float>(milliseconds);
+  window.next = (window.next + 1) % m_windowSize;
+  window.count = std::min(window.count + 1, m_windowSize);
+}
+
+void FrameStatistics::Reset() {
+  for (auto& window : m_windows) {
+    window.next = 0;
+    window.count = 0;
+  }
+  m_reportTimer = 0.0;
+}
+
+FrameStatistics::Summary FrameStatistics::GetSummary(Series series) const {
+  const auto& window = m_windows[static_cast<size_t>(series)];
+  Summary summary{};
+  summary.samples = window.count;
+  if (window.count == 0) return summary;
+
+  // Order doesn't matter once the window is full, the oldest samples are just the ones at next
+  std::vector<float> sorted(window.samples.begin(), window.samples.begin() + window.count);
+  std::sort(sorted.begin(), sorted.end());
+
+  double total = 0.0;
+  for (float sample : sorted) {
+    total += sample;
+  }
+  summary.average = total / sorted.size();
+  summary.min = sorted.front();
+  summary.max = sorted.back();
+
+  // Nearest rank percentiles
+  auto percentile = [&sorted](double p) {
+    auto rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return static_cast<double>(sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1]);
+  };
+  summary.p50 = percentile(0.50);
+  summary.p95 = percentile(0.95);
+  summary.p99 = percentile(0.99);
+
+  // With few samples the slowest frame stands in for the lows instead of an empty average
+  auto low = [&sorted](double fraction) {
+    size_t count = std::max<size_t>(static_cast<size_t>(sorted.size() * fraction), 1);
+    double slowest = 0.0;
+    for (size_t i = sorted.size() - count; i < sorted.size(); i++) {
+      slowest += sorted[i];
+    }
+    return slowest / count;
+  };
+  summary.low1 = low(0.01);
+  summary.low01 = low(0.001);
+  return summary;
+}
+
+std::vector<uint32_t> FrameStatistics::GetHistogram(Series series) const {
+  const auto& window = m_windows[static_cast<size_t>(series)];
+  std::vector<uint32_t> histogram(m_bucketCount, 0);
+  for (uint32_t i = 0; i < window.count; i++) {
+    auto bucket = static_cast<uint32_t>(std::max(window.samples[i] / m_bucketWidth, 0.0));
+    histogram[std::min(bucket, m_bucketCount - 1)]++;
+  }
+  return histogram;
+}
+
+std::string FrameStatistics::FormatSummary() const {
+  std::string line;
+  for (size_t i = 0; i < m_windows.size(); i++) {
+    auto series = static_cast<Series>(i);
+    auto summary = GetSummary(series);
+    if (summary.samples == 0) continue;
+
+    if (!line.empty()) line += " | ";
+    line += fmt::format("{0} avg {1:.2f}ms p50 {2:.2f} p95 {3:.2f} p99 {4:.2f} 1% low {5:.2f} 0.1% low {6:.2f}",
+                        SeriesName(series), summary.average, summary.p50, summary.p95, summary.p99, summary.low1,
+                        summary.low01);
+  }
+  return line;
+}
+
+bool FrameStatistics::Update(double deltaTime) {
+  if (m_reportInterval <= 0.0) return false;
+
+  m_reportTimer += deltaTime;
+  if (m_reportTimer < m_reportInterval) return false;
+  m_reportTimer = 0.0;
+  return true;
+}
+
+const char* FrameStatistics::SeriesName(Series series) {
+  switch (series) {
+    case Series::CpuFrame: return "CPU";
+    case Series::GpuFrame: return "GPU";
+    case Series::PresentInterval: return "Present";
+    default: return "Unknown";
+  }
+}
+
+}
@@ -0,0 +1,98 @@
+/**
+ * @file frame_statistics.hpp
+ *
+ * @brief Rolling frame time statistics, our standard metric for performance regressions
+ */
+
+#pragma once
+#include <bloom_header.hpp>
+#include <array>
+
+namespace bloom {
+
+/**
+ * @class FrameStatistics
+ * @brief Keeps the last frames of CPU time, GPU time and present interval and summarizes them
+ *
+ * Adding a sample is a store into a ring, everything else is computed when a summary is asked for, so the engine
+ * only pays for sorting the window once per report instead of formatting a log line every frame.
+ */
+class BLOOM_API FrameStatistics {
+public:
+  enum class Series {
+    CpuFrame,        ///< CPU time spent on a frame, from input sampling to submit, without the frame limiter
+    GpuFrame,        ///< GPU time of the recorded work, only with the GPU profiler
+    PresentInterval, ///< Time between two presents, what the player actually sees
+    Count
+  };
+
+  /**
+   * @struct Summary
+   * @brief Statistics of one series over the window, all in milliseconds
+   *
+   * Lows follow the usual benchmark definition, the average of the slowest 1% and 0.1% of the frames
+   */
+  struct Summary {
+    uint32_t samples = 0;
+    double average = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double low1 = 0.0;
+    double low01 = 0.0;
+  };
+
+  /**
+   * @param windowSize Frames kept per series
+   * @param bucketWidth Width in milliseconds of the histogram buckets
+   * @param bucketCount Histogram buckets, the last one also holds everything slower
+   */
+  explicit FrameStatistics(uint32_t windowSize = 1024, double bucketWidth = 1.0, uint32_t bucketCount = 50);
+
+  void AddSample(Series series, double milliseconds);
+  /// Forgets every sample, e.g. after a loading screen so it doesn't skew the lows
+  void Reset();
+
+  Summary GetSummary(Series series) const;
+  /// Frames of the window per bucket, bucket @c i holds [i, i + 1) * bucketWidth
+  std::vector<uint32_t> GetHistogram(Series series) const;
+  double GetBucketWidth() const { return m_bucketWidth; }
+
+  /**
+   * @brief One line with every series that has samples, what the engine logs on each report
+   */
+  std::string FormatSummary() const;
+
+  /**
+   * @brief Sets how often @c Update() asks for a report
+   * @param seconds Interval between reports, 0 disables them
+   */
+  void SetReportInterval(double seconds) { m_reportInterval = seconds; }
+  double GetReportInterval() const { return m_reportInterval; }
+  /**
+   * @brief Advances the report timer
+   * @return True when a report is due
+   */
+  bool Update(double deltaTime);
+
+  static const char* SeriesName(Series series);
+
+private:
+  struct Window {
+    std::vector<float> samples;
+    uint32_t next = 0;
+    uint32_t count = 0;
+  };
+
+  std::array<Window, static_cast<size_t>(Series::Count)> m_windows;
+  uint32_t m_windowSize;
+  double m_bucketWidth;
+  uint32_t m_bucketCount;
+
+  double m_reportInterval = 1.0;
+  double m_reportTimer = 0.0;
+};
+
+}
@@ -0,0 +1,59 @@
+#include "input.hpp"
+
+namespace bloom {
+
+void Input::Update(const EventQueue& events) {
+  auto& next = m_current;
+  next.keysPressed.reset();
+  next.keysReleased.reset();
+  next.buttonsPressed.reset();
+  next.buttonsReleased.reset();
+  next.scroll = glm::vec2(0.0f);
+  const glm::vec2 previousPosition = next.mousePosition;
+
+  events.Dispatch(EventHandlers{
+    [&next](const KeyPressedEvent& event) {
+      // Repeats don't count as a new press
+      if (!InputSnapshot::ValidKey(event.GetKeyCode()) || event.GetRepeatCount() != 0) return;
+      next.keys.set(event.GetKeyCode());
+      next.keysPressed.set(event.GetKeyCode());
+    },
+    [&next](const KeyReleasedEvent& event) {
+      if (!InputSnapshot::ValidKey(event.GetKeyCode())) return;
+      next.keys.reset(event.GetKeyCode());
+      next.keysReleased.set(event.GetKeyCode());
+    },
+    [&next](const MouseButtonPressedEvent& event) {
+      if (!InputSnapshot::ValidButton(event.GetMouseButton())) return;
+      next.buttons.set(event.GetMouseButton());
+      next.buttonsPressed.set(event.GetMouseButton());
+    },
+    [&next](const MouseButtonReleasedEvent& event) {
+      if (!InputSnapshot::ValidButton(event.GetMouseButton())) return;
+      next.buttons.reset(event.GetMouseButton());
+      next.buttonsReleased.set(event.GetMouseButton());
+    },
+    [&next](const MouseMovedEvent& event) {
+      next.mousePosition = glm::vec2(event.GetX(), event.GetY());
+    },
+    [&next](const MouseScrolledEvent& event) {
+      next.scroll += glm::vec2(event.GetXOffset(), event.GetYOffset());
+    },
+    [](const auto&) {}
+  });
+
+  // The first position isn't a movement, it's just where the cursor was when the window opened
+  next.mouseDelta = m_hasMousePosition ? next.mousePosition - previousPosition : glm::vec2(0.0f);
+  m_hasMousePosition |= next.mousePosition != previousPosition;
+  next.frame++;
+
+  std::lock_guard lock(m_publishMutex);
+  m_published = next;
+}
+
+InputSnapshot Input::GetSnapshot() const {
+  std::lock_guard lock(m_publishMutex);
+  return m_published;
+}
+
+}
@@ -0,0 +1,82 @@
+/**
+ * @file input.hpp
+ *
+ * @brief Polled keyboard and mouse state
+ */
+
+#pragma once
+#include "events/event_queue.hpp"
+#include <bloom_header.hpp>
+#include <bitset>
+#include <mutex>
+
+namespace bloom {
+
+/**
+ * @struct InputSnapshot
+ * @brief State of the keyboard and mouse at the end of a frame, every query is O(1)
+ *
+ * Edges are kept per frame, a key pressed and released between two frames reads as pressed and released this frame
+ * while @c IsKeyDown() is already false.
+ */
+struct InputSnapshot {
+  using Keys = std::bitset<GLFW_KEY_LAST + 1>;
+  using Buttons = std::bitset<GLFW_MOUSE_BUTTON_LAST + 1>;
+
+  bool IsKeyDown(int key) const { return ValidKey(key) && keys[key]; }
+  bool WasKeyPressed(int key) const { return ValidKey(key) && keysPressed[key]; }
+  bool WasKeyReleased(int key) const { return ValidKey(key) && keysReleased[key]; }
+
+  bool IsButtonDown(int button) const { return ValidButton(button) && buttons[button]; }
+  bool WasButtonPressed(int button) const { return ValidButton(button) && buttonsPressed[button]; }
+  bool WasButtonReleased(int button) const { return ValidButton(button) && buttonsReleased[button]; }
+
+  /// Cursor position in window coordinates
+  glm::vec2 GetMousePosition() const { return mousePosition; }
+  /// Cursor movement since the previous frame
+  glm::vec2 GetMouseDelta() const { return mouseDelta; }
+  /// Scroll accumulated during the frame
+  glm::vec2 GetScroll() const { return scroll; }
+
+  static bool ValidKey(int key) { return key >= 0 && key <= GLFW_KEY_LAST; }
+  static bool ValidButton(int button) { return button >= 0 && button <= GLFW_MOUSE_BUTTON_LAST; }
+
+  Keys keys;
+  Keys keysPressed;
+  Keys keysReleased;
+  Buttons buttons;
+  Buttons buttonsPressed;
+  Buttons buttonsReleased;
+  glm::vec2 mousePosition{0.0f};
+  glm::vec2 mouseDelta{0.0f};
+  glm::vec2 scroll{0.0f};
+  uint64_t frame = 0; ///< Number of @c Update() calls that produced this snapshot
+};
+
+/**
+ * @class Input
+ * @brief Folds the events of each frame into an @c InputSnapshot
+ *
+ * Double buffered: the main thread builds the next snapshot from the event queue while other threads keep reading
+ * the published one through @c GetSnapshot(). The main thread can read @c Current() without locking.
+ */
+class BLOOM_API Input {
+public:
+  /**
+   * @brief Applies the events of this frame and publishes the result, call once per frame after polling
+   */
+  void Update(const EventQueue& events);
+
+  /// Last published snapshot, main thread only
+  const InputSnapshot& Current() const { return m_current; }
+  /// Copy of the last published snapshot, safe from any thread
+  InputSnapshot GetSnapshot() const;
+
+private:
+  InputSnapshot m_current;
+  InputSnapshot m_published;
+  mutable std::mutex m_publishMutex;
+  bool m_hasMousePosition = false;
+};
+
+}
@@ -0,0 +1,141 @@
+#include "input_recorder.hpp"
+#include <cstring>
+
+namespace bloom {
+
+InputRecorder::~InputRecorder() {
+  Stop();
+}
+
+bool InputRecorder::StartRecording(const std::string& path) {
+  Stop();
+  m_output.open(path, std::ios::binary | std::ios::trunc);
+  if (!m_output) {
+    BLOOM_WARN("Could not create input recording {0}", path);
+    return false;
+  }
+
+  FileHeader header{MAGIC, VERSION};
+  m_output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  m_mode = Mode::Recording;
+  m_frame = 0;
+  m_recorded = 0;
+  m_start = std::chrono::steady_clock::now();
+  BLOOM_INFO("Recording input to {0}", path);
+  return true;
+}
+
+bool InputRecorder::StartPlayback(const std::string& path) {
+  Stop();
+  std::ifstream input(path, std::ios::binary | std::ios::ate);
+  if (!input) {
+    BLOOM_WARN("Could not open input recording {0}", path);
+    return false;
+  }
+
+  auto size = static_cast<size_t>(input.tellg());
+  input.seekg(0);
+  FileHeader header{};
+  if (size < sizeof(header) || !input.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+      header.magic != MAGIC || header.version != VERSION) {
+    BLOOM_WARN("{0} is not a version {1} input recording", path, VERSION);
+    return false;
+  }
+
+  m_records.resize((size - sizeof(header)) / sizeof(FileRecord));
+  input.read(reinterpret_cast<char*>(m_records.data()),
+             static_cast<std::streamsize>(m_records.size() * sizeof(FileRecord)));
+  m_mode = Mode::Playback;
+  m_frame = 0;
+  m_next = 0;
+  BLOOM_INFO("Playing back {0} input events from {1} ({2} frames)", m_records.size(), path,
+             m_records.empty() ? 0 : m_records.back().frame + 1);
+  return true;
+}
+
+void InputRecorder::Stop() {
+  if (m_mode == Mode::Recording) {
+    m_output.close();
+    BLOOM_INFO("Input recording stopped: {0} events over {1} frames", m_recorded, m_frame);
+  }
+  m_mode = Mode::Off;
+  m_records.clear();
+  m_next = 0;
+}
+
+void InputRecorder::Record(const EventQueue& events) {
+  if (m_mode != Mode::Recording) return;
+
+  m_pending.clear();
+  events.Dispatch(EventHandlers{
+    [this](const KeyPressedEvent& event) {
+      Write(RecordType::KeyPressed, event.GetKeyCode(), event.GetRepeatCount());
+    },
+    [this](const KeyReleasedEvent& event) {
+      Write(RecordType::KeyReleased, event.GetKeyCode(), 0);
+    },
+    [this](const MouseButtonPressedEvent& event) {
+      Write(RecordType::MouseButtonPressed, event.GetMouseButton(), 0);
+    },
+    [this](const MouseButtonReleasedEvent& event) {
+      Write(RecordType::MouseButtonReleased, event.GetMouseButton(), 0);
+    },
+    [this](const MouseMovedEvent& event) {
+      Write(RecordType::MouseMoved, FloatBits(event.GetX()), FloatBits(event.GetY()));
+    },
+    [this](const MouseScrolledEvent& event) {
+      Write(RecordType::MouseScrolled, FloatBits(event.GetXOffset()), FloatBits(event.GetYOffset()));
+    },
+    // Window and bus events aren't input, a replay regenerates them by itself
+    [](const auto&) {}
+  });
+
+  if (!m_pending.empty()) {
+    m_output.write(reinterpret_cast<const char*>(m_pending.data()),
+                   static_cast<std::streamsize>(m_pending.size() * sizeof(FileRecord)));
+    m_recorded += m_pending.size();
+  }
+  m_frame++;
+}
+
+void InputRecorder::Playback(EventQueue& events) {
+  if (m_mode != Mode::Playback) return;
+
+  for (; m_next < m_records.size() && m_records[m_next].frame <= m_frame; m_next++) {
+    const auto& record = m_records[m_next];
+    auto a = static_cast<int>(record.a);
+    switch (static_cast<RecordType>(record.type)) {
+      case RecordType::KeyPressed: events.Push(KeyPressedEvent(a, static_cast<int>(record.b))); break;
+      case RecordType::KeyReleased: events.Push(KeyReleasedEvent(a)); break;
+      case RecordType::MouseButtonPressed: events.Push(MouseButtonPressedEvent(a)); break;
+      case RecordType::MouseButtonReleased: events.Push(MouseButtonReleasedEvent(a)); break;
+      case RecordType::MouseMoved: events.Push(MouseMovedEvent(BitsFloat(record.a), BitsFloat(record.b))); break;
+      case RecordType::MouseScrolled: events.Push(MouseScrolledEvent(BitsFloat(record.a), BitsFloat(record.b))); break;
+      default: break;
+    }
+  }
+  m_frame++;
+
+  if (IsPlaybackFinished() && m_next != 0 && m_records.back().frame + 1 == m_frame) {
+    BLOOM_INFO("Input playback finished after {0} frames", m_frame);
+  }
+}
+
+void InputRecorder::Write(RecordType type, uint32_t a, uint32_t b) {
+  float time = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_start).count();
+  m_pending.push_back({m_frame, time, static_cast<uint16_t>(type), 0, a, b});
+}
+
+uint32_t InputRecorder::FloatBits(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+float InputRecorder::BitsFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+}
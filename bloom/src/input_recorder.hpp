@@ -0,0 +1,112 @@
+/**
+ * @file input_recorder.hpp
+ *
+ * @brief Records input events to a file and plays them back, for reproducible benchmark sessions
+ */
+
+#pragma once
+#include "events/event_queue.hpp"
+#include <bloom_header.hpp>
+#include <fstream>
+
+namespace bloom {
+
+/**
+ * @class InputRecorder
+ * @brief Writes the input events of every frame to a compact binary file and feeds them back later
+ *
+ * Playback is driven by frame index, not by time, so paired with a fixed delta time the same recording produces the
+ * same frames on any machine. The timestamps are stored only to see how the session was played.
+ *
+ * File layout, little endian: a @c FileHeader followed by one @c FileRecord per event, sorted by frame. Event kinds are
+ * stored as @c RecordType, not @c EventType, so the format only changes when @c VERSION does.
+ */
+class BLOOM_API InputRecorder {
+public:
+  enum class Mode { Off, Recording, Playback };
+
+  InputRecorder() = default;
+  ~InputRecorder();
+
+  InputRecorder(const InputRecorder&) = delete;
+  InputRecorder& operator=(const InputRecorder&) = delete;
+
+  /**
+   * @return False if the file couldn't be created
+   */
+  bool StartRecording(const std::string& path);
+  /**
+   * @return False if the file couldn't be read or isn't a recording
+   */
+  bool StartPlayback(const std::string& path);
+  void Stop();
+
+  /**
+   * @brief Appends the input events of this frame, call once per frame after polling
+   */
+  void Record(const EventQueue& events);
+  /**
+   * @brief Pushes the recorded events of this frame, call once per frame instead of polling input
+   */
+  void Playback(EventQueue& events);
+
+  Mode GetMode() const { return m_mode; }
+  bool IsPlaybackFinished() const { return m_mode == Mode::Playback && m_next == m_records.size(); }
+  /// Frames recorded or played back so far
+  uint32_t GetFrame() const { return m_frame; }
+
+private:
+  static constexpr uint32_t MAGIC = 0x494d4c42; ///< "BLMI"
+  /// Bumped whenever @c FileRecord or @c RecordType change, older files are refused instead of replayed wrong
+  static constexpr uint32_t VERSION = 2;
+
+  /**
+   * @brief Event kinds as stored in the file, pinned so reordering @c EventType doesn't change old recordings
+   *
+   * Values are never reused, new kinds get the next free number
+   */
+  enum class RecordType : uint16_t {
+    KeyPressed = 1,
+    KeyReleased = 2,
+    MouseButtonPressed = 3,
+    MouseButtonReleased = 4,
+    MouseMoved = 5,
+    MouseScrolled = 6,
+  };
+
+  struct FileHeader {
+    uint32_t magic;
+    uint32_t version;
+  };
+
+  /**
+   * @struct FileRecord
+   * @brief One event, the meaning of @c a and @c b depends on the type, floats are stored by their bits
+   */
+  struct FileRecord {
+    uint32_t frame;
+    float time;     ///< Seconds since the recording started
+    uint16_t type;  ///< @c RecordType
+    uint16_t flags; ///< Unused, keeps the record 4 byte aligned
+    uint32_t a;
+    uint32_t b;
+  };
+  static_assert(sizeof(FileRecord) == 20, "Record layout is part of the file format");
+
+  void Write(RecordType type, uint32_t a, uint32_t b);
+  static uint32_t FloatBits(float value);
+  static float BitsFloat(uint32_t bits);
+
+  Mode m_mode = Mode::Off;
+  uint32_t m_frame = 0;
+  std::chrono::steady_clock::time_point m_start{};
+
+  std::ofstream m_output;
+  std::vector<FileRecord> m_pending; ///< Records of the current frame, written in one go
+  uint64_t m_recorded = 0;
+
+  std::vector<FileRecord> m_records;
+  size_t m_next = 0;
+};
+
+}
@@ -1,17 +1,79 @@
 #include "log.hpp"
+#include <spdlog/async.h>
+#include <spdlog/sinks/rotating_file_sink.h>
 
 namespace bloom {
 
 std::shared_ptr<spdlog::logger> Log::_bloomLogger;
 std::shared_ptr<spdlog::logger> Log::_gameLogger;
 
-void Log::Init() {
-  spdlog::set_pattern("%^[%T] %L:%n: %v%$");
-  _bloomLogger = spdlog::stdout_color_mt("BLOOM");
-  _bloomLogger->set_level(spdlog::level::trace);
-  _gameLogger = spdlog::stdout_color_mt("GAME");
-  _gameLogger->set_level(spdlog::level::trace);
+static std::shared_ptr<spdlog::logger> CreateLogger(const std::string& name, const Log::Sinks& sinks,
+                                                    const spdlog::sink_ptr& console, const Log::Settings& settings) {
+  std::vector<spdlog::sink_ptr> loggerSinks;
+  if (sinks.console) {
+    loggerSinks.push_back(console);
+  }
+  if (!sinks.file.empty()) {
+    try {
+      auto file = std::make_shared<spdlog::sinks::rotating_file_sink_mt>(sinks.file, settings.maxFileSize,
+                                                                         settings.maxFiles);
+      // Files get no colour codes
+      file->set_pattern("[%Y-%m-%d %T.%e] [%t] %L:%n: %v");
+      loggerSinks.push_back(std::move(file));
+    } catch (const spdlog::spdlog_ex& e) {
+      std::cerr << "Could not open log file " << sinks.file << ": " << e.what() << std::endl;
+    }
+  }
 
+  std::shared_ptr<spdlog::logger> logger;
+  if (settings.async) {
+    auto policy = settings.overflow == Log::OverflowPolicy::Block ? spdlog::async_overflow_policy::block
+                                                                   : spdlog::async_overflow_policy::overrun_oldest;
+    logger = std::make_shared<spdlog::async_logger>(name, loggerSinks.begin(), loggerSinks.end(), spdlog::thread_pool(),
+                                                    policy);
+  } else {
+    logger = std::make_shared<spdlog::logger>(name, loggerSinks.begin(), loggerSinks.end());
+  }
+  logger->set_level(settings.level);
+  // Errors usually come right before a crash, don't leave them sitting on a buffer
+  logger->flush_on(spdlog::level::err);
+  spdlog::register_logger(logger);
+  return logger;
+}
+
+void Log::Init(const Settings& settings) {
+  // Every engine inits again, a process running several of them one after another would register the loggers twice
+  spdlog::drop_all();
+  if (settings.async) {
+    // One worker keeps the messages in order
+    spdlog::init_thread_pool(std::max<size_t>(settings.queueSize, 1), 1);
+  }
+
+  auto console = std::make_shared<spdlog::sinks::stdout_color_sink_mt>();
+  console->set_pattern("%^[%T] %L:%n: %v%$");
+
+  _bloomLogger = CreateLogger("BLOOM", settings.bloom, console, settings);
+  _gameLogger = CreateLogger("GAME", settings.game, console, settings);
+}
+
+void Log::Shutdown() {
+  // Whatever logs after this, destructors mostly, goes straight to the same sinks
+  auto makeSync = [](const std::shared_ptr<spdlog::logger>& logger) -> std::shared_ptr<spdlog::logger> {
+    if (!logger) return nullptr;
+    auto sync = std::make_shared<spdlog::logger>(logger->name(), logger->sinks().begin(), logger->sinks().end());
+    sync->set_level(logger->level());
+    sync->flush_on(spdlog::level::err);
+    return sync;
+  };
+  auto bloomLogger = makeSync(_bloomLogger);
+  auto gameLogger = makeSync(_gameLogger);
+
+  // Destroying the thread pool drains its queue before joining the worker
+  spdlog::shutdown();
+  _bloomLogger = std::move(bloomLogger);
+  _gameLogger = std::move(gameLogger);
+  if (_bloomLogger) _bloomLogger->flush();
+  if (_gameLogger) _gameLogger->flush();
 }
 
 } // namespace bloom
@@ -11,6 +11,9 @@
  *
  * The file also includes the necessary macros and definitions for the Bloom and
  * Game logging consoles, ensuring clear separation between engine and game logs.
+ *
+ * By default both loggers are asynchronous: the calling thread formats the message into a queue and a background
+ * thread applies the pattern and writes it to the console and the rotating log files.
  */
 
 #pragma once
@@ -18,6 +21,32 @@
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/stdout_color_sinks.h>
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+// Compile time levels, same values as spdlog's so they can be passed straight to it
+
+#define BLOOM_LEVEL_TRACE    0
+#define BLOOM_LEVEL_INFO     2
+#define BLOOM_LEVEL_WARN     3
+#define BLOOM_LEVEL_ERROR    4
+#define BLOOM_LEVEL_CRITICAL 5
+
+/**
+ * @def BLOOM_ACTIVE_LOG_LEVEL
+ * @brief Lowest level compiled in, macros below it expand to nothing and their arguments are never evaluated
+ *
+ * Defaults to @c BLOOM_LEVEL_INFO on release builds and @c BLOOM_LEVEL_TRACE otherwise. Critical messages are
+ * never stripped, they end the process. Stripping @c BLOOM_ERROR keeps its debug break.
+ */
+#ifndef BLOOM_ACTIVE_LOG_LEVEL
+  #ifdef NDEBUG
+    #define BLOOM_ACTIVE_LOG_LEVEL BLOOM_LEVEL_INFO
+  #else
+    #define BLOOM_ACTIVE_LOG_LEVEL BLOOM_LEVEL_TRACE
+  #endif
+#endif
 
 namespace bloom {
 
@@ -38,10 +67,71 @@ namespace bloom {
 class BLOOM_API Log {
 
 public:
+  /**
+   * @enum OverflowPolicy
+   * @brief What an asynchronous log call does when the queue is full
+   */
+  enum class OverflowPolicy {
+    Block,      ///< Wait for the background thread, nothing is lost
+    DropOldest, ///< Overwrite the oldest queued message, logging never stalls the caller
+  };
+
+  /**
+   * @struct Sinks
+   * @brief Where the messages of one logger end up
+   */
+  struct Sinks {
+    bool console = true;
+    std::string file;  ///< Rotating log file, empty disables it
+  };
+
+  /**
+   * @struct Settings
+   * @brief Logging backend configuration, used once on @c Init()
+   */
+  struct Settings {
+    bool async = true;
+    size_t queueSize = 8192; ///< Messages the asynchronous queue holds before the overflow policy kicks in
+    OverflowPolicy overflow = OverflowPolicy::Block;
+    Sinks bloom{true, "logs/bloom.log"};
+    Sinks game{true, "logs/game.log"};
+    size_t maxFileSize = 5 * 1024 * 1024; ///< Bytes before a log file rotates
+    size_t maxFiles = 3;                  ///< Rotated files kept besides the current one
+    /// Runtime level of both loggers, can only filter more than @c BLOOM_ACTIVE_LOG_LEVEL, not less
+    spdlog::level::level_enum level = static_cast<spdlog::level::level_enum>(BLOOM_ACTIVE_LOG_LEVEL);
+  };
+
   /**
    * @brief This function initializes the logger for the game
    */
-  static void Init();
+  static void Init(const Settings& settings);
+  // Not a default argument, GCC and Clang can't use the member initializers of Settings before Log is complete
+  static void Init() { Init(Settings{}); }
+
+  /**
+   * @brief Writes out every queued message and stops the background thread
+   *
+   * Called on exit and by @c BLOOM_CRITICAL before the process goes down. The loggers stay usable afterwards but
+   * write synchronously.
+   */
+  static void Shutdown();
+
+  /// Initial value of a @c BLOOM_THROTTLED timer, lets the first call through
+  static constexpr int64_t THROTTLE_NEVER = std::numeric_limits<int64_t>::min() / 2;
+
+  /**
+   * @brief Decides whether a throttled call site may log now, used by @c BLOOM_THROTTLED
+   * @param last Time of the last accepted call in milliseconds, updated when this returns true
+   * @param intervalMs Minimum time between two accepted calls
+   */
+  static bool Throttle(std::atomic<int64_t>& last, int64_t intervalMs) {
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t previous = last.load(std::memory_order_relaxed);
+    // Only one of the threads racing on the same call site gets through
+    return now - previous >= intervalMs &&
+           last.compare_exchange_strong(previous, now, std::memory_order_relaxed);
+  }
 
   /**
    * Gets the bloom log console
@@ -69,11 +159,13 @@ private:
  *
  * This macro sends a critical-level log message using the Bloom logger.
  * Critical messages are the most severe and indicate fatal errors.
+ * The queued messages are written out before the process exits.
  *
  * @param ... The message and optional arguments to log.
  */
 #define BLOOM_CRITICAL(...)   {::bloom::Log::GetBloomLogger()->critical(__VA_ARGS__);\
-                              __debugbreak();\
+                              ::bloom::Log::Shutdown();\
+                              BLOOM_DEBUGBREAK();\
                               std::exit(1);}
 
 /**
@@ -85,8 +177,12 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_ERROR
 #define BLOOM_ERROR(...)      ::bloom::Log::GetBloomLogger()->error(__VA_ARGS__);\
-                              __debugbreak()
+                              BLOOM_DEBUGBREAK()
+#else
+#define BLOOM_ERROR(...)      BLOOM_DEBUGBREAK()
+#endif
 
 /**
  * @def BLOOM_WARN(message)
@@ -97,7 +193,11 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_WARN
 #define BLOOM_WARN(...)       ::bloom::Log::GetBloomLogger()->warn(__VA_ARGS__)
+#else
+#define BLOOM_WARN(...)       (void)0
+#endif
 
 /**
  * @def BLOOM_INFO(message)
@@ -108,7 +208,11 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_INFO
 #define BLOOM_INFO(...)       ::bloom::Log::GetBloomLogger()->info(__VA_ARGS__)
+#else
+#define BLOOM_INFO(...)       (void)0
+#endif
 
 /**
  * @def BLOOM_LOG(message)
@@ -119,7 +223,11 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_TRACE
 #define BLOOM_LOG(...)        ::bloom::Log::GetBloomLogger()->trace(__VA_ARGS__)
+#else
+#define BLOOM_LOG(...)        (void)0
+#endif
 
 // Game log macros
 
@@ -143,7 +251,11 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_ERROR
 #define GAME_ERROR(...)       ::bloom::Log::GetGameLogger()->error(__VA_ARGS__)
+#else
+#define GAME_ERROR(...)       (void)0
+#endif
 
 /**
  * @def GAME_WARN(message)
@@ -154,7 +266,11 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_WARN
 #define GAME_WARN(...)        ::bloom::Log::GetGameLogger()->warn(__VA_ARGS__)
+#else
+#define GAME_WARN(...)        (void)0
+#endif
 
 /**
  * @def GAME_INFO(message)
@@ -165,7 +281,11 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_INFO
 #define GAME_INFO(...)        ::bloom::Log::GetGameLogger()->info(__VA_ARGS__)
+#else
+#define GAME_INFO(...)        (void)0
+#endif
 
 /**
  * @def GAME_LOG(message)
@@ -176,5 +296,68 @@ private:
  *
  * @param ... The message and optional arguments to log.
  */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_TRACE
 #define GAME_LOG(...)         ::bloom::Log::GetGameLogger()->trace(__VA_ARGS__)
+#else
+#define GAME_LOG(...)         (void)0
+#endif
+
+// Rate limited log macros, for call sites that run every frame. Each call site keeps its own counter or timer
+
+/**
+ * @def BLOOM_EVERY_N(n, statement)
+ * @brief Runs @c statement on the first call and then once every @c n calls of this call site
+ */
+#define BLOOM_EVERY_N(n, statement) do {\
+                                      static std::atomic<uint64_t> bloomEveryN{0};\
+                                      if (bloomEveryN.fetch_add(1, std::memory_order_relaxed) % (n) == 0) { statement; }\
+                                    } while (false)
+
+/**
+ * @def BLOOM_THROTTLED(ms, statement)
+ * @brief Runs @c statement at most once every @c ms milliseconds for this call site
+ */
+#define BLOOM_THROTTLED(ms, statement) do {\
+                                         static std::atomic<int64_t> bloomThrottled{::bloom::Log::THROTTLE_NEVER};\
+                                         if (::bloom::Log::Throttle(bloomThrottled, ms)) { statement; }\
+                                       } while (false)
 
+/**
+ * @def BLOOM_LOG_EVERY_N(n, message)
+ * @brief Logs a trace message once every @c n calls
+ */
+/**
+ * @def BLOOM_LOG_THROTTLED(ms, message)
+ * @brief Logs a trace message at most once every @c ms milliseconds
+ */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_TRACE
+#define BLOOM_LOG_EVERY_N(n, ...)     BLOOM_EVERY_N(n, BLOOM_LOG(__VA_ARGS__))
+#define BLOOM_LOG_THROTTLED(ms, ...)  BLOOM_THROTTLED(ms, BLOOM_LOG(__VA_ARGS__))
+#define GAME_LOG_EVERY_N(n, ...)      BLOOM_EVERY_N(n, GAME_LOG(__VA_ARGS__))
+#define GAME_LOG_THROTTLED(ms, ...)   BLOOM_THROTTLED(ms, GAME_LOG(__VA_ARGS__))
+#else
+#define BLOOM_LOG_EVERY_N(n, ...)     (void)0
+#define BLOOM_LOG_THROTTLED(ms, ...)  (void)0
+#define GAME_LOG_EVERY_N(n, ...)      (void)0
+#define GAME_LOG_THROTTLED(ms, ...)   (void)0
+#endif
+
+/**
+ * @def BLOOM_WARN_EVERY_N(n, message)
+ * @brief Logs a warning once every @c n calls
+ */
+/**
+ * @def BLOOM_WARN_THROTTLED(ms, message)
+ * @brief Logs a warning at most once every @c ms milliseconds
+ */
+#if BLOOM_ACTIVE_LOG_LEVEL <= BLOOM_LEVEL_WARN
+#define BLOOM_WARN_EVERY_N(n, ...)    BLOOM_EVERY_N(n, BLOOM_WARN(__VA_ARGS__))
+#define BLOOM_WARN_THROTTLED(ms, ...) BLOOM_THROTTLED(ms, BLOOM_WARN(__VA_ARGS__))
+#define GAME_WARN_EVERY_N(n, ...)     BLOOM_EVERY_N(n, GAME_WARN(__VA_ARGS__))
+#define GAME_WARN_THROTTLED(ms, ...)  BLOOM_THROTTLED(ms, GAME_WARN(__VA_ARGS__))
+#else
+#define BLOOM_WARN_EVERY_N(n, ...)    (void)0
+#define BLOOM_WARN_THROTTLED(ms, ...) (void)0
+#define GAME_WARN_EVERY_N(n, ...)     (void)0
+#define GAME_WARN_THROTTLED(ms, ...)  (void)0
+#endif
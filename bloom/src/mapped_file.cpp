@@ -0,0 +1,110 @@
+#include "mapped_file.hpp"
+
+// Windows.h already comes with the precompiled header
+#ifndef BLOOM_PLATFORM_WINDOWS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace bloom {
+
+MappedFile::~MappedFile() {
+  Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept {
+  *this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+  if (this == &other) return *this;
+  Close();
+  m_data = std::exchange(other.m_data, nullptr);
+  m_size = std::exchange(other.m_size, 0);
+#ifdef BLOOM_PLATFORM_WINDOWS
+  m_file = std::exchange(other.m_file, nullptr);
+  m_mapping = std::exchange(other.m_mapping, nullptr);
+#endif
+  return *this;
+}
+
+#ifdef BLOOM_PLATFORM_WINDOWS
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+  HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                            FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (file == INVALID_HANDLE_VALUE) return false;
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_file = file;
+  m_mapping = mapping;
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close() {
+  if (m_data != nullptr) UnmapViewOfFile(m_data);
+  if (m_mapping != nullptr) CloseHandle(m_mapping);
+  if (m_file != nullptr) CloseHandle(m_file);
+  m_data = nullptr;
+  m_size = 0;
+  m_mapping = nullptr;
+  m_file = nullptr;
+}
+
+#else
+
+bool MappedFile::Open(const std::string& path) {
+  Close();
+  int file = open(path.c_str(), O_RDONLY);
+  if (file < 0) return false;
+
+  struct stat info{};
+  if (fstat(file, &info) != 0 || info.st_size == 0) {
+    close(file);
+    return false;
+  }
+
+  auto size = static_cast<size_t>(info.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+  // The mapping keeps its own reference to the file
+  close(file);
+  if (data == MAP_FAILED) return false;
+
+  madvise(data, size, MADV_SEQUENTIAL);
+  m_data = static_cast<const uint8_t*>(data);
+  m_size = size;
+  return true;
+}
+
+void MappedFile::Close() {
+  if (m_data != nullptr) munmap(const_cast<uint8_t*>(m_data), m_size);
+  m_data = nullptr;
+  m_size = 0;
+}
+
+#endif
+
+}
@@ -0,0 +1,50 @@
+/**
+ * @file mapped_file.hpp
+ *
+ * @brief Read only memory mapped files
+ */
+
+#pragma once
+#include <bloom_header.hpp>
+#include <span>
+
+namespace bloom {
+
+/**
+ * @class MappedFile
+ * @brief Maps a whole file read only into the address space
+ *
+ * The OS pages the file in on first touch, so reading it is one copy from the page cache instead of a read into a
+ * temporary buffer plus another copy. Move only, the mapping is released on destruction.
+ */
+class BLOOM_API MappedFile {
+public:
+  MappedFile() = default;
+  ~MappedFile();
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  MappedFile(MappedFile&& other) noexcept;
+  MappedFile& operator=(MappedFile&& other) noexcept;
+
+  /**
+   * @return False if the file doesn't exist, is empty or couldn't be mapped
+   */
+  bool Open(const std::string& path);
+  void Close();
+
+  bool IsOpen() const { return m_data != nullptr; }
+  const uint8_t* Data() const { return m_data; }
+  size_t Size() const { return m_size; }
+  std::span<const uint8_t> View() const { return {m_data, m_size}; }
+
+private:
+  const uint8_t* m_data = nullptr;
+  size_t m_size = 0;
+#ifdef BLOOM_PLATFORM_WINDOWS
+  void* m_file = nullptr;
+  void* m_mapping = nullptr;
+#endif
+};
+
+}
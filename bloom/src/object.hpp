@@ -65,7 +65,9 @@ public:
   std::shared_ptr<render::Model> model;
   glm::vec3 color;
 
-  render::Texture* texture;
+  render::Texture* texture = nullptr;
+  /// Level of detail drawn last frame, the render system keeps it to apply hysteresis
+  uint32_t lod = 0;
 
   id_t GetID() const { return m_id; }
 private:
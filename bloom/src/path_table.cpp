@@ -0,0 +1,26 @@
+#include "path_table.hpp"
+
+namespace bloom {
+
+std::mutex PathTable::s_mutex;
+std::deque<std::string> PathTable::s_paths;
+std::unordered_map<std::string, PathTable::Id, PathTable::Hash, std::equal_to<>> PathTable::s_ids;
+
+PathTable::Id PathTable::Intern(std::string_view path) {
+  std::lock_guard lock(s_mutex);
+  auto it = s_ids.find(path);
+  if (it != s_ids.end()) return it->second;
+
+  const auto id = static_cast<Id>(s_paths.size());
+  s_paths.emplace_back(path);
+  s_ids.emplace(s_paths.back(), id);
+  return id;
+}
+
+const std::string& PathTable::Get(Id id) {
+  static const std::string empty;
+  std::lock_guard lock(s_mutex);
+  return id < s_paths.size() ? s_paths[id] : empty;
+}
+
+}
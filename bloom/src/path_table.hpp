@@ -0,0 +1,47 @@
+/**
+ * @file path_table.hpp
+ *
+ * @brief Process wide table of interned asset paths
+ */
+
+#pragma once
+#include <bloom_header.hpp>
+#include <deque>
+#include <mutex>
+#include <string_view>
+
+namespace bloom {
+
+/**
+ * @class PathTable
+ * @brief Turns paths into small ids that can be copied around instead of the strings
+ *
+ * Events and other fixed size records carry an @c Id, the string is stored once and lives until the process ends.
+ * Interning takes a lock and allocates the first time a path is seen, looking an id up only takes the lock.
+ */
+class BLOOM_API PathTable {
+public:
+  using Id = uint32_t;
+
+  /**
+   * @brief Gets the id of a path, adding it to the table the first time
+   */
+  static Id Intern(std::string_view path);
+  /**
+   * @return Path the id was interned from, empty for unknown ids
+   */
+  static const std::string& Get(Id id);
+
+private:
+  struct Hash {
+    using is_transparent = void;
+    size_t operator()(std::string_view path) const { return std::hash<std::string_view>{}(path); }
+  };
+
+  static std::mutex s_mutex;
+  /// Never shrinks and a deque never moves its elements, references handed out by Get() stay valid
+  static std::deque<std::string> s_paths;
+  static std::unordered_map<std::string, Id, Hash, std::equal_to<>> s_ids;
+};
+
+}
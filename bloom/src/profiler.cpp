@@ -0,0 +1,174 @@
+#include "profiler.hpp"
+#include <fstream>
+#include <limits>
+
+namespace bloom {
+
+std::atomic<bool> Profiler::s_enabled = true;
+std::mutex Profiler::s_threadsMutex;
+std::vector<std::unique_ptr<Profiler::ThreadBuffer>> Profiler::s_threads;
+std::vector<Profiler::ThreadBuffer*> Profiler::s_freeThreads;
+uint32_t Profiler::s_nextThreadId = 0;
+
+Profiler::ThreadBuffer* Profiler::AcquireThreadBuffer() {
+  std::lock_guard lock(s_threadsMutex);
+  ThreadBuffer* buffer = nullptr;
+  if (!s_freeThreads.empty()) {
+    // The exporter only reads under the lock, so the old events can go without racing it
+    buffer = s_freeThreads.back();
+    s_freeThreads.pop_back();
+    buffer->reserved.store(0, std::memory_order_relaxed);
+    buffer->committed.store(0, std::memory_order_relaxed);
+  } else {
+    s_threads.push_back(std::make_unique<ThreadBuffer>());
+    buffer = s_threads.back().get();
+  }
+  buffer->id = s_nextThreadId++;
+  buffer->name = fmt::format("Thread {0}", buffer->id);
+  return buffer;
+}
+
+void Profiler::ReleaseThreadBuffer(ThreadBuffer* buffer) {
+  std::lock_guard lock(s_threadsMutex);
+  s_freeThreads.push_back(buffer);
+}
+
+Profiler::ThreadBuffer* Profiler::GetThreadBuffer() {
+  // thread_local can't be exported from a DLL, so it lives here instead of on the class. Its destructor runs when the
+  // thread exits and gives the buffer back, its events stay on the trace until another thread takes it
+  struct Owner {
+    ThreadBuffer* buffer = nullptr;
+    ~Owner() {
+      if (buffer != nullptr) ReleaseThreadBuffer(buffer);
+    }
+  };
+  static thread_local Owner owner;
+  if (owner.buffer == nullptr) owner.buffer = AcquireThreadBuffer();
+  return owner.buffer;
+}
+
+void Profiler::Push(const Event& event) {
+  auto buffer = GetThreadBuffer();
+  uint64_t head = buffer->committed.load(std::memory_order_relaxed);
+  // Announce the overwrite before touching the slot, the exporter checks it after its copy
+  buffer->reserved.store(head + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  Slot& slot = buffer->events[head & (CAPACITY - 1)];
+  slot.name.store(event.name, std::memory_order_relaxed);
+  slot.start.store(event.start, std::memory_order_relaxed);
+  slot.end.store(event.end, std::memory_order_relaxed);
+  buffer->committed.store(head + 1, std::memory_order_release);
+}
+
+void Profiler::Record(const char* name, int64_t start, int64_t end) {
+  if (!s_enabled.load(std::memory_order_relaxed)) return;
+  Push({name, start, end});
+}
+
+void Profiler::MarkFrame(uint64_t frameNumber) {
+  if (!s_enabled.load(std::memory_order_relaxed)) return;
+  Push({nullptr, Now(), static_cast<int64_t>(frameNumber)});
+}
+
+void Profiler::SetThreadName(const std::string& name) {
+  auto buffer = GetThreadBuffer();
+  std::lock_guard lock(s_threadsMutex);
+  buffer->name = name;
+}
+
+static void WriteJsonString(std::ofstream& file, std::string_view text) {
+  file << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\') file << '\\';
+    file << c;
+  }
+  file << '"';
+}
+
+bool Profiler::WriteChromeTrace(const std::string& path) {
+  struct ThreadEvents {
+    uint32_t id;
+    std::string name;
+    std::vector<Event> events;
+  };
+
+  std::vector<ThreadEvents> threads;
+  {
+    std::lock_guard lock(s_threadsMutex);
+    for (const auto& buffer : s_threads) {
+      // Only complete events, the acquire pairs with the owner's release after writing them
+      uint64_t head = buffer->committed.load(std::memory_order_acquire);
+      uint64_t first = head > CAPACITY ? head - CAPACITY : 0;
+      ThreadEvents thread{buffer->id, buffer->name, {}};
+      thread.events.reserve(head - first);
+      for (uint64_t i = first; i < head; i++) {
+        const Slot& slot = buffer->events[i & (CAPACITY - 1)];
+        thread.events.push_back({slot.name.load(std::memory_order_relaxed), slot.start.load(std::memory_order_relaxed),
+                                 slot.end.load(std::memory_order_relaxed)});
+      }
+
+      // The owner kept writing while we copied, drop whatever it may have overwritten. If we read any value it
+      // stored, the fence makes its reservation of that slot visible below
+      std::atomic_thread_fence(std::memory_order_acquire);
+      uint64_t newHead = buffer->reserved.load(std::memory_order_relaxed);
+      uint64_t overwritten = newHead > CAPACITY ? newHead - CAPACITY : 0;
+      if (overwritten > first) {
+        thread.events.erase(thread.events.begin(),
+                            thread.events.begin() + static_cast<ptrdiff_t>(std::min(overwritten - first, head - first)));
+      }
+      threads.push_back(std::move(thread));
+    }
+  }
+
+  int64_t origin = std::numeric_limits<int64_t>::max();
+  for (const auto& thread : threads) {
+    for (const auto& event : thread.events) {
+      origin = std::min(origin, event.start);
+    }
+  }
+
+  std::ofstream file(path);
+  if (!file) {
+    BLOOM_WARN("Could not open {0} to write the trace", path);
+    return false;
+  }
+
+  // Chrome traces are in microseconds
+  auto microseconds = [origin](int64_t ticks) {
+    return std::chrono::duration<double, std::micro>(Clock::duration(ticks - origin)).count();
+  };
+
+  size_t eventCount = 0;
+  file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (const auto& thread : threads) {
+    if (!first) file << ',';
+    first = false;
+    file << "\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.id << ",\"args\":{\"name\":";
+    WriteJsonString(file, thread.name);
+    file << "}}";
+
+    for (const auto& event : thread.events) {
+      file << ",\n{\"pid\":1,\"tid\":" << thread.id << ",\"ts\":" << fmt::format("{0:.3f}", microseconds(event.start));
+      if (event.name == nullptr) {
+        file << ",\"ph\":\"i\",\"s\":\"g\",\"name\":\"Frame " << event.end << "\"}";
+      } else {
+        file << ",\"ph\":\"X\",\"dur\":" << fmt::format("{0:.3f}", microseconds(event.end) - microseconds(event.start))
+             << ",\"name\":";
+        WriteJsonString(file, event.name);
+        file << '}';
+      }
+    }
+    eventCount += thread.events.size();
+  }
+  file << "\n]}\n";
+
+  if (!file) {
+    BLOOM_WARN("Failed writing the trace to {0}", path);
+    return false;
+  }
+  BLOOM_INFO("Wrote {0} profiler events from {1} threads to {2}", eventCount, threads.size(), path);
+  return true;
+}
+
+}
@@ -0,0 +1,161 @@
+/**
+ * @file profiler.hpp
+ *
+ * @brief CPU scoped timings with Chrome trace export
+ */
+
+#pragma once
+#include <bloom_header.hpp>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace bloom {
+
+/**
+ * @class Profiler
+ * @brief Records CPU scopes into per thread ring buffers and dumps them as a Chrome trace
+ *
+ * Every thread writes into its own buffer, so recording a scope is two clock reads and a few relaxed stores, no locks
+ * and no allocations after the first scope of a thread. Buffers keep the last @c CAPACITY events of each thread and
+ * overwrite the oldest ones. When a thread exits its buffer goes back to a pool and the next new thread takes it
+ * over, so memory is bounded by the threads alive at once. The trace opens in chrome://tracing or ui.perfetto.dev.
+ *
+ * Instrument with @c BLOOM_PROFILE_SCOPE and @c BLOOM_PROFILE_FUNCTION, they compile to nothing without
+ * @c BLOOM_ENABLE_CPU_PROFILER.
+ */
+class BLOOM_API Profiler {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /// Events kept per thread, power of two
+  static constexpr uint64_t CAPACITY = 1 << 16;
+
+  /**
+   * @class Scope
+   * @brief Times the enclosing block, use @c BLOOM_PROFILE_SCOPE
+   */
+  class Scope {
+  public:
+    explicit Scope(const char* name) : m_name(name), m_start(Now()) {}
+    ~Scope() { Record(m_name, m_start, Now()); }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    const char* m_name;
+    int64_t m_start;
+  };
+
+  static int64_t Now() { return Clock::now().time_since_epoch().count(); }
+
+  /**
+   * @brief Stores a finished scope on the calling thread buffer
+   * @param name Has to outlive the profiler, string literals and @c __func__ are fine
+   * @param start Clock ticks from @c Now()
+   * @param end Clock ticks from @c Now()
+   */
+  static void Record(const char* name, int64_t start, int64_t end);
+  /**
+   * @brief Marks the start of a frame, shown as a global instant event on the trace
+   */
+  static void MarkFrame(uint64_t frameNumber);
+  /**
+   * @brief Names the calling thread on the trace
+   */
+  static void SetThreadName(const std::string& name);
+
+  /**
+   * @brief Stops or resumes recording, scopes still read the clock while disabled
+   */
+  static void SetEnabled(bool enabled) { s_enabled.store(enabled, std::memory_order_relaxed); }
+  static bool IsEnabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Writes every buffered event as a Chrome trace JSON file
+   *
+   * Can be called from any thread while others keep recording, events overwritten during the copy are dropped.
+   * Threads that exited are included until a new thread reuses their buffer.
+   * @return False if the file could not be written
+   */
+  static bool WriteChromeTrace(const std::string& path);
+
+private:
+  struct Event {
+    const char* name; ///< nullptr for frame markers
+    int64_t start;
+    int64_t end;      ///< Frame number for frame markers
+  };
+
+  /**
+   * @struct Slot
+   * @brief Storage of one event, atomic so the exporter can read it while the owner thread overwrites it
+   *
+   * Relaxed loads and stores compile to plain moves on the platforms we target, a torn event is caught by the
+   * exporter through @c ThreadBuffer::reserved and dropped.
+   */
+  struct Slot {
+    std::atomic<const char*> name;
+    std::atomic<int64_t> start;
+    std::atomic<int64_t> end;
+  };
+
+  /**
+   * @struct ThreadBuffer
+   * @brief Single producer ring, only its thread writes
+   *
+   * The owner bumps @c reserved before overwriting a slot and @c committed once the event is complete. The exporter
+   * copies the slots below @c committed and then drops the ones @c reserved says may have been overwritten meanwhile.
+   */
+  struct ThreadBuffer {
+    std::unique_ptr<Slot[]> events = std::make_unique<Slot[]>(CAPACITY);
+    std::atomic<uint64_t> reserved = 0;
+    std::atomic<uint64_t> committed = 0;
+    uint32_t id;
+    std::string name;
+  };
+
+  static ThreadBuffer* AcquireThreadBuffer();
+  static void ReleaseThreadBuffer(ThreadBuffer* buffer);
+  static ThreadBuffer* GetThreadBuffer();
+  static void Push(const Event& event);
+
+  static std::atomic<bool> s_enabled;
+  static std::mutex s_threadsMutex;
+  static std::vector<std::unique_ptr<ThreadBuffer>> s_threads;
+  /// Buffers of threads that exited, handed to the next new thread
+  static std::vector<ThreadBuffer*> s_freeThreads;
+  static uint32_t s_nextThreadId;
+};
+
+}
+
+#ifdef BLOOM_ENABLE_CPU_PROFILER
+/**
+ * @def BLOOM_PROFILE_SCOPE(name)
+ * @brief Times the CPU until the end of the enclosing block
+ * @param name String literal identifying the scope
+ */
+#define BLOOM_PROFILE_SCOPE(name) ::bloom::Profiler::Scope BLOOM_CONCAT(bloomProfileScope, __LINE__)(name)
+/**
+ * @def BLOOM_PROFILE_FUNCTION()
+ * @brief Times the CPU until the end of the enclosing function, named after it
+ */
+#define BLOOM_PROFILE_FUNCTION() BLOOM_PROFILE_SCOPE(__func__)
+/**
+ * @def BLOOM_PROFILE_FRAME(frameNumber)
+ * @brief Marks the start of a frame on the trace
+ */
+#define BLOOM_PROFILE_FRAME(frameNumber) ::bloom::Profiler::MarkFrame(frameNumber)
+/**
+ * @def BLOOM_PROFILE_THREAD(name)
+ * @brief Names the calling thread on the trace
+ */
+#define BLOOM_PROFILE_THREAD(name) ::bloom::Profiler::SetThreadName(name)
+#else
+#define BLOOM_PROFILE_SCOPE(name)
+#define BLOOM_PROFILE_FUNCTION()
+#define BLOOM_PROFILE_FRAME(frameNumber)
+#define BLOOM_PROFILE_THREAD(name)
+#endif
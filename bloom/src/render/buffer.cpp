@@ -0,0 +1,49 @@
+#include "buffer.hpp"
+
+namespace bloom::render {
+
+Buffer::Buffer(Devices* devices, VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage,
+               VkMemoryPropertyFlags memoryProperties, VkDeviceSize minOffsetAlignment) :
+    m_devices(devices), m_instanceSize(instanceSize), m_instanceCount(instanceCount) {
+  m_alignmentSize = GetAlignment(instanceSize, minOffsetAlignment);
+  m_bufferSize = m_alignmentSize * instanceCount;
+  m_devices->createBuffer(m_bufferSize, usage, memoryProperties, m_buffer, m_memory);
+}
+
+Buffer::~Buffer() {
+  Unmap();
+  vkDestroyBuffer(m_devices->device(), m_buffer, nullptr);
+  vkFreeMemory(m_devices->device(), m_memory, nullptr);
+}
+
+void Buffer::Map() {
+  if (m_mapped != nullptr) return;
+  if (vkMapMemory(m_devices->device(), m_memory, 0, VK_WHOLE_SIZE, 0, &m_mapped) != VK_SUCCESS) {
+    BLOOM_ERROR("Failed to map buffer memory");
+  }
+}
+
+void Buffer::Unmap() {
+  if (m_mapped == nullptr) return;
+  vkUnmapMemory(m_devices->device(), m_memory);
+  m_mapped = nullptr;
+}
+
+void Buffer::WriteToBuffer(const void* data, VkDeviceSize size, VkDeviceSize offset) {
+  if (m_mapped == nullptr) {
+    BLOOM_WARN("Cannot write to an unmapped buffer");
+    return;
+  }
+
+  if (size == VK_WHOLE_SIZE) size = m_bufferSize - offset;
+  memcpy(static_cast<char*>(m_mapped) + offset, data, static_cast<size_t>(size));
+}
+
+VkDeviceSize Buffer::GetAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment) {
+  if (minOffsetAlignment > 0) {
+    return (instanceSize + minOffsetAlignment - 1) & ~(minOffsetAlignment - 1);
+  }
+  return instanceSize;
+}
+
+}
@@ -0,0 +1,73 @@
+/**
+ * @file buffer.hpp
+ *
+ * @brief Wrapper around a Vulkan buffer and its memory
+ */
+
+#pragma once
+#include "devices.hpp"
+
+namespace bloom::render {
+
+/**
+ * @class Buffer
+ * @brief Owns a @c VkBuffer with its @c VkDeviceMemory
+ *
+ * The buffer is split in @c instanceCount instances of @c instanceSize bytes, each one aligned to
+ * @c minOffsetAlignment so they can be used as dynamic offsets or as per frame copies of the same data.
+ */
+class BLOOM_API Buffer {
+public:
+  Buffer(Devices* devices, VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usage,
+         VkMemoryPropertyFlags memoryProperties, VkDeviceSize minOffsetAlignment = 1);
+  ~Buffer();
+
+  Buffer(const Buffer&) = delete;
+  Buffer& operator=(const Buffer&) = delete;
+
+  /**
+   * @brief Maps the whole buffer, memory must be host visible
+   */
+  void Map();
+  void Unmap();
+
+  /**
+   * @brief Copies data into the mapped buffer
+   * @param data Data to copy
+   * @param size Size of the data, @c VK_WHOLE_SIZE copies the whole buffer
+   * @param offset Offset in bytes from the start of the buffer
+   */
+  void WriteToBuffer(const void* data, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+  /**
+   * @brief Copies data into an instance of the mapped buffer
+   */
+  void WriteToIndex(const void* data, uint32_t index) { WriteToBuffer(data, m_instanceSize, index * m_alignmentSize); }
+
+  VkDescriptorBufferInfo DescriptorInfo(VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0) const {
+    return VkDescriptorBufferInfo{m_buffer, offset, size};
+  }
+  VkDescriptorBufferInfo DescriptorInfoForIndex(uint32_t index) const {
+    return DescriptorInfo(m_alignmentSize, index * m_alignmentSize);
+  }
+
+  VkBuffer GetBuffer() const { return m_buffer; }
+  void* GetMappedMemory() const { return m_mapped; }
+  VkDeviceSize GetBufferSize() const { return m_bufferSize; }
+  VkDeviceSize GetAlignmentSize() const { return m_alignmentSize; }
+  uint32_t GetInstanceCount() const { return m_instanceCount; }
+
+private:
+  static VkDeviceSize GetAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
+
+  Devices* m_devices;
+  VkBuffer m_buffer = VK_NULL_HANDLE;
+  VkDeviceMemory m_memory = VK_NULL_HANDLE;
+  void* m_mapped = nullptr;
+
+  VkDeviceSize m_bufferSize;
+  VkDeviceSize m_instanceSize;
+  VkDeviceSize m_alignmentSize;
+  uint32_t m_instanceCount;
+};
+
+}
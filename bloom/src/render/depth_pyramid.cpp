@@ -0,0 +1,235 @@
+#include "depth_pyramid.hpp"
+#include "swap_chain.hpp"
+#include "src/profiler.hpp"
+
+namespace bloom::render {
+
+/**
+ * @struct ReduceConstants
+ * @brief Push constants of @c depth_pyramid.comp
+ */
+struct ReduceConstants {
+  glm::uvec2 sourceSize;
+  glm::uvec2 destinationSize;
+};
+
+static uint32_t PreviousPowerOfTwo(uint32_t value) {
+  uint32_t result = 1;
+  while (result * 2 <= value) result *= 2;
+  return result;
+}
+
+static VkImageAspectFlags DepthAspects(VkFormat format) {
+  // Without separate depth stencil layouts both aspects of a combined format change layout together
+  const bool stencil = format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+                       format == VK_FORMAT_D16_UNORM_S8_UINT;
+  return VK_IMAGE_ASPECT_DEPTH_BIT | (stencil ? VK_IMAGE_ASPECT_STENCIL_BIT : 0);
+}
+
+DepthPyramid::DepthPyramid(Devices* devices, VkExtent2D extent) : m_devices(devices), m_sourceExtent(extent) {
+  m_extent = {PreviousPowerOfTwo(std::max(extent.width, 1u)), PreviousPowerOfTwo(std::max(extent.height, 1u))};
+  while (m_levelCount < MAX_LEVELS && (m_extent.width >> m_levelCount > 0 || m_extent.height >> m_levelCount > 0)) {
+    m_levelCount++;
+  }
+
+  CreateImage();
+  CreateDescriptors();
+  m_pipeline = std::make_unique<Pipeline>(*m_devices, "resources/shaders/depth_pyramid.comp.spv", m_pipelineLayout);
+  BLOOM_LOG("Depth pyramid: {0}x{1}, {2} levels", m_extent.width, m_extent.height, m_levelCount);
+}
+
+DepthPyramid::~DepthPyramid() {
+  VkDevice device = m_devices->device();
+  vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+  vkDestroySampler(device, m_sampler, nullptr);
+  for (auto view : m_levelViews) vkDestroyImageView(device, view, nullptr);
+  vkDestroyImageView(device, m_view, nullptr);
+  vkDestroyImage(device, m_image, nullptr);
+  vkFreeMemory(device, m_memory, nullptr);
+}
+
+void DepthPyramid::CreateImage() {
+  VkImageCreateInfo imageInfo{};
+  imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+  imageInfo.imageType = VK_IMAGE_TYPE_2D;
+  imageInfo.format = VK_FORMAT_R32_SFLOAT;
+  imageInfo.extent = {m_extent.width, m_extent.height, 1};
+  imageInfo.mipLevels = m_levelCount;
+  imageInfo.arrayLayers = 1;
+  imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+  imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+  imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+  imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+  imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  m_devices->createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_memory);
+
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = m_image;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = VK_FORMAT_R32_SFLOAT;
+  viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_levelCount, 0, 1};
+  if (vkCreateImageView(m_devices->device(), &viewInfo, nullptr, &m_view) != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create depth pyramid view");
+  }
+  m_levelViews.resize(m_levelCount);
+  for (uint32_t i = 0; i < m_levelCount; i++) {
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, i, 1, 0, 1};
+    if (vkCreateImageView(m_devices->device(), &viewInfo, nullptr, &m_levelViews[i]) != VK_SUCCESS) {
+      BLOOM_CRITICAL("Failed to create depth pyramid level view");
+    }
+  }
+
+  // Texels are fetched at exact levels, filtering would mix in depths from outside of the footprint
+  VkSamplerCreateInfo samplerInfo{};
+  samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  samplerInfo.magFilter = VK_FILTER_NEAREST;
+  samplerInfo.minFilter = VK_FILTER_NEAREST;
+  samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+  samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+  samplerInfo.minLod = 0.0f;
+  samplerInfo.maxLod = static_cast<float>(m_levelCount);
+  samplerInfo.maxAnisotropy = 1.0f;
+  if (vkCreateSampler(m_devices->device(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create depth pyramid sampler");
+  }
+
+  // Descriptors pointing at it expect GENERAL even before the first build
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = m_image;
+  barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_levelCount, 0, 1};
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  VkCommandBuffer commandBuffer = m_devices->beginSingleTimeCommands();
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                       0, nullptr, 0, nullptr, 1, &barrier);
+  m_devices->endSingleTimeCommands(commandBuffer);
+}
+
+void DepthPyramid::CreateDescriptors() {
+  m_setLayout = std::make_unique<DescriptorSetLayout>(m_devices, std::vector<VkDescriptorSetLayoutBinding>{
+      {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+  });
+
+  const uint32_t setCount = m_levelCount + SwapChain::MAX_FRAMES_IN_FLIGHT;
+  m_descriptorPool = std::make_unique<DescriptorPool>(m_devices, setCount, std::vector<VkDescriptorPoolSize>{
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, setCount},
+      {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, setCount},
+  });
+
+  VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(ReduceConstants)};
+  VkDescriptorSetLayout setLayout = m_setLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &setLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(m_devices->device(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create depth pyramid pipeline layout");
+  }
+
+  m_levelSets.resize(m_levelCount, VK_NULL_HANDLE);
+  for (uint32_t i = 1; i < m_levelCount; i++) {
+    if (!m_descriptorPool->allocateDescriptorSet(setLayout, m_levelSets[i])) {
+      BLOOM_CRITICAL("Failed to allocate depth pyramid descriptor set");
+    }
+    WriteSet(m_levelSets[i], m_levelViews[i - 1], VK_IMAGE_LAYOUT_GENERAL, i);
+  }
+  m_depthSets.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+  for (auto& set : m_depthSets) {
+    if (!m_descriptorPool->allocateDescriptorSet(setLayout, set)) {
+      BLOOM_CRITICAL("Failed to allocate depth pyramid descriptor set");
+    }
+  }
+}
+
+void DepthPyramid::WriteSet(VkDescriptorSet set, VkImageView source, VkImageLayout sourceLayout,
+                            uint32_t level) const {
+  VkDescriptorImageInfo sourceInfo{m_sampler, source, sourceLayout};
+  VkDescriptorImageInfo destinationInfo{VK_NULL_HANDLE, m_levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+
+  std::array<VkWriteDescriptorSet, 2> writes{};
+  for (uint32_t i = 0; i < writes.size(); i++) {
+    writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[i].dstSet = set;
+    writes[i].dstBinding = i;
+    writes[i].descriptorCount = 1;
+  }
+  writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  writes[0].pImageInfo = &sourceInfo;
+  writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+  writes[1].pImageInfo = &destinationInfo;
+  vkUpdateDescriptorSets(m_devices->device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void DepthPyramid::Build(VkCommandBuffer commandBuffer, int frameIndex, const DepthAttachment& depth) {
+  BLOOM_PROFILE_FUNCTION();
+  // The set of this frame in flight isn't in use anymore, the frame that used it has finished
+  WriteSet(m_depthSets[frameIndex], depth.view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, 0);
+
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  for (auto& barrier : barriers) {
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  }
+  barriers[0].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  barriers[0].image = depth.image;
+  barriers[0].subresourceRange = {DepthAspects(depth.format), 0, 1, 0, 1};
+  // Whatever the previous frame culled with is discarded, its reads have to be done first
+  barriers[1].srcAccessMask = 0;
+  barriers[1].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barriers[1].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+  barriers[1].image = m_image;
+  barriers[1].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_levelCount, 0, 1};
+  vkCmdPipelineBarrier(commandBuffer,
+                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr,
+                       static_cast<uint32_t>(barriers.size()), barriers.data());
+
+  m_pipeline->Bind(commandBuffer);
+  VkExtent2D source = m_sourceExtent;
+  for (uint32_t level = 0; level < m_levelCount; level++) {
+    const VkExtent2D destination = {std::max(m_extent.width >> level, 1u), std::max(m_extent.height >> level, 1u)};
+    const ReduceConstants constants{{source.width, source.height}, {destination.width, destination.height}};
+    VkDescriptorSet set = level == 0 ? m_depthSets[frameIndex] : m_levelSets[level];
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &set, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (destination.width + 7) / 8, (destination.height + 7) / 8, 1);
+
+    // The next level reads this one, the last barrier also publishes the whole pyramid to the culling
+    VkImageMemoryBarrier levelBarrier = barriers[1];
+    levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    levelBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    levelBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &levelBarrier);
+    source = destination;
+  }
+
+  // Back to an attachment for the rest of the render pass
+  barriers[0].srcAccessMask = 0;
+  barriers[0].dstAccessMask =
+      VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  barriers[0].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+  barriers[0].newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                       0, 0, nullptr, 0, nullptr, 1, &barriers[0]);
+}
+
+}
@@ -0,0 +1,85 @@
+/**
+ * @file depth_pyramid.hpp
+ *
+ * @brief Hierarchical depth buffer occlusion culling tests bounds against
+ */
+
+#pragma once
+#include "pipeline.hpp"
+#include "descriptor_pool.hpp"
+#include "descriptor_set_layout.hpp"
+#include "render_target.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class DepthPyramid
+ * @brief Mip chain of a depth buffer where every texel holds the farthest depth of the pixels it covers
+ *
+ * Level 0 is the largest power of two that fits the depth buffer, so every level halves the previous one exactly and
+ * a texel of any level covers a fixed screen footprint. Each level is reduced from the previous one by
+ * @c depth_pyramid.comp, the first from the depth buffer itself.
+ *
+ * Anything whose nearest depth is farther than the pyramid over its screen rect is hidden behind what was drawn. A
+ * couple of texels of the right level cover any rect, so the test costs four fetches no matter the size on screen.
+ *
+ * The image stays in @c GENERAL layout. A single pyramid is shared by every frame in flight, @c Build() waits for the
+ * reads of the previous frame before overwriting it.
+ */
+class BLOOM_API DepthPyramid {
+public:
+  static constexpr uint32_t MAX_LEVELS = 16;
+
+  /**
+   * @param extent Size of the depth buffers the pyramid is built from
+   */
+  DepthPyramid(Devices* devices, VkExtent2D extent);
+  ~DepthPyramid();
+
+  DepthPyramid(const DepthPyramid&) = delete;
+  DepthPyramid& operator=(const DepthPyramid&) = delete;
+
+  /**
+   * @brief Records the reduction of a depth buffer, has to be outside of a render pass
+   *
+   * The depth has to be in attachment layout with its writes done, it is sampled and put back in attachment layout.
+   * The pyramid is ready for compute shaders once this returns.
+   */
+  void Build(VkCommandBuffer commandBuffer, int frameIndex, const DepthAttachment& depth);
+
+  /// Whole mip chain with a nearest sampler, for combined image sampler descriptors
+  VkDescriptorImageInfo DescriptorInfo() const { return {m_sampler, m_view, VK_IMAGE_LAYOUT_GENERAL}; }
+  /// Extent of the depth buffers it is built from
+  VkExtent2D GetSourceExtent() const { return m_sourceExtent; }
+  /// Size of level 0
+  VkExtent2D GetExtent() const { return m_extent; }
+  uint32_t GetLevelCount() const { return m_levelCount; }
+
+private:
+  void CreateImage();
+  void CreateDescriptors();
+  void WriteSet(VkDescriptorSet set, VkImageView source, VkImageLayout sourceLayout, uint32_t level) const;
+
+  Devices* m_devices;
+  VkExtent2D m_sourceExtent;
+  VkExtent2D m_extent;
+  uint32_t m_levelCount = 1;
+
+  VkImage m_image = VK_NULL_HANDLE;
+  VkDeviceMemory m_memory = VK_NULL_HANDLE;
+  VkImageView m_view = VK_NULL_HANDLE;
+  std::vector<VkImageView> m_levelViews;
+  VkSampler m_sampler = VK_NULL_HANDLE;
+
+  std::unique_ptr<DescriptorSetLayout> m_setLayout;
+  std::unique_ptr<DescriptorPool> m_descriptorPool;
+  VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<Pipeline> m_pipeline;
+  /// Reduce level i - 1 into level i, the first one is unused
+  std::vector<VkDescriptorSet> m_levelSets;
+  /// Reduce the depth buffer into level 0, one per frame in flight since the depth image changes every frame
+  std::vector<VkDescriptorSet> m_depthSets;
+};
+
+}
@@ -2,11 +2,11 @@
 
 namespace bloom::render {
 
-DescriptorPool::DescriptorPool(Devices* devices, uint32_t maxSets) : devices(devices){
-  std::array<VkDescriptorPoolSize, 1> poolSizes{};
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[0].descriptorCount = maxSets;
+DescriptorPool::DescriptorPool(Devices* devices, uint32_t maxSets) :
+    DescriptorPool(devices, maxSets, {{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, maxSets}}) { }
 
+DescriptorPool::DescriptorPool(Devices* devices, uint32_t maxSets, const std::vector<VkDescriptorPoolSize>& poolSizes) :
+    devices(devices) {
   VkDescriptorPoolCreateInfo poolInfo{};
   poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
   poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
@@ -22,4 +22,13 @@ DescriptorPool::~DescriptorPool() {
   vkDestroyDescriptorPool(devices->device(), descriptorPool, nullptr);
 }
 
+bool DescriptorPool::allocateDescriptorSet(VkDescriptorSetLayout layout, VkDescriptorSet& descriptorSet) const {
+  VkDescriptorSetAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+  allocInfo.descriptorPool = descriptorPool;
+  allocInfo.descriptorSetCount = 1;
+  allocInfo.pSetLayouts = &layout;
+  return vkAllocateDescriptorSets(devices->device(), &allocInfo, &descriptorSet) == VK_SUCCESS;
+}
+
 }
\ No newline at end of file
@@ -14,9 +14,21 @@ namespace bloom::render {
 class BLOOM_API DescriptorPool {
 public:
   DescriptorPool(Devices* devices, uint32_t maxSets);
+  /**
+   * @brief Creates a pool able to hold any kind of descriptor
+   * @param devices Device the pool is created on
+   * @param maxSets Maximum number of sets that can be allocated
+   * @param poolSizes Number of descriptors of each type the pool holds
+   */
+  DescriptorPool(Devices* devices, uint32_t maxSets, const std::vector<VkDescriptorPoolSize>& poolSizes);
   ~DescriptorPool();
 
   VkDescriptorPool getDescriptorPool() const { return descriptorPool; }
+  /**
+   * @brief Allocates a single descriptor set from the pool
+   * @return @c false if the pool is exhausted or fragmented
+   */
+  bool allocateDescriptorSet(VkDescriptorSetLayout layout, VkDescriptorSet& descriptorSet) const;
 
 private:
   Devices* devices;
@@ -66,7 +66,17 @@ void DestroyDebugUtilsMessengerEXT(
 }
 
 // class member functions
-Devices::Devices(Window &window) : window{window} {
+Devices::Devices(Window &window) : window{&window} {
+  init();
+}
+
+Devices::Devices(const std::string &preferredDevice) : preferredDevice_{preferredDevice} {
+  // Nothing to present to, the swap chain extension is not needed
+  deviceExtensions.clear();
+  init();
+}
+
+void Devices::init() {
   createInstance();
   setupDebugMessenger();
   createSurface();
@@ -83,7 +93,9 @@ Devices::~Devices() {
     DestroyDebugUtilsMessengerEXT(instance, debugMessenger, nullptr);
   }
 
-  vkDestroySurfaceKHR(instance, surface_, nullptr);
+  if (surface_ != VK_NULL_HANDLE) {
+    vkDestroySurfaceKHR(instance, surface_, nullptr);
+  }
   vkDestroyInstance(instance, nullptr);
 }
 
@@ -98,7 +110,7 @@ void Devices::createInstance() {
   appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
   appInfo.pEngineName = "No Engine";
   appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-  appInfo.apiVersion = VK_API_VERSION_1_0;
+  appInfo.apiVersion = VK_API_VERSION_1_2;
 
   VkInstanceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -138,9 +150,25 @@ void Devices::pickPhysicalDevice() {
   vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
   for (const auto &device : devices) {
-    if (isDeviceSuitable(device)) {
-      physicalDevice = device;
-      break;
+    if (!isDeviceSuitable(device)) continue;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    BLOOM_LOG("Suitable device: {0}", deviceProperties.deviceName);
+    if (!preferredDevice_.empty() && std::string(deviceProperties.deviceName).find(preferredDevice_) == std::string::npos) {
+      continue;
+    }
+    physicalDevice = device;
+    break;
+  }
+
+  if (physicalDevice == VK_NULL_HANDLE && !preferredDevice_.empty()) {
+    BLOOM_WARN("No device matches \"{0}\", using the first suitable one", preferredDevice_);
+    for (const auto &device : devices) {
+      if (isDeviceSuitable(device)) {
+        physicalDevice = device;
+        break;
+      }
     }
   }
 
@@ -150,6 +178,44 @@ void Devices::pickPhysicalDevice() {
 
   vkGetPhysicalDeviceProperties(physicalDevice, &properties);
   BLOOM_LOG("Physical device: {0}", properties.deviceName);
+  queryDeviceFeatures();
+}
+
+void Devices::queryDeviceFeatures() {
+  VkPhysicalDeviceFeatures supportedFeatures;
+  vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+  features_ = {};
+  features_.samplerAnisotropy = VK_TRUE;
+  // Profiling only, enabled when available
+  features_.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+  features_.occlusionQueryPrecise = supportedFeatures.occlusionQueryPrecise;
+  BLOOM_LOG("Pipeline statistics queries: {0}", features_.pipelineStatisticsQuery == VK_TRUE);
+  // GPU driven rendering, draws come from a buffer and index their object with firstInstance
+  features_.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+  features_.drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance;
+  features_.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+
+  features12_ = {};
+  features12_.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  // Older devices can't even be asked about 1.2 features, everything stays disabled
+  if (properties.apiVersion < VK_API_VERSION_1_2) {
+    BLOOM_WARN("Device only supports Vulkan {0}.{1}, 1.2 features disabled",
+               VK_API_VERSION_MAJOR(properties.apiVersion), VK_API_VERSION_MINOR(properties.apiVersion));
+    return;
+  }
+
+  VkPhysicalDeviceVulkan12Features supported12{};
+  supported12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+  VkPhysicalDeviceFeatures2 supported{};
+  supported.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  supported.pNext = &supported12;
+  vkGetPhysicalDeviceFeatures2(physicalDevice, &supported);
+
+  // Only enable what we actually use
+  features12_.timelineSemaphore = supported12.timelineSemaphore;
+  BLOOM_LOG("Timeline semaphores: {0}", features12_.timelineSemaphore == VK_TRUE);
+  features12_.drawIndirectCount = supported12.drawIndirectCount;
+  BLOOM_LOG("Draw indirect count: {0}", features12_.drawIndirectCount == VK_TRUE);
 }
 
 void Devices::createLogicalDevice() {
@@ -168,8 +234,7 @@ void Devices::createLogicalDevice() {
     queueCreateInfos.push_back(queueCreateInfo);
   }
 
-  VkPhysicalDeviceFeatures deviceFeatures = {};
-  deviceFeatures.samplerAnisotropy = VK_TRUE;
+  VkPhysicalDeviceFeatures deviceFeatures = features_;
 
   VkDeviceCreateInfo createInfo = {};
   createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
@@ -177,7 +242,18 @@ void Devices::createLogicalDevice() {
   createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
   createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
-  createInfo.pEnabledFeatures = &deviceFeatures;
+  // 1.2 features go through VkPhysicalDeviceFeatures2, which replaces pEnabledFeatures
+  VkPhysicalDeviceVulkan12Features features12 = features12_;
+  VkPhysicalDeviceFeatures2 deviceFeatures2{};
+  deviceFeatures2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  deviceFeatures2.pNext = &features12;
+  deviceFeatures2.features = deviceFeatures;
+  if (properties.apiVersion >= VK_API_VERSION_1_2) {
+    createInfo.pNext = &deviceFeatures2;
+    createInfo.pEnabledFeatures = nullptr;
+  } else {
+    createInfo.pEnabledFeatures = &deviceFeatures;
+  }
   createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
   createInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
@@ -212,15 +288,18 @@ void Devices::createCommandPool() {
   }
 }
 
-void Devices::createSurface() { window.CreateWindowSurface(instance, &surface_); }
+void Devices::createSurface() {
+  if (window == nullptr) return;
+  window->CreateWindowSurface(instance, &surface_);
+}
 
 bool Devices::isDeviceSuitable(VkPhysicalDevice device) {
   QueueFamilyIndices indices = findQueueFamilies(device);
 
   bool extensionsSupported = checkDeviceExtensionSupport(device);
 
-  bool swapChainAdequate = false;
-  if (extensionsSupported) {
+  bool swapChainAdequate = isHeadless();
+  if (extensionsSupported && !isHeadless()) {
     SwapChainSupportDetails swapChainSupport = querySwapChainSupport(device);
     swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
   }
@@ -282,11 +361,14 @@ bool Devices::checkValidationLayerSupport() {
 }
 
 std::vector<const char *> Devices::getRequiredExtensions() {
-  uint32_t glfwExtensionCount = 0;
-  const char **glfwExtensions;
-  glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-  std::vector<const char *> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  std::vector<const char *> extensions;
+  // GLFW might not even be initialized without a display
+  if (!isHeadless()) {
+    uint32_t glfwExtensionCount = 0;
+    const char **glfwExtensions;
+    glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+    extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+  }
 
   if (enableValidationLayers) {
     extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -353,8 +435,13 @@ QueueFamilyIndices Devices::findQueueFamilies(VkPhysicalDevice device) {
       indices.graphicsFamily = i;
       indices.graphicsFamilyHasValue = true;
     }
+    // Headless devices never present, the graphics queue stands in for the present one
     VkBool32 presentSupport = false;
-    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    if (isHeadless()) {
+      presentSupport = indices.graphicsFamilyHasValue && indices.graphicsFamily == static_cast<uint32_t>(i);
+    } else {
+      vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface_, &presentSupport);
+    }
     if (queueFamily.queueCount > 0 && presentSupport) {
       indices.presentFamily = i;
       indices.presentFamilyHasValue = true;
@@ -36,6 +36,13 @@ class Devices {
 #endif
 
   Devices(Window &window);
+  /**
+   * @brief Creates a headless device, without a surface or swap chain support
+   *
+   * Used to render offscreen on machines without a display, software implementations like lavapipe work too
+   * @param preferredDevice Picks the first suitable device whose name contains this, empty picks the first one
+   */
+  explicit Devices(const std::string &preferredDevice = "");
   virtual ~Devices();
 
   // Not copyable or movable
@@ -45,8 +52,10 @@ class Devices {
   Devices& operator=(Devices &&) = delete;
 
   VkCommandPool getCommandPool() { return commandPool; }
+  VkPhysicalDevice getPhysicalDevice() { return physicalDevice; }
   VkDevice device() { return device_; }
   VkSurfaceKHR surface() { return surface_; }
+  bool isHeadless() const { return window == nullptr; }
   VkQueue graphicsQueue() { return graphicsQueue_; }
   VkQueue presentQueue() { return presentQueue_; }
 
@@ -75,15 +84,41 @@ class Devices {
       VkImage &image,
       VkDeviceMemory &imageMemory);
 
+  /**
+   * @brief Whether timeline semaphores were enabled on the logical device (Vulkan 1.2 core)
+   */
+  bool supportsTimelineSemaphore() const { return features12_.timelineSemaphore == VK_TRUE; }
+  /**
+   * @brief Whether pipeline statistics queries were enabled on the logical device
+   */
+  bool supportsPipelineStatistics() const { return features_.pipelineStatisticsQuery == VK_TRUE; }
+  /**
+   * @brief Whether occlusion queries can return exact sample counts instead of just zero / non zero
+   */
+  bool supportsPreciseOcclusion() const { return features_.occlusionQueryPrecise == VK_TRUE; }
+  /**
+   * @brief Whether the device can draw from buffers filled on the GPU, see @c GpuScene
+   */
+  bool supportsGpuDrivenRendering() const {
+    return features_.multiDrawIndirect == VK_TRUE && features_.drawIndirectFirstInstance == VK_TRUE &&
+           features_.shaderSampledImageArrayDynamicIndexing == VK_TRUE;
+  }
+  /**
+   * @brief Whether the number of indirect draws can come from a buffer (Vulkan 1.2 core)
+   */
+  bool supportsDrawIndirectCount() const { return features12_.drawIndirectCount == VK_TRUE; }
+
   VkPhysicalDeviceProperties properties;
 
  private:
+  void init();
   void createInstance();
   void setupDebugMessenger();
   void createSurface();
   void pickPhysicalDevice();
   void createLogicalDevice();
   void createCommandPool();
+  void queryDeviceFeatures();
 
   // helper functions
   bool isDeviceSuitable(VkPhysicalDevice device);
@@ -98,16 +133,19 @@ class Devices {
   VkInstance instance;
   VkDebugUtilsMessengerEXT debugMessenger;
   VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
-  Window &window;
+  Window *window = nullptr;
+  std::string preferredDevice_;
   VkCommandPool commandPool;
 
   VkDevice device_;
-  VkSurfaceKHR surface_;
+  VkSurfaceKHR surface_ = VK_NULL_HANDLE;
   VkQueue graphicsQueue_;
   VkQueue presentQueue_;
+  VkPhysicalDeviceFeatures features_{};
+  VkPhysicalDeviceVulkan12Features features12_{};
 
   const std::vector<const char *> validationLayers = {"VK_LAYER_KHRONOS_validation"};
-  const std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+  std::vector<const char *> deviceExtensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 };
 
 }  // namespace lve
\ No newline at end of file
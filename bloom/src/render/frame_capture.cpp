@@ -0,0 +1,232 @@
+#include "frame_capture.hpp"
+#include "src/profiler.hpp"
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+#include <filesystem>
+#include <fstream>
+
+namespace bloom::render {
+
+FrameCapture::FrameCapture(Devices* devices, uint32_t slotCount) : m_devices(devices) {
+  m_slots.resize(std::max<uint32_t>(slotCount, 1));
+  for (auto& slot : m_slots) {
+    slot = std::make_unique<Slot>();
+  }
+}
+
+FrameCapture::~FrameCapture() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_stop = true;
+  }
+  m_condition.notify_all();
+  if (m_worker.joinable()) {
+    m_worker.join();
+  }
+}
+
+void FrameCapture::CaptureFrame(const std::string& path, Encoding encoding) {
+  m_requests.push_back({path, encoding});
+}
+
+void FrameCapture::StartSequence(const std::string& directory, Encoding encoding) {
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  if (error) {
+    BLOOM_WARN("Could not create capture directory {0}: {1}", directory, error.message());
+    return;
+  }
+  m_sequence = true;
+  m_sequenceDirectory = directory;
+  m_sequenceEncoding = encoding;
+  BLOOM_INFO("Capturing frames into {0}", directory);
+}
+
+void FrameCapture::StopSequence() {
+  if (!m_sequence) return;
+  m_sequence = false;
+  BLOOM_INFO("Frame capture stopped, {0} frames captured, {1} dropped", m_capturedFrames, m_droppedFrames);
+}
+
+void FrameCapture::SetCallback(Callback callback) {
+  std::lock_guard lock(m_mutex);
+  m_callback = std::move(callback);
+}
+
+void FrameCapture::Record(VkCommandBuffer commandBuffer, RenderTarget& target, uint32_t imageIndex,
+                          uint64_t frameNumber) {
+  if (!IsCapturing()) return;
+  if (!target.SupportsReadback()) {
+    BLOOM_WARN("Render target doesn't support readback, capture cancelled");
+    m_requests.clear();
+    m_sequence = false;
+    return;
+  }
+
+  Request request;
+  if (!m_requests.empty()) {
+    request = m_requests.front();
+  } else {
+    const char* extension = m_sequenceEncoding == Encoding::Png ? "png" : "raw";
+    request = {fmt::format("{0}/frame_{1:06}.{2}", m_sequenceDirectory, frameNumber, extension), m_sequenceEncoding};
+  }
+
+  auto it = std::find_if(m_slots.begin(), m_slots.end(),
+                         [](const auto& slot) { return slot->state == SlotState::Free; });
+  if (it == m_slots.end()) {
+    // Never stall the render thread, single captures are retried next frame
+    m_droppedFrames++;
+    return;
+  }
+  if (!m_requests.empty()) m_requests.pop_front();
+
+  Slot& slot = **it;
+  const VkExtent2D extent = target.GetExtent();
+  const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+  if (slot.buffer == nullptr || slot.buffer->GetBufferSize() < size) {
+    // The slot is free so neither the GPU nor the worker are using the old buffer
+    slot.buffer = std::make_unique<Buffer>(m_devices, size, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    slot.buffer->Map();
+  }
+  slot.frameNumber = frameNumber;
+  slot.extent = extent;
+  slot.format = target.GetColorFormat();
+  slot.request = std::move(request);
+  slot.state = SlotState::Pending;
+
+  VkImage image = target.GetColorImage(static_cast<int>(imageIndex));
+  const VkImageLayout layout = target.GetColorLayout();
+
+  VkImageMemoryBarrier toTransfer{};
+  toTransfer.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  toTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  toTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  toTransfer.oldLayout = layout;
+  toTransfer.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toTransfer.image = image;
+  toTransfer.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       0, 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+  VkBufferImageCopy region{};
+  region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+  region.imageExtent = {extent.width, extent.height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, slot.buffer->GetBuffer(), 1,
+                         &region);
+
+  VkBufferMemoryBarrier toHost{};
+  toHost.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  toHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  toHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  toHost.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  toHost.buffer = slot.buffer->GetBuffer();
+  toHost.size = size;
+
+  // Give the image back in the layout the target expects, e.g. PRESENT_SRC for the swap chain
+  VkImageMemoryBarrier toTarget = toTransfer;
+  toTarget.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+  toTarget.dstAccessMask = 0;
+  toTarget.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+  toTarget.newLayout = layout;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_HOST_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                       0, 0, nullptr, 1, &toHost, 1, &toTarget);
+}
+
+void FrameCapture::Poll(uint64_t completedFrameNumber) {
+  bool queued = false;
+  for (auto& slot : m_slots) {
+    if (slot->state != SlotState::Pending || slot->frameNumber > completedFrameNumber) continue;
+
+    slot->state = SlotState::Encoding;
+    {
+      std::lock_guard lock(m_mutex);
+      m_jobs.push_back(slot.get());
+    }
+    m_capturedFrames++;
+    queued = true;
+  }
+  if (!queued) return;
+
+  if (!m_worker.joinable()) {
+    m_worker = std::thread(&FrameCapture::WorkerLoop, this);
+  }
+  m_condition.notify_one();
+}
+
+void FrameCapture::Flush() {
+  Poll(std::numeric_limits<uint64_t>::max());
+  std::unique_lock lock(m_mutex);
+  m_idleCondition.wait(lock, [this] { return m_jobs.empty() && m_busyJobs == 0; });
+}
+
+void FrameCapture::WorkerLoop() {
+  BLOOM_PROFILE_THREAD("Frame capture");
+  while (true) {
+    Slot* slot;
+    {
+      std::unique_lock lock(m_mutex);
+      m_condition.wait(lock, [this] { return m_stop || !m_jobs.empty(); });
+      if (m_jobs.empty()) return;
+      slot = m_jobs.front();
+      m_jobs.pop_front();
+      m_busyJobs++;
+    }
+
+    Encode(*slot);
+    slot->state = SlotState::Free;
+
+    {
+      std::lock_guard lock(m_mutex);
+      m_busyJobs--;
+    }
+    m_idleCondition.notify_all();
+  }
+}
+
+void FrameCapture::Encode(Slot& slot) {
+  BLOOM_PROFILE_FUNCTION();
+  const size_t size = static_cast<size_t>(slot.extent.width) * slot.extent.height * 4;
+  // One sequential read out of the mapped memory, it's usually uncached
+  std::vector<uint8_t> pixels(size);
+  memcpy(pixels.data(), slot.buffer->GetMappedMemory(), size);
+
+  if (slot.format == VK_FORMAT_B8G8R8A8_SRGB || slot.format == VK_FORMAT_B8G8R8A8_UNORM) {
+    for (size_t i = 0; i < size; i += 4) {
+      std::swap(pixels[i], pixels[i + 2]);
+    }
+  }
+
+  Callback callback;
+  {
+    std::lock_guard lock(m_mutex);
+    callback = m_callback;
+  }
+  if (callback) {
+    callback({slot.frameNumber, slot.extent, slot.format, pixels.data()});
+  }
+
+  const Request& request = slot.request;
+  if (request.path.empty()) return;
+
+  if (request.encoding == Encoding::Png) {
+    if (!stbi_write_png(request.path.c_str(), static_cast<int>(slot.extent.width), static_cast<int>(slot.extent.height),
+                        4, pixels.data(), static_cast<int>(slot.extent.width * 4))) {
+      BLOOM_WARN("Failed to write capture {0}", request.path);
+    }
+    return;
+  }
+
+  std::ofstream file(request.path, std::ios::binary);
+  if (!file) {
+    BLOOM_WARN("Failed to write capture {0}", request.path);
+    return;
+  }
+  file.write(reinterpret_cast<const char*>(pixels.data()), static_cast<std::streamsize>(size));
+}
+
+}
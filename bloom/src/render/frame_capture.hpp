@@ -0,0 +1,134 @@
+/**
+ * @file frame_capture.hpp
+ *
+ * @brief Asynchronous readback of rendered frames
+ */
+
+#pragma once
+#include "buffer.hpp"
+#include "render_target.hpp"
+#include <bloom_header.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace bloom::render {
+
+/**
+ * @class FrameCapture
+ * @brief Copies rendered frames into a ring of host visible buffers and encodes them on a worker thread
+ *
+ * The copy is recorded at the end of the frame's own command buffer, so it completes together with the frame and the
+ * render thread never waits for it. Once the frame is known to be done (frame number based, same as the rest of the
+ * frame pacing) the slot is handed to the worker, which writes it to disk and/or passes it to a callback. If every
+ * slot is busy the capture is dropped instead of stalling.
+ */
+class BLOOM_API FrameCapture {
+public:
+  enum class Encoding {
+    Png, ///< RGBA png through stb_image_write
+    Raw, ///< Headerless RGBA8 pixels, row after row
+  };
+
+  /**
+   * @struct Image
+   * @brief Captured frame handed to the callback, the pixels are only valid during the call
+   */
+  struct Image {
+    uint64_t frameNumber;
+    VkExtent2D extent;
+    VkFormat format;
+    const uint8_t* pixels; ///< Tightly packed, 4 bytes per pixel, RGBA order
+  };
+  using Callback = std::function<void(const Image&)>;
+
+  /**
+   * @param devices Device the readback buffers are created on
+   * @param slotCount Frames that can be in flight or being encoded at once
+   */
+  FrameCapture(Devices* devices, uint32_t slotCount = 4);
+  ~FrameCapture();
+
+  FrameCapture(const FrameCapture&) = delete;
+  FrameCapture& operator=(const FrameCapture&) = delete;
+
+  /**
+   * @brief Captures the next rendered frame into a file
+   * @param path File to write, empty only runs the callback
+   */
+  void CaptureFrame(const std::string& path, Encoding encoding = Encoding::Png);
+  /**
+   * @brief Captures every frame into @c directory as frame_<frame number>.<png|raw> until @c StopSequence()
+   */
+  void StartSequence(const std::string& directory, Encoding encoding = Encoding::Png);
+  void StopSequence();
+  bool IsCapturing() const { return m_sequence || !m_requests.empty(); }
+
+  /**
+   * @brief Called on the worker thread for every captured frame, e.g. to compare against a golden image
+   */
+  void SetCallback(Callback callback);
+
+  /**
+   * @brief Records the copy of the frame's colour image, call it after the render pass ends
+   * @param commandBuffer Command buffer of the frame
+   * @param target Target the frame was rendered into
+   * @param imageIndex Image of the target used by the frame
+   * @param frameNumber Number the frame will be submitted as
+   */
+  void Record(VkCommandBuffer commandBuffer, RenderTarget& target, uint32_t imageIndex, uint64_t frameNumber);
+  /**
+   * @brief Hands the frames the GPU already finished to the worker thread
+   */
+  void Poll(uint64_t completedFrameNumber);
+  /**
+   * @brief Waits until every captured frame has been encoded, the device must be idle
+   */
+  void Flush();
+
+  uint64_t GetCapturedFrames() const { return m_capturedFrames; }
+  uint64_t GetDroppedFrames() const { return m_droppedFrames; }
+
+private:
+  enum class SlotState { Free, Pending, Encoding };
+
+  struct Request {
+    std::string path;
+    Encoding encoding;
+  };
+
+  struct Slot {
+    std::unique_ptr<Buffer> buffer;
+    std::atomic<SlotState> state = SlotState::Free;
+    uint64_t frameNumber = 0;
+    VkExtent2D extent{};
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    Request request;
+  };
+
+  void WorkerLoop();
+  void Encode(Slot& slot);
+
+  Devices* m_devices;
+  std::vector<std::unique_ptr<Slot>> m_slots;
+  std::deque<Request> m_requests;
+  bool m_sequence = false;
+  std::string m_sequenceDirectory;
+  Encoding m_sequenceEncoding = Encoding::Png;
+
+  std::thread m_worker;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  std::condition_variable m_idleCondition;
+  std::deque<Slot*> m_jobs;
+  uint32_t m_busyJobs = 0;
+  bool m_stop = false;
+  Callback m_callback;
+
+  uint64_t m_capturedFrames = 0;
+  uint64_t m_droppedFrames = 0;
+};
+
+}
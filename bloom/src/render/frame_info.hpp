@@ -0,0 +1,44 @@
+/**
+ * @file frame_info.hpp
+ *
+ * @brief Per frame data shared by all the render systems
+ */
+
+#pragma once
+#include "src/camera.hpp"
+#include "gpu_profiler.hpp"
+#include "pipeline_statistics.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @struct GlobalUbo
+ * @brief Uniform buffer bound on set 0, written once per frame
+ *
+ * Matches the @c Global block on the shaders (std140 layout)
+ */
+struct GlobalUbo {
+  glm::mat4 projection{1.0f};
+  glm::mat4 view{1.0f};
+  glm::mat4 projectionView{1.0f};
+  glm::vec4 cameraPosition{0.0f}; ///< w is unused, vec4 to avoid std140 padding surprises
+  float time = 0.0f;              ///< Seconds since the engine started
+};
+
+/**
+ * @struct FrameInfo
+ * @brief Everything a render system needs to record a frame
+ */
+struct FrameInfo {
+  int frameIndex;                      ///< Index of the frame in flight, use it for per frame resources
+  float frameTime;                     ///< Delta time of the frame
+  VkCommandBuffer commandBuffer;       ///< Command buffer the frame is recorded into
+  const Camera& camera;                ///< Camera used to render the frame
+  VkDescriptorSet globalDescriptorSet; ///< Set 0 with the @c GlobalUbo of this frame
+  GpuProfiler* gpuProfiler = nullptr;  ///< Only set when built with @c BLOOM_ENABLE_GPU_PROFILER
+  PipelineStatistics* pipelineStatistics = nullptr; ///< Only set while pipeline statistics are on
+  VkExtent2D extent{};                 ///< Size of the render target, in pixels
+};
+
+}
@@ -0,0 +1,171 @@
+#include "geometry_pool.hpp"
+#include "renderer.hpp"
+#include "src/profiler.hpp"
+
+namespace bloom::render {
+
+GeometryPool::RangeAllocator::RangeAllocator(uint32_t capacity) : m_freeCount(capacity) {
+  if (capacity > 0) m_free.emplace(0, capacity);
+}
+
+uint32_t GeometryPool::RangeAllocator::Allocate(uint32_t count) {
+  for (auto it = m_free.begin(); it != m_free.end(); ++it) {
+    if (it->second < count) continue;
+    const uint32_t offset = it->first;
+    const uint32_t remaining = it->second - count;
+    m_free.erase(it);
+    if (remaining > 0) m_free.emplace(offset + count, remaining);
+    m_freeCount -= count;
+    return offset;
+  }
+  return INVALID;
+}
+
+void GeometryPool::RangeAllocator::Free(uint32_t offset, uint32_t count) {
+  m_freeCount += count;
+  auto next = m_free.lower_bound(offset);
+  // Merge with the range right after and the one right before, if they touch
+  if (next != m_free.end() && offset + count == next->first) {
+    count += next->second;
+    next = m_free.erase(next);
+  }
+  if (next != m_free.begin()) {
+    auto previous = std::prev(next);
+    if (previous->first + previous->second == offset) {
+      previous->second += count;
+      return;
+    }
+  }
+  m_free.emplace(offset, count);
+}
+
+GeometryPool::GeometryPool(Devices* devices, const Settings& settings) :
+    m_devices(devices), m_settings(settings), m_freeIndices(settings.indexCapacity) {
+  m_indices = std::make_unique<Buffer>(m_devices, sizeof(uint32_t), m_settings.indexCapacity,
+      VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  BLOOM_INFO("Geometry pool: {0} indices, {1} vertices per layout", m_settings.indexCapacity,
+             m_settings.vertexCapacity);
+}
+
+GeometryPool::~GeometryPool() = default;
+
+GeometryPool::Arena& GeometryPool::GetArena(const Model::Layout& layout) {
+  auto it = m_arenas.find(layout.Key());
+  if (it != m_arenas.end()) return it->second;
+
+  const uint32_t stride = Model::GetVertexStride(layout.format);
+  const uint32_t positionStride = layout.splitPositions ? Model::GetPositionStride(layout.format) : stride;
+  const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+  Arena arena{nullptr, nullptr, RangeAllocator(m_settings.vertexCapacity)};
+  arena.vertices = std::make_unique<Buffer>(m_devices, positionStride, m_settings.vertexCapacity, usage,
+                                            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (layout.splitPositions) {
+    arena.attributes = std::make_unique<Buffer>(m_devices, stride - positionStride, m_settings.vertexCapacity, usage,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  }
+  BLOOM_LOG("Geometry pool: created vertex buffers for layout {0:#x}, {1} bytes", layout.Key(),
+            static_cast<uint64_t>(stride) * m_settings.vertexCapacity);
+  return m_arenas.emplace(layout.Key(), std::move(arena)).first->second;
+}
+
+GeometryPool::Allocation GeometryPool::Allocate(const Model::Layout& layout, std::span<const uint8_t> vertices,
+                                                std::span<const uint32_t> indices) {
+  BLOOM_PROFILE_FUNCTION();
+  const uint32_t stride = Model::GetVertexStride(layout.format);
+  const auto vertexCount = static_cast<uint32_t>(vertices.size() / stride);
+  const auto indexCount = static_cast<uint32_t>(indices.size());
+  if (vertexCount == 0 || indexCount == 0) {
+    BLOOM_WARN("Geometry pool: meshes need vertices and indices");
+    return {};
+  }
+
+  Arena& arena = GetArena(layout);
+  const uint32_t vertexOffset = arena.free.Allocate(vertexCount);
+  if (vertexOffset == RangeAllocator::INVALID) {
+    BLOOM_WARN("Geometry pool: out of vertex space for {0} vertices, {1} free", vertexCount,
+               arena.free.GetFreeCount());
+    return {};
+  }
+  const uint32_t firstIndex = m_freeIndices.Allocate(indexCount);
+  if (firstIndex == RangeAllocator::INVALID) {
+    BLOOM_WARN("Geometry pool: out of index space for {0} indices, {1} free", indexCount,
+               m_freeIndices.GetFreeCount());
+    arena.free.Free(vertexOffset, vertexCount);
+    return {};
+  }
+
+  // One staging buffer holding every stream, copied with a single submit
+  const uint32_t positionStride = layout.splitPositions ? Model::GetPositionStride(layout.format) : stride;
+  const uint32_t attributeStride = stride - positionStride;
+  const VkDeviceSize positionBytes = static_cast<VkDeviceSize>(positionStride) * vertexCount;
+  const VkDeviceSize attributeBytes = static_cast<VkDeviceSize>(attributeStride) * vertexCount;
+  const VkDeviceSize indexBytes = indices.size_bytes();
+  Buffer staging(m_devices, positionBytes + attributeBytes + indexBytes, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  staging.Map();
+  auto mapped = static_cast<uint8_t*>(staging.GetMappedMemory());
+  if (layout.splitPositions) {
+    for (size_t i = 0; i < vertexCount; i++) {
+      memcpy(mapped + i * positionStride, vertices.data() + i * stride, positionStride);
+      memcpy(mapped + positionBytes + i * attributeStride, vertices.data() + i * stride + positionStride,
+             attributeStride);
+    }
+  } else {
+    memcpy(mapped, vertices.data(), positionBytes);
+  }
+  memcpy(mapped + positionBytes + attributeBytes, indices.data(), indexBytes);
+
+  VkCommandBuffer commandBuffer = m_devices->beginSingleTimeCommands();
+  VkBufferCopy copy{0, static_cast<VkDeviceSize>(vertexOffset) * positionStride, positionBytes};
+  vkCmdCopyBuffer(commandBuffer, staging.GetBuffer(), arena.vertices->GetBuffer(), 1, &copy);
+  if (layout.splitPositions) {
+    copy = {positionBytes, static_cast<VkDeviceSize>(vertexOffset) * attributeStride, attributeBytes};
+    vkCmdCopyBuffer(commandBuffer, staging.GetBuffer(), arena.attributes->GetBuffer(), 1, &copy);
+  }
+  copy = {positionBytes + attributeBytes, static_cast<VkDeviceSize>(firstIndex) * sizeof(uint32_t), indexBytes};
+  vkCmdCopyBuffer(commandBuffer, staging.GetBuffer(), m_indices->GetBuffer(), 1, &copy);
+  m_devices->endSingleTimeCommands(commandBuffer);
+
+  return {vertexOffset, vertexCount, firstIndex, indexCount};
+}
+
+void GeometryPool::Free(const Model::Layout& layout, const Allocation& allocation) {
+  if (!allocation.IsValid()) return;
+  if (m_renderer != nullptr) {
+    // Frames in flight may still draw the range, a model allocated over it would show up in them
+    m_renderer->DeferDestroy([this, key = layout.Key(), allocation] { Release(key, allocation); });
+    return;
+  }
+  Release(layout.Key(), allocation);
+}
+
+void GeometryPool::Release(uint32_t layoutKey, const Allocation& allocation) {
+  auto it = m_arenas.find(layoutKey);
+  if (it == m_arenas.end()) {
+    BLOOM_WARN("Geometry pool: freeing an allocation of a layout the pool never had");
+    return;
+  }
+  it->second.free.Free(allocation.vertexOffset, allocation.vertexCount);
+  m_freeIndices.Free(allocation.firstIndex, allocation.indexCount);
+}
+
+void GeometryPool::Bind(VkCommandBuffer commandBuffer, const Model::Layout& layout, bool positionsOnly) const {
+  auto it = m_arenas.find(layout.Key());
+  if (it == m_arenas.end()) return;
+
+  const Arena& arena = it->second;
+  VkBuffer buffers[] = {arena.vertices->GetBuffer(),
+                        arena.attributes ? arena.attributes->GetBuffer() : VK_NULL_HANDLE};
+  VkDeviceSize offsets[] = {0, 0};
+  uint32_t bindingCount = layout.splitPositions && !positionsOnly ? 2 : 1;
+  vkCmdBindVertexBuffers(commandBuffer, 0, bindingCount, buffers, offsets);
+  vkCmdBindIndexBuffer(commandBuffer, m_indices->GetBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+uint32_t GeometryPool::GetVertexCount(const Model::Layout& layout) const {
+  auto it = m_arenas.find(layout.Key());
+  return it == m_arenas.end() ? 0 : m_settings.vertexCapacity - it->second.free.GetFreeCount();
+}
+
+}
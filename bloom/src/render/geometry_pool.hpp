@@ -0,0 +1,130 @@
+/**
+ * @file geometry_pool.hpp
+ *
+ * @brief Shared vertex and index buffers static meshes are suballocated from
+ */
+
+#pragma once
+#include "model.hpp"
+#include "buffer.hpp"
+#include <bloom_header.hpp>
+#include <map>
+
+namespace bloom::render {
+
+class Renderer;
+
+/**
+ * @class GeometryPool
+ * @brief Owns one big index buffer and one set of vertex buffers per vertex layout, models take ranges of them
+ *
+ * A pooled @c Model is just a vertex offset and an index offset into the shared buffers, so every model with the same
+ * layout draws with the same buffers bound and a draw only differs in its @c firstIndex and @c vertexOffset. That is
+ * exactly what a @c VkDrawIndexedIndirectCommand holds, the pool is what multi draw indirect builds on.
+ *
+ * Indices stay relative to the start of their model, the vertex offset of the draw rebases them, so a single index
+ * buffer serves every layout. Vertex buffers can't be shared between layouts since their strides differ, they are
+ * created the first time a layout is used.
+ *
+ * Freed ranges are merged with their neighbours and reused first fit. Capacities are fixed, allocations that don't
+ * fit fail instead of growing the buffers, which would invalidate every binding and recorded draw.
+ */
+class BLOOM_API GeometryPool {
+public:
+  struct Settings {
+    uint32_t vertexCapacity = 1 << 20; ///< Vertices per layout
+    uint32_t indexCapacity = 1 << 22;  ///< Indices shared by every layout
+  };
+
+  /**
+   * @struct Allocation
+   * @brief Where a model lives in the pool, offsets are in elements, not bytes
+   */
+  struct Allocation {
+    uint32_t vertexOffset = 0;
+    uint32_t vertexCount = 0;
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+
+    bool IsValid() const { return vertexCount > 0; }
+  };
+
+  GeometryPool(Devices* devices, const Settings& settings);
+  ~GeometryPool();
+
+  GeometryPool(const GeometryPool&) = delete;
+  GeometryPool& operator=(const GeometryPool&) = delete;
+
+  /**
+   * @brief Copies a mesh into the pool through a staging buffer
+   * @param vertices Interleaved vertices already in the GPU format of @c layout, split layouts are deinterleaved here
+   * @param indices Relative to the first vertex of the mesh, must not be empty
+   * @return An invalid allocation if the pool is out of space
+   */
+  Allocation Allocate(const Model::Layout& layout, std::span<const uint8_t> vertices, std::span<const uint32_t> indices);
+  /**
+   * @brief Gives the ranges back, once the frames that may still draw them are done if there is a renderer
+   */
+  void Free(const Model::Layout& layout, const Allocation& allocation);
+  /**
+   * @brief Defers every @c Free() through @c Renderer::DeferDestroy(), without a renderer ranges are reused right away
+   *
+   * The renderer runs the pending frees when it's destroyed, so it has to go before the pool
+   */
+  void SetRenderer(Renderer* renderer) { m_renderer = renderer; }
+
+  /**
+   * @brief Binds the vertex buffers of a layout and the index buffer
+   * @param positionsOnly Only bind the position stream, see @c Model::Bind()
+   */
+  void Bind(VkCommandBuffer commandBuffer, const Model::Layout& layout, bool positionsOnly = false) const;
+
+  VkBuffer GetIndexBuffer() const { return m_indices->GetBuffer(); }
+  /// Vertices in use by a layout
+  uint32_t GetVertexCount(const Model::Layout& layout) const;
+  /// Indices in use across every layout
+  uint32_t GetIndexCount() const { return m_settings.indexCapacity - m_freeIndices.GetFreeCount(); }
+
+private:
+  /**
+   * @class RangeAllocator
+   * @brief First fit allocator of element ranges, free ranges are kept sorted so neighbours merge on free
+   */
+  class RangeAllocator {
+  public:
+    explicit RangeAllocator(uint32_t capacity);
+
+    /// @return Offset of the range, @c INVALID if nothing big enough is free
+    uint32_t Allocate(uint32_t count);
+    void Free(uint32_t offset, uint32_t count);
+    uint32_t GetFreeCount() const { return m_freeCount; }
+
+    static constexpr uint32_t INVALID = UINT32_MAX;
+
+  private:
+    std::map<uint32_t, uint32_t> m_free; ///< Offset to count
+    uint32_t m_freeCount;
+  };
+
+  /**
+   * @struct Arena
+   * @brief Vertex buffers of a single layout, @c attributes only exists for split layouts
+   */
+  struct Arena {
+    std::unique_ptr<Buffer> vertices;
+    std::unique_ptr<Buffer> attributes;
+    RangeAllocator free;
+  };
+
+  Arena& GetArena(const Model::Layout& layout);
+  void Release(uint32_t layoutKey, const Allocation& allocation);
+
+  Devices* m_devices;
+  Renderer* m_renderer = nullptr;
+  Settings m_settings;
+  std::unique_ptr<Buffer> m_indices;
+  RangeAllocator m_freeIndices;
+  std::unordered_map<uint32_t, Arena> m_arenas;
+};
+
+}
@@ -0,0 +1,135 @@
+#include "gpu_profiler.hpp"
+#include "swap_chain.hpp"
+
+namespace bloom::render {
+
+GpuProfiler::Scope::Scope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name) :
+    m_profiler(profiler), m_commandBuffer(commandBuffer) {
+  m_index = m_profiler != nullptr ? m_profiler->BeginScope(commandBuffer, name) : INVALID_SCOPE;
+}
+
+GpuProfiler::Scope::~Scope() {
+  if (m_profiler != nullptr) m_profiler->EndScope(m_commandBuffer, m_index);
+}
+
+GpuProfiler::GpuProfiler(Devices* devices, uint32_t maxScopes) : m_devices(devices), m_maxScopes(maxScopes) {
+  uint32_t familyCount = 0;
+  vkGetPhysicalDeviceQueueFamilyProperties(m_devices->getPhysicalDevice(), &familyCount, nullptr);
+  std::vector<VkQueueFamilyProperties> families(familyCount);
+  vkGetPhysicalDeviceQueueFamilyProperties(m_devices->getPhysicalDevice(), &familyCount, families.data());
+
+  uint32_t validBits = families[m_devices->findPhysicalQueueFamilies().graphicsFamily].timestampValidBits;
+  m_supported = validBits > 0 && m_devices->properties.limits.timestampPeriod > 0.0f;
+  if (!m_supported) {
+    BLOOM_WARN("Graphics queue doesn't support timestamps, GPU profiler disabled");
+    return;
+  }
+  m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+  m_timestampPeriod = m_devices->properties.limits.timestampPeriod;
+
+  VkQueryPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+  poolInfo.queryCount = m_maxScopes * 2;
+
+  m_frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+  for (auto& frame : m_frames) {
+    if (vkCreateQueryPool(m_devices->device(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+      BLOOM_ERROR("Failed to create timestamp query pool");
+    }
+    frame.names.reserve(m_maxScopes);
+    frame.depths.reserve(m_maxScopes);
+  }
+  m_timestamps.resize(static_cast<size_t>(m_maxScopes) * 2);
+  m_lastFrame.reserve(m_maxScopes);
+  m_frameTotals.reserve(m_maxScopes);
+}
+
+GpuProfiler::~GpuProfiler() {
+  for (auto& frame : m_frames) {
+    vkDestroyQueryPool(m_devices->device(), frame.pool, nullptr);
+  }
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  if (!m_supported) return;
+
+  Frame& frame = m_frames[frameIndex];
+  if (frame.recorded) {
+    Collect(frame);
+  }
+
+  vkCmdResetQueryPool(commandBuffer, frame.pool, 0, m_maxScopes * 2);
+  frame.names.clear();
+  frame.depths.clear();
+  frame.depth = 0;
+  frame.recorded = true;
+  m_current = &frame;
+}
+
+uint32_t GpuProfiler::BeginScope(VkCommandBuffer commandBuffer, const char* name) {
+  if (m_current == nullptr || m_current->names.size() >= m_maxScopes) return INVALID_SCOPE;
+
+  auto index = static_cast<uint32_t>(m_current->names.size());
+  m_current->names.push_back(name);
+  m_current->depths.push_back(m_current->depth++);
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_current->pool, index * 2);
+  return index;
+}
+
+void GpuProfiler::EndScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (m_current == nullptr || scope == INVALID_SCOPE) return;
+
+  m_current->depth--;
+  vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_current->pool, scope * 2 + 1);
+}
+
+double GpuProfiler::GetAverage(std::string_view name) const {
+  auto it = m_averages.find(name);
+  return it != m_averages.end() ? it->second : 0.0;
+}
+
+void GpuProfiler::Collect(Frame& frame) {
+  const auto count = static_cast<uint32_t>(frame.names.size());
+  if (count == 0) return;
+
+  // No WAIT flag, the frame pacing already waited for this frame. If it's somehow not ready we just lose it
+  VkResult result = vkGetQueryPoolResults(m_devices->device(), frame.pool, 0, count * 2,
+                                          sizeof(uint64_t) * count * 2, m_timestamps.data(), sizeof(uint64_t),
+                                          VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS) return;
+
+  m_lastFrame.clear();
+  m_frameTotals.clear();
+  uint64_t first = m_timestamps[0];
+  uint64_t span = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t ticks = (m_timestamps[i * 2 + 1] - m_timestamps[i * 2]) & m_timestampMask;
+    span = std::max(span, (m_timestamps[i * 2 + 1] - first) & m_timestampMask);
+    double milliseconds = static_cast<double>(ticks) * m_timestampPeriod * 1e-6;
+    m_lastFrame.push_back({frame.names[i], frame.depths[i], milliseconds});
+    // A handful of scopes per frame, a linear search beats hashing them
+    auto total = std::find_if(m_frameTotals.begin(), m_frameTotals.end(), [&](const auto& entry) {
+      return std::string_view(entry.first) == frame.names[i];
+    });
+    if (total != m_frameTotals.end()) {
+      total->second += milliseconds;
+    } else {
+      m_frameTotals.emplace_back(frame.names[i], milliseconds);
+    }
+  }
+  m_lastFrameTime = static_cast<double>(span) * m_timestampPeriod * 1e-6;
+  m_collectedFrames++;
+
+  for (const auto& [name, milliseconds] : m_frameTotals) {
+    // Only a name seen for the first time builds a key
+    auto it = m_averages.find(std::string_view(name));
+    if (it == m_averages.end()) {
+      m_averages.emplace(name, milliseconds);
+    } else {
+      it->second += (milliseconds - it->second) * AVERAGE_WEIGHT;
+    }
+  }
+}
+
+}
@@ -0,0 +1,137 @@
+/**
+ * @file gpu_profiler.hpp
+ *
+ * @brief GPU timings through timestamp queries
+ */
+
+#pragma once
+#include "devices.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class GpuProfiler
+ * @brief Measures how long the GPU spends inside scopes placed around passes and draw groups
+ *
+ * Each frame in flight has its own query pool. Results are read when the same frame index comes around again, by
+ * then the frame pacing already waited for it so reading never blocks. Built only with @c BLOOM_ENABLE_GPU_PROFILER,
+ * otherwise the renderer doesn't create it and @c BLOOM_GPU_SCOPE expands to nothing.
+ */
+class BLOOM_API GpuProfiler {
+public:
+  struct ScopeResult {
+    const char* name;
+    uint32_t depth;      ///< Nesting level, 0 for top level scopes
+    double milliseconds;
+  };
+
+  /**
+   * @class Scope
+   * @brief Writes a timestamp on construction and another one on destruction, use @c BLOOM_GPU_SCOPE
+   */
+  class BLOOM_API Scope {
+  public:
+    Scope(GpuProfiler* profiler, VkCommandBuffer commandBuffer, const char* name);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    GpuProfiler* m_profiler;
+    VkCommandBuffer m_commandBuffer;
+    uint32_t m_index;
+  };
+
+  /**
+   * @param devices Device to create the query pools on
+   * @param maxScopes Scopes that can be recorded per frame, extra ones are ignored
+   */
+  GpuProfiler(Devices* devices, uint32_t maxScopes = 64);
+  ~GpuProfiler();
+
+  GpuProfiler(const GpuProfiler&) = delete;
+  GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+  /**
+   * @brief Collects the results of the last use of this frame index and resets its queries
+   *
+   * Must be recorded outside of a render pass, the renderer calls it right after beginning the command buffer
+   */
+  void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+  /**
+   * @param name Has to outlive the profiler, string literals are fine
+   * @return Index to pass to @c EndScope()
+   */
+  uint32_t BeginScope(VkCommandBuffer commandBuffer, const char* name);
+  void EndScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  /// Scopes of the last collected frame, in the order they began
+  const std::vector<ScopeResult>& GetLastFrame() const { return m_lastFrame; }
+  /// Milliseconds from the start of the first scope to the end of the last one on the last collected frame
+  double GetLastFrameTime() const { return m_lastFrameTime; }
+  /// Frames collected so far, tells whether @c GetLastFrame() changed since it was last read
+  uint64_t GetCollectedFrames() const { return m_collectedFrames; }
+  /// Exponential moving average in milliseconds of every scope seen, summed when a name repeats on a frame
+  const auto& GetAverages() const { return m_averages; }
+  double GetAverage(std::string_view name) const;
+
+  /// False when the graphics queue can't write timestamps, scopes are ignored then
+  bool IsSupported() const { return m_supported; }
+
+private:
+  static constexpr uint32_t INVALID_SCOPE = ~0u;
+  static constexpr double AVERAGE_WEIGHT = 1.0 / 32.0;
+
+  /// Lets the averages be looked up by scope name without building a @c std::string
+  struct NameHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+  };
+
+  struct Frame {
+    VkQueryPool pool = VK_NULL_HANDLE;
+    std::vector<const char*> names;
+    std::vector<uint32_t> depths;
+    uint32_t depth = 0;
+    bool recorded = false;
+  };
+
+  void Collect(Frame& frame);
+
+  Devices* m_devices;
+  uint32_t m_maxScopes;
+  bool m_supported = false;
+  double m_timestampPeriod = 1.0; ///< Nanoseconds per tick
+  uint64_t m_timestampMask = ~0ull;
+
+  std::vector<Frame> m_frames;
+  Frame* m_current = nullptr;
+  std::vector<uint64_t> m_timestamps;
+
+  std::vector<ScopeResult> m_lastFrame;
+  /// Milliseconds per name on the frame being collected, kept between frames so collecting doesn't allocate
+  std::vector<std::pair<const char*, double>> m_frameTotals;
+  double m_lastFrameTime = 0.0;
+  uint64_t m_collectedFrames = 0;
+  std::unordered_map<std::string, double, NameHash, std::equal_to<>> m_averages;
+};
+
+}
+
+#ifdef BLOOM_ENABLE_GPU_PROFILER
+/**
+ * @def BLOOM_GPU_SCOPE(profiler, commandBuffer, name)
+ * @brief Times the GPU work recorded until the end of the enclosing block
+ *
+ * @param profiler @c GpuProfiler to record into, may be nullptr
+ * @param commandBuffer Command buffer the work is recorded into
+ * @param name String literal identifying the scope
+ */
+#define BLOOM_GPU_SCOPE(profiler, commandBuffer, name) \
+  ::bloom::render::GpuProfiler::Scope BLOOM_CONCAT(bloomGpuScope, __LINE__)(profiler, commandBuffer, name)
+#else
+#define BLOOM_GPU_SCOPE(profiler, commandBuffer, name)
+#endif
@@ -0,0 +1,615 @@
+#include "gpu_scene.hpp"
+#include "swap_chain.hpp"
+#include "src/profiler.hpp"
+
+namespace bloom::render {
+
+GpuScene::GpuScene(Devices* devices, VkDescriptorSetLayout globalSetLayout) : m_devices(devices) {
+  CreateLayouts(globalSetLayout);
+  CreateFrameResources();
+  m_cullPipeline = std::make_unique<Pipeline>(*m_devices, "resources/shaders/cull.comp.spv", m_cullPipelineLayout);
+  m_clusterPipeline = std::make_unique<Pipeline>(*m_devices, "resources/shaders/cluster_cull.comp.spv",
+                                                 m_cullPipelineLayout);
+  // Turning on back face culling in the pipelines turns on the cone test, both have to agree on the front face
+  PipelineConfiguration config{};
+  Pipeline::defaultPipelineConfig(config);
+  m_coneCulling = (config.rasterizationInfo.cullMode & VK_CULL_MODE_BACK_BIT) != 0;
+  m_maxDrawCount = m_devices->properties.limits.maxDrawIndirectCount;
+  BLOOM_INFO("GPU driven rendering: {0} objects, draw count {1}", MAX_OBJECTS,
+             m_devices->supportsDrawIndirectCount() ? "from the GPU" : "fixed");
+}
+
+GpuScene::~GpuScene() {
+  vkDestroyPipelineLayout(m_devices->device(), m_cullPipelineLayout, nullptr);
+  vkDestroyPipelineLayout(m_devices->device(), m_drawPipelineLayout, nullptr);
+}
+
+void GpuScene::CreateLayouts(VkDescriptorSetLayout globalSetLayout) {
+  m_cullSetLayout = std::make_unique<DescriptorSetLayout>(m_devices, std::vector<VkDescriptorSetLayoutBinding>{
+      {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {6, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {7, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {8, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {9, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {10, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+      {11, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr},
+  });
+  m_textureSetLayout = std::make_unique<DescriptorSetLayout>(m_devices, std::vector<VkDescriptorSetLayoutBinding>{
+      {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_TEXTURES, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr},
+  });
+  m_objectSetLayout = std::make_unique<DescriptorSetLayout>(m_devices, std::vector<VkDescriptorSetLayoutBinding>{
+      {0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+  });
+
+  VkPushConstantRange pushConstantRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(CullPhase)};
+  VkDescriptorSetLayout cullSetLayout = m_cullSetLayout->getDescriptorSetLayout();
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = 1;
+  pipelineLayoutInfo.pSetLayouts = &cullSetLayout;
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(m_devices->device(), &pipelineLayoutInfo, nullptr, &m_cullPipelineLayout) != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create culling pipeline layout");
+  }
+
+  std::array<VkDescriptorSetLayout, 3> drawSetLayouts = {
+    globalSetLayout,
+    m_textureSetLayout->getDescriptorSetLayout(),
+    m_objectSetLayout->getDescriptorSetLayout()
+  };
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(drawSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = drawSetLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 0;
+  pipelineLayoutInfo.pPushConstantRanges = nullptr;
+  if (vkCreatePipelineLayout(m_devices->device(), &pipelineLayoutInfo, nullptr, &m_drawPipelineLayout) != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create GPU driven pipeline layout");
+  }
+}
+
+void GpuScene::CreateFrameResources() {
+  constexpr auto frameCount = static_cast<uint32_t>(SwapChain::MAX_FRAMES_IN_FLIGHT);
+  m_descriptorPool = std::make_unique<DescriptorPool>(m_devices, frameCount * 3, std::vector<VkDescriptorPoolSize>{
+      {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, frameCount * 11},
+      {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, frameCount},
+      {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frameCount * (MAX_TEXTURES + 1)},
+  });
+
+  // Only the culling shader reads and writes them, they start at the finest level and with nothing visible
+  m_lodState = std::make_unique<Buffer>(m_devices, sizeof(uint32_t), MAX_STATE_SLOTS,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  m_visibility = std::make_unique<Buffer>(m_devices, sizeof(uint32_t), MAX_STATE_SLOTS,
+      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  VkCommandBuffer commandBuffer = m_devices->beginSingleTimeCommands();
+  vkCmdFillBuffer(commandBuffer, m_lodState->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+  vkCmdFillBuffer(commandBuffer, m_visibility->GetBuffer(), 0, VK_WHOLE_SIZE, 0);
+  m_devices->endSingleTimeCommands(commandBuffer);
+
+  constexpr VkMemoryPropertyFlags hostMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+  m_frames.resize(frameCount);
+  for (auto& frame : m_frames) {
+    frame.objects = std::make_unique<Buffer>(m_devices, sizeof(GpuObject), MAX_OBJECTS,
+                                             VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory);
+    frame.objects->Map();
+    frame.meshes = std::make_unique<Buffer>(m_devices, sizeof(GpuMesh), MAX_MESHES,
+                                            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory);
+    frame.meshes->Map();
+    // The late phase of occlusion culling writes its draws and counts after MAX_OBJECTS
+    frame.draws = std::make_unique<Buffer>(m_devices, sizeof(VkDrawIndexedIndirectCommand), MAX_OBJECTS * 2,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    // One counter per batch, there can't be more batches than objects. Early and late object draws come first, then
+    // early and late cluster draws
+    frame.counts = std::make_unique<Buffer>(m_devices, sizeof(uint32_t), MAX_OBJECTS * 4,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    frame.cullData = std::make_unique<Buffer>(m_devices, sizeof(CullData), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                              hostMemory);
+    frame.cullData->Map();
+    frame.meshlets = std::make_unique<Buffer>(m_devices, sizeof(GpuMeshlet), MAX_MESHLETS,
+                                              VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostMemory);
+    frame.meshlets->Map();
+    frame.tasks = std::make_unique<Buffer>(m_devices, sizeof(uint32_t), MAX_OBJECTS * 2,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    frame.dispatches = std::make_unique<Buffer>(m_devices, sizeof(uint32_t) * 4, 2,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    frame.clusterDraws = std::make_unique<Buffer>(m_devices, sizeof(VkDrawIndexedIndirectCommand),
+        MAX_CLUSTER_DRAWS * 2,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (!m_descriptorPool->allocateDescriptorSet(m_cullSetLayout->getDescriptorSetLayout(), frame.cullSet) ||
+        !m_descriptorPool->allocateDescriptorSet(m_objectSetLayout->getDescriptorSetLayout(), frame.objectSet) ||
+        !m_descriptorPool->allocateDescriptorSet(m_textureSetLayout->getDescriptorSetLayout(), frame.textureSet)) {
+      BLOOM_CRITICAL("Failed to allocate GPU driven descriptor sets");
+    }
+
+    // Binding 7 is the depth pyramid, written by UpdatePyramid()
+    std::array<std::pair<uint32_t, VkDescriptorBufferInfo>, 11> bufferInfos = {{
+      {0, frame.objects->DescriptorInfo()},
+      {1, frame.meshes->DescriptorInfo()},
+      {2, m_lodState->DescriptorInfo()},
+      {3, frame.draws->DescriptorInfo()},
+      {4, frame.counts->DescriptorInfo()},
+      {5, m_visibility->DescriptorInfo()},
+      {6, frame.cullData->DescriptorInfo()},
+      {8, frame.meshlets->DescriptorInfo()},
+      {9, frame.tasks->DescriptorInfo()},
+      {10, frame.dispatches->DescriptorInfo()},
+      {11, frame.clusterDraws->DescriptorInfo()}
+    }};
+    std::array<VkWriteDescriptorSet, 12> writes{};
+    for (uint32_t i = 0; i < bufferInfos.size(); i++) {
+      writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+      writes[i].dstSet = frame.cullSet;
+      writes[i].dstBinding = bufferInfos[i].first;
+      writes[i].descriptorCount = 1;
+      writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+      writes[i].pBufferInfo = &bufferInfos[i].second;
+    }
+    writes[6].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[11] = writes[0];
+    writes[11].dstSet = frame.objectSet;
+    vkUpdateDescriptorSets(m_devices->device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+  }
+}
+
+uint32_t GpuScene::RegisterMesh(const Model* model) {
+  GpuMesh mesh{};
+  mesh.vertexOffset = static_cast<int32_t>(model->GetVertexOffset());
+  mesh.lodCount = std::min(model->GetLodCount(), MAX_LODS);
+  for (uint32_t i = 0; i < mesh.lodCount; i++) {
+    const auto& lod = model->GetLod(i);
+    mesh.lods[i] = {model->GetFirstIndex() + lod.firstIndex, lod.indexCount, lod.error, 0};
+  }
+
+  // A new model can get the address of a destroyed one, the record is checked against the model every time
+  auto it = m_meshIndices.find(model);
+  if (it != m_meshIndices.end()) {
+    MeshSlot& slot = m_meshSlots[it->second];
+    slot.lastUpdate = m_updateNumber;
+    GpuMesh& record = m_meshes[it->second];
+    mesh.firstMeshlet = record.firstMeshlet;
+    RegisterMeshlets(model, mesh, slot.meshletCapacity);
+    if (memcmp(&record, &mesh, sizeof(GpuMesh)) != 0) {
+      record = mesh;
+      m_meshVersion++;
+    }
+    return it->second;
+  }
+
+  uint32_t index;
+  if (!m_freeMeshes.empty()) {
+    index = m_freeMeshes.back();
+    m_freeMeshes.pop_back();
+  } else if (m_meshes.size() < MAX_MESHES) {
+    index = static_cast<uint32_t>(m_meshes.size());
+    m_meshes.emplace_back();
+    m_meshSlots.emplace_back();
+  } else {
+    return INVALID;
+  }
+  // A freed record keeps its meshlet range, the new model reuses it if it fits
+  MeshSlot& slot = m_meshSlots[index];
+  mesh.firstMeshlet = m_meshes[index].firstMeshlet;
+  RegisterMeshlets(model, mesh, slot.meshletCapacity);
+  slot.model = model;
+  slot.lastUpdate = m_updateNumber;
+  m_meshes[index] = mesh;
+  m_meshIndices.emplace(model, index);
+  m_meshVersion++;
+  return index;
+}
+
+void GpuScene::RegisterMeshlets(const Model* model, GpuMesh& mesh, uint32_t& capacity) {
+  const auto meshlets = model->GetMeshlets();
+  // A range too small is left behind, the meshlet buffer only grows
+  if (meshlets.size() > capacity) {
+    if (m_meshlets.size() + meshlets.size() > MAX_MESHLETS) {
+      BLOOM_WARN_THROTTLED(5000, "GPU scene is out of meshlets, new meshes are culled whole");
+      mesh.meshletCount = 0;
+      return;
+    }
+    mesh.firstMeshlet = static_cast<uint32_t>(m_meshlets.size());
+    capacity = static_cast<uint32_t>(meshlets.size());
+    m_meshlets.resize(m_meshlets.size() + meshlets.size());
+  }
+  mesh.meshletCount = static_cast<uint32_t>(meshlets.size());
+
+  // The model matrix of an object includes the dequantization, bounds are moved before it so the shader applies
+  // the matrix as is. It's a translation and a scale, so normals only need the inverse scale
+  const glm::mat4& dequantization = model->GetDequantization();
+  const glm::vec3 offset(dequantization[3]);
+  const glm::vec3 scale(dequantization[0][0], dequantization[1][1], dequantization[2][2]);
+  bool changed = false;
+  for (size_t i = 0; i < meshlets.size(); i++) {
+    const auto& meshlet = meshlets[i];
+    GpuMeshlet record{};
+    record.sphere = glm::vec4((glm::vec3(meshlet.sphere) - offset) / scale, meshlet.sphere.w);
+    record.cone = glm::vec4(glm::vec3(meshlet.cone) / scale, meshlet.cone.w);
+    record.firstIndex = model->GetFirstIndex() + meshlet.firstIndex;
+    record.indexCount = meshlet.indexCount;
+
+    GpuMeshlet& slot = m_meshlets[mesh.firstMeshlet + i];
+    if (memcmp(&slot, &record, sizeof(GpuMeshlet)) != 0) {
+      slot = record;
+      changed = true;
+    }
+  }
+  if (changed) m_meshletVersion++;
+}
+
+uint32_t GpuScene::RegisterTexture(const Texture* texture) {
+  auto it = m_textureIndices.find(texture);
+  if (it != m_textureIndices.end()) {
+    TextureSlot& slot = m_textures[it->second];
+    slot.lastUpdate = m_updateNumber;
+    // Destroyed and another one created at its address, the descriptors still point to the old image
+    if (slot.id != texture->GetUniqueId()) {
+      slot.id = texture->GetUniqueId();
+      m_textureVersion++;
+    }
+    return it->second;
+  }
+
+  uint32_t index;
+  if (!m_freeTextures.empty()) {
+    index = m_freeTextures.back();
+    m_freeTextures.pop_back();
+  } else if (m_textures.size() < MAX_TEXTURES) {
+    index = static_cast<uint32_t>(m_textures.size());
+    m_textures.emplace_back();
+  } else {
+    return INVALID;
+  }
+  m_textures[index] = {texture, texture->GetUniqueId(), m_updateNumber};
+  m_textureIndices.emplace(texture, index);
+  m_textureVersion++;
+  return index;
+}
+
+void GpuScene::ReleaseUnused() {
+  // Only pointers are compared here, the models and textures they point to may be gone already
+  for (uint32_t i = 0; i < m_meshSlots.size(); i++) {
+    MeshSlot& slot = m_meshSlots[i];
+    if (slot.model == nullptr || slot.lastUpdate == m_updateNumber) continue;
+    m_meshIndices.erase(slot.model);
+    slot.model = nullptr;
+    m_freeMeshes.push_back(i);
+  }
+  for (uint32_t i = 0; i < m_textures.size(); i++) {
+    TextureSlot& slot = m_textures[i];
+    if (slot.texture == nullptr || slot.lastUpdate == m_updateNumber) continue;
+    m_textureIndices.erase(slot.texture);
+    slot = {};
+    m_freeTextures.push_back(i);
+    m_textureVersion++;
+  }
+  std::erase_if(m_stateSlots, [this](const auto& entry) {
+    if (entry.second.lastUpdate == m_updateNumber) return false;
+    m_freeStateSlots.push_back(entry.second.slot);
+    return true;
+  });
+}
+
+void GpuScene::WriteTextures(FrameResources& frame) const {
+  const auto fallback = std::find_if(m_textures.begin(), m_textures.end(),
+                                     [](const TextureSlot& slot) { return slot.texture != nullptr; });
+  if (fallback == m_textures.end()) return;
+
+  // Every element of the array has to be valid, free slots repeat a texture in use
+  std::array<VkDescriptorImageInfo, MAX_TEXTURES> imageInfos{};
+  for (uint32_t i = 0; i < MAX_TEXTURES; i++) {
+    const bool used = i < m_textures.size() && m_textures[i].texture != nullptr;
+    const Texture* texture = used ? m_textures[i].texture : fallback->texture;
+    imageInfos[i] = {texture->GetSampler(), texture->GetImageView(), texture->GetImageLayout()};
+  }
+
+  VkWriteDescriptorSet write{};
+  write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  write.dstSet = frame.textureSet;
+  write.dstBinding = 0;
+  write.descriptorCount = MAX_TEXTURES;
+  write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  write.pImageInfo = imageInfos.data();
+  vkUpdateDescriptorSets(m_devices->device(), 1, &write, 0, nullptr);
+  frame.textureVersion = m_textureVersion;
+}
+
+void GpuScene::Update(const FrameInfo& frameInfo, std::vector<Object>& objects) {
+  BLOOM_PROFILE_FUNCTION();
+  m_frameIndex = frameInfo.frameIndex;
+  FrameResources& frame = m_frames[m_frameIndex];
+
+  // First pass assigns every object a batch, the second one writes them batch after batch
+  m_batches.clear();
+  m_drawn.assign(objects.size(), 0);
+  m_placement.resize(objects.size());
+  m_objectCount = 0;
+  m_clusterCount = 0;
+  m_updateNumber++;
+  bool full = false;
+  for (size_t i = 0; i < objects.size(); i++) {
+    const Object& obj = objects[i];
+    if (obj.model == nullptr || obj.model->GetPool() == nullptr || obj.texture == nullptr) continue;
+    if (m_objectCount >= MAX_OBJECTS) {
+      full = true;
+      continue;
+    }
+    const uint32_t mesh = RegisterMesh(obj.model.get());
+    const uint32_t texture = RegisterTexture(obj.texture);
+    if (mesh == INVALID || texture == INVALID) {
+      full = true;
+      continue;
+    }
+
+    uint32_t batch = 0;
+    while (batch < m_batches.size() && (m_batches[batch].pool != obj.model->GetPool() ||
+                                        m_batches[batch].layout.Key() != obj.model->GetLayout().Key())) {
+      batch++;
+    }
+    if (batch == m_batches.size()) m_batches.push_back({obj.model->GetLayout(), obj.model->GetPool(), 0, 0, 0, 0});
+    m_batches[batch].objectCount++;
+
+    // Every meshlet of the object gets a slot, past the limit objects are just culled whole
+    const uint32_t meshlets = m_meshes[mesh].meshletCount;
+    const bool clustered = meshlets > 0 && m_clusterCount + meshlets <= MAX_CLUSTER_DRAWS &&
+                           m_batches[batch].clusterCount + meshlets <= m_maxDrawCount;
+    if (clustered) {
+      m_batches[batch].clusterCount += meshlets;
+      m_clusterCount += meshlets;
+    }
+    // Never runs out, the slots held past this Update() belong to at most MAX_OBJECTS objects of the last one
+    auto [state, added] = m_stateSlots.try_emplace(obj.GetID(), StateSlot{0, m_updateNumber});
+    state->second.lastUpdate = m_updateNumber;
+    if (added) {
+      if (!m_freeStateSlots.empty()) {
+        state->second.slot = m_freeStateSlots.back();
+        m_freeStateSlots.pop_back();
+      } else {
+        state->second.slot = m_stateSlotCount++;
+      }
+    }
+
+    m_placement[i] = {batch, mesh, texture, state->second.slot, clustered, added};
+    m_drawn[i] = 1;
+    m_objectCount++;
+  }
+  if (full) {
+    BLOOM_WARN_THROTTLED(5000, "GPU scene is full, the objects left out are drawn one by one");
+  }
+  ReleaseUnused();
+
+  uint32_t firstObject = 0;
+  uint32_t firstCluster = 0;
+  for (auto& batch : m_batches) {
+    batch.firstObject = firstObject;
+    batch.firstCluster = firstCluster;
+    firstObject += batch.objectCount;
+    firstCluster += batch.clusterCount;
+  }
+
+  std::vector<uint32_t> cursors(m_batches.size());
+  auto records = static_cast<GpuObject*>(frame.objects->GetMappedMemory());
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (!m_drawn[i]) continue;
+    Object& obj = objects[i];
+    const auto [batch, mesh, texture, state, clustered, newState] = m_placement[i];
+    const glm::mat4 transform = obj.transform.mat4();
+    const glm::vec4 sphere = obj.model->GetBoundingSphere();
+    const float scale = glm::max(glm::abs(obj.transform.scale.x),
+                                 glm::max(glm::abs(obj.transform.scale.y), glm::abs(obj.transform.scale.z)));
+
+    GpuObject& record = records[m_batches[batch].firstObject + cursors[batch]++];
+    record.model = transform * obj.model->GetDequantization();
+    record.sphere = glm::vec4(glm::vec3(transform * glm::vec4(glm::vec3(sphere), 1.0f)), sphere.w * scale);
+    record.mesh = mesh;
+    record.texture = texture;
+    record.drawOffset = m_batches[batch].firstObject;
+    record.batch = batch;
+    record.scale = scale;
+    record.clusterOffset = clustered ? m_batches[batch].firstCluster : INVALID;
+    const glm::vec3 axes = obj.transform.scale;
+    const bool uniform = axes.x > 0.0f && glm::abs(axes.y - axes.x) <= axes.x * 1e-3f &&
+                         glm::abs(axes.z - axes.x) <= axes.x * 1e-3f;
+    record.flags = (uniform && m_coneCulling ? FLAG_CONE_CULLING : 0) | (newState ? FLAG_NEW_STATE : 0);
+    record.state = state;
+  }
+
+  // The previous use of this frame's buffers finished before the frame began, they are safe to rewrite
+  if (frame.meshVersion != m_meshVersion) {
+    frame.meshes->WriteToBuffer(m_meshes.data(), m_meshes.size() * sizeof(GpuMesh));
+    frame.meshVersion = m_meshVersion;
+  }
+  if (frame.meshletVersion != m_meshletVersion) {
+    frame.meshlets->WriteToBuffer(m_meshlets.data(), m_meshlets.size() * sizeof(GpuMeshlet));
+    frame.meshletVersion = m_meshletVersion;
+  }
+  if (frame.textureVersion != m_textureVersion) {
+    WriteTextures(frame);
+  }
+}
+
+void GpuScene::UpdatePyramid(VkExtent2D extent) {
+  if (m_pyramid != nullptr && m_pyramid->GetSourceExtent().width == extent.width &&
+      m_pyramid->GetSourceExtent().height == extent.height) {
+    return;
+  }
+
+  // Only happens on resizes, which already stalled the device to recreate the swap chain
+  if (m_pyramid != nullptr) vkDeviceWaitIdle(m_devices->device());
+  m_pyramid = std::make_unique<DepthPyramid>(m_devices, extent);
+
+  // The culling shader statically uses the pyramid, every set needs it even with occlusion culling off
+  const VkDescriptorImageInfo imageInfo = m_pyramid->DescriptorInfo();
+  for (auto& frame : m_frames) {
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = frame.cullSet;
+    write.dstBinding = 7;
+    write.descriptorCount = 1;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(m_devices->device(), 1, &write, 0, nullptr);
+  }
+}
+
+void GpuScene::Dispatch(VkCommandBuffer commandBuffer, CullPhase phase) const {
+  const FrameResources& frame = m_frames[m_frameIndex];
+  if (m_objectCount > 0) {
+    m_cullPipeline->Bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipelineLayout, 0, 1,
+                            &frame.cullSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+    vkCmdDispatch(commandBuffer, (m_objectCount + 63) / 64, 1, 1);
+  }
+
+  if (m_clusterCount > 0) {
+    // The tasks and their count come from the dispatch above, the pipeline layout and set are the same
+    VkMemoryBarrier taskBarrier{};
+    taskBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    taskBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    taskBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT |
+                                VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1,
+                         &taskBarrier, 0, nullptr, 0, nullptr);
+
+    m_clusterPipeline->Bind(commandBuffer);
+    vkCmdPushConstants(commandBuffer, m_cullPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(phase), &phase);
+    const VkDeviceSize offset = phase == CullPhase::Late ? sizeof(uint32_t) * 4 : 0;
+    vkCmdDispatchIndirect(commandBuffer, frame.dispatches->GetBuffer(), offset);
+  }
+
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuScene::Cull(const FrameInfo& frameInfo, float pixelError, float hysteresis, bool occlusion) {
+  BLOOM_PROFILE_FUNCTION();
+  auto commandBuffer = frameInfo.commandBuffer;
+  FrameResources& frame = m_frames[m_frameIndex];
+  BLOOM_GPU_SCOPE(frameInfo.gpuProfiler, commandBuffer, "Culling");
+  UpdatePyramid(frameInfo.extent);
+  m_occlusion = occlusion;
+
+  // Count regions are early and late objects, then early and late clusters
+  const VkDeviceSize countBytes = std::max<size_t>(m_batches.size(), 1) * sizeof(uint32_t);
+  for (uint32_t region = 0; region < 4; region++) {
+    const bool late = (region & 1) != 0;
+    const bool clusters = region >= 2;
+    if ((late && !m_occlusion) || (clusters && m_clusterCount == 0)) continue;
+    vkCmdFillBuffer(commandBuffer, frame.counts->GetBuffer(), region * MAX_OBJECTS * sizeof(uint32_t), countBytes, 0);
+  }
+  if (!m_devices->supportsDrawIndirectCount()) {
+    // Only the slots of this frame's batches, the whole buffers are several megabytes
+    constexpr VkDeviceSize stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (m_objectCount > 0) {
+      vkCmdFillBuffer(commandBuffer, frame.draws->GetBuffer(), 0, m_objectCount * stride, 0);
+      if (m_occlusion) {
+        vkCmdFillBuffer(commandBuffer, frame.draws->GetBuffer(), MAX_OBJECTS * stride, m_objectCount * stride, 0);
+      }
+    }
+    if (m_clusterCount > 0) {
+      vkCmdFillBuffer(commandBuffer, frame.clusterDraws->GetBuffer(), 0, m_clusterCount * stride, 0);
+      if (m_occlusion) {
+        vkCmdFillBuffer(commandBuffer, frame.clusterDraws->GetBuffer(), MAX_CLUSTER_DRAWS * stride,
+                        m_clusterCount * stride, 0);
+      }
+    }
+  }
+  if (m_clusterCount > 0) {
+    // Both phases start with no tasks, one workgroup high and deep
+    const std::array<uint32_t, 8> dispatches = {0, 1, 1, 0, 0, 1, 1, 0};
+    vkCmdUpdateBuffer(commandBuffer, frame.dispatches->GetBuffer(), 0, sizeof(dispatches), dispatches.data());
+  }
+
+  // Covers the clears above and the LOD state and visibility written by the previous frame's culling
+  VkMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+  vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+  const auto& projection = frameInfo.camera.GetProjection();
+  CullData data{};
+  data.projectionView = projection * frameInfo.camera.GetView();
+  const glm::mat4 rows = glm::transpose(data.projectionView);
+  // Gribb and Hartmann, with the 0 to 1 depth range the near plane is just the third row
+  data.planes[0] = rows[3] + rows[0];
+  data.planes[1] = rows[3] - rows[0];
+  data.planes[2] = rows[3] + rows[1];
+  data.planes[3] = rows[3] - rows[1];
+  data.planes[4] = rows[2];
+  data.planes[5] = rows[3] - rows[2];
+  for (auto& plane : data.planes) {
+    plane /= glm::length(glm::vec3(plane));
+  }
+  data.camera = glm::vec4(frameInfo.camera.GetPosition(), projection[3][3] == 1.0f ? 1.0f : 0.0f);
+  data.pyramidSize = glm::vec2(m_pyramid->GetExtent().width, m_pyramid->GetExtent().height);
+  data.objectCount = m_objectCount;
+  data.pixelsPerUnit = glm::abs(projection[1][1]) * 0.5f * static_cast<float>(frameInfo.extent.height);
+  data.pixelError = pixelError;
+  data.hysteresis = hysteresis;
+  frame.cullData->WriteToBuffer(&data);
+
+  Dispatch(commandBuffer, m_occlusion ? CullPhase::Early : CullPhase::All);
+}
+
+void GpuScene::CullOccluded(const FrameInfo& frameInfo, const DepthAttachment& depth) {
+  BLOOM_PROFILE_FUNCTION();
+  if (!m_occlusion) return;
+  auto commandBuffer = frameInfo.commandBuffer;
+  BLOOM_GPU_SCOPE(frameInfo.gpuProfiler, commandBuffer, "Occlusion culling");
+  m_pyramid->Build(commandBuffer, m_frameIndex, depth);
+  Dispatch(commandBuffer, CullPhase::Late);
+}
+
+void GpuScene::Bind(const FrameInfo& frameInfo) {
+  const FrameResources& frame = m_frames[m_frameIndex];
+  std::array<VkDescriptorSet, 3> sets = {frameInfo.globalDescriptorSet, frame.textureSet, frame.objectSet};
+  vkCmdBindDescriptorSets(frameInfo.commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_drawPipelineLayout, 0,
+                          static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+}
+
+void GpuScene::Draw(const FrameInfo& frameInfo, uint32_t batch, bool late) const {
+  const FrameResources& frame = m_frames[m_frameIndex];
+  const Batch& range = m_batches[batch];
+  constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+  const uint32_t first = late ? MAX_OBJECTS : 0;
+  const VkDeviceSize offset = static_cast<VkDeviceSize>(first + range.firstObject) * stride;
+  if (m_devices->supportsDrawIndirectCount()) {
+    vkCmdDrawIndexedIndirectCount(frameInfo.commandBuffer, frame.draws->GetBuffer(), offset, frame.counts->GetBuffer(),
+                                  (first + batch) * sizeof(uint32_t), std::min(range.objectCount, m_maxDrawCount),
+                                  stride);
+  } else {
+    vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, frame.draws->GetBuffer(), offset,
+                             std::min(range.objectCount, m_maxDrawCount), stride);
+  }
+
+  if (range.clusterCount == 0) return;
+  const uint32_t firstCluster = late ? MAX_CLUSTER_DRAWS : 0;
+  const VkDeviceSize clusterOffset = static_cast<VkDeviceSize>(firstCluster + range.firstCluster) * stride;
+  if (m_devices->supportsDrawIndirectCount()) {
+    const uint32_t countRegion = (late ? 3 : 2) * MAX_OBJECTS;
+    vkCmdDrawIndexedIndirectCount(frameInfo.commandBuffer, frame.clusterDraws->GetBuffer(), clusterOffset,
+                                  frame.counts->GetBuffer(), (countRegion + batch) * sizeof(uint32_t),
+                                  std::min(range.clusterCount, m_maxDrawCount), stride);
+  } else {
+    vkCmdDrawIndexedIndirect(frameInfo.commandBuffer, frame.clusterDraws->GetBuffer(), clusterOffset,
+                             std::min(range.clusterCount, m_maxDrawCount), stride);
+  }
+}
+
+}
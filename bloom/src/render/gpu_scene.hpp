@@ -0,0 +1,358 @@
+/**
+ * @file gpu_scene.hpp
+ *
+ * @brief Scene data on storage buffers, culled and turned into indirect draws by a compute shader
+ */
+
+#pragma once
+#include "buffer.hpp"
+#include "pipeline.hpp"
+#include "geometry_pool.hpp"
+#include "descriptor_pool.hpp"
+#include "descriptor_set_layout.hpp"
+#include "frame_info.hpp"
+#include "texture.hpp"
+#include "depth_pyramid.hpp"
+#include "src/object.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class GpuScene
+ * @brief GPU driven path for objects whose models live in a @c GeometryPool
+ *
+ * Every frame @c Update() writes one record per object (model matrix, bounds, mesh and texture) to a storage buffer,
+ * and @c Cull() dispatches @c cull.comp, which frustum culls every object, picks its level of detail and appends the
+ * draws of the visible ones to a draw buffer. The frame is then drawn with one @c vkCmdDrawIndexedIndirectCount per
+ * batch, a batch being every object sharing a pool and a vertex layout, so the commands recorded on the CPU don't
+ * depend on the number of objects. The vertex shader finds its object through @c firstInstance.
+ *
+ * Without @c drawIndirectCount the draw buffer is cleared before culling and every batch draws its full capacity
+ * with @c vkCmdDrawIndexedIndirect, the slots nobody wrote are empty draws.
+ *
+ * With occlusion culling every frame is culled twice, using the visibility of each object on the previous frame:
+ *  - Early: objects visible last frame and inside the frustum are drawn, they are most of what is visible now
+ *  - Late: after the early draws, their depth is reduced into a @c DepthPyramid and every object in the frustum is
+ *    tested against it. The visible ones not drawn yet are drawn on a second indirect call, the visibility of every
+ *    object is stored for the next frame
+ *
+ * The pyramid only holds this frame's depth, so nothing is culled based on where things were last frame and objects
+ * appearing from behind an occluder are drawn the same frame, they don't pop in a frame late.
+ *
+ * Objects at their finest level whose model has meshlets are culled a second time, cluster by cluster: @c cull.comp
+ * hands them to @c cluster_cull.comp through an indirect dispatch, one workgroup per object, which frustum culls every
+ * meshlet, drops the back facing ones with their normal cone when the pipelines cull back faces and, on the late
+ * phase, tests them against the pyramid.
+ * Visible meshlets are regular indexed draws on a draw buffer of their own, drawn with a second indirect call per
+ * batch, so this works on any device without mesh shaders.
+ *
+ * Meshes and textures are registered the first time an object uses them, and their records are freed on the first
+ * @c Update() no object uses them anymore, so models and textures can come and go. The level of detail and visibility
+ * kept for the next frame belong to the object, by @c Object::GetID(), not to its place in the object buffer, which
+ * changes whenever objects are added, removed or move between batches.
+ */
+class BLOOM_API GpuScene {
+public:
+  /// Must match @c cull.comp, the draws of the late culling phase start there
+  static constexpr uint32_t MAX_OBJECTS = 16384;
+  static constexpr uint32_t MAX_MESHES = 1024;
+  /// Must match the texture array of @c indirect.frag
+  static constexpr uint32_t MAX_TEXTURES = 64;
+  /// Levels of detail a mesh record holds, coarser ones are dropped
+  static constexpr uint32_t MAX_LODS = 8;
+  /// Meshlets of every registered mesh, meshes past it are drawn whole
+  static constexpr uint32_t MAX_MESHLETS = 1 << 16;
+  /**
+   * Must match @c cluster_cull.comp, the cluster draws of the late culling phase start there. A batch draws at most
+   * @c maxDrawIndirectCount of them, 65535 on some devices, its objects past that are drawn whole
+   */
+  static constexpr uint32_t MAX_CLUSTER_DRAWS = 1 << 17;
+
+  /**
+   * @struct Batch
+   * @brief Objects drawn by a single indirect call, they share their vertex and index buffers
+   */
+  struct Batch {
+    Model::Layout layout;
+    GeometryPool* pool;
+    uint32_t firstObject; ///< Also the first draw of the batch in the draw buffer
+    uint32_t objectCount;
+    uint32_t firstCluster; ///< First draw of the batch in the cluster draw buffer
+    uint32_t clusterCount; ///< Meshlets of every object drawn by clusters
+  };
+
+  /**
+   * @param globalSetLayout Layout of set 0, holding the @c GlobalUbo
+   */
+  GpuScene(Devices* devices, VkDescriptorSetLayout globalSetLayout);
+  ~GpuScene();
+
+  GpuScene(const GpuScene&) = delete;
+  GpuScene& operator=(const GpuScene&) = delete;
+
+  /**
+   * @brief Writes the objects it can draw to the object buffer of this frame and groups them in batches
+   *
+   * Objects need a pooled model and a texture, and room left on the scene. The rest are left to the caller, check
+   * them with @c IsDrawn().
+   */
+  void Update(const FrameInfo& frameInfo, std::vector<Object>& objects);
+  /**
+   * @brief Whether the object at @c index on the last @c Update() is drawn by the scene
+   */
+  bool IsDrawn(size_t index) const { return index < m_drawn.size() && m_drawn[index]; }
+  /**
+   * @brief Records the culling dispatch, has to be outside of a render pass
+   * @param pixelError Screen space error a level of detail may have, see @c SimpleRenderSystem::SetLodSettings()
+   * @param occlusion Only draw what was visible last frame, the rest is left to @c CullOccluded()
+   */
+  void Cull(const FrameInfo& frameInfo, float pixelError, float hysteresis, bool occlusion);
+  /**
+   * @brief Builds the depth pyramid and records the late culling, has to be outside of a render pass
+   *
+   * Only after a @c Cull() with occlusion on and with the early draws done.
+   * @param depth Depth the early draws were drawn into, left in attachment layout
+   */
+  void CullOccluded(const FrameInfo& frameInfo, const DepthAttachment& depth);
+  /**
+   * @brief Binds the descriptor sets of every draw pipeline, set 0 included since the layouts aren't compatible
+   */
+  void Bind(const FrameInfo& frameInfo);
+  /**
+   * @brief Draws the visible objects of a batch, the pipeline and the batch buffers have to be bound
+   * @param late Draw the objects found by @c CullOccluded() instead of the ones of @c Cull()
+   */
+  void Draw(const FrameInfo& frameInfo, uint32_t batch, bool late = false) const;
+
+  const std::vector<Batch>& GetBatches() const { return m_batches; }
+  uint32_t GetObjectCount() const { return m_objectCount; }
+  /// Whether the last @c Cull() left objects for @c CullOccluded()
+  bool GetOcclusion() const { return m_occlusion; }
+  /**
+   * @brief Layout shared by every pipeline drawing the scene: set 0 global, set 1 textures and set 2 objects
+   */
+  VkPipelineLayout GetPipelineLayout() const { return m_drawPipelineLayout; }
+
+private:
+  /**
+   * @struct GpuObject
+   * @brief @c Object of @c object.glsl (std430), shared by the culling and indirect shaders
+   */
+  struct GpuObject {
+    glm::mat4 model;
+    glm::vec4 sphere;
+    uint32_t mesh;
+    uint32_t texture;
+    uint32_t drawOffset;
+    uint32_t batch;
+    float scale;
+    uint32_t clusterOffset; ///< @c Batch::firstCluster, @c INVALID when the object is never drawn by clusters
+    uint32_t flags;
+    uint32_t state; ///< Slot of the object in the LOD state and visibility buffers, the same every frame
+  };
+  static_assert(sizeof(GpuObject) == 112, "GpuObject must match the std430 layout of the shaders");
+
+  struct GpuLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t padding;
+  };
+
+  /**
+   * @struct GpuMesh
+   * @brief @c Mesh on @c cull.comp (std430), index ranges are absolute in the pool index buffer
+   */
+  struct GpuMesh {
+    int32_t vertexOffset;
+    uint32_t lodCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    GpuLod lods[MAX_LODS];
+  };
+  static_assert(sizeof(GpuMesh) == 144, "GpuMesh must match the std430 layout of the shaders");
+
+  /**
+   * @struct GpuMeshlet
+   * @brief @c Meshlet on @c cluster_cull.comp (std430)
+   *
+   * Bounds are moved before the dequantization, so the object model matrix takes them straight to world space.
+   */
+  struct GpuMeshlet {
+    glm::vec4 sphere; ///< Center in quantized space, radius in model units
+    glm::vec4 cone;   ///< Axis in quantized space, not normalized, and cutoff
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t padding[2];
+  };
+  static_assert(sizeof(GpuMeshlet) == 48, "GpuMeshlet must match the std430 layout of the shader");
+
+  /// @c GpuObject::flags, the scale is uniform so normal cones keep their angle in world space
+  static constexpr uint32_t FLAG_CONE_CULLING = BIT(0);
+  /// @c GpuObject::flags, the state slot was just given to the object and still holds what another one left
+  static constexpr uint32_t FLAG_NEW_STATE = BIT(1);
+  /// LOD state and visibility slots, objects of the last @c Update() keep theirs while this one takes new ones
+  static constexpr uint32_t MAX_STATE_SLOTS = MAX_OBJECTS * 2;
+
+  /**
+   * @struct MeshSlot
+   * @brief Model a mesh record belongs to, records no object used on the last @c Update() are freed
+   */
+  struct MeshSlot {
+    const Model* model = nullptr; ///< nullptr while the record is free
+    uint32_t meshletCapacity = 0; ///< Size of the meshlet range of the record, kept for the next model using it
+    uint64_t lastUpdate = 0;
+  };
+
+  /**
+   * @struct TextureSlot
+   * @brief Texture of an element of the texture array, freed like @c MeshSlot
+   */
+  struct TextureSlot {
+    const Texture* texture = nullptr; ///< nullptr while the slot is free
+    uint64_t id = 0;                  ///< @c Texture::GetUniqueId(), a new texture can get the address of a freed one
+    uint64_t lastUpdate = 0;
+  };
+
+  /**
+   * @struct StateSlot
+   * @brief LOD state and visibility slot of an object
+   */
+  struct StateSlot {
+    uint32_t slot;
+    uint64_t lastUpdate;
+  };
+
+  /**
+   * @struct Placement
+   * @brief Where an object goes, filled by the first pass of @c Update()
+   */
+  struct Placement {
+    uint32_t batch;
+    uint32_t mesh;
+    uint32_t texture;
+    uint32_t state;
+    bool clustered;
+    bool newState;
+  };
+
+  /**
+   * @struct CullData
+   * @brief @c Cull uniform block of @c cull.comp (std140), the same for both phases of a frame
+   */
+  struct CullData {
+    glm::mat4 projectionView;
+    glm::vec4 planes[6];
+    glm::vec4 camera;
+    glm::vec2 pyramidSize;
+    uint32_t objectCount;
+    float pixelsPerUnit;
+    float pixelError;
+    float hysteresis;
+    uint32_t padding[2];
+  };
+  static_assert(sizeof(CullData) == 208, "CullData must match the std140 layout of the shader");
+
+  /**
+   * @enum CullPhase
+   * @brief Push constant of @c cull.comp
+   */
+  enum class CullPhase : uint32_t {
+    All,   ///< No occlusion culling, everything in the frustum is drawn
+    Early, ///< Objects visible last frame
+    Late,  ///< Everything else, tested against the depth pyramid
+  };
+
+  /**
+   * @struct FrameResources
+   * @brief Everything written every frame, one per frame in flight
+   */
+  struct FrameResources {
+    std::unique_ptr<Buffer> objects;
+    std::unique_ptr<Buffer> meshes;
+    std::unique_ptr<Buffer> draws;
+    std::unique_ptr<Buffer> counts;
+    std::unique_ptr<Buffer> cullData;
+    std::unique_ptr<Buffer> meshlets;
+    /// Objects handed to @c cluster_cull.comp, the late phase ones after @c MAX_OBJECTS
+    std::unique_ptr<Buffer> tasks;
+    /// One @c VkDispatchIndirectCommand per phase, padded to 16 bytes, the shader counts the tasks in x
+    std::unique_ptr<Buffer> dispatches;
+    std::unique_ptr<Buffer> clusterDraws;
+    VkDescriptorSet cullSet = VK_NULL_HANDLE;
+    VkDescriptorSet objectSet = VK_NULL_HANDLE;
+    VkDescriptorSet textureSet = VK_NULL_HANDLE;
+    uint32_t meshVersion = 0;    ///< @c m_meshVersion the mesh buffer was last written with
+    uint32_t meshletVersion = 0; ///< @c m_meshletVersion the meshlet buffer was last written with
+    uint32_t textureVersion = 0; ///< @c m_textureVersion the texture set was last written with
+  };
+
+  static constexpr uint32_t INVALID = UINT32_MAX;
+
+  void CreateLayouts(VkDescriptorSetLayout globalSetLayout);
+  void CreateFrameResources();
+  /// (Re)creates the depth pyramid when the frame size changes
+  void UpdatePyramid(VkExtent2D extent);
+  void Dispatch(VkCommandBuffer commandBuffer, CullPhase phase) const;
+  /// @return Index of the mesh record, @c INVALID if the scene is full
+  uint32_t RegisterMesh(const Model* model);
+  /**
+   * @brief Converts the meshlets of a model into @c mesh, in place when they fit its current range
+   * @param capacity Meshlets of the range @c mesh points to, 0 for a new record. Updated when a new range is taken
+   */
+  void RegisterMeshlets(const Model* model, GpuMesh& mesh, uint32_t& capacity);
+  /// @return Slot of the texture, @c INVALID if the scene is full
+  uint32_t RegisterTexture(const Texture* texture);
+  /// Frees the mesh, texture and state slots nothing used on this @c Update()
+  void ReleaseUnused();
+  void WriteTextures(FrameResources& frame) const;
+
+  Devices* m_devices;
+  std::unique_ptr<DescriptorSetLayout> m_cullSetLayout;
+  std::unique_ptr<DescriptorSetLayout> m_textureSetLayout;
+  std::unique_ptr<DescriptorSetLayout> m_objectSetLayout;
+  std::unique_ptr<DescriptorPool> m_descriptorPool;
+  VkPipelineLayout m_cullPipelineLayout = VK_NULL_HANDLE;
+  VkPipelineLayout m_drawPipelineLayout = VK_NULL_HANDLE;
+  std::unique_ptr<Pipeline> m_cullPipeline;
+  std::unique_ptr<Pipeline> m_clusterPipeline;
+
+  std::vector<FrameResources> m_frames;
+  /// Level of detail drawn last frame by every state slot, only the culling shader touches it
+  std::unique_ptr<Buffer> m_lodState;
+  /// Whether every state slot was visible last frame, only the culling shader touches it
+  std::unique_ptr<Buffer> m_visibility;
+  std::unique_ptr<DepthPyramid> m_pyramid;
+
+  std::unordered_map<const Model*, uint32_t> m_meshIndices;
+  std::vector<GpuMesh> m_meshes;
+  std::vector<MeshSlot> m_meshSlots;
+  std::vector<uint32_t> m_freeMeshes;
+  uint32_t m_meshVersion = 0;
+  std::vector<GpuMeshlet> m_meshlets;
+  uint32_t m_meshletVersion = 0;
+  std::unordered_map<const Texture*, uint32_t> m_textureIndices;
+  std::vector<TextureSlot> m_textures;
+  std::vector<uint32_t> m_freeTextures;
+  uint32_t m_textureVersion = 0;
+  /// By @c Object::GetID()
+  std::unordered_map<uint32_t, StateSlot> m_stateSlots;
+  std::vector<uint32_t> m_freeStateSlots;
+  uint32_t m_stateSlotCount = 0; ///< Slots handed out at least once, the ones past it were never used
+  uint64_t m_updateNumber = 0;
+
+  std::vector<Batch> m_batches;
+  std::vector<uint8_t> m_drawn;
+  std::vector<Placement> m_placement;
+  uint32_t m_objectCount = 0;
+  uint32_t m_clusterCount = 0;
+  int m_frameIndex = 0;
+  bool m_occlusion = false;
+  /// Draws a single indirect call may make, @c MAX_OBJECTS fits in the minimum the GPU scene requires
+  uint32_t m_maxDrawCount = 0;
+  /// The draw pipelines cull back faces, otherwise clusters facing away are still visible and the cone test is skipped
+  bool m_coneCulling = false;
+};
+
+}
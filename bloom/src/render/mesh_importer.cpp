@@ -0,0 +1,1192 @@
+#include "mesh_importer.hpp"
+#include "src/profiler.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <thread>
+
+namespace bloom::render {
+
+static_assert(sizeof(Model::Vertex) == 36, "Vertex layout is part of the cooked mesh format");
+static_assert(sizeof(Model::Lod) == 12, "Lod layout is part of the cooked mesh format");
+
+// Hand made levels have no error to go by, assume each halving of the triangles costs this much of the radius
+static constexpr float HAND_MADE_LOD_ERROR = 0.01f;
+
+// Below this an OBJ isn't worth splitting between threads
+static constexpr size_t OBJ_MIN_CHUNK_SIZE = 1 << 20;
+static constexpr uint8_t OBJ_RELATIVE_POSITION = BIT(0);
+static constexpr uint8_t OBJ_RELATIVE_TEXCOORD = BIT(1);
+
+static constexpr uint32_t GLB_MAGIC = 0x46546c67;      ///< "glTF"
+static constexpr uint32_t GLB_CHUNK_JSON = 0x4e4f534a; ///< "JSON"
+static constexpr uint32_t GLB_CHUNK_BIN = 0x004e4942;  ///< "BIN\0"
+
+static double ElapsedMilliseconds(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string GetExtension(const std::string& path) {
+  std::string extension = std::filesystem::path(path).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(),
+                 [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+  return extension;
+}
+
+static uint32_t ResolveThreadCount(uint32_t threads) {
+  if (threads != 0) return threads;
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/**
+ * @brief Runs @c function(i) for every i in [0, count), the first one on the calling thread
+ */
+template<typename Function>
+static void ParallelFor(size_t count, Function&& function) {
+  std::vector<std::future<void>> tasks;
+  tasks.reserve(count > 0 ? count - 1 : 0);
+  for (size_t i = 1; i < count; i++) {
+    tasks.push_back(std::async(std::launch::async, function, i));
+  }
+  if (count > 0) function(0);
+  for (auto& task : tasks) task.get();
+}
+
+/**
+ * @brief 64 bit hash reading a word at a time, only meant to tell files apart, not to resist attacks
+ */
+static uint64_t HashBytes(std::span<const uint8_t> data, uint64_t seed) {
+  constexpr uint64_t PRIME_A = 0x9e3779b97f4a7c15ull;
+  constexpr uint64_t PRIME_B = 0xc2b2ae3d27d4eb4full;
+  uint64_t hash = seed ^ (data.size() * PRIME_A);
+
+  size_t i = 0;
+  for (; i + 8 <= data.size(); i += 8) {
+    uint64_t word;
+    memcpy(&word, data.data() + i, sizeof(word));
+    hash ^= word * PRIME_B;
+    hash = ((hash << 31) | (hash >> 33)) * PRIME_A;
+  }
+  uint64_t tail = 0;
+  memcpy(&tail, data.data() + i, data.size() - i);
+  hash ^= tail * PRIME_B;
+
+  // Final avalanche so every input bit reaches every output bit
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static bool ReadFile(const std::string& path, std::vector<uint8_t>& data) {
+  std::ifstream input(path, std::ios::binary | std::ios::ate);
+  if (!input) return false;
+  data.resize(static_cast<size_t>(input.tellg()));
+  input.seekg(0);
+  return static_cast<bool>(input.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())));
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// OBJ
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * @struct ObjCorner
+ * @brief Face corner as written in the file, negative indices are kept relative to the start of their chunk
+ */
+struct ObjCorner {
+  int64_t position = -1;
+  int64_t texCoord = -1;
+  uint8_t relative = 0;
+};
+
+/**
+ * @struct ObjChunk
+ * @brief Range of lines parsed by one thread
+ */
+struct ObjChunk {
+  const char* begin = nullptr;
+  const char* end = nullptr;
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec4> colors;
+  std::vector<glm::vec2> texCoords;
+  std::vector<ObjCorner> corners; ///< Three per triangle, polygons are already fanned
+
+  size_t positionOffset = 0;
+  size_t texCoordOffset = 0;
+
+  std::vector<Model::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  size_t skippedTriangles = 0;
+};
+
+static bool IsObjSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+static const char* SkipObjSpaces(const char* it, const char* end) {
+  while (it < end && IsObjSpace(*it)) it++;
+  return it;
+}
+
+static const char* ParseObjFloat(const char* it, const char* end, float& value) {
+  it = SkipObjSpaces(it, end);
+  if (it < end && *it == '+') it++;
+  auto [next, error] = std::from_chars(it, end, value);
+  return error == std::errc() ? next : nullptr;
+}
+
+static const char* ParseObjIndex(const char* it, const char* end, size_t localCount, int64_t& resolved,
+                                 uint8_t& relative, uint8_t flag) {
+  int64_t index = 0;
+  auto [next, error] = std::from_chars(it, end, index);
+  if (error != std::errc()) return it;
+
+  if (index > 0) {
+    resolved = index - 1;
+  } else if (index < 0) {
+    // Relative to the last element read, which we only know locally until the chunks are merged
+    resolved = static_cast<int64_t>(localCount) + index;
+    relative |= flag;
+  }
+  return next;
+}
+
+static void ParseObjFace(const char* it, const char* end, ObjChunk& chunk, std::vector<ObjCorner>& face) {
+  face.clear();
+  while (true) {
+    it = SkipObjSpaces(it, end);
+    if (it == end) break;
+
+    ObjCorner corner;
+    it = ParseObjIndex(it, end, chunk.positions.size(), corner.position, corner.relative, OBJ_RELATIVE_POSITION);
+    if (it < end && *it == '/') {
+      it++;
+      if (it < end && *it != '/') {
+        it = ParseObjIndex(it, end, chunk.texCoords.size(), corner.texCoord, corner.relative, OBJ_RELATIVE_TEXCOORD);
+      }
+      // Normals aren't part of the vertex format yet
+    }
+    while (it < end && !IsObjSpace(*it)) it++;
+    face.push_back(corner);
+  }
+
+  for (size_t i = 2; i < face.size(); i++) {
+    chunk.corners.push_back(face[0]);
+    chunk.corners.push_back(face[i - 1]);
+    chunk.corners.push_back(face[i]);
+  }
+}
+
+static void ParseObjChunk(ObjChunk& chunk) {
+  std::vector<ObjCorner> face;
+  for (const char* line = chunk.begin; line < chunk.end;) {
+    auto lineEnd = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(chunk.end - line)));
+    if (lineEnd == nullptr) lineEnd = chunk.end;
+
+    const char* it = SkipObjSpaces(line, lineEnd);
+    const auto length = lineEnd - it;
+    if (length >= 2 && it[0] == 'v' && IsObjSpace(it[1])) {
+      glm::vec3 position{0.0f};
+      const char* next = it + 1;
+      for (int i = 0; i < 3 && next != nullptr; i++) next = ParseObjFloat(next, lineEnd, position[i]);
+      if (next == nullptr) next = lineEnd;
+
+      // Vertex colours are a common extension, r g b right after the position
+      glm::vec4 color{1.0f};
+      const char* colorNext = next;
+      for (int i = 0; i < 3 && colorNext != nullptr; i++) colorNext = ParseObjFloat(colorNext, lineEnd, color[i]);
+      if (colorNext == nullptr) color = glm::vec4(1.0f);
+
+      chunk.positions.push_back(position);
+      chunk.colors.push_back(color);
+    } else if (length >= 3 && it[0] == 'v' && it[1] == 't' && IsObjSpace(it[2])) {
+      glm::vec2 texCoord{0.0f};
+      const char* next = ParseObjFloat(it + 2, lineEnd, texCoord.x);
+      if (next != nullptr) ParseObjFloat(next, lineEnd, texCoord.y);
+      // OBJ puts v = 0 at the bottom of the image
+      texCoord.y = 1.0f - texCoord.y;
+      chunk.texCoords.push_back(texCoord);
+    } else if (length >= 2 && it[0] == 'f' && IsObjSpace(it[1])) {
+      ParseObjFace(it + 1, lineEnd, chunk, face);
+    }
+
+    line = lineEnd + 1;
+  }
+}
+
+static void ResolveObjChunk(ObjChunk& chunk, const std::vector<glm::vec3>& positions,
+                            const std::vector<glm::vec4>& colors, const std::vector<glm::vec2>& texCoords) {
+  // Deduplication is per chunk, a vertex shared across a chunk boundary is stored twice
+  std::unordered_map<uint64_t, uint32_t> remap;
+  remap.reserve(chunk.corners.size());
+  chunk.indices.reserve(chunk.corners.size());
+
+  for (size_t triangle = 0; triangle + 3 <= chunk.corners.size(); triangle += 3) {
+    uint32_t indices[3];
+    bool valid = true;
+    for (size_t i = 0; i < 3 && valid; i++) {
+      const auto& corner = chunk.corners[triangle + i];
+      int64_t position = corner.position;
+      if (corner.relative & OBJ_RELATIVE_POSITION) position += static_cast<int64_t>(chunk.positionOffset);
+      int64_t texCoord = corner.texCoord;
+      if (corner.relative & OBJ_RELATIVE_TEXCOORD) texCoord += static_cast<int64_t>(chunk.texCoordOffset);
+
+      if (position < 0 || position >= static_cast<int64_t>(positions.size())) {
+        valid = false;
+        break;
+      }
+      const bool hasTexCoord = texCoord >= 0 && texCoord < static_cast<int64_t>(texCoords.size());
+
+      uint64_t key = static_cast<uint64_t>(position) << 32 | (hasTexCoord ? static_cast<uint32_t>(texCoord) : ~0u);
+      auto [entry, inserted] = remap.try_emplace(key, static_cast<uint32_t>(chunk.vertices.size()));
+      if (inserted) {
+        chunk.vertices.push_back({positions[position], hasTexCoord ? texCoords[texCoord] : glm::vec2(0.0f),
+                                  colors[position]});
+      }
+      indices[i] = entry->second;
+    }
+
+    if (!valid) {
+      chunk.skippedTriangles++;
+      continue;
+    }
+    chunk.indices.insert(chunk.indices.end(), indices, indices + 3);
+  }
+}
+
+bool MeshImporter::ParseObj(std::span<const uint8_t> source, MeshData& mesh, uint32_t threads) {
+  BLOOM_PROFILE_FUNCTION();
+  const auto text = reinterpret_cast<const char*>(source.data());
+  const auto end = text + source.size();
+
+  // Split on line boundaries, every chunk gets a similar amount of bytes
+  const size_t chunkCount = std::clamp<size_t>(source.size() / OBJ_MIN_CHUNK_SIZE, 1, ResolveThreadCount(threads));
+  std::vector<ObjChunk> chunks(chunkCount);
+  const char* begin = text;
+  for (size_t i = 0; i < chunkCount; i++) {
+    const char* split = i + 1 == chunkCount ? end : text + source.size() * (i + 1) / chunkCount;
+    if (split < begin) split = begin;
+    auto newline = static_cast<const char*>(memchr(split, '\n', static_cast<size_t>(end - split)));
+    split = newline != nullptr && i + 1 < chunkCount ? newline + 1 : end;
+    chunks[i].begin = begin;
+    chunks[i].end = split;
+    begin = split;
+  }
+
+  ParallelFor(chunkCount, [&chunks](size_t i) { ParseObjChunk(chunks[i]); });
+
+  // Indices in the file are global, so every chunk needs to know how many elements came before it
+  size_t positionCount = 0;
+  size_t texCoordCount = 0;
+  for (auto& chunk : chunks) {
+    chunk.positionOffset = positionCount;
+    chunk.texCoordOffset = texCoordCount;
+    positionCount += chunk.positions.size();
+    texCoordCount += chunk.texCoords.size();
+  }
+  if (positionCount == 0) return false;
+
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec4> colors;
+  std::vector<glm::vec2> texCoords;
+  positions.reserve(positionCount);
+  colors.reserve(positionCount);
+  texCoords.reserve(texCoordCount);
+  for (auto& chunk : chunks) {
+    positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+    colors.insert(colors.end(), chunk.colors.begin(), chunk.colors.end());
+    texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+    chunk.positions = {};
+    chunk.colors = {};
+    chunk.texCoords = {};
+  }
+
+  ParallelFor(chunkCount, [&](size_t i) { ResolveObjChunk(chunks[i], positions, colors, texCoords); });
+
+  size_t vertexCount = 0;
+  size_t indexCount = 0;
+  size_t skippedTriangles = 0;
+  for (const auto& chunk : chunks) {
+    vertexCount += chunk.vertices.size();
+    indexCount += chunk.indices.size();
+    skippedTriangles += chunk.skippedTriangles;
+  }
+  if (skippedTriangles > 0) {
+    BLOOM_WARN("Skipped {0} triangles with out of range indices", skippedTriangles);
+  }
+
+  mesh.vertices.clear();
+  mesh.indices.clear();
+  mesh.vertices.reserve(vertexCount);
+  mesh.indices.reserve(indexCount);
+  for (const auto& chunk : chunks) {
+    const auto base = static_cast<uint32_t>(mesh.vertices.size());
+    mesh.vertices.insert(mesh.vertices.end(), chunk.vertices.begin(), chunk.vertices.end());
+    for (uint32_t index : chunk.indices) mesh.indices.push_back(base + index);
+  }
+  return !mesh.indices.empty();
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// glTF
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * @struct JsonValue
+ * @brief Just enough JSON to read glTF documents, objects keep their keys in order next to the values
+ */
+struct JsonValue {
+  enum class Type { Null, Bool, Number, String, Array, Object };
+
+  Type type = Type::Null;
+  bool boolean = false;
+  double number = 0.0;
+  std::string string;
+  std::vector<JsonValue> values; ///< Array elements or object member values
+  std::vector<std::string> keys; ///< Object member names, same order as @c values
+
+  const JsonValue* Find(std::string_view key) const {
+    if (type != Type::Object) return nullptr;
+    for (size_t i = 0; i < keys.size(); i++) {
+      if (keys[i] == key) return &values[i];
+    }
+    return nullptr;
+  }
+  const JsonValue* At(size_t index) const {
+    return type == Type::Array && index < values.size() ? &values[index] : nullptr;
+  }
+  size_t Size() const { return type == Type::Array ? values.size() : 0; }
+  double GetNumber(std::string_view key, double fallback) const {
+    auto value = Find(key);
+    return value != nullptr && value->type == Type::Number ? value->number : fallback;
+  }
+  const std::string* GetString(std::string_view key) const {
+    auto value = Find(key);
+    return value != nullptr && value->type == Type::String ? &value->string : nullptr;
+  }
+};
+
+struct JsonReader {
+  const char* it;
+  const char* end;
+};
+
+static constexpr int JSON_MAX_DEPTH = 128;
+
+static void SkipJsonSpaces(JsonReader& reader) {
+  while (reader.it < reader.end && (*reader.it == ' ' || *reader.it == '\t' || *reader.it == '\n' || *reader.it == '\r')) {
+    reader.it++;
+  }
+}
+
+static bool ParseJsonValue(JsonReader& reader, JsonValue& value, int depth);
+
+static void AppendUtf8(std::string& out, uint32_t codepoint) {
+  if (codepoint < 0x80) {
+    out += static_cast<char>(codepoint);
+  } else if (codepoint < 0x800) {
+    out += static_cast<char>(0xc0 | (codepoint >> 6));
+    out += static_cast<char>(0x80 | (codepoint & 0x3f));
+  } else {
+    out += static_cast<char>(0xe0 | (codepoint >> 12));
+    out += static_cast<char>(0x80 | ((codepoint >> 6) & 0x3f));
+    out += static_cast<char>(0x80 | (codepoint & 0x3f));
+  }
+}
+
+static bool ParseJsonString(JsonReader& reader, std::string& out) {
+  if (reader.it == reader.end || *reader.it != '"') return false;
+  reader.it++;
+  out.clear();
+  while (reader.it < reader.end) {
+    char c = *reader.it++;
+    if (c == '"') return true;
+    if (c != '\\') {
+      out += c;
+      continue;
+    }
+    if (reader.it == reader.end) return false;
+    switch (char escape = *reader.it++) {
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        // Surrogate pairs aren't joined, glTF names and URIs are never outside the BMP in practice
+        uint32_t codepoint = 0;
+        if (reader.end - reader.it < 4) return false;
+        auto [next, error] = std::from_chars(reader.it, reader.it + 4, codepoint, 16);
+        if (error != std::errc() || next != reader.it + 4) return false;
+        reader.it += 4;
+        AppendUtf8(out, codepoint);
+        break;
+      }
+      default: out += escape; break;
+    }
+  }
+  return false;
+}
+
+static bool ParseJsonLiteral(JsonReader& reader, std::string_view literal) {
+  if (static_cast<size_t>(reader.end - reader.it) < literal.size()) return false;
+  if (std::string_view(reader.it, literal.size()) != literal) return false;
+  reader.it += literal.size();
+  return true;
+}
+
+static bool ParseJsonContainer(JsonReader& reader, JsonValue& value, int depth, bool object) {
+  value.type = object ? JsonValue::Type::Object : JsonValue::Type::Array;
+  const char close = object ? '}' : ']';
+  reader.it++;
+  SkipJsonSpaces(reader);
+  if (reader.it < reader.end && *reader.it == close) {
+    reader.it++;
+    return true;
+  }
+
+  while (reader.it < reader.end) {
+    if (object) {
+      SkipJsonSpaces(reader);
+      value.keys.emplace_back();
+      if (!ParseJsonString(reader, value.keys.back())) return false;
+      SkipJsonSpaces(reader);
+      if (reader.it == reader.end || *reader.it++ != ':') return false;
+    }
+    value.values.emplace_back();
+    if (!ParseJsonValue(reader, value.values.back(), depth + 1)) return false;
+
+    SkipJsonSpaces(reader);
+    if (reader.it == reader.end) return false;
+    char c = *reader.it++;
+    if (c == close) return true;
+    if (c != ',') return false;
+  }
+  return false;
+}
+
+static bool ParseJsonValue(JsonReader& reader, JsonValue& value, int depth) {
+  if (depth > JSON_MAX_DEPTH) return false;
+  SkipJsonSpaces(reader);
+  if (reader.it == reader.end) return false;
+
+  switch (*reader.it) {
+    case '{': return ParseJsonContainer(reader, value, depth, true);
+    case '[': return ParseJsonContainer(reader, value, depth, false);
+    case '"':
+      value.type = JsonValue::Type::String;
+      return ParseJsonString(reader, value.string);
+    case 't':
+      value.type = JsonValue::Type::Bool;
+      value.boolean = true;
+      return ParseJsonLiteral(reader, "true");
+    case 'f':
+      value.type = JsonValue::Type::Bool;
+      return ParseJsonLiteral(reader, "false");
+    case 'n':
+      return ParseJsonLiteral(reader, "null");
+    default: {
+      value.type = JsonValue::Type::Number;
+      auto [next, error] = std::from_chars(reader.it, reader.end, value.number);
+      if (error != std::errc()) return false;
+      reader.it = next;
+      return true;
+    }
+  }
+}
+
+static bool ParseJson(std::string_view text, JsonValue& root) {
+  JsonReader reader{text.data(), text.data() + text.size()};
+  return ParseJsonValue(reader, root, 0);
+}
+
+static bool DecodeBase64(std::string_view text, std::vector<uint8_t>& out) {
+  auto decode = [](char c) -> int {
+    if (c >= 'A' && c <= 'Z') return c - 'A';
+    if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+    if (c >= '0' && c <= '9') return c - '0' + 52;
+    if (c == '+') return 62;
+    if (c == '/') return 63;
+    return -1;
+  };
+
+  out.clear();
+  out.reserve(text.size() / 4 * 3);
+  uint32_t bits = 0;
+  int bitCount = 0;
+  for (char c : text) {
+    if (c == '=') break;
+    int digit = decode(c);
+    if (digit < 0) return false;
+    bits = (bits << 6) | static_cast<uint32_t>(digit);
+    bitCount += 6;
+    if (bitCount >= 8) {
+      bitCount -= 8;
+      out.push_back(static_cast<uint8_t>(bits >> bitCount));
+    }
+  }
+  return true;
+}
+
+/**
+ * @struct GltfDocument
+ * @brief Parsed JSON plus the contents of every buffer it references
+ */
+struct GltfDocument {
+  JsonValue json;
+  std::vector<std::vector<uint8_t>> ownedBuffers;
+  std::vector<std::span<const uint8_t>> buffers;
+};
+
+/**
+ * @brief Splits a glb container into its JSON and binary chunks, a .gltf file is all JSON
+ */
+static bool SplitGltf(std::span<const uint8_t> source, std::string_view& json, std::span<const uint8_t>& binary) {
+  uint32_t header[3];
+  if (source.size() < sizeof(header)) {
+    json = {reinterpret_cast<const char*>(source.data()), source.size()};
+    return true;
+  }
+  memcpy(header, source.data(), sizeof(header));
+  if (header[0] != GLB_MAGIC) {
+    json = {reinterpret_cast<const char*>(source.data()), source.size()};
+    return true;
+  }
+  if (header[1] != 2) return false;
+
+  const size_t length = std::min<size_t>(header[2], source.size());
+  for (size_t offset = sizeof(header); offset + 8 <= length;) {
+    uint32_t chunk[2];
+    memcpy(chunk, source.data() + offset, sizeof(chunk));
+    offset += sizeof(chunk);
+    if (chunk[0] > length - offset) return false;
+
+    if (chunk[1] == GLB_CHUNK_JSON) json = {reinterpret_cast<const char*>(source.data() + offset), chunk[0]};
+    else if (chunk[1] == GLB_CHUNK_BIN) binary = source.subspan(offset, chunk[0]);
+    // Chunks are padded to 4 bytes
+    offset += (chunk[0] + 3) & ~3u;
+  }
+  return !json.empty();
+}
+
+static bool LoadGltfBuffers(const std::string& path, std::span<const uint8_t> binary, GltfDocument& gltf) {
+  const auto buffers = gltf.json.Find("buffers");
+  const size_t count = buffers != nullptr ? buffers->Size() : 0;
+  gltf.ownedBuffers.resize(count);
+  gltf.buffers.resize(count);
+
+  const auto directory = std::filesystem::path(path).parent_path();
+  for (size_t i = 0; i < count; i++) {
+    const auto& buffer = *buffers->At(i);
+    const auto uri = buffer.GetString("uri");
+    const auto byteLength = static_cast<size_t>(buffer.GetNumber("byteLength", 0.0));
+
+    if (uri == nullptr) {
+      gltf.buffers[i] = binary;
+    } else if (uri->starts_with("data:")) {
+      auto comma = uri->find(',');
+      if (comma == std::string::npos || !DecodeBase64(std::string_view(*uri).substr(comma + 1), gltf.ownedBuffers[i])) {
+        BLOOM_WARN("Invalid data URI on buffer {0} of {1}", i, path);
+        return false;
+      }
+      gltf.buffers[i] = gltf.ownedBuffers[i];
+    } else {
+      if (!ReadFile((directory / *uri).string(), gltf.ownedBuffers[i])) {
+        BLOOM_WARN("Could not read buffer {0} of {1}", *uri, path);
+        return false;
+      }
+      gltf.buffers[i] = gltf.ownedBuffers[i];
+    }
+
+    if (gltf.buffers[i].size() < byteLength) {
+      BLOOM_WARN("Buffer {0} of {1} is shorter than its byteLength", i, path);
+      return false;
+    }
+  }
+  return true;
+}
+
+static uint32_t GetGltfComponentSize(int componentType) {
+  switch (componentType) {
+    case 5120: case 5121: return 1; // byte, unsigned byte
+    case 5122: case 5123: return 2; // short, unsigned short
+    case 5125: case 5126: return 4; // unsigned int, float
+    default: return 0;
+  }
+}
+
+static uint32_t GetGltfComponentCount(const std::string& type) {
+  if (type == "SCALAR") return 1;
+  if (type == "VEC2") return 2;
+  if (type == "VEC3") return 3;
+  if (type == "VEC4") return 4;
+  return 0;
+}
+
+static double ReadGltfComponent(const uint8_t* data, int componentType, bool normalized) {
+  switch (componentType) {
+    case 5120: {
+      int8_t value;
+      memcpy(&value, data, sizeof(value));
+      return normalized ? std::max(value / 127.0, -1.0) : value;
+    }
+    case 5121: return normalized ? *data / 255.0 : *data;
+    case 5122: {
+      int16_t value;
+      memcpy(&value, data, sizeof(value));
+      return normalized ? std::max(value / 32767.0, -1.0) : value;
+    }
+    case 5123: {
+      uint16_t value;
+      memcpy(&value, data, sizeof(value));
+      return normalized ? value / 65535.0 : value;
+    }
+    case 5125: {
+      uint32_t value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    case 5126: {
+      float value;
+      memcpy(&value, data, sizeof(value));
+      return value;
+    }
+    default: return 0.0;
+  }
+}
+
+/**
+ * @brief Reads an accessor into a tightly packed array of doubles
+ * @param components Set to the component count of the accessor type
+ */
+static bool ReadGltfAccessor(const GltfDocument& gltf, size_t index, std::vector<double>& out, uint32_t& components) {
+  const auto accessors = gltf.json.Find("accessors");
+  const auto accessor = accessors != nullptr ? accessors->At(index) : nullptr;
+  if (accessor == nullptr) return false;
+
+  const auto type = accessor->GetString("type");
+  const auto componentType = static_cast<int>(accessor->GetNumber("componentType", 0.0));
+  const auto count = static_cast<size_t>(accessor->GetNumber("count", 0.0));
+  const auto normalizedValue = accessor->Find("normalized");
+  const bool normalized = normalizedValue != nullptr && normalizedValue->boolean;
+  components = type != nullptr ? GetGltfComponentCount(*type) : 0;
+  const uint32_t componentSize = GetGltfComponentSize(componentType);
+  if (components == 0 || componentSize == 0) return false;
+
+  out.assign(count * components, 0.0);
+  if (accessor->Find("sparse") != nullptr) {
+    BLOOM_WARN_THROTTLED(1000, "Sparse glTF accessors aren't supported, reading the base values only");
+  }
+  // No buffer view means all zeros
+  const auto viewIndex = accessor->Find("bufferView");
+  if (viewIndex == nullptr || count == 0) return true;
+
+  const auto views = gltf.json.Find("bufferViews");
+  const auto view = views != nullptr ? views->At(static_cast<size_t>(viewIndex->number)) : nullptr;
+  if (view == nullptr) return false;
+  const auto bufferIndex = static_cast<size_t>(view->GetNumber("buffer", 0.0));
+  if (bufferIndex >= gltf.buffers.size()) return false;
+
+  const auto buffer = gltf.buffers[bufferIndex];
+  const auto viewOffset = static_cast<size_t>(view->GetNumber("byteOffset", 0.0));
+  const auto viewLength = static_cast<size_t>(view->GetNumber("byteLength", 0.0));
+  const size_t elementSize = static_cast<size_t>(components) * componentSize;
+  const auto stride = static_cast<size_t>(view->GetNumber("byteStride", static_cast<double>(elementSize)));
+  const auto offset = static_cast<size_t>(accessor->GetNumber("byteOffset", 0.0));
+  if (viewOffset + viewLength > buffer.size() || offset + stride * (count - 1) + elementSize > viewLength) {
+    BLOOM_WARN("glTF accessor {0} reads out of its buffer view", index);
+    return false;
+  }
+
+  const uint8_t* data = buffer.data() + viewOffset + offset;
+  for (size_t i = 0; i < count; i++) {
+    for (uint32_t c = 0; c < components; c++) {
+      out[i * components + c] = ReadGltfComponent(data + i * stride + c * componentSize, componentType, normalized);
+    }
+  }
+  return true;
+}
+
+static glm::mat4 GetGltfNodeMatrix(const JsonValue& node) {
+  if (auto matrix = node.Find("matrix"); matrix != nullptr && matrix->Size() == 16) {
+    glm::mat4 result;
+    for (size_t i = 0; i < 16; i++) glm::value_ptr(result)[i] = static_cast<float>(matrix->values[i].number);
+    return result;
+  }
+
+  auto read = [&node](std::string_view key, auto fallback) {
+    auto result = fallback;
+    if (auto value = node.Find(key); value != nullptr && value->Size() == static_cast<size_t>(result.length())) {
+      for (int i = 0; i < result.length(); i++) result[i] = static_cast<float>(value->values[i].number);
+    }
+    return result;
+  };
+  const auto translation = read("translation", glm::vec3(0.0f));
+  const auto rotation = read("rotation", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
+  const auto scale = read("scale", glm::vec3(1.0f));
+
+  const glm::quat orientation(rotation.w, rotation.x, rotation.y, rotation.z);
+  return glm::translate(glm::mat4(1.0f), translation) * glm::mat4_cast(orientation) *
+         glm::scale(glm::mat4(1.0f), scale);
+}
+
+static bool AppendGltfPrimitive(const GltfDocument& gltf, const JsonValue& primitive, const glm::mat4& transform,
+                                MeshData& mesh) {
+  // Only triangle lists, strips and fans are rare enough to not be worth it
+  if (primitive.GetNumber("mode", 4.0) != 4.0) return false;
+  const auto attributes = primitive.Find("attributes");
+  const auto positionIndex = attributes != nullptr ? attributes->Find("POSITION") : nullptr;
+  if (positionIndex == nullptr) return false;
+
+  std::vector<double> positions;
+  uint32_t components = 0;
+  if (!ReadGltfAccessor(gltf, static_cast<size_t>(positionIndex->number), positions, components) || components != 3) {
+    return false;
+  }
+  const size_t vertexCount = positions.size() / 3;
+
+  std::vector<double> texCoords;
+  uint32_t texCoordComponents = 0;
+  if (auto index = attributes->Find("TEXCOORD_0"); index != nullptr) {
+    if (!ReadGltfAccessor(gltf, static_cast<size_t>(index->number), texCoords, texCoordComponents) ||
+        texCoordComponents != 2 || texCoords.size() / 2 != vertexCount) {
+      texCoords.clear();
+    }
+  }
+  std::vector<double> colors;
+  uint32_t colorComponents = 0;
+  if (auto index = attributes->Find("COLOR_0"); index != nullptr) {
+    if (!ReadGltfAccessor(gltf, static_cast<size_t>(index->number), colors, colorComponents) ||
+        colorComponents < 3 || colors.size() / colorComponents != vertexCount) {
+      colors.clear();
+    }
+  }
+
+  const auto base = static_cast<uint32_t>(mesh.vertices.size());
+  mesh.vertices.reserve(mesh.vertices.size() + vertexCount);
+  for (size_t i = 0; i < vertexCount; i++) {
+    Model::Vertex vertex{};
+    glm::vec4 position(positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2], 1.0f);
+    vertex.position = glm::vec3(transform * position);
+    if (!texCoords.empty()) vertex.texCoord = glm::vec2(texCoords[i * 2], texCoords[i * 2 + 1]);
+    vertex.color = glm::vec4(1.0f);
+    for (uint32_t c = 0; c < colorComponents && !colors.empty(); c++) {
+      vertex.color[static_cast<int>(c)] = static_cast<float>(colors[i * colorComponents + c]);
+    }
+    mesh.vertices.push_back(vertex);
+  }
+
+  std::vector<uint32_t> indices;
+  if (auto index = primitive.Find("indices"); index != nullptr) {
+    std::vector<double> values;
+    if (!ReadGltfAccessor(gltf, static_cast<size_t>(index->number), values, components) || components != 1) {
+      mesh.vertices.resize(base);
+      return false;
+    }
+    indices.reserve(values.size());
+    for (double value : values) indices.push_back(static_cast<uint32_t>(value));
+  } else {
+    indices.resize(vertexCount);
+    for (size_t i = 0; i < vertexCount; i++) indices[i] = static_cast<uint32_t>(i);
+  }
+
+  // Mirroring transforms flip the winding, undo it so every primitive ends up counter clockwise
+  const bool mirrored = glm::determinant(glm::mat3(transform)) < 0.0f;
+  for (size_t i = 0; i + 3 <= indices.size(); i += 3) {
+    if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount) continue;
+    mesh.indices.push_back(base + indices[i]);
+    mesh.indices.push_back(base + indices[mirrored ? i + 2 : i + 1]);
+    mesh.indices.push_back(base + indices[mirrored ? i + 1 : i + 2]);
+  }
+  return true;
+}
+
+static void AppendGltfMesh(const GltfDocument& gltf, size_t meshIndex, const glm::mat4& transform, MeshData& mesh) {
+  const auto meshes = gltf.json.Find("meshes");
+  const auto gltfMesh = meshes != nullptr ? meshes->At(meshIndex) : nullptr;
+  const auto primitives = gltfMesh != nullptr ? gltfMesh->Find("primitives") : nullptr;
+  if (primitives == nullptr) return;
+
+  for (const auto& primitive : primitives->values) {
+    if (!AppendGltfPrimitive(gltf, primitive, transform, mesh)) {
+      BLOOM_WARN_THROTTLED(1000, "Skipped a glTF primitive that isn't an indexed or plain triangle list");
+    }
+  }
+}
+
+static void AppendGltfNode(const GltfDocument& gltf, size_t nodeIndex, const glm::mat4& parent, MeshData& mesh,
+                           int depth) {
+  const auto nodes = gltf.json.Find("nodes");
+  const auto node = nodes != nullptr ? nodes->At(nodeIndex) : nullptr;
+  // The depth limit only guards against broken files with cycles
+  if (node == nullptr || depth > JSON_MAX_DEPTH) return;
+
+  const glm::mat4 transform = parent * GetGltfNodeMatrix(*node);
+  if (auto meshIndex = node->Find("mesh"); meshIndex != nullptr) {
+    AppendGltfMesh(gltf, static_cast<size_t>(meshIndex->number), transform, mesh);
+  }
+  if (auto children = node->Find("children"); children != nullptr) {
+    for (const auto& child : children->values) {
+      AppendGltfNode(gltf, static_cast<size_t>(child.number), transform, mesh, depth + 1);
+    }
+  }
+}
+
+bool MeshImporter::ParseGltf(const std::string& path, std::span<const uint8_t> source, MeshData& mesh) {
+  BLOOM_PROFILE_FUNCTION();
+  std::string_view json;
+  std::span<const uint8_t> binary;
+  GltfDocument gltf;
+  if (!SplitGltf(source, json, binary) || !ParseJson(json, gltf.json) || gltf.json.type != JsonValue::Type::Object) {
+    BLOOM_WARN("{0} is not a valid glTF 2.0 file", path);
+    return false;
+  }
+  if (!LoadGltfBuffers(path, binary, gltf)) return false;
+
+  mesh.vertices.clear();
+  mesh.indices.clear();
+  const auto scenes = gltf.json.Find("scenes");
+  const auto scene = scenes != nullptr ? scenes->At(static_cast<size_t>(gltf.json.GetNumber("scene", 0.0))) : nullptr;
+  const auto sceneNodes = scene != nullptr ? scene->Find("nodes") : nullptr;
+  if (sceneNodes != nullptr) {
+    for (const auto& node : sceneNodes->values) {
+      AppendGltfNode(gltf, static_cast<size_t>(node.number), glm::mat4(1.0f), mesh, 0);
+    }
+  } else if (const auto meshes = gltf.json.Find("meshes"); meshes != nullptr) {
+    // Files without scenes are libraries, take every mesh as is
+    for (size_t i = 0; i < meshes->Size(); i++) {
+      AppendGltfMesh(gltf, i, glm::mat4(1.0f), mesh);
+    }
+  }
+  return !mesh.indices.empty();
+}
+
+static void CollectGltfExternalBuffers(const std::string& path, std::span<const uint8_t> source,
+                                       std::vector<std::string>& paths) {
+  std::string_view json;
+  std::span<const uint8_t> binary;
+  JsonValue root;
+  if (!SplitGltf(source, json, binary) || !ParseJson(json, root)) return;
+
+  const auto buffers = root.Find("buffers");
+  if (buffers == nullptr) return;
+  const auto directory = std::filesystem::path(path).parent_path();
+  for (const auto& buffer : buffers->values) {
+    const auto uri = buffer.GetString("uri");
+    if (uri != nullptr && !uri->starts_with("data:")) paths.push_back((directory / *uri).string());
+  }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Importer
+// ---------------------------------------------------------------------------------------------------------------------
+
+MeshImporter::MeshImporter(Devices* devices, const Settings& settings) : m_devices(devices), m_settings(settings) {}
+
+std::unique_ptr<Model> MeshImporter::Load(const std::string& path, const Model::Layout& layout) {
+  return Upload(path, Import(path), layout);
+}
+
+std::vector<std::unique_ptr<Model>> MeshImporter::LoadAll(const std::vector<std::string>& paths,
+                                                          const Model::Layout& layout) {
+  BLOOM_PROFILE_FUNCTION();
+  std::vector<ImportedMesh> imported(paths.size());
+  ParallelFor(paths.size(), [&](size_t i) { imported[i] = Import(paths[i]); });
+
+  // Uploads go through the single time command pool, which isn't thread safe
+  std::vector<std::unique_ptr<Model>> models;
+  models.reserve(paths.size());
+  for (size_t i = 0; i < paths.size(); i++) {
+    models.push_back(Upload(paths[i], imported[i], layout));
+  }
+  return models;
+}
+
+std::unique_ptr<Model> MeshImporter::LoadLodChain(const std::vector<std::string>& paths,
+                                                  const Model::Layout& layout) {
+  BLOOM_PROFILE_FUNCTION();
+  std::vector<ImportedMesh> imported(paths.size());
+  ParallelFor(paths.size(), [&](size_t i) { imported[i] = Import(paths[i]); });
+
+  MeshData chain;
+  float radius = 0.0f;
+  uint32_t finestTriangles = 0;
+  for (size_t i = 0; i < paths.size(); i++) {
+    if (!imported[i].valid) {
+      BLOOM_WARN("LOD chain stopped at {0}, levels after it are dropped", paths[i]);
+      break;
+    }
+    const auto vertices = imported[i].Vertices();
+    const auto indices = imported[i].Indices();
+    const auto lods = imported[i].Lods();
+    const auto meshlets = imported[i].Meshlets();
+    // Only the finest level of every file, generated levels would interleave with the hand made ones
+    const auto finest = lods.empty() ? indices : indices.subspan(lods[0].firstIndex, lods[0].indexCount);
+    const auto base = static_cast<uint32_t>(chain.vertices.size());
+    const auto triangles = static_cast<uint32_t>(finest.size() / 3);
+
+    float error = 0.0f;
+    if (i == 0) {
+      finestTriangles = triangles;
+      for (const auto& v : vertices) radius = std::max(radius, glm::length(v.position));
+      // Level 0 starts the chain, meshlets only have to be moved to the start of the index buffer
+      const uint32_t start = lods.empty() ? 0 : lods[0].firstIndex;
+      for (auto meshlet : meshlets) {
+        meshlet.firstIndex -= start;
+        chain.meshlets.push_back(meshlet);
+      }
+    } else if (triangles > 0) {
+      error = HAND_MADE_LOD_ERROR * radius * std::log2(std::max(1.0f, static_cast<float>(finestTriangles) / triangles));
+    }
+
+    chain.lods.push_back({static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(finest.size()), error});
+    chain.vertices.insert(chain.vertices.end(), vertices.begin(), vertices.end());
+    for (uint32_t index : finest) chain.indices.push_back(base + index);
+  }
+  if (chain.lods.empty()) return nullptr;
+
+  BLOOM_INFO("Loaded LOD chain of {0} levels from {1}", chain.lods.size(), paths[0]);
+  return std::make_unique<Model>(m_pool, m_devices, chain, layout);
+}
+
+bool MeshImporter::Parse(const std::string& path, MeshData& mesh, uint32_t threads) {
+  MappedFile source;
+  if (!source.Open(path)) {
+    BLOOM_WARN("Could not open mesh {0}", path);
+    return false;
+  }
+  return ParseSource(path, source.View(), mesh, threads);
+}
+
+bool MeshImporter::ParseSource(const std::string& path, std::span<const uint8_t> source, MeshData& mesh,
+                               uint32_t threads) {
+  const auto extension = GetExtension(path);
+  bool parsed = false;
+  if (extension == ".obj") {
+    parsed = ParseObj(source, mesh, threads);
+  } else if (extension == ".gltf" || extension == ".glb") {
+    parsed = ParseGltf(path, source, mesh);
+  } else {
+    BLOOM_WARN("Unsupported mesh format {0}", path);
+    return false;
+  }
+
+  if (!parsed) {
+    BLOOM_WARN("No triangles found in {0}", path);
+    return false;
+  }
+  ConvertToEngineSpace(mesh);
+  return true;
+}
+
+void MeshImporter::ConvertToEngineSpace(MeshData& mesh) {
+  // Both formats are y up with counter clockwise front faces, the engine is y down. Flipping y mirrors the mesh, so
+  // the winding has to be reversed too
+  for (auto& vertex : mesh.vertices) {
+    vertex.position.y = -vertex.position.y;
+  }
+  for (size_t i = 0; i + 3 <= mesh.indices.size(); i += 3) {
+    std::swap(mesh.indices[i + 1], mesh.indices[i + 2]);
+  }
+}
+
+MeshImporter::ImportedMesh MeshImporter::Import(const std::string& path) const {
+  BLOOM_PROFILE_SCOPE("Import mesh");
+  ImportedMesh mesh;
+  const auto start = std::chrono::steady_clock::now();
+
+  MappedFile source;
+  if (!source.Open(path)) {
+    BLOOM_WARN("Could not open mesh {0}", path);
+    return mesh;
+  }
+
+  uint64_t hash = 0;
+  std::string cachePath;
+  if (m_settings.useCache) {
+    // Parser version and optimizer settings are part of the seed, changing either invalidates the cooked files
+    const uint64_t optimizerKey = m_settings.optimize ? m_settings.optimizer.Key() : 0;
+    const auto seed = HashBytes({reinterpret_cast<const uint8_t*>(&optimizerKey), sizeof(optimizerKey)}, CACHE_VERSION);
+    hash = HashSource(path, source.View(), seed);
+    cachePath = GetCachePath(hash);
+    if (ReadCache(cachePath, hash, mesh.cooked)) {
+      mesh.valid = true;
+      mesh.cached = true;
+      mesh.milliseconds = ElapsedMilliseconds(start);
+      return mesh;
+    }
+  }
+
+  if (!ParseSource(path, source.View(), mesh.parsed, m_settings.parseThreads)) return mesh;
+  mesh.valid = true;
+
+  if (m_settings.optimize) {
+    const auto statistics = MeshOptimizer::Optimize(mesh.parsed, m_settings.optimizer);
+    BLOOM_INFO("Optimized {0}: {1}", path, MeshOptimizer::FormatStatistics(statistics));
+  }
+
+  if (m_settings.useCache) WriteCache(cachePath, hash, mesh.parsed);
+  mesh.milliseconds = ElapsedMilliseconds(start);
+  return mesh;
+}
+
+std::unique_ptr<Model> MeshImporter::Upload(const std::string& path, const ImportedMesh& mesh,
+                                            const Model::Layout& layout) {
+  if (!mesh.valid) return nullptr;
+
+  const auto start = std::chrono::steady_clock::now();
+  const auto vertices = mesh.Vertices();
+  const auto indices = mesh.Indices();
+  std::unique_ptr<Model> model;
+  {
+    BLOOM_PROFILE_SCOPE("Upload mesh");
+    model = std::make_unique<Model>(m_pool, m_devices, vertices, indices, mesh.Lods(), mesh.Meshlets(), layout);
+  }
+  const double milliseconds = mesh.milliseconds + ElapsedMilliseconds(start);
+
+  auto& statistics = mesh.cached ? m_statistics.cooked : m_statistics.parsed;
+  statistics.loads++;
+  statistics.triangles += indices.size() / 3;
+  statistics.milliseconds += milliseconds;
+  BLOOM_INFO("{0} {1} ({2} vertices, {3} triangles) in {4:.2f}ms", mesh.cached ? "Loaded cooked" : "Parsed", path,
+             vertices.size(), indices.size() / 3, milliseconds);
+  return model;
+}
+
+void MeshImporter::LogLoadStatistics() const {
+  const auto& [parsed, cooked] = m_statistics;
+  if (parsed.loads + cooked.loads == 0) return;
+
+  // Per million triangles, so loads of different meshes still compare
+  const auto rate = [](const LoadStatistics::Path& path) {
+    return path.triangles > 0 ? path.milliseconds * 1e6 / static_cast<double>(path.triangles) : 0.0;
+  };
+  std::string speedup;
+  if (parsed.triangles > 0 && cooked.triangles > 0 && rate(cooked) > 0.0) {
+    speedup = fmt::format(", cooked loads {0:.1f}x faster", rate(parsed) / rate(cooked));
+  }
+  BLOOM_INFO("Mesh loads: {0} parsed in {1:.2f}ms ({2:.2f}ms per million triangles), {3} cooked in {4:.2f}ms "
+             "({5:.2f}ms per million triangles){6}", parsed.loads, parsed.milliseconds, rate(parsed), cooked.loads,
+             cooked.milliseconds, rate(cooked), speedup);
+}
+
+std::span<const Model::Vertex> MeshImporter::ImportedMesh::Vertices() const {
+  if (!cached) return parsed.vertices;
+  CacheHeader header;
+  memcpy(&header, cooked.Data(), sizeof(header));
+  return {reinterpret_cast<const Model::Vertex*>(cooked.Data() + sizeof(header)), header.vertexCount};
+}
+
+std::span<const uint32_t> MeshImporter::ImportedMesh::Indices() const {
+  if (!cached) return parsed.indices;
+  CacheHeader header;
+  memcpy(&header, cooked.Data(), sizeof(header));
+  const size_t offset = sizeof(header) + header.vertexCount * sizeof(Model::Vertex);
+  return {reinterpret_cast<const uint32_t*>(cooked.Data() + offset), header.indexCount};
+}
+
+std::span<const Model::Lod> MeshImporter::ImportedMesh::Lods() const {
+  if (!cached) return parsed.lods;
+  CacheHeader header;
+  memcpy(&header, cooked.Data(), sizeof(header));
+  const size_t offset = sizeof(header) + header.vertexCount * sizeof(Model::Vertex) +
+                        header.indexCount * sizeof(uint32_t);
+  return {reinterpret_cast<const Model::Lod*>(cooked.Data() + offset), header.lodCount};
+}
+
+std::span<const Model::Meshlet> MeshImporter::ImportedMesh::Meshlets() const {
+  if (!cached) return parsed.meshlets;
+  CacheHeader header;
+  memcpy(&header, cooked.Data(), sizeof(header));
+  const size_t offset = sizeof(header) + header.vertexCount * sizeof(Model::Vertex) +
+                        header.indexCount * sizeof(uint32_t) + header.lodCount * sizeof(Model::Lod);
+  return {reinterpret_cast<const Model::Meshlet*>(cooked.Data() + offset), header.meshletCount};
+}
+
+uint64_t MeshImporter::HashSource(const std::string& path, std::span<const uint8_t> source, uint64_t seed) {
+  uint64_t hash = HashBytes(source, seed);
+  if (GetExtension(path) != ".gltf") return hash;
+
+  std::vector<std::string> buffers;
+  CollectGltfExternalBuffers(path, source, buffers);
+  for (const auto& buffer : buffers) {
+    MappedFile file;
+    if (file.Open(buffer)) hash = HashBytes(file.View(), hash);
+  }
+  return hash;
+}
+
+std::string MeshImporter::GetCachePath(uint64_t hash) const {
+  return fmt::format("{0}/{1:016x}.mesh", m_settings.cacheDirectory, hash);
+}
+
+bool MeshImporter::ReadCache(const std::string& cachePath, uint64_t hash, MappedFile& cooked) const {
+  if (!cooked.Open(cachePath)) return false;
+
+  CacheHeader header{};
+  if (cooked.Size() >= sizeof(header)) memcpy(&header, cooked.Data(), sizeof(header));
+  const size_t expectedSize = sizeof(header) + header.vertexCount * sizeof(Model::Vertex) +
+                              header.indexCount * sizeof(uint32_t) + header.lodCount * sizeof(Model::Lod) +
+                              header.meshletCount * sizeof(Model::Meshlet);
+  if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.sourceHash != hash ||
+      cooked.Size() != expectedSize) {
+    BLOOM_WARN("Ignoring invalid cooked mesh {0}", cachePath);
+    cooked.Close();
+    return false;
+  }
+  return true;
+}
+
+void MeshImporter::WriteCache(const std::string& cachePath, uint64_t hash, const MeshData& mesh) const {
+  BLOOM_PROFILE_FUNCTION();
+  std::error_code error;
+  std::filesystem::create_directories(m_settings.cacheDirectory, error);
+  if (error) {
+    BLOOM_WARN("Could not create mesh cache directory {0}: {1}", m_settings.cacheDirectory, error.message());
+    return;
+  }
+
+  // Written aside and renamed, so a crash or another importer never leaves a half written file behind
+  const std::string temporary = fmt::format("{0}.{1}.tmp", cachePath,
+                                            std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  {
+    std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+    CacheHeader header{CACHE_MAGIC, CACHE_VERSION, hash, static_cast<uint32_t>(mesh.vertices.size()),
+                       static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(mesh.lods.size()),
+                       static_cast<uint32_t>(mesh.meshlets.size())};
+    output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    output.write(reinterpret_cast<const char*>(mesh.vertices.data()),
+                 static_cast<std::streamsize>(mesh.vertices.size() * sizeof(Model::Vertex)));
+    output.write(reinterpret_cast<const char*>(mesh.indices.data()),
+                 static_cast<std::streamsize>(mesh.indices.size() * sizeof(uint32_t)));
+    output.write(reinterpret_cast<const char*>(mesh.lods.data()),
+                 static_cast<std::streamsize>(mesh.lods.size() * sizeof(Model::Lod)));
+    output.write(reinterpret_cast<const char*>(mesh.meshlets.data()),
+                 static_cast<std::streamsize>(mesh.meshlets.size() * sizeof(Model::Meshlet)));
+    if (!output) {
+      BLOOM_WARN("Could not write cooked mesh {0}", temporary);
+      output.close();
+      std::filesystem::remove(temporary, error);
+      return;
+    }
+  }
+
+  std::filesystem::rename(temporary, cachePath, error);
+  if (error) {
+    BLOOM_WARN("Could not write cooked mesh {0}: {1}", cachePath, error.message());
+    std::filesystem::remove(temporary, error);
+  }
+}
+
+}
@@ -0,0 +1,163 @@
+/**
+ * @file mesh_importer.hpp
+ *
+ * @brief OBJ and glTF 2.0 import with a cooked binary cache
+ */
+
+#pragma once
+#include "model.hpp"
+#include "mesh_optimizer.hpp"
+#include "geometry_pool.hpp"
+#include "src/mapped_file.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class MeshImporter
+ * @brief Loads meshes from OBJ, glTF and glb files into @c Model instances
+ *
+ * The first time a file is imported its parsed vertices and indices are written to the cache directory, in a file
+ * named after a hash of the source contents. Later imports of the same contents map the cooked file and copy it
+ * straight into the staging buffer of the model, skipping parsing altogether. Editing the source changes the hash, so
+ * stale entries are never read, they are just left behind.
+ *
+ * Big OBJ files are parsed by several threads, each taking a range of lines. @c LoadAll() additionally imports every
+ * file on its own thread, the GPU upload stays on the calling thread.
+ *
+ * Parsed meshes go through the @c MeshOptimizer before being cooked, its settings are part of the cache key.
+ */
+class BLOOM_API MeshImporter {
+public:
+  struct Settings {
+    std::string cacheDirectory = "cache/meshes";
+    bool useCache = true;
+    /// Threads used to parse a single OBJ file, 0 uses every hardware thread
+    uint32_t parseThreads = 0;
+    bool optimize = true;
+    MeshOptimizer::Settings optimizer{};
+  };
+
+  /**
+   * @struct LoadStatistics
+   * @brief Loads so far, split by whether the cooked file was used
+   *
+   * Every load is timed from opening the source until its model is uploaded. Cooked data is only paged in while it's
+   * copied to the staging buffer, so stopping at the mapping would leave most of the cooked cost out.
+   */
+  struct LoadStatistics {
+    struct Path {
+      uint32_t loads = 0;
+      uint64_t triangles = 0;
+      double milliseconds = 0.0;
+    };
+    Path parsed; ///< Parse, optimize, write the cooked file and upload
+    Path cooked; ///< Map, validate, page in and upload
+  };
+
+  MeshImporter(Devices* devices, const Settings& settings);
+
+  MeshImporter(const MeshImporter&) = delete;
+  MeshImporter& operator=(const MeshImporter&) = delete;
+
+  /**
+   * @return The uploaded model, nullptr if the file couldn't be read or parsed
+   */
+  std::unique_ptr<Model> Load(const std::string& path, const Model::Layout& layout = {});
+  /**
+   * @brief Imports every file in parallel and uploads them in order
+   * @return One model per path, nullptr for the ones that failed
+   */
+  std::vector<std::unique_ptr<Model>> LoadAll(const std::vector<std::string>& paths,
+                                              const Model::Layout& layout = {});
+  /**
+   * @brief Builds one model out of levels of detail made by hand, one file per level
+   *
+   * Every file is imported and cooked on its own, only its finest level is kept. Hand made levels have no measured
+   * error, it's estimated from how many triangles they drop. The meshlets of the first file are kept for level 0.
+   * @param paths Finest level first
+   */
+  std::unique_ptr<Model> LoadLodChain(const std::vector<std::string>& paths, const Model::Layout& layout = {});
+
+  /**
+   * @brief Parses a source file without touching the cache or the GPU
+   * @param threads Threads used for OBJ files, 0 uses every hardware thread
+   * @return False if the file couldn't be read or isn't a supported format
+   */
+  static bool Parse(const std::string& path, MeshData& mesh, uint32_t threads = 0);
+
+  const Settings& GetSettings() const { return m_settings; }
+  const LoadStatistics& GetLoadStatistics() const { return m_statistics; }
+  /**
+   * @brief Logs parsed against cooked loads on one line, nothing if no mesh was loaded
+   */
+  void LogLoadStatistics() const;
+  /**
+   * @brief Models loaded from now on are suballocated from @c pool, nullptr gives each model its own buffers
+   */
+  void SetGeometryPool(GeometryPool* pool) { m_pool = pool; }
+
+private:
+  static constexpr uint32_t CACHE_MAGIC = 0x48534d42; ///< "BMSH"
+  static constexpr uint32_t CACHE_VERSION = 5;
+
+  /**
+   * @struct CacheHeader
+   * @brief Start of a cooked file, followed by @c vertexCount vertices, @c indexCount indices, @c lodCount
+   *        @c Model::Lod ranges and @c meshletCount @c Model::Meshlet clusters
+   */
+  struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t lodCount;
+    uint32_t meshletCount;
+  };
+  static_assert(sizeof(CacheHeader) == 32, "CacheHeader layout is part of the file format");
+
+  /**
+   * @struct ImportedMesh
+   * @brief Result of importing a file, either a mapped cooked file or freshly parsed data
+   */
+  struct ImportedMesh {
+    bool valid = false;
+    bool cached = false;
+    MappedFile cooked;
+    MeshData parsed;
+    double milliseconds = 0.0; ///< Until it's ready to upload, cooking included
+
+    std::span<const Model::Vertex> Vertices() const;
+    std::span<const uint32_t> Indices() const;
+    std::span<const Model::Lod> Lods() const;
+    std::span<const Model::Meshlet> Meshlets() const;
+  };
+
+  ImportedMesh Import(const std::string& path) const;
+  std::unique_ptr<Model> Upload(const std::string& path, const ImportedMesh& mesh, const Model::Layout& layout);
+
+  static bool ParseSource(const std::string& path, std::span<const uint8_t> source, MeshData& mesh, uint32_t threads);
+  static bool ParseObj(std::span<const uint8_t> source, MeshData& mesh, uint32_t threads);
+  static bool ParseGltf(const std::string& path, std::span<const uint8_t> source, MeshData& mesh);
+  /**
+   * @brief Converts from the y up, counter clockwise convention of both formats to the engine one
+   */
+  static void ConvertToEngineSpace(MeshData& mesh);
+
+  /**
+   * @brief Hash of the source contents, for .gltf files the external buffers are hashed too
+   * @param seed Mixed in first, covers everything besides the source that changes the cooked output
+   */
+  static uint64_t HashSource(const std::string& path, std::span<const uint8_t> source, uint64_t seed);
+  std::string GetCachePath(uint64_t hash) const;
+  bool ReadCache(const std::string& cachePath, uint64_t hash, MappedFile& cooked) const;
+  void WriteCache(const std::string& cachePath, uint64_t hash, const MeshData& mesh) const;
+
+  Devices* m_devices;
+  GeometryPool* m_pool = nullptr;
+  Settings m_settings;
+  LoadStatistics m_statistics{};
+};
+
+}
@@ -0,0 +1,443 @@
+#include "mesh_optimizer.hpp"
+#include "src/profiler.hpp"
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace bloom::render {
+
+// Forsyth tuned his scores for a 32 entry LRU, it works well for any real cache size
+static constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+static constexpr uint32_t FORSYTH_MAX_VALENCE = 64;
+static constexpr uint32_t NOT_CACHED = ~0u;
+static constexpr uint32_t NO_TRIANGLE = ~0u;
+
+struct VertexHash {
+  const Model::Vertex* vertices;
+
+  size_t operator()(uint32_t index) const {
+    uint32_t words[sizeof(Model::Vertex) / sizeof(uint32_t)];
+    memcpy(words, &vertices[index], sizeof(words));
+    uint32_t hash = 2166136261u;
+    for (uint32_t word : words) hash = (hash ^ word) * 16777619u;
+    return hash;
+  }
+};
+
+struct VertexEqual {
+  const Model::Vertex* vertices;
+
+  bool operator()(uint32_t a, uint32_t b) const {
+    return memcmp(&vertices[a], &vertices[b], sizeof(Model::Vertex)) == 0;
+  }
+};
+
+// Renumbered to the few vertices of the meshlet, the cache pass allocates per vertex of the whole mesh otherwise
+static void OptimizeMeshletCache(std::span<uint32_t> indices) {
+  std::vector<uint32_t> vertices;
+  std::vector<uint32_t> local(indices.size());
+  for (size_t i = 0; i < indices.size(); i++) {
+    const auto it = std::find(vertices.begin(), vertices.end(), indices[i]);
+    local[i] = static_cast<uint32_t>(it - vertices.begin());
+    if (it == vertices.end()) vertices.push_back(indices[i]);
+  }
+  MeshOptimizer::OptimizeVertexCache(local, vertices.size());
+  for (size_t i = 0; i < indices.size(); i++) indices[i] = vertices[local[i]];
+}
+
+uint64_t MeshOptimizer::Settings::Key() const {
+  uint64_t key = 0;
+  if (removeDuplicates) key |= BIT(0);
+  if (optimizeVertexCache) key |= BIT(1);
+  if (optimizeOverdraw) key |= BIT(2);
+  if (optimizeVertexFetch) key |= BIT(3);
+  if (buildMeshlets) key |= BIT(4);
+  // Only matters for the overdraw clusters, a percent of threshold is plenty of resolution
+  if (optimizeOverdraw) key |= (static_cast<uint64_t>(overdrawThreshold * 100.0f) & 0xffff) << 8 | (cacheSize & 0xffull) << 24;
+  if (lodCount > 1) {
+    key |= static_cast<uint64_t>(lodCount & 0xff) << 32;
+    key |= (static_cast<uint64_t>(lodReduction * 1000.0f) & 0xfff) << 40;
+    key |= (static_cast<uint64_t>(lodMaxError * 1000.0f) & 0xfff) << 52;
+  }
+  return key;
+}
+
+MeshOptimizer::Statistics MeshOptimizer::Optimize(MeshData& mesh, const Settings& settings) {
+  BLOOM_PROFILE_FUNCTION();
+  const auto start = std::chrono::steady_clock::now();
+  Statistics statistics;
+
+  if (mesh.indices.empty()) {
+    mesh.indices.resize(mesh.vertices.size() - mesh.vertices.size() % 3);
+    std::iota(mesh.indices.begin(), mesh.indices.end(), 0u);
+  }
+  // Before and after cover the same span, the finest level. Generated levels keep the whole input as level 0
+  const uint32_t finestFirst = mesh.lods.empty() ? 0 : mesh.lods[0].firstIndex;
+  const auto finestCount = static_cast<uint32_t>(mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount);
+  statistics.verticesBefore = static_cast<uint32_t>(mesh.vertices.size());
+  statistics.before = AnalyzeVertexCache(std::span<const uint32_t>(mesh.indices.data() + finestFirst, finestCount),
+                                         mesh.vertices.size(), settings.cacheSize);
+
+  if (settings.removeDuplicates) {
+    RemoveDuplicates(mesh);
+  }
+  if (settings.lodCount > 1) {
+    MeshSimplifier::GenerateLods(mesh, settings.lodCount, settings.lodReduction, settings.lodMaxError);
+  }
+
+  // Levels are drawn on their own, each one gets its own cache and overdraw ordering
+  std::vector<Model::Lod> lods = mesh.lods;
+  if (lods.empty()) lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+  for (const auto& lod : lods) {
+    std::span<uint32_t> indices(mesh.indices.data() + lod.firstIndex, lod.indexCount);
+    if (settings.optimizeVertexCache) {
+      OptimizeVertexCache(indices, mesh.vertices.size());
+    }
+    if (settings.optimizeOverdraw) {
+      OptimizeOverdraw(indices, mesh.vertices, settings.overdrawThreshold, settings.cacheSize);
+    }
+    statistics.lodTriangles.push_back(lod.indexCount / 3);
+  }
+  // Growing meshlets undoes the cache and overdraw order of the finest level, only the cache order is brought back,
+  // inside each meshlet. Meshlets still transform more vertices than the plain cache order, see buildMeshlets
+  if (settings.buildMeshlets) {
+    std::span<uint32_t> indices(mesh.indices.data() + lods[0].firstIndex, lods[0].indexCount);
+    mesh.meshlets = MeshletBuilder::Build(indices, mesh.vertices);
+    for (auto& meshlet : mesh.meshlets) {
+      meshlet.firstIndex += lods[0].firstIndex;
+      if (settings.optimizeVertexCache) {
+        OptimizeMeshletCache(std::span<uint32_t>(mesh.indices.data() + meshlet.firstIndex, meshlet.indexCount));
+      }
+    }
+    statistics.meshlets = static_cast<uint32_t>(mesh.meshlets.size());
+  }
+  // The finest level comes first in the index buffer, so it gets the best fetch locality
+  if (settings.optimizeVertexFetch) {
+    OptimizeVertexFetch(mesh);
+  }
+
+  statistics.verticesAfter = static_cast<uint32_t>(mesh.vertices.size());
+  statistics.after = AnalyzeVertexCache(std::span<const uint32_t>(mesh.indices.data() + finestFirst, finestCount),
+                                        mesh.vertices.size(), settings.cacheSize);
+  statistics.milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  return statistics;
+}
+
+uint32_t MeshOptimizer::RemoveDuplicates(MeshData& mesh) {
+  BLOOM_PROFILE_FUNCTION();
+  const auto vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+  std::unordered_set<uint32_t, VertexHash, VertexEqual> unique(vertexCount, VertexHash{mesh.vertices.data()},
+                                                               VertexEqual{mesh.vertices.data()});
+
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<Model::Vertex> vertices;
+  vertices.reserve(vertexCount);
+  for (uint32_t i = 0; i < vertexCount; i++) {
+    auto [first, inserted] = unique.insert(i);
+    if (inserted) {
+      remap[i] = static_cast<uint32_t>(vertices.size());
+      vertices.push_back(mesh.vertices[i]);
+    } else {
+      remap[i] = remap[*first];
+    }
+  }
+
+  for (auto& index : mesh.indices) index = remap[index];
+  const auto removed = vertexCount - static_cast<uint32_t>(vertices.size());
+  mesh.vertices = std::move(vertices);
+  return removed;
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Vertex cache, Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+// ---------------------------------------------------------------------------------------------------------------------
+
+struct ForsythScores {
+  float cache[FORSYTH_CACHE_SIZE];
+  float valence[FORSYTH_MAX_VALENCE + 1];
+
+  ForsythScores() {
+    constexpr float CACHE_DECAY_POWER = 1.5f;
+    constexpr float LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float VALENCE_BOOST_SCALE = 2.0f;
+    constexpr float VALENCE_BOOST_POWER = 0.5f;
+
+    for (uint32_t i = 0; i < FORSYTH_CACHE_SIZE; i++) {
+      // The three vertices of the last triangle get a fixed score, so the next one isn't forced to share an edge
+      if (i < 3) cache[i] = LAST_TRIANGLE_SCORE;
+      else cache[i] = std::pow(1.0f - static_cast<float>(i - 3) / (FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+    }
+    valence[0] = 0.0f;
+    for (uint32_t i = 1; i <= FORSYTH_MAX_VALENCE; i++) {
+      // Vertices with few triangles left are finished off first, so they leave the working set
+      valence[i] = VALENCE_BOOST_SCALE * std::pow(static_cast<float>(i), -VALENCE_BOOST_POWER);
+    }
+  }
+
+  float Get(uint32_t cachePosition, uint32_t liveTriangles) const {
+    if (liveTriangles == 0) return -1.0f;
+    float score = valence[std::min(liveTriangles, FORSYTH_MAX_VALENCE)];
+    if (cachePosition != NOT_CACHED) score += cache[cachePosition];
+    return score;
+  }
+};
+
+void MeshOptimizer::OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount) {
+  BLOOM_PROFILE_FUNCTION();
+  static const ForsythScores scores;
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) return;
+
+  // Triangles of every vertex, packed, the first liveTriangles[v] entries are the ones not emitted yet
+  std::vector<uint32_t> liveTriangles(vertexCount, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++) liveTriangles[indices[i]]++;
+  std::vector<uint32_t> offsets(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + liveTriangles[v];
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  {
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+      for (size_t k = 0; k < 3; k++) adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+    }
+  }
+
+  std::vector<uint32_t> cachePositions(vertexCount, NOT_CACHED);
+  std::vector<float> vertexScores(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++) vertexScores[v] = scores.Get(NOT_CACHED, liveTriangles[v]);
+
+  std::vector<float> triangleScores(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  uint32_t bestTriangle = 0;
+  for (size_t t = 0; t < triangleCount; t++) {
+    const uint32_t* triangle = &indices[t * 3];
+    triangleScores[t] = vertexScores[triangle[0]] + vertexScores[triangle[1]] + vertexScores[triangle[2]];
+    if (triangleScores[t] > triangleScores[bestTriangle]) bestTriangle = static_cast<uint32_t>(t);
+  }
+
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+  uint32_t cache[FORSYTH_CACHE_SIZE + 3];
+  uint32_t newCache[FORSYTH_CACHE_SIZE + 3];
+  uint32_t cacheCount = 0;
+  size_t nextUnemitted = 0;
+
+  for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+    if (bestTriangle == NO_TRIANGLE) {
+      // Nothing in the cache has triangles left, continue with the next one in the original order
+      while (emitted[nextUnemitted]) nextUnemitted++;
+      bestTriangle = static_cast<uint32_t>(nextUnemitted);
+    }
+
+    const uint32_t triangle[3] = {indices[bestTriangle * 3], indices[bestTriangle * 3 + 1],
+                                  indices[bestTriangle * 3 + 2]};
+    output.insert(output.end(), triangle, triangle + 3);
+    emitted[bestTriangle] = true;
+
+    for (uint32_t v : triangle) {
+      uint32_t* begin = &adjacency[offsets[v]];
+      uint32_t* end = begin + liveTriangles[v];
+      auto found = std::find(begin, end, bestTriangle);
+      if (found != end) {
+        *found = *(end - 1);
+        liveTriangles[v]--;
+      }
+    }
+
+    // The emitted vertices move to the front, everything else is pushed back and may fall out
+    uint32_t newCount = 0;
+    for (uint32_t v : triangle) newCache[newCount++] = v;
+    for (uint32_t i = 0; i < cacheCount; i++) {
+      uint32_t v = cache[i];
+      if (v != triangle[0] && v != triangle[1] && v != triangle[2]) newCache[newCount++] = v;
+    }
+
+    bestTriangle = NO_TRIANGLE;
+    float bestScore = -1.0f;
+    for (uint32_t i = 0; i < newCount; i++) {
+      const uint32_t v = newCache[i];
+      cachePositions[v] = i < FORSYTH_CACHE_SIZE ? i : NOT_CACHED;
+      const float score = scores.Get(cachePositions[v], liveTriangles[v]);
+      const float delta = score - vertexScores[v];
+      vertexScores[v] = score;
+
+      for (uint32_t j = 0; j < liveTriangles[v]; j++) {
+        const uint32_t t = adjacency[offsets[v] + j];
+        triangleScores[t] += delta;
+        if (triangleScores[t] > bestScore) {
+          bestScore = triangleScores[t];
+          bestTriangle = t;
+        }
+      }
+    }
+
+    cacheCount = std::min(newCount, FORSYTH_CACHE_SIZE);
+    std::copy(newCache, newCache + cacheCount, cache);
+  }
+
+  std::copy(output.begin(), output.end(), indices.begin());
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// Overdraw, Sander, Nehab and Barczak's "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+// ---------------------------------------------------------------------------------------------------------------------
+
+/**
+ * @brief Splits an index buffer into clusters, at every triangle that misses the cache on all three vertices and
+ *        wherever the cluster alone reaches an ACMR below @c threshold
+ * @return Index of the first triangle of every cluster
+ */
+static std::vector<uint32_t> FindOverdrawClusters(std::span<const uint32_t> indices, size_t vertexCount,
+                                                  float threshold, uint32_t cacheSize) {
+  const size_t triangleCount = indices.size() / 3;
+  std::vector<uint32_t> timestamps(vertexCount, 0);
+  uint32_t time = cacheSize + 1;
+  std::vector<uint32_t> clusters{0};
+
+  uint32_t clusterMisses = 0;
+  uint32_t clusterTriangles = 0;
+  for (size_t t = 0; t < triangleCount; t++) {
+    uint32_t misses = 0;
+    for (size_t k = 0; k < 3; k++) {
+      const uint32_t v = indices[t * 3 + k];
+      if (time - timestamps[v] > cacheSize) {
+        timestamps[v] = time++;
+        misses++;
+      }
+    }
+
+    // A full miss means the cache was flushed, the order before and after is independent
+    if (misses == 3 && clusterTriangles > 0) {
+      clusters.push_back(static_cast<uint32_t>(t));
+      clusterMisses = 0;
+      clusterTriangles = 0;
+    }
+    clusterMisses += misses;
+    clusterTriangles++;
+
+    if (t + 1 < triangleCount && static_cast<float>(clusterMisses) <= threshold * static_cast<float>(clusterTriangles)) {
+      clusters.push_back(static_cast<uint32_t>(t + 1));
+      clusterMisses = 0;
+      clusterTriangles = 0;
+      // Start the next cluster with a cold cache, it may be moved anywhere
+      time += cacheSize + 1;
+    }
+  }
+  return clusters;
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Model::Vertex> vertices,
+                                     float threshold, uint32_t cacheSize) {
+  BLOOM_PROFILE_FUNCTION();
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) return;
+
+  const float acmr = AnalyzeVertexCache(indices, vertices.size(), cacheSize).acmr;
+  const auto clusters = FindOverdrawClusters(indices, vertices.size(), acmr * threshold, cacheSize);
+
+  // Area weighted centroid of the mesh
+  glm::vec3 meshCentroid{0.0f};
+  float meshArea = 0.0f;
+  for (size_t t = 0; t < triangleCount; t++) {
+    const auto& a = vertices[indices[t * 3]].position;
+    const auto& b = vertices[indices[t * 3 + 1]].position;
+    const auto& c = vertices[indices[t * 3 + 2]].position;
+    const float area = glm::length(glm::cross(b - a, c - a));
+    meshCentroid += (a + b + c) * (area / 3.0f);
+    meshArea += area;
+  }
+  if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+  // Clusters whose average normal points away from the centroid occlude the rest, so they go first
+  struct Cluster {
+    uint32_t begin;
+    uint32_t end;
+    float sortKey;
+  };
+  std::vector<Cluster> sorted(clusters.size());
+  for (size_t i = 0; i < clusters.size(); i++) {
+    auto& cluster = sorted[i];
+    cluster.begin = clusters[i];
+    cluster.end = i + 1 < clusters.size() ? clusters[i + 1] : static_cast<uint32_t>(triangleCount);
+
+    glm::vec3 centroid{0.0f};
+    glm::vec3 normal{0.0f};
+    float area = 0.0f;
+    for (uint32_t t = cluster.begin; t < cluster.end; t++) {
+      const auto& a = vertices[indices[t * 3]].position;
+      const auto& b = vertices[indices[t * 3 + 1]].position;
+      const auto& c = vertices[indices[t * 3 + 2]].position;
+      // Outwards for the engine winding, its length is twice the area
+      const glm::vec3 cross = glm::cross(b - a, c - a);
+      const float triangleArea = glm::length(cross);
+      centroid += (a + b + c) * (triangleArea / 3.0f);
+      normal += cross;
+      area += triangleArea;
+    }
+    if (area > 0.0f) centroid /= area;
+    const float normalLength = glm::length(normal);
+    cluster.sortKey = normalLength > 0.0f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.0f;
+  }
+
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const Cluster& a, const Cluster& b) { return a.sortKey > b.sortKey; });
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+  for (const auto& cluster : sorted) {
+    output.insert(output.end(), indices.begin() + cluster.begin * 3, indices.begin() + cluster.end * 3);
+  }
+  std::copy(output.begin(), output.end(), indices.begin());
+}
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& mesh) {
+  BLOOM_PROFILE_FUNCTION();
+  std::vector<uint32_t> remap(mesh.vertices.size(), NOT_CACHED);
+  std::vector<Model::Vertex> vertices;
+  vertices.reserve(mesh.vertices.size());
+
+  for (auto& index : mesh.indices) {
+    if (remap[index] == NOT_CACHED) {
+      remap[index] = static_cast<uint32_t>(vertices.size());
+      vertices.push_back(mesh.vertices[index]);
+    }
+    index = remap[index];
+  }
+  mesh.vertices = std::move(vertices);
+}
+
+MeshOptimizer::CacheStatistics MeshOptimizer::AnalyzeVertexCache(std::span<const uint32_t> indices,
+                                                                  size_t vertexCount, uint32_t cacheSize) {
+  CacheStatistics statistics;
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) return statistics;
+
+  // A vertex is still cached if less than cacheSize misses happened since it was last transformed
+  std::vector<uint32_t> timestamps(vertexCount, 0);
+  uint32_t time = cacheSize + 1;
+  uint32_t referenced = 0;
+  for (size_t i = 0; i < triangleCount * 3; i++) {
+    const uint32_t v = indices[i];
+    if (timestamps[v] == 0) referenced++;
+    if (time - timestamps[v] > cacheSize) {
+      timestamps[v] = time++;
+      statistics.transformed++;
+    }
+  }
+
+  statistics.acmr = static_cast<float>(statistics.transformed) / static_cast<float>(triangleCount);
+  statistics.atvr = static_cast<float>(statistics.transformed) / static_cast<float>(referenced);
+  return statistics;
+}
+
+std::string MeshOptimizer::FormatStatistics(const Statistics& statistics) {
+  std::string lods;
+  for (uint32_t triangles : statistics.lodTriangles) {
+    lods += fmt::format("{0}{1}", lods.empty() ? "" : "/", triangles);
+  }
+  return fmt::format("ACMR {0:.3f} -> {1:.3f}, ATVR {2:.3f} -> {3:.3f}, {4} -> {5} vertices, LOD triangles {6}, "
+                     "{7} meshlets in {8:.2f}ms", statistics.before.acmr, statistics.after.acmr,
+                     statistics.before.atvr, statistics.after.atvr, statistics.verticesBefore,
+                     statistics.verticesAfter, lods, statistics.meshlets, statistics.milliseconds);
+}
+
+}
@@ -0,0 +1,107 @@
+/**
+ * @file mesh_optimizer.hpp
+ *
+ * @brief Reorders mesh data for the post transform cache, vertex fetch and overdraw
+ */
+
+#pragma once
+#include "model.hpp"
+#include "mesh_simplifier.hpp"
+#include "meshlet_builder.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class MeshOptimizer
+ * @brief Optimization passes run on a @c MeshData before it becomes a @c Model
+ *
+ * The passes run in this order:
+ * 1. Duplicate vertices are merged, turning unindexed meshes into indexed ones
+ * 2. Levels of detail are generated with the @c MeshSimplifier, unless the mesh already has some
+ * 3. Triangles of every level are reordered with Tom Forsyth's linear speed algorithm so recently transformed
+ *    vertices get reused
+ * 4. Optionally, clusters of triangles are sorted so the ones facing outwards draw first (Sander et al. 2007), giving
+ *    up a bit of cache efficiency to reduce overdraw
+ * 5. Optionally, triangles of the finest level are grouped in meshlets by the @c MeshletBuilder, for per cluster
+ *    culling. Growing them undoes the order of steps 3 and 4, step 3 runs again inside each meshlet
+ * 6. Vertices are reordered by first use so the vertex fetch reads memory linearly, unused vertices are dropped
+ *
+ * The importer runs it before cooking, so the cost is only paid the first time a mesh is seen.
+ */
+class BLOOM_API MeshOptimizer {
+public:
+  struct Settings {
+    bool removeDuplicates = true;
+    bool optimizeVertexCache = true;
+    bool optimizeOverdraw = false;
+    /// ACMR the overdraw pass may reach, relative to the ACMR after the cache pass
+    float overdrawThreshold = 1.05f;
+    /**
+     * Split the finest level in meshlets, only the GPU scene culls them (@c SimpleRenderSystem::SetGpuDriven()).
+     * Costs about 7% more transformed vertices on the finest level, and the overdraw order
+     */
+    bool buildMeshlets = false;
+    bool optimizeVertexFetch = true;
+    /// FIFO size used to compute the statistics and the overdraw clusters
+    uint32_t cacheSize = 16;
+    /// Levels of detail including the full mesh, 1 disables generation
+    uint32_t lodCount = 4;
+    /// Triangles of a level relative to the previous one
+    float lodReduction = 0.5f;
+    /// Error the coarsest level may reach, relative to the mesh radius
+    float lodMaxError = 0.05f;
+
+    /// Changes whenever the output would, used to key cooked meshes
+    uint64_t Key() const;
+  };
+
+  /**
+   * @struct CacheStatistics
+   * @brief Post transform cache efficiency of an index buffer, simulated with a FIFO cache
+   */
+  struct CacheStatistics {
+    uint32_t transformed = 0; ///< Vertex shader invocations
+    float acmr = 0.0f;        ///< Average cache miss ratio, transformed vertices per triangle, 0.5 is the best case
+    float atvr = 0.0f;        ///< Average transform to vertex ratio, 1.0 is the best case
+  };
+
+  struct Statistics {
+    CacheStatistics before;
+    CacheStatistics after;
+    uint32_t verticesBefore = 0;
+    uint32_t verticesAfter = 0;
+    std::vector<uint32_t> lodTriangles; ///< Triangles of every level of detail, finest first
+    uint32_t meshlets = 0;
+    double milliseconds = 0.0;
+  };
+
+  /**
+   * @brief Runs every enabled pass, an empty index buffer is taken as an unindexed triangle list
+   *
+   * The cache statistics are measured on the finest level of detail
+   */
+  static Statistics Optimize(MeshData& mesh, const Settings& settings);
+  // Not a default argument, GCC and Clang can't use the member initializers of Settings before the class is complete
+  static Statistics Optimize(MeshData& mesh) { return Optimize(mesh, Settings{}); }
+
+  /**
+   * @brief Merges vertices that are identical byte by byte
+   * @return Vertices removed
+   */
+  static uint32_t RemoveDuplicates(MeshData& mesh);
+  static void OptimizeVertexCache(std::span<uint32_t> indices, size_t vertexCount);
+  /**
+   * @brief Sorts clusters of triangles by how much they face away from the center of the mesh
+   * @param indices Should already be optimized for the vertex cache, clusters are cut where it gets flushed
+   * @param threshold ACMR allowed relative to the input one, higher makes smaller clusters
+   */
+  static void OptimizeOverdraw(std::span<uint32_t> indices, std::span<const Model::Vertex> vertices, float threshold,
+                               uint32_t cacheSize);
+  static void OptimizeVertexFetch(MeshData& mesh);
+
+  static CacheStatistics AnalyzeVertexCache(std::span<const uint32_t> indices, size_t vertexCount, uint32_t cacheSize);
+  static std::string FormatStatistics(const Statistics& statistics);
+};
+
+}
@@ -0,0 +1,289 @@
+#include "mesh_simplifier.hpp"
+#include "src/profiler.hpp"
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace bloom::render {
+
+/**
+ * @struct Quadric
+ * @brief Sum of squared distances to a set of planes, weighted by the area of the triangles they came from
+ */
+struct Quadric {
+  double a2 = 0.0, b2 = 0.0, c2 = 0.0;
+  double ab = 0.0, ac = 0.0, bc = 0.0;
+  double ad = 0.0, bd = 0.0, cd = 0.0;
+  double d2 = 0.0;
+  double weight = 0.0;
+
+  void AddPlane(const glm::dvec3& normal, double d, double w) {
+    a2 += w * normal.x * normal.x;
+    b2 += w * normal.y * normal.y;
+    c2 += w * normal.z * normal.z;
+    ab += w * normal.x * normal.y;
+    ac += w * normal.x * normal.z;
+    bc += w * normal.y * normal.z;
+    ad += w * normal.x * d;
+    bd += w * normal.y * d;
+    cd += w * normal.z * d;
+    d2 += w * d * d;
+    weight += w;
+  }
+
+  Quadric& operator+=(const Quadric& other) {
+    a2 += other.a2; b2 += other.b2; c2 += other.c2;
+    ab += other.ab; ac += other.ac; bc += other.bc;
+    ad += other.ad; bd += other.bd; cd += other.cd;
+    d2 += other.d2;
+    weight += other.weight;
+    return *this;
+  }
+
+  /// Mean squared distance from @c point to the planes
+  double Evaluate(const glm::vec3& point) const {
+    if (weight <= 0.0) return 0.0;
+    const double x = point.x, y = point.y, z = point.z;
+    const double error = a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+                         2.0 * (ad * x + bd * y + cd * z) + d2;
+    return std::max(error, 0.0) / weight;
+  }
+};
+
+struct PositionHash {
+  const Model::Vertex* vertices;
+
+  size_t operator()(uint32_t index) const {
+    uint32_t words[3];
+    memcpy(words, &vertices[index].position, sizeof(words));
+    return (words[0] * 73856093u) ^ (words[1] * 19349663u) ^ (words[2] * 83492791u);
+  }
+};
+
+struct PositionEqual {
+  const Model::Vertex* vertices;
+
+  bool operator()(uint32_t a, uint32_t b) const {
+    return memcmp(&vertices[a].position, &vertices[b].position, sizeof(glm::vec3)) == 0;
+  }
+};
+
+struct EdgeCollapse {
+  uint32_t from;
+  uint32_t to;
+  double cost;
+};
+
+/**
+ * @brief Locks the vertices on attribute seams, open borders and non manifold edges
+ */
+static std::vector<bool> FindLockedVertices(std::span<const uint32_t> indices, std::span<const Model::Vertex> vertices) {
+  const auto vertexCount = static_cast<uint32_t>(vertices.size());
+  std::vector<uint32_t> positionRemap(vertexCount);
+  {
+    std::unordered_set<uint32_t, PositionHash, PositionEqual> unique(vertexCount, PositionHash{vertices.data()},
+                                                                     PositionEqual{vertices.data()});
+    for (uint32_t v = 0; v < vertexCount; v++) positionRemap[v] = *unique.insert(v).first;
+  }
+
+  std::vector<bool> referenced(vertexCount, false);
+  for (uint32_t index : indices) referenced[index] = true;
+  std::vector<uint32_t> wedges(vertexCount, 0);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    if (referenced[v]) wedges[positionRemap[v]]++;
+  }
+
+  // Edges are counted between positions, otherwise every seam would look like a border
+  std::unordered_map<uint64_t, uint32_t> edges;
+  edges.reserve(indices.size());
+  for (size_t t = 0; t + 3 <= indices.size(); t += 3) {
+    for (size_t k = 0; k < 3; k++) {
+      uint32_t a = positionRemap[indices[t + k]];
+      uint32_t b = positionRemap[indices[t + (k + 1) % 3]];
+      if (a == b) continue;
+      if (a > b) std::swap(a, b);
+      edges[static_cast<uint64_t>(a) << 32 | b]++;
+    }
+  }
+  std::vector<bool> lockedPositions(vertexCount, false);
+  for (const auto& [edge, count] : edges) {
+    if (count == 2) continue;
+    lockedPositions[edge >> 32] = true;
+    lockedPositions[edge & 0xffffffffu] = true;
+  }
+
+  std::vector<bool> locked(vertexCount, false);
+  for (uint32_t v = 0; v < vertexCount; v++) {
+    const uint32_t position = positionRemap[v];
+    locked[v] = wedges[position] > 1 || lockedPositions[position];
+  }
+  return locked;
+}
+
+/**
+ * @brief Checks the triangles around @c from, with the collapses already done this pass applied through @c remap
+ * @param removed Set to the triangles the collapse makes degenerate
+ * @return False if moving @c from onto @c to would flip any of them
+ */
+static bool IsCollapseValid(uint32_t from, uint32_t to, std::span<const uint32_t> indices,
+                            std::span<const uint32_t> offsets, std::span<const uint32_t> adjacency,
+                            std::span<const uint32_t> remap, std::span<const Model::Vertex> vertices,
+                            uint32_t& removed) {
+  removed = 0;
+  for (uint32_t a = offsets[from]; a < offsets[from + 1]; a++) {
+    const uint32_t t = adjacency[a];
+    uint32_t triangle[3] = {remap[indices[t * 3]], remap[indices[t * 3 + 1]], remap[indices[t * 3 + 2]]};
+    if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2]) continue;
+    if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+      removed++;
+      continue;
+    }
+
+    const glm::vec3 p0 = vertices[triangle[0]].position;
+    const glm::vec3 p1 = vertices[triangle[1]].position;
+    const glm::vec3 p2 = vertices[triangle[2]].position;
+    const glm::vec3 before = glm::cross(p1 - p0, p2 - p0);
+    for (auto& v : triangle) {
+      if (v == from) v = to;
+    }
+    const glm::vec3 q0 = vertices[triangle[0]].position;
+    const glm::vec3 q1 = vertices[triangle[1]].position;
+    const glm::vec3 q2 = vertices[triangle[2]].position;
+    const glm::vec3 after = glm::cross(q1 - q0, q2 - q0);
+    if (glm::dot(before, after) <= 0.0f) return false;
+  }
+  return true;
+}
+
+float MeshSimplifier::Simplify(std::span<const uint32_t> indices, std::span<const Model::Vertex> vertices,
+                               size_t targetIndexCount, float targetError, std::vector<uint32_t>& result) {
+  BLOOM_PROFILE_FUNCTION();
+  result.assign(indices.begin(), indices.end() - static_cast<ptrdiff_t>(indices.size() % 3));
+  const auto vertexCount = static_cast<uint32_t>(vertices.size());
+  if (result.size() <= targetIndexCount || vertexCount == 0) return 0.0f;
+
+  const auto locked = FindLockedVertices(result, vertices);
+
+  std::vector<Quadric> quadrics(vertexCount);
+  for (size_t t = 0; t < result.size(); t += 3) {
+    const glm::dvec3 p0(vertices[result[t]].position);
+    const glm::dvec3 p1(vertices[result[t + 1]].position);
+    const glm::dvec3 p2(vertices[result[t + 2]].position);
+    const glm::dvec3 normal = glm::cross(p1 - p0, p2 - p0);
+    const double length = glm::length(normal);
+    if (length <= 0.0) continue;
+    const glm::dvec3 unit = normal / length;
+    for (size_t k = 0; k < 3; k++) quadrics[result[t + k]].AddPlane(unit, -glm::dot(unit, p0), length * 0.5);
+  }
+
+  const double errorLimit = static_cast<double>(targetError) * targetError;
+  double maxError = 0.0;
+  std::vector<uint32_t> offsets(vertexCount + 1);
+  std::vector<uint32_t> adjacency;
+  std::vector<uint32_t> remap(vertexCount);
+  std::vector<bool> touched(vertexCount);
+  std::vector<EdgeCollapse> collapses;
+
+  // Every pass collapses an independent set of the cheapest edges, then the index buffer is rebuilt
+  while (result.size() > targetIndexCount) {
+    const size_t triangleCount = result.size() / 3;
+
+    std::fill(offsets.begin(), offsets.end(), 0);
+    for (uint32_t index : result) offsets[index + 1]++;
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    adjacency.resize(result.size());
+    {
+      std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+      for (size_t i = 0; i < result.size(); i++) adjacency[fill[result[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    collapses.clear();
+    for (size_t t = 0; t < triangleCount; t++) {
+      for (size_t k = 0; k < 3; k++) {
+        const uint32_t a = result[t * 3 + k];
+        const uint32_t b = result[t * 3 + (k + 1) % 3];
+        if (!locked[a]) {
+          const double cost = quadrics[a].Evaluate(vertices[b].position);
+          if (cost <= errorLimit) collapses.push_back({a, b, cost});
+        }
+        if (!locked[b]) {
+          const double cost = quadrics[b].Evaluate(vertices[a].position);
+          if (cost <= errorLimit) collapses.push_back({b, a, cost});
+        }
+      }
+    }
+    if (collapses.empty()) break;
+    std::sort(collapses.begin(), collapses.end(),
+              [](const EdgeCollapse& a, const EdgeCollapse& b) { return a.cost < b.cost; });
+
+    std::iota(remap.begin(), remap.end(), 0u);
+    std::fill(touched.begin(), touched.end(), false);
+    const size_t goal = (result.size() - targetIndexCount + 2) / 3;
+    size_t removed = 0;
+    for (const auto& collapse : collapses) {
+      if (removed >= goal) break;
+      if (touched[collapse.from] || touched[collapse.to]) continue;
+
+      uint32_t collapseRemoved = 0;
+      if (!IsCollapseValid(collapse.from, collapse.to, result, offsets, adjacency, remap, vertices, collapseRemoved)) {
+        continue;
+      }
+      remap[collapse.from] = collapse.to;
+      touched[collapse.from] = true;
+      touched[collapse.to] = true;
+      quadrics[collapse.to] += quadrics[collapse.from];
+      maxError = std::max(maxError, collapse.cost);
+      removed += collapseRemoved;
+    }
+    if (removed == 0) break;
+
+    size_t write = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+      const uint32_t a = remap[result[t * 3]];
+      const uint32_t b = remap[result[t * 3 + 1]];
+      const uint32_t c = remap[result[t * 3 + 2]];
+      if (a == b || b == c || a == c) continue;
+      result[write++] = a;
+      result[write++] = b;
+      result[write++] = c;
+    }
+    result.resize(write);
+  }
+
+  return static_cast<float>(std::sqrt(maxError));
+}
+
+void MeshSimplifier::GenerateLods(MeshData& mesh, uint32_t maxLods, float reduction, float maxError) {
+  BLOOM_PROFILE_FUNCTION();
+  if (maxLods <= 1 || mesh.indices.size() < 3 || !mesh.lods.empty()) return;
+
+  glm::vec3 min = mesh.vertices[0].position;
+  glm::vec3 max = mesh.vertices[0].position;
+  for (const auto& v : mesh.vertices) {
+    min = glm::min(min, v.position);
+    max = glm::max(max, v.position);
+  }
+  const float errorLimit = maxError * glm::length(max - min) * 0.5f;
+
+  mesh.lods.push_back({0, static_cast<uint32_t>(mesh.indices.size()), 0.0f});
+  std::vector<uint32_t> previous = mesh.indices;
+  float error = 0.0f;
+  for (uint32_t level = 1; level < maxLods && error < errorLimit; level++) {
+    const auto target = static_cast<size_t>(static_cast<float>(previous.size() / 3) * reduction) * 3;
+    std::vector<uint32_t> simplified;
+    // Levels are simplified from the previous one, so their errors add up
+    const float levelError = Simplify(previous, mesh.vertices, target, errorLimit - error, simplified);
+    // A level that barely shrinks costs memory and never pays off
+    if (simplified.empty() || simplified.size() * 20 > previous.size() * 17) break;
+
+    error += levelError;
+    mesh.lods.push_back({static_cast<uint32_t>(mesh.indices.size()), static_cast<uint32_t>(simplified.size()), error});
+    mesh.indices.insert(mesh.indices.end(), simplified.begin(), simplified.end());
+    previous = std::move(simplified);
+  }
+
+  // A single level is the same as none
+  if (mesh.lods.size() == 1) mesh.lods.clear();
+}
+
+}
@@ -0,0 +1,44 @@
+/**
+ * @file mesh_simplifier.hpp
+ *
+ * @brief Quadric error mesh simplification and LOD chain generation
+ */
+
+#pragma once
+#include "model.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class MeshSimplifier
+ * @brief Reduces triangle counts by collapsing edges, ordered by Garland and Heckbert's quadric error metric
+ *
+ * Collapses move a vertex onto one of its neighbours (half edge collapses), so the simplified meshes reuse the
+ * original vertex buffer and only need their own indices. Vertices on open borders and on attribute seams (the same
+ * position with different texture coordinates or colours) never move, which keeps the silhouette of open meshes and
+ * keeps textures from tearing, at the cost of simplifying heavily seamed meshes less.
+ */
+class BLOOM_API MeshSimplifier {
+public:
+  /**
+   * @brief Simplifies a triangle list until it reaches @c targetIndexCount or collapses would exceed @c targetError
+   * @param result Indices of the simplified mesh, into the same @c vertices
+   * @return Error of the result, distance to the input in model units
+   */
+  static float Simplify(std::span<const uint32_t> indices, std::span<const Model::Vertex> vertices,
+                        size_t targetIndexCount, float targetError, std::vector<uint32_t>& result);
+
+  /**
+   * @brief Appends simplified levels of detail to a mesh and fills @c MeshData::lods
+   *
+   * Every level is simplified from the previous one. Generation stops early when a level can't get meaningfully
+   * smaller without going over @c maxError.
+   * @param maxLods Levels including the full mesh
+   * @param reduction Triangles of a level relative to the previous one
+   * @param maxError Error a level may reach, relative to the radius of the mesh
+   */
+  static void GenerateLods(MeshData& mesh, uint32_t maxLods, float reduction, float maxError);
+};
+
+}
@@ -0,0 +1,176 @@
+#include "meshlet_builder.hpp"
+#include "src/profiler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace bloom::render {
+
+static constexpr uint32_t NO_TRIANGLE = ~0u;
+static constexpr uint32_t NO_MESHLET = ~0u;
+/// How much a candidate facing away from the meshlet counts against it, relative to its distance
+static constexpr float CONE_WEIGHT = 0.5f;
+
+static glm::vec3 TriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+  const glm::vec3 normal = glm::cross(b - a, c - a);
+  const float length = glm::length(normal);
+  return length > 0.0f ? normal / length : glm::vec3(0.0f);
+}
+
+std::vector<Model::Meshlet> MeshletBuilder::Build(std::span<uint32_t> indices,
+                                                  std::span<const Model::Vertex> vertices) {
+  BLOOM_PROFILE_FUNCTION();
+  std::vector<Model::Meshlet> meshlets;
+  const size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0) return meshlets;
+
+  // Triangles using every vertex, as offsets into a single array
+  std::vector<uint32_t> offsets(vertices.size() + 1, 0);
+  for (size_t i = 0; i < triangleCount * 3; i++) offsets[indices[i] + 1]++;
+  std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+  std::vector<uint32_t> adjacency(triangleCount * 3);
+  std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+  for (size_t i = 0; i < triangleCount * 3; i++) {
+    adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+  }
+
+  std::vector<glm::vec3> centroids(triangleCount);
+  std::vector<glm::vec3> normals(triangleCount);
+  for (size_t t = 0; t < triangleCount; t++) {
+    const auto& a = vertices[indices[t * 3]].position;
+    const auto& b = vertices[indices[t * 3 + 1]].position;
+    const auto& c = vertices[indices[t * 3 + 2]].position;
+    centroids[t] = (a + b + c) / 3.0f;
+    normals[t] = TriangleNormal(a, b, c);
+  }
+
+  std::vector<uint8_t> emitted(triangleCount, 0);
+  // Last meshlet every vertex was added to, so membership needs no clearing between meshlets
+  std::vector<uint32_t> vertexMeshlet(vertices.size(), NO_MESHLET);
+  std::vector<uint32_t> output;
+  output.reserve(triangleCount * 3);
+  std::vector<uint32_t> candidates;
+  size_t seed = 0;
+
+  const auto newVertices = [&](uint32_t triangle, uint32_t meshlet) {
+    uint32_t count = 0;
+    for (uint32_t k = 0; k < 3; k++) count += vertexMeshlet[indices[triangle * 3 + k]] != meshlet ? 1 : 0;
+    return count;
+  };
+
+  while (true) {
+    while (seed < triangleCount && emitted[seed]) seed++;
+    if (seed == triangleCount) break;
+
+    const auto meshletIndex = static_cast<uint32_t>(meshlets.size());
+    Model::Meshlet meshlet{static_cast<uint32_t>(output.size()), 0, glm::vec4(0.0f), glm::vec4(0.0f)};
+    uint32_t vertexCount = 0;
+    uint32_t triangles = 0;
+    glm::vec3 centroidSum(0.0f);
+    glm::vec3 normalSum(0.0f);
+    candidates.clear();
+
+    auto next = static_cast<uint32_t>(seed);
+    while (next != NO_TRIANGLE) {
+      emitted[next] = 1;
+      for (uint32_t k = 0; k < 3; k++) {
+        const uint32_t v = indices[next * 3 + k];
+        output.push_back(v);
+        if (vertexMeshlet[v] == meshletIndex) continue;
+        vertexMeshlet[v] = meshletIndex;
+        vertexCount++;
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; i++) {
+          if (!emitted[adjacency[i]]) candidates.push_back(adjacency[i]);
+        }
+      }
+      triangles++;
+      centroidSum += centroids[next];
+      normalSum += normals[next];
+      if (triangles == MAX_TRIANGLES) break;
+
+      const glm::vec3 center = centroidSum / static_cast<float>(triangles);
+      const float normalLength = glm::length(normalSum);
+      const glm::vec3 axis = normalLength > 0.0f ? normalSum / normalLength : glm::vec3(0.0f);
+
+      next = NO_TRIANGLE;
+      uint32_t bestAdded = 4;
+      float bestSpread = 0.0f;
+      size_t kept = 0;
+      for (uint32_t candidate : candidates) {
+        if (emitted[candidate]) continue;
+        candidates[kept++] = candidate;
+        const uint32_t added = newVertices(candidate, meshletIndex);
+        if (vertexCount + added > MAX_VERTICES || added > bestAdded) continue;
+        const float facing = 1.0f - glm::dot(normals[candidate], axis);
+        const float spread = glm::length(centroids[candidate] - center) * (1.0f + CONE_WEIGHT * facing);
+        if (added < bestAdded || spread < bestSpread) {
+          next = candidate;
+          bestAdded = added;
+          bestSpread = spread;
+        }
+      }
+      candidates.resize(kept);
+
+      // Nothing connected left, disconnected pieces continue in input order
+      if (next == NO_TRIANGLE) {
+        while (seed < triangleCount && emitted[seed]) seed++;
+        const auto fallback = static_cast<uint32_t>(seed);
+        if (seed < triangleCount && vertexCount + newVertices(fallback, meshletIndex) <= MAX_VERTICES) next = fallback;
+      }
+    }
+
+    meshlet.indexCount = triangles * 3;
+    meshlets.push_back(meshlet);
+  }
+
+  std::copy(output.begin(), output.end(), indices.begin());
+  for (auto& meshlet : meshlets) ComputeBounds(indices, vertices, meshlet);
+  return meshlets;
+}
+
+void MeshletBuilder::ComputeBounds(std::span<const uint32_t> indices, std::span<const Model::Vertex> vertices,
+                                   Model::Meshlet& meshlet) {
+  const auto range = indices.subspan(meshlet.firstIndex, meshlet.indexCount);
+  if (range.empty()) {
+    meshlet.sphere = glm::vec4(0.0f);
+    meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return;
+  }
+
+  glm::vec3 min(std::numeric_limits<float>::max());
+  glm::vec3 max(std::numeric_limits<float>::lowest());
+  for (uint32_t index : range) {
+    min = glm::min(min, vertices[index].position);
+    max = glm::max(max, vertices[index].position);
+  }
+  const glm::vec3 center = (min + max) * 0.5f;
+  float radius = 0.0f;
+  for (uint32_t index : range) radius = std::max(radius, glm::length(vertices[index].position - center));
+  meshlet.sphere = glm::vec4(center, radius);
+
+  std::vector<glm::vec3> normals;
+  normals.reserve(range.size() / 3);
+  glm::vec3 sum(0.0f);
+  for (size_t i = 0; i + 3 <= range.size(); i += 3) {
+    const glm::vec3 normal = TriangleNormal(vertices[range[i]].position, vertices[range[i + 1]].position,
+                                            vertices[range[i + 2]].position);
+    // Degenerate triangles are never rasterized, they don't constrain the cone
+    if (normal == glm::vec3(0.0f)) continue;
+    normals.push_back(normal);
+    sum += normal;
+  }
+
+  const float length = glm::length(sum);
+  if (normals.empty() || length < 1e-6f) {
+    meshlet.cone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    return;
+  }
+  const glm::vec3 axis = sum / length;
+  float minDot = 1.0f;
+  for (const auto& normal : normals) minDot = std::min(minDot, glm::dot(normal, axis));
+  const float cutoff = minDot <= 0.0f ? 1.0f : std::sqrt(1.0f - minDot * minDot);
+  meshlet.cone = glm::vec4(axis, cutoff);
+}
+
+}
@@ -0,0 +1,50 @@
+/**
+ * @file meshlet_builder.hpp
+ *
+ * @brief Splits meshes into small clusters of triangles with bounds to cull them on their own
+ */
+
+#pragma once
+#include "model.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class MeshletBuilder
+ * @brief Groups the triangles of a mesh into meshlets and computes their bounding sphere and normal cone
+ *
+ * Meshlets are grown greedily: starting from a seed, the next triangle is the neighbour adding the fewest new vertices,
+ * ties broken by how close it is to the meshlet and how much its normal agrees with the rest. Compact meshlets have
+ * tight spheres and flat ones narrow cones, which is what makes them cullable. A meshlet closes once it's out of
+ * vertices or triangles, the next seed is the first triangle left in input order. The order inside a meshlet follows
+ * the growth, not the vertex cache, the @c MeshOptimizer reorders every meshlet again afterwards.
+ *
+ * Triangles are reordered so every meshlet is a contiguous index range, drawn with a regular indexed draw.
+ */
+class BLOOM_API MeshletBuilder {
+public:
+  /// Small enough for a meshlet to be one workgroup of work, big enough to keep the per draw overhead low
+  static constexpr uint32_t MAX_VERTICES = 64;
+  static constexpr uint32_t MAX_TRIANGLES = 124;
+
+  /**
+   * @brief Reorders a triangle list into meshlets
+   * @param indices Reordered in place
+   * @return Meshlets covering every triangle, ranges are relative to the start of @c indices
+   */
+  static std::vector<Model::Meshlet> Build(std::span<uint32_t> indices, std::span<const Model::Vertex> vertices);
+
+  /**
+   * @brief Fills the bounding sphere and normal cone of a meshlet from the triangles in its range
+   *
+   * The cone cutoff is the sine of the widest angle between a triangle normal and the axis. The meshlet is back facing
+   * for every camera where @c dot(center - camera, axis) >= cutoff * length(center - camera) + radius, a cone wider
+   * than a half sphere gets a cutoff of 1 so it's never culled.
+   * @param indices Whole index buffer the meshlet range points into
+   */
+  static void ComputeBounds(std::span<const uint32_t> indices, std::span<const Model::Vertex> vertices,
+                            Model::Meshlet& meshlet);
+};
+
+}
@@ -1,52 +1,254 @@
 #include "model.hpp"
+#include "geometry_pool.hpp"
+#include "glm/gtc/packing.hpp"
+#include "glm/gtc/matrix_transform.hpp"
 
 namespace bloom::render {
 
 std::vector<VkVertexInputBindingDescription> Model::Vertex::GetBindingDescriptions() {
-  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+  return Model::GetBindingDescriptions({VertexFormat::Float});
+}
+
+std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions() {
+  return Model::GetAttributeDescriptions({VertexFormat::Float});
+}
+
+std::vector<VkVertexInputBindingDescription> Model::GetBindingDescriptions(const Layout& layout) {
+  if (!layout.splitPositions) {
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+    bindingDescriptions[0].binding = 0;
+    bindingDescriptions[0].stride = GetVertexStride(layout.format);
+    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return bindingDescriptions;
+  }
+
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions(2);
   bindingDescriptions[0].binding = 0;
-  bindingDescriptions[0].stride = sizeof(Vertex);
+  bindingDescriptions[0].stride = GetPositionStride(layout.format);
   bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  bindingDescriptions[1].binding = 1;
+  bindingDescriptions[1].stride = GetVertexStride(layout.format) - GetPositionStride(layout.format);
+  bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
   return bindingDescriptions;
 }
 
-std::vector<VkVertexInputAttributeDescription> Model::Vertex::GetAttributeDescriptions() {
+std::vector<VkVertexInputAttributeDescription> Model::GetAttributeDescriptions(const Layout& layout) {
   std::vector<VkVertexInputAttributeDescription> attributeDescriptions(3);
-  attributeDescriptions[0].binding = 0;
-  attributeDescriptions[0].location = 0;
-  attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-  attributeDescriptions[0].offset = offsetof(Vertex, position);
-  attributeDescriptions[1].binding = 0;
+  attributeDescriptions[0] = GetPositionAttributeDescriptions(layout)[0];
   attributeDescriptions[1].location = 1;
-  attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
-  attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
-  attributeDescriptions[2].binding = 0;
   attributeDescriptions[2].location = 2;
-  attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-  attributeDescriptions[2].offset = offsetof(Vertex, color);
+
+  if (layout.format == VertexFormat::Float) {
+    attributeDescriptions[1].format = VK_FORMAT_R32G32_SFLOAT;
+    attributeDescriptions[1].offset = offsetof(Vertex, texCoord);
+    attributeDescriptions[2].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+    attributeDescriptions[2].offset = offsetof(Vertex, color);
+  } else {
+    attributeDescriptions[1].format = VK_FORMAT_R16G16_UNORM;
+    attributeDescriptions[1].offset = offsetof(QuantizedVertex, texCoord);
+    attributeDescriptions[2].format = VK_FORMAT_R8G8B8A8_UNORM;
+    attributeDescriptions[2].offset = offsetof(QuantizedVertex, color);
+  }
+
+  // The attribute stream is the vertex with the position cut off the front
+  uint32_t binding = layout.splitPositions ? 1 : 0;
+  uint32_t offset = layout.splitPositions ? GetPositionStride(layout.format) : 0;
+  for (size_t i = 1; i < attributeDescriptions.size(); i++) {
+    attributeDescriptions[i].binding = binding;
+    attributeDescriptions[i].offset -= offset;
+  }
+  return attributeDescriptions;
+}
+
+std::vector<VkVertexInputBindingDescription> Model::GetPositionBindingDescriptions(const Layout& layout) {
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions(1);
+  bindingDescriptions[0].binding = 0;
+  bindingDescriptions[0].stride = layout.splitPositions ? GetPositionStride(layout.format)
+                                                        : GetVertexStride(layout.format);
+  bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+  return bindingDescriptions;
+}
+
+std::vector<VkVertexInputAttributeDescription> Model::GetPositionAttributeDescriptions(const Layout& layout) {
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions(1);
+  attributeDescriptions[0].binding = 0;
+  attributeDescriptions[0].location = 0;
+  attributeDescriptions[0].offset = 0;
+
+  // The shader reads a vec3, the fourth component of quantized positions is just padding
+  switch (layout.format) {
+    case VertexFormat::Float:
+      attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+      break;
+    case VertexFormat::Half:
+      attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SFLOAT;
+      break;
+    case VertexFormat::Snorm16:
+      attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_SNORM;
+      break;
+  }
   return attributeDescriptions;
 }
 
-Model::Model(Devices* device, const std::vector<Vertex> &vertices) : m_device(device) {
+uint32_t Model::GetVertexStride(VertexFormat format) {
+  return format == VertexFormat::Float ? sizeof(Vertex) : sizeof(QuantizedVertex);
+}
+
+uint32_t Model::GetPositionStride(VertexFormat format) {
+  return format == VertexFormat::Float ? sizeof(Vertex::position) : sizeof(QuantizedVertex::position);
+}
+
+Model::Model(Devices* device, const std::vector<Vertex> &vertices, const Layout& layout) :
+    Model(device, std::span<const Vertex>(vertices), {}, layout) {}
+
+Model::Model(Devices* device, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+             const Layout& layout) : Model(device, vertices, indices, {}, {}, layout) {}
+
+Model::Model(Devices* device, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+             std::span<const Lod> lods, std::span<const Meshlet> meshlets, const Layout& layout) :
+    m_device(device), m_layout(layout) {
   CreateVBO(vertices);
+  CreateIBO(indices);
+  Initialize(vertices, lods, meshlets);
+}
+
+Model::Model(Devices* device, const MeshData& mesh, const Layout& layout) :
+    Model(device, std::span<const Vertex>(mesh.vertices), std::span<const uint32_t>(mesh.indices),
+          std::span<const Lod>(mesh.lods), std::span<const Meshlet>(mesh.meshlets), layout) {}
+
+Model::Model(GeometryPool* pool, Devices* device, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+             std::span<const Lod> lods, std::span<const Meshlet> meshlets, const Layout& layout) :
+    m_device(device), m_layout(layout) {
+  if (pool == nullptr || !CreatePooled(pool, vertices, indices)) {
+    CreateVBO(vertices);
+    CreateIBO(indices);
+  }
+  Initialize(vertices, lods, meshlets);
+}
+
+Model::Model(GeometryPool* pool, Devices* device, const MeshData& mesh, const Layout& layout) :
+    Model(pool, device, std::span<const Vertex>(mesh.vertices), std::span<const uint32_t>(mesh.indices),
+          std::span<const Lod>(mesh.lods), std::span<const Meshlet>(mesh.meshlets), layout) {}
+
+void Model::Initialize(std::span<const Vertex> vertices, std::span<const Lod> lods,
+                       std::span<const Meshlet> meshlets) {
+  const uint32_t count = m_indexCount > 0 ? m_indexCount : m_vertexCount;
+  for (const auto& lod : lods) {
+    if (lod.indexCount == 0 || static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > count) {
+      BLOOM_WARN("Ignoring LOD {0} of a model, its range is out of the index buffer", m_lods.size());
+      break;
+    }
+    m_lods.push_back(lod);
+  }
+  if (m_lods.empty()) {
+    m_lods.push_back({0, count, 0.0f});
+  }
+  // Meshlets split the finest level, all or nothing so the GPU scene never draws part of a mesh
+  for (const auto& meshlet : meshlets) {
+    if (meshlet.firstIndex < m_lods[0].firstIndex ||
+        static_cast<uint64_t>(meshlet.firstIndex) + meshlet.indexCount > m_lods[0].firstIndex + m_lods[0].indexCount) {
+      BLOOM_WARN("Ignoring the meshlets of a model, meshlet {0} is out of its finest level", m_meshlets.size());
+      m_meshlets.clear();
+      break;
+    }
+    m_meshlets.push_back(meshlet);
+  }
+
+  if (!vertices.empty()) {
+    glm::vec3 min = vertices[0].position;
+    glm::vec3 max = vertices[0].position;
+    for (const auto& v : vertices) {
+      min = glm::min(min, v.position);
+      max = glm::max(max, v.position);
+    }
+    const glm::vec3 center = (min + max) * 0.5f;
+    float radius = 0.0f;
+    for (const auto& v : vertices) {
+      radius = glm::max(radius, glm::length(v.position - center));
+    }
+    m_boundingSphere = glm::vec4(center, radius);
+  }
 }
 
 Model::~Model() {
+  if (m_pool != nullptr) {
+    m_pool->Free(m_layout, {m_vertexOffset, m_vertexCount, m_firstIndex, m_indexCount});
+    return;
+  }
   vkDestroyBuffer(m_device->device(), m_VBO, nullptr);
   vkFreeMemory(m_device->device(), m_VBOMemory, nullptr);
+  if (m_attributeVBO != VK_NULL_HANDLE) {
+    vkDestroyBuffer(m_device->device(), m_attributeVBO, nullptr);
+    vkFreeMemory(m_device->device(), m_attributeVBOMemory, nullptr);
+  }
+  if (m_IBO != VK_NULL_HANDLE) {
+    vkDestroyBuffer(m_device->device(), m_IBO, nullptr);
+    vkFreeMemory(m_device->device(), m_IBOMemory, nullptr);
+  }
+}
+
+void Model::Bind(VkCommandBuffer commandBuffer, bool positionsOnly) {
+  if (m_pool != nullptr) {
+    m_pool->Bind(commandBuffer, m_layout, positionsOnly);
+    return;
+  }
+  VkBuffer buffers[] = {m_VBO, m_attributeVBO};
+  VkDeviceSize offsets[] = {0, 0};
+  // Interleaved models only have one buffer, positions only pipelines just use a bigger stride there
+  uint32_t bindingCount = m_layout.splitPositions && !positionsOnly ? 2 : 1;
+  vkCmdBindVertexBuffers(commandBuffer, 0, bindingCount, buffers, offsets);
+  if (m_IBO != VK_NULL_HANDLE) {
+    vkCmdBindIndexBuffer(commandBuffer, m_IBO, 0, VK_INDEX_TYPE_UINT32);
+  }
 }
 
-void Model::Bind(VkCommandBuffer commandBuffer) {
-  VkBuffer buffers[] = {m_VBO};
-  VkDeviceSize offsets[] = {0};
-  vkCmdBindVertexBuffers(commandBuffer, 0, 1, buffers, offsets);
+void Model::Draw(VkCommandBuffer commandBuffer, uint32_t lod) {
+  const auto& range = GetLod(lod);
+  if (m_indexCount > 0) {
+    vkCmdDrawIndexed(commandBuffer, range.indexCount, 1, m_firstIndex + range.firstIndex,
+                     static_cast<int32_t>(m_vertexOffset), 0);
+  } else {
+    vkCmdDraw(commandBuffer, range.indexCount, 1, range.firstIndex, 0);
+  }
 }
 
-void Model::Draw(VkCommandBuffer commandBuffer) {
-  vkCmdDraw(commandBuffer, m_vertexCount, 1, 0, 0);
+uint32_t Model::GetTriangleCount(uint32_t lod) const {
+  return GetLod(lod).indexCount / 3;
 }
 
-void Model::CreateVBO(const std::vector<Vertex> &vertices) {
+bool Model::CreatePooled(GeometryPool* pool, std::span<const Vertex> vertices, std::span<const uint32_t> indices) {
+  // Left to CreateVBO() to report
+  if (vertices.size() < 3) return false;
+
+  std::vector<QuantizedVertex> quantized;
+  std::span<const uint8_t> bytes{reinterpret_cast<const uint8_t*>(vertices.data()), vertices.size_bytes()};
+  if (m_layout.format != VertexFormat::Float) {
+    quantized = Quantize(vertices);
+    bytes = {reinterpret_cast<const uint8_t*>(quantized.data()), quantized.size() * sizeof(QuantizedVertex)};
+  }
+
+  // Pooled draws are always indexed so they can all go through the same indirect command layout
+  std::vector<uint32_t> sequential;
+  if (indices.empty()) {
+    sequential.resize(vertices.size());
+    for (size_t i = 0; i < sequential.size(); i++) sequential[i] = static_cast<uint32_t>(i);
+    indices = sequential;
+  }
+
+  const auto allocation = pool->Allocate(m_layout, bytes, indices);
+  if (!allocation.IsValid()) {
+    BLOOM_WARN("Geometry pool is full, the model gets its own buffers");
+    return false;
+  }
+  m_pool = pool;
+  m_vertexOffset = allocation.vertexOffset;
+  m_vertexCount = allocation.vertexCount;
+  m_firstIndex = allocation.firstIndex;
+  m_indexCount = allocation.indexCount;
+  return true;
+}
+
+void Model::CreateVBO(std::span<const Vertex> vertices) {
   m_vertexCount = static_cast<unsigned int>(vertices.size());
   // Sanity check
   if (m_vertexCount < 3) {
@@ -54,14 +256,101 @@ void Model::CreateVBO(const std::vector<Vertex> &vertices) {
     BLOOM_INFO("Create VBO aborted");
     return;
   }
-  VkDeviceSize bufferSize = sizeof(vertices[0]) * m_vertexCount;
-  m_device->createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+
+  std::vector<QuantizedVertex> quantized;
+  const void* source = vertices.data();
+  if (m_layout.format != VertexFormat::Float) {
+    quantized = Quantize(vertices);
+    source = quantized.data();
+  }
+
+  const uint32_t stride = GetVertexStride(m_layout.format);
+  if (!m_layout.splitPositions) {
+    CreateBuffer(source, static_cast<VkDeviceSize>(stride) * m_vertexCount, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_VBO,
+                 m_VBOMemory);
+    BLOOM_LOG("Model VBO: {0} vertices, {1} bytes", m_vertexCount, stride * m_vertexCount);
+    return;
+  }
+
+  // Deinterleave into a position stream and an attribute stream
+  const uint32_t positionStride = GetPositionStride(m_layout.format);
+  const uint32_t attributeStride = stride - positionStride;
+  std::vector<uint8_t> positions(static_cast<size_t>(positionStride) * m_vertexCount);
+  std::vector<uint8_t> attributes(static_cast<size_t>(attributeStride) * m_vertexCount);
+  auto bytes = static_cast<const uint8_t*>(source);
+  for (size_t i = 0; i < m_vertexCount; i++) {
+    memcpy(&positions[i * positionStride], bytes + i * stride, positionStride);
+    memcpy(&attributes[i * attributeStride], bytes + i * stride + positionStride, attributeStride);
+  }
+  CreateBuffer(positions.data(), positions.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_VBO, m_VBOMemory);
+  CreateBuffer(attributes.data(), attributes.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, m_attributeVBO,
+               m_attributeVBOMemory);
+  BLOOM_LOG("Model VBO: {0} vertices, {1} bytes positions, {2} bytes attributes",
+            m_vertexCount, positions.size(), attributes.size());
+}
+
+void Model::CreateIBO(std::span<const uint32_t> indices) {
+  m_indexCount = static_cast<uint32_t>(indices.size());
+  if (m_indexCount == 0) return;
+
+  CreateBuffer(indices.data(), indices.size_bytes(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT, m_IBO, m_IBOMemory);
+  BLOOM_LOG("Model IBO: {0} indices", m_indexCount);
+}
+
+void Model::CreateBuffer(const void* source, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer,
+                         VkDeviceMemory& memory) {
+  VkBuffer stagingBuffer;
+  VkDeviceMemory stagingMemory;
+  m_device->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
     VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-    m_VBO, m_VBOMemory);
+    stagingBuffer, stagingMemory);
   void* data;
-  vkMapMemory(m_device->device(), m_VBOMemory, 0, bufferSize, 0, &data);
-  memcpy(data, vertices.data(), static_cast<size_t>(bufferSize));
-  vkUnmapMemory(m_device->device(), m_VBOMemory);
+  vkMapMemory(m_device->device(), stagingMemory, 0, size, 0, &data);
+  memcpy(data, source, static_cast<size_t>(size));
+  vkUnmapMemory(m_device->device(), stagingMemory);
+
+  // Geometry is read every frame and never written again, keep it in VRAM
+  m_device->createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                         buffer, memory);
+  m_device->copyBuffer(stagingBuffer, buffer, size);
+
+  vkDestroyBuffer(m_device->device(), stagingBuffer, nullptr);
+  vkFreeMemory(m_device->device(), stagingMemory, nullptr);
+}
+
+std::vector<Model::QuantizedVertex> Model::Quantize(std::span<const Vertex> vertices) {
+  glm::vec3 min = vertices[0].position;
+  glm::vec3 max = vertices[0].position;
+  for (const auto& v : vertices) {
+    min = glm::min(min, v.position);
+    max = glm::max(max, v.position);
+  }
+  glm::vec3 center = (min + max) * 0.5f;
+  // Avoid dividing by zero on flat meshes
+  glm::vec3 extent = glm::max((max - min) * 0.5f, glm::vec3(1e-6f));
+
+  // Both formats store positions normalized to the bounds. Half floats in model units overflow past 65504 and lose
+  // precision to denormals on tiny meshes, within [-1, 1] neither depends on the units the mesh was authored in
+  m_dequantization = glm::scale(glm::translate(glm::mat4(1.0f), center), extent);
+
+  bool uvOutOfRange = false;
+  std::vector<QuantizedVertex> quantized(vertices.size());
+  for (size_t i = 0; i < vertices.size(); i++) {
+    const auto& v = vertices[i];
+    glm::vec4 position = glm::vec4((v.position - center) / extent, 0.0f);
+    quantized[i].position = m_layout.format == VertexFormat::Half ? glm::packHalf4x16(position)
+                                                                  : glm::packSnorm4x16(position);
+
+    uvOutOfRange |= glm::any(glm::lessThan(v.texCoord, glm::vec2(0.0f))) ||
+                    glm::any(glm::greaterThan(v.texCoord, glm::vec2(1.0f)));
+    quantized[i].texCoord = glm::packUnorm2x16(v.texCoord);
+    quantized[i].color = glm::packUnorm4x8(v.color);
+  }
+
+  if (uvOutOfRange) {
+    BLOOM_WARN("Model texture coordinates outside [0, 1] got clamped by unorm16 quantization");
+  }
+  return quantized;
 }
 
 }
@@ -9,9 +9,13 @@
 #pragma once
 #include "devices.hpp"
 #include <bloom_header.hpp>
+#include <span>
 
 namespace bloom::render {
 
+struct MeshData;
+class GeometryPool;
+
 class BLOOM_API Model {
 public:
   struct Vertex {
@@ -23,22 +27,223 @@ public:
     static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions();
   };
 
-  Model(Devices* device, const std::vector<Vertex> &vertices);
+  /**
+   * @enum VertexFormat
+   * @brief Storage format of the vertex data once uploaded to the GPU
+   *
+   * Quantized formats pack positions in 16 bit components, texture coordinates as unorm16 and colours as unorm8,
+   * bringing the vertex from 36 bytes down to 16. The shader still receives floats, the vertex fetch unit does the
+   * conversion for us. Quantized positions are stored relative to the mesh bounds and have to be expanded with
+   * @c GetDequantization() before the model matrix is applied.
+   */
+  enum class VertexFormat {
+    Float,   ///< Full precision @c Vertex, 36 bytes
+    Half,    ///< Half float positions normalized to the mesh bounds, 16 bytes
+    Snorm16, ///< Snorm16 positions normalized to the mesh bounds, 16 bytes
+  };
+
+  /**
+   * @struct Layout
+   * @brief Describes how a model stores its vertices, chosen when the model is imported
+   *
+   * With @c splitPositions the positions live on their own vertex buffer (binding 0) and the rest of the attributes
+   * on a second one (binding 1). Passes that only need positions (depth pre-pass, shadows, picking) can then bind
+   * the position stream alone and fetch a fraction of the memory.
+   */
+  struct Layout {
+    // A constructor instead of member initializers, GCC and Clang can't use those in the default arguments of Model
+    constexpr Layout(VertexFormat vertexFormat = VertexFormat::Float, bool split = false)
+      : format(vertexFormat), splitPositions(split) {}
+
+    VertexFormat format;
+    bool splitPositions;
+
+    /// Unique key used to cache pipelines per layout
+    uint32_t Key() const { return static_cast<uint32_t>(format) | (splitPositions ? BIT(8) : 0); }
+  };
+
+  /**
+   * @struct QuantizedVertex
+   * @brief GPU representation of a vertex for the @c Half and @c Snorm16 formats
+   *
+   * Components are packed with @c glm packing functions so the memory order matches the Vulkan formats used in
+   * @c GetAttributeDescriptions().
+   */
+  struct QuantizedVertex {
+    uint64_t position; ///< xyz + padding, either half floats or snorm16
+    uint32_t texCoord; ///< uv as unorm16
+    uint32_t color;    ///< rgba as unorm8
+  };
+
+  /**
+   * @struct Lod
+   * @brief Range of the index buffer drawing one level of detail, every level shares the vertex buffer
+   */
+  struct Lod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; ///< How far the level may deviate from the full mesh, in model units
+  };
+
+  /**
+   * @struct Meshlet
+   * @brief Small cluster of triangles of the finest level of detail, culled on its own by the GPU scene
+   *
+   * Its triangles are a contiguous range of the index buffer, so a meshlet draws with a regular indexed draw.
+   */
+  struct Meshlet {
+    uint32_t firstIndex; ///< Relative to the model, like @c Lod::firstIndex
+    uint32_t indexCount;
+    glm::vec4 sphere;    ///< Bounding sphere in model space, xyz center and w radius
+    glm::vec4 cone;      ///< Normal cone, xyz axis and w the cutoff, 1 when it can never be back facing
+  };
+
+  /**
+   * @brief Gets the vertex bindings for a given layout
+   * @param layout Layout of the model that will be drawn with the pipeline
+   * @return Binding descriptions to be used on the pipeline creation
+   */
+  static std::vector<VkVertexInputBindingDescription> GetBindingDescriptions(const Layout& layout);
+  /**
+   * @brief Gets the vertex attributes for a given layout
+   * @param layout Layout of the model that will be drawn with the pipeline
+   * @return Attribute descriptions to be used on the pipeline creation
+   */
+  static std::vector<VkVertexInputAttributeDescription> GetAttributeDescriptions(const Layout& layout);
+  /**
+   * @brief Gets the vertex bindings for a pipeline that only reads positions
+   *
+   * Works for both interleaved and split layouts, for interleaved ones the other attributes are just skipped
+   */
+  static std::vector<VkVertexInputBindingDescription> GetPositionBindingDescriptions(const Layout& layout);
+  /**
+   * @brief Gets the vertex attributes for a pipeline that only reads positions (location 0)
+   */
+  static std::vector<VkVertexInputAttributeDescription> GetPositionAttributeDescriptions(const Layout& layout);
+  /**
+   * @brief Gets the size in bytes of a single vertex for a given format
+   */
+  static uint32_t GetVertexStride(VertexFormat format);
+  /**
+   * @brief Gets the size in bytes of the position of a single vertex for a given format
+   */
+  static uint32_t GetPositionStride(VertexFormat format);
+
+  Model(Devices* device, const std::vector<Vertex> &vertices, const Layout& layout = {});
+  /**
+   * @brief Creates an indexed model, both streams are uploaded to device local memory through a staging buffer
+   * @param vertices Can point straight into a mapped file, it's only read during the constructor
+   * @param indices Triangle list, empty draws the vertices in order
+   * @param lods Ranges of @c indices for each level of detail, finest first. Empty draws every index as level 0
+   * @param meshlets Clusters of the finest level, can be empty
+   */
+  Model(Devices* device, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+        std::span<const Lod> lods, std::span<const Meshlet> meshlets, const Layout& layout = {});
+  Model(Devices* device, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+        const Layout& layout = {});
+  Model(Devices* device, const MeshData& mesh, const Layout& layout = {});
+  /**
+   * @brief Creates a model suballocated from a @c GeometryPool instead of owning its buffers
+   *
+   * Unindexed meshes get a sequential index buffer, every pooled draw is indexed. Falls back to owning its buffers
+   * if the pool is full. The pool has to outlive the model.
+   */
+  Model(GeometryPool* pool, Devices* device, std::span<const Vertex> vertices, std::span<const uint32_t> indices,
+        std::span<const Lod> lods, std::span<const Meshlet> meshlets, const Layout& layout = {});
+  Model(GeometryPool* pool, Devices* device, const MeshData& mesh, const Layout& layout = {});
   ~Model();
 
   Model(const Model&) = delete;
   Model &operator=(const Model&) = delete;
 
-  void Bind(VkCommandBuffer commandBuffer);
-  void Draw(VkCommandBuffer commandBuffer);
+  /**
+   * @brief Binds the vertex buffers of the model
+   * @param commandBuffer Command buffer to record into
+   * @param positionsOnly Only bind the position stream, must be used with a pipeline created from
+   *                      @c GetPositionBindingDescriptions()
+   */
+  void Bind(VkCommandBuffer commandBuffer, bool positionsOnly = false);
+  /**
+   * @param lod Level of detail to draw, clamped to the coarsest one
+   */
+  void Draw(VkCommandBuffer commandBuffer, uint32_t lod = 0);
+
+  uint32_t GetVertexCount() const { return m_vertexCount; }
+  uint32_t GetIndexCount() const { return m_indexCount; }
+  uint32_t GetLodCount() const { return static_cast<uint32_t>(m_lods.size()); }
+  const Lod& GetLod(uint32_t lod) const { return m_lods[std::min(lod, GetLodCount() - 1)]; }
+  /// Triangles drawn by a level of detail
+  uint32_t GetTriangleCount(uint32_t lod = 0) const;
+  /// Clusters of the finest level of detail, empty if the mesh wasn't split
+  std::span<const Meshlet> GetMeshlets() const { return m_meshlets; }
+  /**
+   * @brief Sphere enclosing every vertex, xyz is the center and w the radius, in model space
+   */
+  const glm::vec4& GetBoundingSphere() const { return m_boundingSphere; }
+
+  const Layout& GetLayout() const { return m_layout; }
+  /**
+   * @brief Matrix that expands the quantized positions back to model space
+   *
+   * Should be applied before the model matrix, identity for @c VertexFormat::Float
+   */
+  const glm::mat4& GetDequantization() const { return m_dequantization; }
+
+  /**
+   * @brief Pool the model lives in, nullptr if it owns its buffers
+   *
+   * Models of the same pool and layout bind the same buffers, binding once is enough to draw all of them
+   */
+  GeometryPool* GetPool() const { return m_pool; }
+  /// Added to every index of the model, 0 when it owns its buffers
+  uint32_t GetVertexOffset() const { return m_vertexOffset; }
+  /// First index of the model in the bound index buffer, @c Lod::firstIndex is relative to it
+  uint32_t GetFirstIndex() const { return m_firstIndex; }
 
 private:
-  void CreateVBO(const std::vector<Vertex> &vertices);
+  /**
+   * @brief Fills the LOD ranges, the meshlets and the bounding sphere, once the buffers exist
+   */
+  void Initialize(std::span<const Vertex> vertices, std::span<const Lod> lods, std::span<const Meshlet> meshlets);
+  /**
+   * @return Whether the model got its space from the pool
+   */
+  bool CreatePooled(GeometryPool* pool, std::span<const Vertex> vertices, std::span<const uint32_t> indices);
+  void CreateVBO(std::span<const Vertex> vertices);
+  void CreateIBO(std::span<const uint32_t> indices);
+  void CreateBuffer(const void* source, VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer& buffer,
+                    VkDeviceMemory& memory);
+  std::vector<QuantizedVertex> Quantize(std::span<const Vertex> vertices);
 
   Devices* m_device;
-  VkBuffer m_VBO;
-  VkDeviceMemory m_VBOMemory;
-  unsigned int m_vertexCount;
+  GeometryPool* m_pool = nullptr;
+  uint32_t m_vertexOffset = 0;
+  uint32_t m_firstIndex = 0;
+  VkBuffer m_VBO = VK_NULL_HANDLE;
+  VkDeviceMemory m_VBOMemory = VK_NULL_HANDLE;
+  VkBuffer m_attributeVBO = VK_NULL_HANDLE;
+  VkDeviceMemory m_attributeVBOMemory = VK_NULL_HANDLE;
+  VkBuffer m_IBO = VK_NULL_HANDLE;
+  VkDeviceMemory m_IBOMemory = VK_NULL_HANDLE;
+  unsigned int m_vertexCount = 0;
+  uint32_t m_indexCount = 0;
+  std::vector<Lod> m_lods;
+  std::vector<Meshlet> m_meshlets;
+  glm::vec4 m_boundingSphere{0.0f};
+
+  Layout m_layout;
+  glm::mat4 m_dequantization = glm::mat4(1.0f);
+};
+
+/**
+ * @struct MeshData
+ * @brief Triangle list on the CPU, in engine space (y down, clockwise front faces)
+ */
+struct MeshData {
+  std::vector<Model::Vertex> vertices;
+  std::vector<uint32_t> indices;
+  std::vector<Model::Lod> lods; ///< Ranges of @c indices, finest first. Empty means a single level with every index
+  std::vector<Model::Meshlet> meshlets; ///< Clusters of the finest level, ranges of @c indices
 };
 
 }
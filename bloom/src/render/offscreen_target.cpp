@@ -0,0 +1,288 @@
+#include "offscreen_target.hpp"
+
+namespace bloom::render {
+
+OffscreenTarget::OffscreenTarget(Devices* devices, const Settings& settings, uint64_t firstFrameNumber) :
+    m_devices(devices), m_settings(settings), m_frameNumber(firstFrameNumber),
+    m_completedFrameNumber(firstFrameNumber) {
+  m_settings.imageCount = std::max<uint32_t>(m_settings.imageCount, 1);
+  m_settings.framesInFlight = std::clamp<uint32_t>(m_settings.framesInFlight, 1, SwapChain::MAX_FRAMES_IN_FLIGHT);
+
+  CreateImages();
+  CreateRenderPass();
+  CreateFramebuffers();
+  CreateSyncObjects();
+  BLOOM_LOG("Offscreen target: {0}x{1}, {2} images, {3} frames in flight", m_settings.extent.width,
+            m_settings.extent.height, m_settings.imageCount, m_settings.framesInFlight);
+}
+
+OffscreenTarget::~OffscreenTarget() {
+  VkDevice device = m_devices->device();
+  for (auto fence : m_inFlightFences) vkDestroyFence(device, fence, nullptr);
+  for (auto framebuffer : m_framebuffers) vkDestroyFramebuffer(device, framebuffer, nullptr);
+  vkDestroyRenderPass(device, m_renderPass, nullptr);
+  vkDestroyRenderPass(device, m_resumeRenderPass, nullptr);
+
+  for (size_t i = 0; i < m_colorImages.size(); i++) {
+    vkDestroyImageView(device, m_colorViews[i], nullptr);
+    vkDestroyImage(device, m_colorImages[i], nullptr);
+    vkFreeMemory(device, m_colorMemories[i], nullptr);
+    vkDestroyImageView(device, m_depthViews[i], nullptr);
+    vkDestroyImage(device, m_depthImages[i], nullptr);
+    vkFreeMemory(device, m_depthMemories[i], nullptr);
+  }
+}
+
+VkResult OffscreenTarget::AcquireNextImage(uint32_t* imageIndex) {
+  vkWaitForFences(m_devices->device(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE,
+                  std::numeric_limits<uint64_t>::max());
+  m_completedFrameNumber = std::max(m_completedFrameNumber, m_fenceFrameNumbers[m_currentFrame]);
+
+  // Round robin, only blocks if there are fewer images than frames in flight
+  *imageIndex = static_cast<uint32_t>(m_frameNumber % m_settings.imageCount);
+  WaitForFrame(m_imageFrameNumbers[*imageIndex]);
+  return VK_SUCCESS;
+}
+
+VkResult OffscreenTarget::SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = buffers;
+
+  vkResetFences(m_devices->device(), 1, &m_inFlightFences[m_currentFrame]);
+  VkResult result = vkQueueSubmit(m_devices->graphicsQueue(), 1, &submitInfo, m_inFlightFences[m_currentFrame]);
+  if (result != VK_SUCCESS) return result;
+
+  m_frameNumber++;
+  m_fenceFrameNumbers[m_currentFrame] = m_frameNumber;
+  m_imageFrameNumbers[*imageIndex] = m_frameNumber;
+  m_lastImageIndex = *imageIndex;
+  m_currentFrame = (m_currentFrame + 1) % m_settings.framesInFlight;
+  return VK_SUCCESS;
+}
+
+uint64_t OffscreenTarget::GetCompletedFrameNumber() {
+  for (uint32_t i = 0; i < m_settings.framesInFlight; i++) {
+    if (m_fenceFrameNumbers[i] > m_completedFrameNumber &&
+        vkGetFenceStatus(m_devices->device(), m_inFlightFences[i]) == VK_SUCCESS) {
+      m_completedFrameNumber = m_fenceFrameNumbers[i];
+    }
+  }
+  return m_completedFrameNumber;
+}
+
+void OffscreenTarget::WaitForLastFrame() {
+  WaitForFrame(m_frameNumber);
+}
+
+void OffscreenTarget::WaitForFrame(uint64_t frameNumber) {
+  if (frameNumber <= m_completedFrameNumber) return;
+
+  // Frames finish in order, the fence of any frame at or after the one we want is enough
+  for (uint32_t i = 0; i < m_settings.framesInFlight; i++) {
+    if (m_fenceFrameNumbers[i] < frameNumber) continue;
+    vkWaitForFences(m_devices->device(), 1, &m_inFlightFences[i], VK_TRUE, std::numeric_limits<uint64_t>::max());
+    m_completedFrameNumber = std::max(m_completedFrameNumber, m_fenceFrameNumbers[i]);
+    return;
+  }
+}
+
+std::vector<uint8_t> OffscreenTarget::ReadPixels(uint32_t index) {
+  WaitForFrame(m_imageFrameNumbers[index]);
+
+  const VkExtent2D extent = m_settings.extent;
+  const VkDeviceSize size = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+  VkBuffer staging;
+  VkDeviceMemory stagingMemory;
+  m_devices->createBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, staging, stagingMemory);
+
+  // The render pass already left the image in TRANSFER_SRC_OPTIMAL
+  VkCommandBuffer commandBuffer = m_devices->beginSingleTimeCommands();
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {extent.width, extent.height, 1};
+  vkCmdCopyImageToBuffer(commandBuffer, m_colorImages[index], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, staging, 1,
+                         &region);
+  m_devices->endSingleTimeCommands(commandBuffer);
+
+  std::vector<uint8_t> pixels(static_cast<size_t>(size));
+  void* data;
+  vkMapMemory(m_devices->device(), stagingMemory, 0, size, 0, &data);
+  memcpy(pixels.data(), data, pixels.size());
+  vkUnmapMemory(m_devices->device(), stagingMemory);
+
+  vkDestroyBuffer(m_devices->device(), staging, nullptr);
+  vkFreeMemory(m_devices->device(), stagingMemory, nullptr);
+  return pixels;
+}
+
+void OffscreenTarget::CreateImages() {
+  m_depthFormat = m_devices->findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
+  const uint32_t count = m_settings.imageCount;
+  m_colorImages.resize(count);
+  m_colorMemories.resize(count);
+  m_colorViews.resize(count);
+  m_depthImages.resize(count);
+  m_depthMemories.resize(count);
+  m_depthViews.resize(count);
+
+  for (uint32_t i = 0; i < count; i++) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {m_settings.extent.width, m_settings.extent.height, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    imageInfo.format = m_settings.colorFormat;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    m_devices->createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_colorImages[i], m_colorMemories[i]);
+
+    imageInfo.format = m_depthFormat;
+    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (m_settings.sampledDepth) imageInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
+    m_devices->createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImages[i], m_depthMemories[i]);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    viewInfo.image = m_colorImages[i];
+    viewInfo.format = m_settings.colorFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    if (vkCreateImageView(m_devices->device(), &viewInfo, nullptr, &m_colorViews[i]) != VK_SUCCESS) {
+      BLOOM_CRITICAL("Failed to create offscreen colour view");
+    }
+
+    viewInfo.image = m_depthImages[i];
+    viewInfo.format = m_depthFormat;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (vkCreateImageView(m_devices->device(), &viewInfo, nullptr, &m_depthViews[i]) != VK_SUCCESS) {
+      BLOOM_CRITICAL("Failed to create offscreen depth view");
+    }
+  }
+}
+
+void OffscreenTarget::CreateRenderPass() {
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = m_settings.colorFormat;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = m_depthFormat;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = m_settings.sampledDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef{0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL};
+  VkAttachmentReference depthAttachmentRef{1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL};
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  // Same as the swap chain, plus making the colour writes visible to the readback copy
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+
+  if (vkCreateRenderPass(m_devices->device(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create offscreen render pass");
+  }
+
+  // Same as the swap chain resume pass
+  attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[0].initialLayout = colorAttachment.finalLayout;
+  attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[1].initialLayout = depthAttachment.finalLayout;
+  dependencies[0].srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependencies[0].dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+  if (vkCreateRenderPass(m_devices->device(), &renderPassInfo, nullptr, &m_resumeRenderPass) != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create offscreen resume render pass");
+  }
+}
+
+void OffscreenTarget::CreateFramebuffers() {
+  m_framebuffers.resize(m_settings.imageCount);
+  for (uint32_t i = 0; i < m_settings.imageCount; i++) {
+    std::array<VkImageView, 2> attachments = {m_colorViews[i], m_depthViews[i]};
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = m_settings.extent.width;
+    framebufferInfo.height = m_settings.extent.height;
+    framebufferInfo.layers = 1;
+
+    if (vkCreateFramebuffer(m_devices->device(), &framebufferInfo, nullptr, &m_framebuffers[i]) != VK_SUCCESS) {
+      BLOOM_CRITICAL("Failed to create offscreen framebuffer");
+    }
+  }
+}
+
+void OffscreenTarget::CreateSyncObjects() {
+  m_inFlightFences.resize(m_settings.framesInFlight);
+  m_fenceFrameNumbers.resize(m_settings.framesInFlight, 0);
+  m_imageFrameNumbers.resize(m_settings.imageCount, 0);
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+  for (auto& fence : m_inFlightFences) {
+    if (vkCreateFence(m_devices->device(), &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+      BLOOM_CRITICAL("Failed to create offscreen fence");
+    }
+  }
+}
+
+}
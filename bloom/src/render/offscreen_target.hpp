@@ -0,0 +1,105 @@
+/**
+ * @file offscreen_target.hpp
+ *
+ * @brief Render target that renders into plain images instead of a swap chain
+ */
+
+#pragma once
+#include "devices.hpp"
+#include "render_target.hpp"
+#include "swap_chain.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class OffscreenTarget
+ * @brief Colour + depth images the renderer draws into when there is no window
+ *
+ * Behaves like a swap chain that presents instantly: images are used round robin and frames are paced with one
+ * fence per frame in flight. Colour images end the render pass in @c TRANSFER_SRC_OPTIMAL so they can be read back.
+ */
+class OffscreenTarget : public RenderTarget {
+public:
+  struct Settings {
+    VkExtent2D extent{1280, 720};
+    uint32_t imageCount = 2;                                          ///< Images rendered round robin
+    uint32_t framesInFlight = SwapChain::MAX_FRAMES_IN_FLIGHT;        ///< Clamped to [1, MAX_FRAMES_IN_FLIGHT]
+    VkFormat colorFormat = VK_FORMAT_R8G8B8A8_SRGB;
+    bool sampledDepth = false;                                        ///< Same as @c SwapChain::Settings::sampledDepth
+  };
+
+  /**
+   * @param devices Device to create the images on, usually a headless one
+   * @param settings Size and count of the images
+   * @param firstFrameNumber Frame number to continue from when replacing another target
+   */
+  OffscreenTarget(Devices* devices, const Settings& settings, uint64_t firstFrameNumber = 0);
+  ~OffscreenTarget() override;
+
+  OffscreenTarget(const OffscreenTarget&) = delete;
+  OffscreenTarget& operator=(const OffscreenTarget&) = delete;
+
+  VkRenderPass GetRenderPass() override { return m_renderPass; }
+  VkRenderPass GetResumeRenderPass() override { return m_resumeRenderPass; }
+  VkFramebuffer GetFrameBuffer(int index) override { return m_framebuffers[index]; }
+  VkExtent2D GetExtent() override { return m_settings.extent; }
+
+  VkResult AcquireNextImage(uint32_t* imageIndex) override;
+  VkResult SubmitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) override;
+
+  uint32_t GetFrameIndex() const override { return m_currentFrame; }
+  uint64_t GetFrameNumber() const override { return m_frameNumber; }
+  uint64_t GetCompletedFrameNumber() override;
+  void WaitForLastFrame() override;
+
+  const Settings& GetSettings() const { return m_settings; }
+  VkImage GetColorImage(int index) override { return m_colorImages[index]; }
+  VkFormat GetColorFormat() override { return m_settings.colorFormat; }
+  VkImageLayout GetColorLayout() override { return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL; }
+  bool SupportsReadback() override { return true; }
+  bool HasSampledDepth() override { return m_settings.sampledDepth; }
+  DepthAttachment GetDepthAttachment(int index) override {
+    return {m_depthImages[index], m_depthViews[index], m_depthFormat};
+  }
+  /// Image the last submitted frame was rendered into
+  uint32_t GetLastImageIndex() const { return m_lastImageIndex; }
+
+  /**
+   * @brief Copies an image back to the CPU, blocking until the frame that wrote it is done
+   * @param index Image to read, see @c GetLastImageIndex()
+   * @return Tightly packed pixels in @c Settings::colorFormat, 4 bytes per pixel
+   */
+  std::vector<uint8_t> ReadPixels(uint32_t index);
+
+private:
+  void CreateImages();
+  void CreateRenderPass();
+  void CreateFramebuffers();
+  void CreateSyncObjects();
+  void WaitForFrame(uint64_t frameNumber);
+
+  Devices* m_devices;
+  Settings m_settings;
+  VkFormat m_depthFormat;
+
+  std::vector<VkImage> m_colorImages;
+  std::vector<VkDeviceMemory> m_colorMemories;
+  std::vector<VkImageView> m_colorViews;
+  std::vector<VkImage> m_depthImages;
+  std::vector<VkDeviceMemory> m_depthMemories;
+  std::vector<VkImageView> m_depthViews;
+  std::vector<VkFramebuffer> m_framebuffers;
+  VkRenderPass m_renderPass = VK_NULL_HANDLE;
+  VkRenderPass m_resumeRenderPass = VK_NULL_HANDLE;
+
+  std::vector<VkFence> m_inFlightFences;
+  std::vector<uint64_t> m_fenceFrameNumbers;
+  std::vector<uint64_t> m_imageFrameNumbers; ///< Last frame that rendered into each image
+  uint32_t m_currentFrame = 0;
+  uint32_t m_lastImageIndex = 0;
+  uint64_t m_frameNumber = 0;
+  uint64_t m_completedFrameNumber = 0;
+};
+
+}
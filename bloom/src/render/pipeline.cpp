@@ -8,17 +8,26 @@ Pipeline::Pipeline(Devices &device, const std::string &vertPath, const std::stri
   CreatePipeline(vertPath, fragPath, config);
 }
 
+Pipeline::Pipeline(Devices& device, const std::string& compPath, VkPipelineLayout pipelineLayout) :
+    _device(device), _bindPoint(VK_PIPELINE_BIND_POINT_COMPUTE) {
+  CreateComputePipeline(compPath, pipelineLayout);
+}
+
 Pipeline::~Pipeline() {
   vkDestroyShaderModule(_device.device(), _vertShaderModule, nullptr);
   vkDestroyShaderModule(_device.device(), _fragShaderModule, nullptr);
+  vkDestroyShaderModule(_device.device(), _compShaderModule, nullptr);
   vkDestroyPipeline(_device.device(), _graphicsPipeline, nullptr);
 }
 
 void Pipeline::Bind(VkCommandBuffer commandBuffer) {
-  vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, _graphicsPipeline);
+  vkCmdBindPipeline(commandBuffer, _bindPoint, _graphicsPipeline);
 }
 
 void Pipeline::defaultPipelineConfig(PipelineConfiguration& config) {
+  config.bindingDescriptions = Model::Vertex::GetBindingDescriptions();
+  config.attributeDescriptions = Model::Vertex::GetAttributeDescriptions();
+
   config.inputAssemblyInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
   config.inputAssemblyInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
   config.inputAssemblyInfo.primitiveRestartEnable = VK_FALSE;
@@ -112,10 +121,15 @@ void Pipeline::CreatePipeline(const std::string &vertPath, const std::string &fr
   }
   
   auto vertShader = ReadFile(vertPath);
-  auto fragShader = ReadFile(fragPath);
-
   CreateShaderModule(vertShader, &_vertShaderModule);
-  CreateShaderModule(fragShader, &_fragShaderModule);
+  // Depth only pipelines don't have a fragment stage
+  uint32_t stageCount = 1;
+  if (!fragPath.empty()) {
+    auto fragShader = ReadFile(fragPath);
+    CreateShaderModule(fragShader, &_fragShaderModule);
+    stageCount = 2;
+  }
+
   VkPipelineShaderStageCreateInfo shaderStages[2];
   shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
   shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
@@ -132,8 +146,8 @@ void Pipeline::CreatePipeline(const std::string &vertPath, const std::string &fr
   shaderStages[1].pNext = nullptr;
   shaderStages[1].pSpecializationInfo = nullptr;
 
-  auto attributeDescriptions = Model::Vertex::GetAttributeDescriptions();
-  auto bindingDescriptions = Model::Vertex::GetBindingDescriptions();
+  auto& attributeDescriptions = config.attributeDescriptions;
+  auto& bindingDescriptions = config.bindingDescriptions;
   VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
   vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
   vertexInputInfo.vertexAttributeDescriptionCount = static_cast<unsigned int>(attributeDescriptions.size());
@@ -143,7 +157,7 @@ void Pipeline::CreatePipeline(const std::string &vertPath, const std::string &fr
 
   VkGraphicsPipelineCreateInfo pipelineInfo{};
   pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-  pipelineInfo.stageCount = 2;
+  pipelineInfo.stageCount = stageCount;
   pipelineInfo.pStages = shaderStages;
   pipelineInfo.pVertexInputState = &vertexInputInfo;
   pipelineInfo.pInputAssemblyState = &config.inputAssemblyInfo;
@@ -168,6 +182,30 @@ void Pipeline::CreatePipeline(const std::string &vertPath, const std::string &fr
   }
 }
 
+void Pipeline::CreateComputePipeline(const std::string& compPath, VkPipelineLayout pipelineLayout) {
+  if (pipelineLayout == VK_NULL_HANDLE) {
+    BLOOM_CRITICAL("Cannot create compute pipeline, no pipelineLayout specified");
+  }
+
+  auto compShader = ReadFile(compPath);
+  CreateShaderModule(compShader, &_compShaderModule);
+
+  VkComputePipelineCreateInfo pipelineInfo{};
+  pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+  pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+  pipelineInfo.stage.module = _compShaderModule;
+  pipelineInfo.stage.pName = "main";
+  pipelineInfo.layout = pipelineLayout;
+  pipelineInfo.basePipelineIndex = -1;
+  pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+  VkResult result = vkCreateComputePipelines(_device.device(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_graphicsPipeline);
+  if (result != VK_SUCCESS) {
+    BLOOM_CRITICAL("Failed to create compute pipeline");
+  }
+}
+
 void Pipeline::CreateShaderModule(const std::vector<char> &code, VkShaderModule*shaderModule) {
   VkShaderModuleCreateInfo createInfo{};
   createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -15,6 +15,8 @@
 namespace bloom::render {
 
 struct PipelineConfiguration {
+  std::vector<VkVertexInputBindingDescription> bindingDescriptions;
+  std::vector<VkVertexInputAttributeDescription> attributeDescriptions;
   VkPipelineViewportStateCreateInfo viewportInfo;
   VkPipelineInputAssemblyStateCreateInfo inputAssemblyInfo;
   VkPipelineRasterizationStateCreateInfo rasterizationInfo;
@@ -31,7 +33,16 @@ struct PipelineConfiguration {
 
 class Pipeline {
 public:
+  /**
+   * @brief Creates a graphics pipeline
+   *
+   * An empty @c fragPath creates a vertex only pipeline, used for depth only passes
+   */
   Pipeline(Devices& device, const std::string& vertPath, const std::string& fragPath, const PipelineConfiguration& config);
+  /**
+   * @brief Creates a compute pipeline
+   */
+  Pipeline(Devices& device, const std::string& compPath, VkPipelineLayout pipelineLayout);
   ~Pipeline();
 
   Pipeline(const Pipeline&) = delete;
@@ -43,12 +54,15 @@ public:
 private:
   static std::vector<char> ReadFile(const std::string& path);
   void CreatePipeline(const std::string& vertPath, const std::string& fragPath, const PipelineConfiguration& config);
+  void CreateComputePipeline(const std::string& compPath, VkPipelineLayout pipelineLayout);
   void CreateShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
   Devices& _device;
   VkPipeline _graphicsPipeline;
-  VkShaderModule _vertShaderModule;
-  VkShaderModule _fragShaderModule;
+  VkPipelineBindPoint _bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  VkShaderModule _vertShaderModule = VK_NULL_HANDLE;
+  VkShaderModule _fragShaderModule = VK_NULL_HANDLE;
+  VkShaderModule _compShaderModule = VK_NULL_HANDLE;
 };
 
 }
@@ -0,0 +1,142 @@
+#include "pipeline_statistics.hpp"
+#include "swap_chain.hpp"
+
+namespace bloom::render {
+
+PipelineStatistics::Counts& PipelineStatistics::Counts::operator+=(const Counts& other) {
+  inputVertices += other.inputVertices;
+  inputPrimitives += other.inputPrimitives;
+  vertexInvocations += other.vertexInvocations;
+  clippingInvocations += other.clippingInvocations;
+  clippingPrimitives += other.clippingPrimitives;
+  fragmentInvocations += other.fragmentInvocations;
+  samplesPassed += other.samplesPassed;
+  return *this;
+}
+
+PipelineStatistics::Scope::Scope(PipelineStatistics* statistics, VkCommandBuffer commandBuffer, const char* name) :
+    m_statistics(statistics), m_commandBuffer(commandBuffer), m_index(INVALID_SCOPE) {
+  if (m_statistics != nullptr && m_statistics->GetMode() == Mode::PerSystem) {
+    m_index = m_statistics->BeginScope(commandBuffer, name);
+  }
+}
+
+PipelineStatistics::Scope::~Scope() {
+  if (m_statistics != nullptr) m_statistics->EndScope(m_commandBuffer, m_index);
+}
+
+PipelineStatistics::PipelineStatistics(Devices* devices, uint32_t maxScopes) :
+    m_devices(devices), m_maxScopes(maxScopes) {
+  m_supported = m_devices->supportsPipelineStatistics();
+  if (!m_supported) {
+    BLOOM_WARN("Device doesn't support pipeline statistics queries");
+    return;
+  }
+
+  VkQueryPoolCreateInfo statisticsInfo{};
+  statisticsInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  statisticsInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+  statisticsInfo.queryCount = m_maxScopes;
+  statisticsInfo.pipelineStatistics = STATISTICS;
+
+  VkQueryPoolCreateInfo occlusionInfo{};
+  occlusionInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+  occlusionInfo.queryType = VK_QUERY_TYPE_OCCLUSION;
+  occlusionInfo.queryCount = m_maxScopes;
+
+  m_frames.resize(SwapChain::MAX_FRAMES_IN_FLIGHT);
+  for (auto& frame : m_frames) {
+    if (vkCreateQueryPool(m_devices->device(), &statisticsInfo, nullptr, &frame.statisticsPool) != VK_SUCCESS ||
+        vkCreateQueryPool(m_devices->device(), &occlusionInfo, nullptr, &frame.occlusionPool) != VK_SUCCESS) {
+      BLOOM_ERROR("Failed to create pipeline statistics query pools");
+    }
+    frame.names.reserve(m_maxScopes);
+  }
+  m_results.resize(static_cast<size_t>(m_maxScopes) * STATISTIC_COUNT);
+  m_samples.resize(m_maxScopes);
+  m_lastFrame.reserve(m_maxScopes);
+}
+
+PipelineStatistics::~PipelineStatistics() {
+  for (auto& frame : m_frames) {
+    vkDestroyQueryPool(m_devices->device(), frame.statisticsPool, nullptr);
+    vkDestroyQueryPool(m_devices->device(), frame.occlusionPool, nullptr);
+  }
+}
+
+void PipelineStatistics::BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+  m_current = nullptr;
+  if (!m_supported) return;
+
+  Frame& frame = m_frames[frameIndex];
+  if (frame.recorded) {
+    Collect(frame);
+    frame.recorded = false;
+  }
+  if (m_mode == Mode::Off) return;
+
+  vkCmdResetQueryPool(commandBuffer, frame.statisticsPool, 0, m_maxScopes);
+  vkCmdResetQueryPool(commandBuffer, frame.occlusionPool, 0, m_maxScopes);
+  frame.names.clear();
+  frame.active = false;
+  frame.recorded = true;
+  m_current = &frame;
+}
+
+uint32_t PipelineStatistics::BeginScope(VkCommandBuffer commandBuffer, const char* name) {
+  if (m_current == nullptr || m_current->active || m_current->names.size() >= m_maxScopes) {
+    if (m_current != nullptr && m_current->active) {
+      BLOOM_WARN_THROTTLED(1000, "Pipeline statistics scope {0} ignored, scopes can't nest", name);
+    }
+    return INVALID_SCOPE;
+  }
+
+  auto index = static_cast<uint32_t>(m_current->names.size());
+  m_current->names.push_back(name);
+  m_current->active = true;
+  vkCmdBeginQuery(commandBuffer, m_current->statisticsPool, index, 0);
+  vkCmdBeginQuery(commandBuffer, m_current->occlusionPool, index,
+                  m_devices->supportsPreciseOcclusion() ? VK_QUERY_CONTROL_PRECISE_BIT : 0);
+  return index;
+}
+
+void PipelineStatistics::EndScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+  if (m_current == nullptr || scope == INVALID_SCOPE) return;
+
+  vkCmdEndQuery(commandBuffer, m_current->occlusionPool, scope);
+  vkCmdEndQuery(commandBuffer, m_current->statisticsPool, scope);
+  m_current->active = false;
+}
+
+void PipelineStatistics::Collect(Frame& frame) {
+  const auto count = static_cast<uint32_t>(frame.names.size());
+  if (count == 0) return;
+
+  // No WAIT flag, the frame pacing already waited for this frame
+  VkResult result = vkGetQueryPoolResults(m_devices->device(), frame.statisticsPool, 0, count,
+                                          sizeof(uint64_t) * STATISTIC_COUNT * count, m_results.data(),
+                                          sizeof(uint64_t) * STATISTIC_COUNT, VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS) return;
+
+  result = vkGetQueryPoolResults(m_devices->device(), frame.occlusionPool, 0, count, sizeof(uint64_t) * count,
+                                 m_samples.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+  if (result != VK_SUCCESS) return;
+
+  m_lastFrame.clear();
+  m_frameTotals = {};
+  for (uint32_t i = 0; i < count; i++) {
+    const uint64_t* values = &m_results[static_cast<size_t>(i) * STATISTIC_COUNT];
+    Counts counts;
+    counts.inputVertices = values[0];
+    counts.inputPrimitives = values[1];
+    counts.vertexInvocations = values[2];
+    counts.clippingInvocations = values[3];
+    counts.clippingPrimitives = values[4];
+    counts.fragmentInvocations = values[5];
+    counts.samplesPassed = m_samples[i];
+    m_lastFrame.push_back({frame.names[i], counts});
+    m_frameTotals += counts;
+  }
+}
+
+}
@@ -0,0 +1,127 @@
+/**
+ * @file pipeline_statistics.hpp
+ *
+ * @brief Counts of the work the GPU did through pipeline statistics and occlusion queries
+ */
+
+#pragma once
+#include "devices.hpp"
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @class PipelineStatistics
+ * @brief Reports vertices, primitives, shader invocations and samples for a frame or for each render system
+ *
+ * Opt in through @c Renderer::SetPipelineStatistics(). Like the @c GpuProfiler every frame in flight has its own
+ * query pools and results are read when the frame index comes around again, so it never blocks.
+ *
+ * Vulkan doesn't allow two pipeline statistics queries to be active at once, so scopes can't nest. In
+ * @c Mode::Frame the renderer wraps the whole frame, in @c Mode::PerSystem the systems place their own scopes and the
+ * frame totals are their sum.
+ */
+class BLOOM_API PipelineStatistics {
+public:
+  enum class Mode {
+    Off,
+    Frame,     ///< One scope around the whole frame, recorded by the renderer
+    PerSystem, ///< Scopes placed by the render systems
+  };
+
+  struct Counts {
+    uint64_t inputVertices = 0;
+    uint64_t inputPrimitives = 0;
+    uint64_t vertexInvocations = 0;
+    uint64_t clippingInvocations = 0;    ///< Primitives that reached the clipper
+    uint64_t clippingPrimitives = 0;     ///< Primitives that came out of it, culled ones are gone
+    uint64_t fragmentInvocations = 0;
+    uint64_t samplesPassed = 0;          ///< Occlusion query, exact only if the device supports precise occlusion
+
+    Counts& operator+=(const Counts& other);
+  };
+
+  struct ScopeResult {
+    const char* name;
+    Counts counts;
+  };
+
+  /**
+   * @class Scope
+   * @brief Counts the work recorded until the end of the enclosing block, does nothing outside of @c Mode::PerSystem
+   *
+   * Has to begin and end inside the same subpass, or both outside of a render pass
+   */
+  class BLOOM_API Scope {
+  public:
+    Scope(PipelineStatistics* statistics, VkCommandBuffer commandBuffer, const char* name);
+    ~Scope();
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    PipelineStatistics* m_statistics;
+    VkCommandBuffer m_commandBuffer;
+    uint32_t m_index;
+  };
+
+  PipelineStatistics(Devices* devices, uint32_t maxScopes = 16);
+  ~PipelineStatistics();
+
+  PipelineStatistics(const PipelineStatistics&) = delete;
+  PipelineStatistics& operator=(const PipelineStatistics&) = delete;
+
+  void SetMode(Mode mode) { m_mode = m_supported ? mode : Mode::Off; }
+  Mode GetMode() const { return m_mode; }
+  bool IsSupported() const { return m_supported; }
+
+  /**
+   * @brief Collects the last use of this frame index and resets its queries, outside of a render pass
+   */
+  void BeginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+  uint32_t BeginScope(VkCommandBuffer commandBuffer, const char* name);
+  void EndScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+  /// Scopes of the last collected frame
+  const std::vector<ScopeResult>& GetLastFrame() const { return m_lastFrame; }
+  /// Sum of every scope of the last collected frame
+  const Counts& GetFrameTotals() const { return m_frameTotals; }
+
+private:
+  static constexpr uint32_t INVALID_SCOPE = ~0u;
+  /// Order of the results, fixed by the bit order of the flags
+  static constexpr VkQueryPipelineStatisticFlags STATISTICS =
+      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_VERTICES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_CLIPPING_INVOCATIONS_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+      VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+  static constexpr uint32_t STATISTIC_COUNT = 6;
+
+  struct Frame {
+    VkQueryPool statisticsPool = VK_NULL_HANDLE;
+    VkQueryPool occlusionPool = VK_NULL_HANDLE;
+    std::vector<const char*> names;
+    bool active = false; ///< A scope is open, they can't nest
+    bool recorded = false;
+  };
+
+  void Collect(Frame& frame);
+
+  Devices* m_devices;
+  uint32_t m_maxScopes;
+  bool m_supported = false;
+  Mode m_mode = Mode::Off;
+
+  std::vector<Frame> m_frames;
+  Frame* m_current = nullptr;
+  std::vector<uint64_t> m_results;
+  std::vector<uint64_t> m_samples;
+
+  std::vector<ScopeResult> m_lastFrame;
+  Counts m_frameTotals;
+};
+
+}
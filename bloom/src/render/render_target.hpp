@@ -0,0 +1,79 @@
+/**
+ * @file render_target.hpp
+ *
+ * @brief Common interface of everything the renderer can draw a frame into
+ */
+
+#pragma once
+#include <bloom_header.hpp>
+
+namespace bloom::render {
+
+/**
+ * @struct DepthAttachment
+ * @brief Depth image of a framebuffer, the view only covers the depth aspect
+ */
+struct DepthAttachment {
+  VkImage image = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+};
+
+/**
+ * @class RenderTarget
+ * @brief Set of colour + depth images the renderer cycles through, paced by frames in flight
+ *
+ * Implemented by the @c SwapChain for windows and by the @c OffscreenTarget for headless rendering
+ */
+class RenderTarget {
+public:
+  virtual ~RenderTarget() = default;
+
+  virtual VkRenderPass GetRenderPass() = 0;
+  /**
+   * @brief Same pass as @c GetRenderPass() but loading the attachments instead of clearing them
+   *
+   * Compatible with the same framebuffers, used to keep drawing into a frame after the render pass was interrupted
+   * to run compute work on its depth.
+   */
+  virtual VkRenderPass GetResumeRenderPass() = 0;
+  virtual VkFramebuffer GetFrameBuffer(int index) = 0;
+  virtual VkExtent2D GetExtent() = 0;
+
+  /**
+   * @brief Waits until the resources of the next frame are free and picks the image to render into
+   */
+  virtual VkResult AcquireNextImage(uint32_t *imageIndex) = 0;
+  /**
+   * @brief Submits the frame, and presents it if the target has something to present to
+   */
+  virtual VkResult SubmitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) = 0;
+
+  /// Index of the frame in flight that will be recorded next
+  virtual uint32_t GetFrameIndex() const = 0;
+  /// Number of the last submitted frame, frames are numbered from 1
+  virtual uint64_t GetFrameNumber() const = 0;
+  /// Number of the last frame the GPU finished executing
+  virtual uint64_t GetCompletedFrameNumber() = 0;
+  /// Blocks until the GPU finishes the last submitted frame
+  virtual void WaitForLastFrame() = 0;
+
+  /// Colour image behind a framebuffer, used to read frames back
+  virtual VkImage GetColorImage(int index) = 0;
+  virtual VkFormat GetColorFormat() = 0;
+  /// Layout the colour images are left in once the render pass ends
+  virtual VkImageLayout GetColorLayout() = 0;
+  /// Whether the colour images can be used as transfer sources
+  virtual bool SupportsReadback() = 0;
+  /// Whether the depth is stored by the render pass and can be sampled, only then is @c GetDepthAttachment() readable
+  virtual bool HasSampledDepth() = 0;
+  /// Depth behind a framebuffer, left in attachment layout
+  virtual DepthAttachment GetDepthAttachment(int index) = 0;
+
+  float ExtentAspectRatio() {
+    VkExtent2D extent = GetExtent();
+    return static_cast<float>(extent.width) / static_cast<float>(extent.height);
+  }
+};
+
+}
@@ -1,20 +1,92 @@
 #include "renderer.hpp"
+#include "src/profiler.hpp"
 
 namespace bloom::render {
 
 Renderer::Renderer(Window* window, Devices* devices) : m_window(window), m_devices(devices) {
+  m_swapChainSettings.presentMode = m_window->GetPresentMode();
   RecreateSwapChain();
   CreateCommandBuffers();
+  m_capture = std::make_unique<FrameCapture>(m_devices);
+#ifdef BLOOM_ENABLE_GPU_PROFILER
+  m_gpuProfiler = std::make_unique<GpuProfiler>(m_devices);
+#endif
+}
+
+Renderer::Renderer(Devices* devices, const OffscreenTarget::Settings& settings) :
+    m_devices(devices), m_offscreenSettings(settings) {
+  m_swapChainSettings.framesInFlight = settings.framesInFlight;
+  m_swapChainSettings.sampledDepth = settings.sampledDepth;
+  RecreateSwapChain();
+  CreateCommandBuffers();
+  m_capture = std::make_unique<FrameCapture>(m_devices);
+#ifdef BLOOM_ENABLE_GPU_PROFILER
+  m_gpuProfiler = std::make_unique<GpuProfiler>(m_devices);
+#endif
+}
+Renderer::~Renderer() {
+  vkDeviceWaitIdle(m_devices->device());
+  m_capture->Flush();
+  FlushDeferredDestroys(std::numeric_limits<uint64_t>::max());
+  FreeCommandBuffers();
+}
+
+void Renderer::SetFramesInFlight(uint32_t framesInFlight) {
+  framesInFlight = std::clamp<uint32_t>(framesInFlight, 1, SwapChain::MAX_FRAMES_IN_FLIGHT);
+  if (framesInFlight == m_swapChainSettings.framesInFlight) return;
+  m_swapChainSettings.framesInFlight = framesInFlight;
+  m_swapChainDirty = true;
+}
+
+void Renderer::SetSampledDepth(bool enabled) {
+  if (enabled == m_swapChainSettings.sampledDepth) return;
+  m_swapChainSettings.sampledDepth = enabled;
+  m_swapChainDirty = true;
+}
+
+void Renderer::SetPipelineStatistics(PipelineStatistics::Mode mode) {
+  if (m_pipelineStatistics == nullptr) {
+    if (mode == PipelineStatistics::Mode::Off) return;
+    m_pipelineStatistics = std::make_unique<PipelineStatistics>(m_devices);
+  }
+  // Takes effect on the next BeginFrame, a frame already being recorded keeps its scopes
+  m_pipelineStatistics->SetMode(mode);
+}
+
+void Renderer::DeferDestroy(std::function<void()> destroy) {
+  // The frame being recorded gets submitted as GetFrameNumber() + 1
+  uint64_t frame = m_target->GetFrameNumber() + (m_frameStarted ? 1 : 0);
+  m_deferredDestroys.emplace_back(frame, std::move(destroy));
+}
+
+void Renderer::FlushDeferredDestroys(uint64_t completedFrame) {
+  std::erase_if(m_deferredDestroys, [completedFrame](auto& entry) {
+    if (entry.first > completedFrame) return false;
+    entry.second();
+    return true;
+  });
 }
-Renderer::~Renderer() { FreeCommandBuffers(); }
 
 VkCommandBuffer Renderer::BeginFrame() {
+  BLOOM_PROFILE_FUNCTION();
   if (m_frameStarted) {
-    BLOOM_WARN("Can't call BeginFrame while already in progress");
+    BLOOM_WARN_THROTTLED(1000, "Can't call BeginFrame while already in progress");
     return nullptr;
   }
 
-  auto result = m_swapChain->AcquireNextImage(&m_currentImageIndex);
+  if (m_window != nullptr && m_window->GetPresentMode() != m_swapChainSettings.presentMode) {
+    m_swapChainSettings.presentMode = m_window->GetPresentMode();
+    m_swapChainDirty = true;
+  }
+  if (m_swapChainDirty) {
+    RecreateSwapChain();
+  }
+
+  VkResult result;
+  {
+    BLOOM_PROFILE_SCOPE("Acquire image");
+    result = m_target->AcquireNextImage(&m_currentImageIndex);
+  }
 
   if (result == VK_ERROR_OUT_OF_DATE_KHR) {
     RecreateSwapChain();
@@ -26,6 +98,13 @@ VkCommandBuffer Renderer::BeginFrame() {
   }
 
   m_frameStarted = true;
+  // Acquire waited for the frame that used this index, so its resources are free now
+  m_currentFrameIndex = static_cast<int>(m_target->GetFrameIndex());
+  uint64_t completedFrame = m_target->GetCompletedFrameNumber();
+  if (!m_deferredDestroys.empty()) {
+    FlushDeferredDestroys(completedFrame);
+  }
+  m_capture->Poll(completedFrame);
 
   auto commandBuffer = GetCurrentCommandBuffer();
   VkCommandBufferBeginInfo beginInfo{};
@@ -35,22 +114,45 @@ VkCommandBuffer Renderer::BeginFrame() {
   if (result != VK_SUCCESS) {
     BLOOM_CRITICAL("Failed to begin recording command buffer");
   }
+#ifdef BLOOM_ENABLE_GPU_PROFILER
+  m_gpuProfiler->BeginFrame(commandBuffer, m_currentFrameIndex);
+#endif
+  if (m_pipelineStatistics) {
+    m_pipelineStatistics->BeginFrame(commandBuffer, m_currentFrameIndex);
+    if (m_pipelineStatistics->GetMode() == PipelineStatistics::Mode::Frame) {
+      m_frameStatisticsScope = m_pipelineStatistics->BeginScope(commandBuffer, "Frame");
+    }
+  }
 
   return commandBuffer;
 }
 
 void Renderer::EndFrame() {
+  BLOOM_PROFILE_FUNCTION();
   if (!m_frameStarted) {
-    BLOOM_WARN("Can't call EndFrame without frame started");
+    BLOOM_WARN_THROTTLED(1000, "Can't call EndFrame without frame started");
     return;
   }
   auto commandBuffer = GetCurrentCommandBuffer();
+  if (m_frameStatisticsScope != ~0u) {
+    m_pipelineStatistics->EndScope(commandBuffer, m_frameStatisticsScope);
+    m_frameStatisticsScope = ~0u;
+  }
+  m_capture->Record(commandBuffer, *m_target, m_currentImageIndex, m_target->GetFrameNumber() + 1);
   if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
     BLOOM_CRITICAL("Failed to record command buffer");
   }
 
-  auto result = m_swapChain->SubmitCommandBuffers(&commandBuffer, &m_currentImageIndex);
-  if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window->GetWindowResized()) {
+  VkResult result;
+  {
+    BLOOM_PROFILE_SCOPE("Submit and present");
+    result = m_target->SubmitCommandBuffers(&commandBuffer, &m_currentImageIndex);
+  }
+  if (m_window == nullptr) {
+    if (result != VK_SUCCESS) {
+      BLOOM_ERROR("Failed to submit command buffer");
+    }
+  } else if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window->GetWindowResized()) {
     m_window->ResetWindowResized();
     RecreateSwapChain();
   } else if (result != VK_SUCCESS) {
@@ -58,26 +160,34 @@ void Renderer::EndFrame() {
   }
 
   m_frameStarted = false;
-  m_currentFrameIndex = (m_currentFrameIndex + 1) % SwapChain::MAX_FRAMES_IN_FLIGHT;
 }
 
 void Renderer::BeginRenderPass(VkCommandBuffer commandBuffer) {
+  StartRenderPass(commandBuffer, false);
+}
+
+void Renderer::ResumeRenderPass(VkCommandBuffer commandBuffer) {
+  StartRenderPass(commandBuffer, true);
+}
+
+void Renderer::StartRenderPass(VkCommandBuffer commandBuffer, bool resume) {
   if (!m_frameStarted) {
-    BLOOM_WARN("Can't call BeginRenderPass if frame is not in progress");
+    BLOOM_WARN_THROTTLED(1000, "Can't begin a render pass if frame is not in progress");
     return;
   }
   if (commandBuffer != GetCurrentCommandBuffer()) {
-    BLOOM_WARN("Can't begin render pass on command buffer from a different frame");
+    BLOOM_WARN_THROTTLED(1000, "Can't begin render pass on command buffer from a different frame");
     return;
   }
 
   VkRenderPassBeginInfo renderPassInfo{};
   renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-  renderPassInfo.renderPass = m_swapChain->GetRenderPass();
-  renderPassInfo.framebuffer = m_swapChain->GetFrameBuffer(m_currentImageIndex);
+  renderPassInfo.renderPass = resume ? m_target->GetResumeRenderPass() : m_target->GetRenderPass();
+  renderPassInfo.framebuffer = m_target->GetFrameBuffer(m_currentImageIndex);
 
+  const VkExtent2D extent = m_target->GetExtent();
   renderPassInfo.renderArea.offset = {0, 0};
-  renderPassInfo.renderArea.extent = m_swapChain->GetSwapChainExtent();
+  renderPassInfo.renderArea.extent = extent;
   std::array<VkClearValue, 2> clearValues{};
   clearValues[0].color = {0.01f, 0.01f, 0.01f, 1.0f};
   clearValues[1].depthStencil = {1.0f, 0};
@@ -89,22 +199,22 @@ void Renderer::BeginRenderPass(VkCommandBuffer commandBuffer) {
   VkViewport viewport{};
   viewport.x = 0.0f;
   viewport.y = 0.0f;
-  viewport.width = static_cast<float>(m_swapChain->GetSwapChainExtent().width);
-  viewport.height = static_cast<float>(m_swapChain->GetSwapChainExtent().height);
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
   viewport.minDepth = 0.0f;
   viewport.maxDepth = 1.0f;
-  VkRect2D scissor{{0, 0}, m_swapChain->GetSwapChainExtent()};
+  VkRect2D scissor{{0, 0}, extent};
   vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
   vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
 void Renderer::EndRenderPass(VkCommandBuffer commandBuffer) {
   if (!m_frameStarted) {
-    BLOOM_WARN("Can't call EndRenderPass if frame is not in progress");
+    BLOOM_WARN_THROTTLED(1000, "Can't call EndRenderPass if frame is not in progress");
     return;
   }
   if (commandBuffer != GetCurrentCommandBuffer()) {
-    BLOOM_WARN("Can't end render pass on command buffer from a different frame");
+    BLOOM_WARN_THROTTLED(1000, "Can't end render pass on command buffer from a different frame");
     return;
   }
 
@@ -135,6 +245,20 @@ void Renderer::FreeCommandBuffers() {
 }
 
 void Renderer::RecreateSwapChain() {
+  if (m_window == nullptr) {
+    vkDeviceWaitIdle(m_devices->device());
+    m_swapChainDirty = false;
+    FlushDeferredDestroys(std::numeric_limits<uint64_t>::max());
+
+    m_offscreenSettings.framesInFlight = m_swapChainSettings.framesInFlight;
+    m_offscreenSettings.sampledDepth = m_swapChainSettings.sampledDepth;
+    uint64_t frameNumber = m_offscreen ? m_offscreen->GetFrameNumber() : 0;
+    m_offscreen.reset();
+    m_offscreen = std::make_unique<OffscreenTarget>(m_devices, m_offscreenSettings, frameNumber);
+    m_target = m_offscreen.get();
+    return;
+  }
+
   auto extent = m_window->GetExtent();
   // Makes the program wait while minimized
   while (extent.width == 0 || extent.height == 0) {
@@ -142,12 +266,15 @@ void Renderer::RecreateSwapChain() {
     glfwWaitEvents();
   }
   vkDeviceWaitIdle(m_devices->device());
+  m_swapChainDirty = false;
 
   if (m_swapChain == nullptr) {
-    m_swapChain = std::make_unique<render::SwapChain>(*m_devices, extent);
+    m_swapChain = std::make_unique<render::SwapChain>(*m_devices, extent, m_swapChainSettings);
   } else {
+    // Everything is idle, no need to keep the deferred resources around
+    FlushDeferredDestroys(std::numeric_limits<uint64_t>::max());
     std::shared_ptr<SwapChain> oldSwapChain = std::move(m_swapChain);
-    m_swapChain = std::make_unique<render::SwapChain>(*m_devices, extent, oldSwapChain);
+    m_swapChain = std::make_unique<render::SwapChain>(*m_devices, extent, oldSwapChain, m_swapChainSettings);
 
     if (!oldSwapChain->compareSwapFormats(*m_swapChain.get())) {
       BLOOM_WARN("Swap chain image format or depth format changed, recreating command buffers");
@@ -155,6 +282,7 @@ void Renderer::RecreateSwapChain() {
       CreateCommandBuffers();
     }
   }
+  m_target = m_swapChain.get();
   // CreatePipeline();
 }
 
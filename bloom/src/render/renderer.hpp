@@ -11,6 +11,10 @@
 #include "src/window.hpp"
 #include "devices.hpp"
 #include "swap_chain.hpp"
+#include "offscreen_target.hpp"
+#include "frame_capture.hpp"
+#include "gpu_profiler.hpp"
+#include "pipeline_statistics.hpp"
 #include <bloom_header.hpp>
 
 namespace bloom::render {
@@ -25,6 +29,10 @@ class BLOOM_API Renderer {
 
 public:
   Renderer(Window* window, Devices* devices);
+  /**
+   * @brief Creates a headless renderer that draws into an @c OffscreenTarget instead of a swap chain
+   */
+  Renderer(Devices* devices, const OffscreenTarget::Settings& settings);
   ~Renderer();
 
   Renderer(const Renderer&) = delete;
@@ -33,6 +41,10 @@ public:
   VkCommandBuffer BeginFrame();
   void EndFrame();
   void BeginRenderPass(VkCommandBuffer commandBuffer);
+  /**
+   * @brief Begins the render pass again after @c EndRenderPass(), keeping what was already drawn this frame
+   */
+  void ResumeRenderPass(VkCommandBuffer commandBuffer);
   void EndRenderPass(VkCommandBuffer commandBuffer);
 
   bool GetFrameStarted() const { return m_frameStarted; }
@@ -40,8 +52,33 @@ public:
     if (!m_frameStarted) { BLOOM_WARN("Cannot get CommandBuffer when frame not in progress"); }
     return m_commandBuffers[m_currentFrameIndex];
   }
-  VkRenderPass GetRenderPass() const { return m_swapChain->GetRenderPass(); }
-  float GetAspectRatio() const { return m_swapChain->ExtentAspectRatio(); }
+  VkRenderPass GetRenderPass() const { return m_target->GetRenderPass(); }
+  float GetAspectRatio() const { return m_target->ExtentAspectRatio(); }
+  VkExtent2D GetExtent() const { return m_target->GetExtent(); }
+  /// Depth of the image the current frame renders into
+  DepthAttachment GetDepthAttachment() const { return m_target->GetDepthAttachment(m_currentImageIndex); }
+  bool IsHeadless() const { return m_window == nullptr; }
+  /// Offscreen target of a headless renderer, nullptr when rendering to a window
+  OffscreenTarget* GetOffscreenTarget() const { return m_offscreen.get(); }
+  /// Captures rendered frames without stalling, see @c FrameCapture
+  FrameCapture& GetFrameCapture() { return *m_capture; }
+  /**
+   * @brief Turns pipeline statistics queries on or off, the query pools are created on first use
+   */
+  void SetPipelineStatistics(PipelineStatistics::Mode mode);
+  /// nullptr while pipeline statistics are off
+  PipelineStatistics* GetPipelineStatistics() const {
+    return m_pipelineStatistics && m_pipelineStatistics->GetMode() != PipelineStatistics::Mode::Off
+        ? m_pipelineStatistics.get() : nullptr;
+  }
+  /// nullptr unless built with @c BLOOM_ENABLE_GPU_PROFILER
+  GpuProfiler* GetGpuProfiler() const {
+#ifdef BLOOM_ENABLE_GPU_PROFILER
+    return m_gpuProfiler.get();
+#else
+    return nullptr;
+#endif
+  }
 
   int GetFrameIndex() const {
     if (!m_frameStarted) {
@@ -51,19 +88,78 @@ public:
     return m_currentFrameIndex;
   }
 
+  /**
+   * @brief Changes how many frames the CPU can record ahead of the GPU
+   *
+   * Applied on the next swap chain recreation, which is forced at the start of the next frame. Per frame resources
+   * should keep being sized with @c SwapChain::MAX_FRAMES_IN_FLIGHT, the frame index never goes past this value.
+   * @param framesInFlight Clamped to [1, SwapChain::MAX_FRAMES_IN_FLIGHT]
+   */
+  void SetFramesInFlight(uint32_t framesInFlight);
+  uint32_t GetFramesInFlight() const { return m_swapChainSettings.framesInFlight; }
+
+  /**
+   * @brief Stores the depth of every frame and makes it sampleable, which occlusion culling needs
+   *
+   * Off by default, storing the depth costs bandwidth on tiled GPUs. Applied like @c SetFramesInFlight().
+   */
+  void SetSampledDepth(bool enabled);
+  /// Whether the current target has sampleable depth, stays false until the target is recreated
+  bool HasSampledDepth() const { return m_target->HasSampledDepth(); }
+
+  /// Number of the last submitted frame, grows forever and survives swap chain recreations
+  uint64_t GetFrameNumber() const { return m_target->GetFrameNumber(); }
+  /// Number of the last frame the GPU has finished
+  uint64_t GetCompletedFrameNumber() const { return m_target->GetCompletedFrameNumber(); }
+
+  /**
+   * @brief Destroys a GPU resource once the frames that might still use it are done
+   *
+   * The callback runs after the GPU completes the frame currently being recorded (or the last submitted one if
+   * called outside of a frame), instead of stalling the whole device with @c vkDeviceWaitIdle
+   */
+  void DeferDestroy(std::function<void()> destroy);
+
+  /**
+   * @brief Blocks until the GPU finished the last submitted frame
+   *
+   * Used by the low latency mode so input is sampled as late as possible instead of queueing frames ahead
+   */
+  void WaitForLastFrame() { m_target->WaitForLastFrame(); }
+  /// Present mode in use, the window only requests one. Headless renderers never wait for a display
+  VkPresentModeKHR GetPresentMode() const {
+    return m_swapChain ? m_swapChain->GetPresentMode() : VK_PRESENT_MODE_IMMEDIATE_KHR;
+  }
+
 protected:
+  void StartRenderPass(VkCommandBuffer commandBuffer, bool resume);
   void CreateCommandBuffers();
   void FreeCommandBuffers();
   void RecreateSwapChain();
+  void FlushDeferredDestroys(uint64_t completedFrame);
 
   Window* m_window = nullptr;
   Devices* m_devices = nullptr;
   std::unique_ptr<SwapChain> m_swapChain = nullptr;
+  std::unique_ptr<OffscreenTarget> m_offscreen = nullptr;
+  OffscreenTarget::Settings m_offscreenSettings{};
+  /// Either the swap chain or the offscreen target
+  RenderTarget* m_target = nullptr;
   std::vector<VkCommandBuffer> m_commandBuffers;
+  std::unique_ptr<FrameCapture> m_capture = nullptr;
+  std::unique_ptr<PipelineStatistics> m_pipelineStatistics = nullptr;
+  uint32_t m_frameStatisticsScope = ~0u;
+#ifdef BLOOM_ENABLE_GPU_PROFILER
+  std::unique_ptr<GpuProfiler> m_gpuProfiler = nullptr;
+#endif
 
   unsigned int m_currentImageIndex = 0;
   int m_currentFrameIndex = 0;
   bool m_frameStarted = false;
+
+  SwapChain::Settings m_swapChainSettings{};
+  bool m_swapChainDirty = false;
+  std::vector<std::pair<uint64_t, std::function<void()>>> m_deferredDestroys;
 };
 
 }
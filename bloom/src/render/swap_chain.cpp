@@ -2,17 +2,29 @@
 
 namespace bloom::render {
 
-SwapChain::SwapChain(Devices &deviceRef, VkExtent2D extent)
-    : m_device{deviceRef}, m_windowExtent{extent} {
+SwapChain::SwapChain(Devices &deviceRef, VkExtent2D extent, const Settings& settings)
+    : m_device{deviceRef}, m_windowExtent{extent}, m_settings{settings} {
   Init();
-}SwapChain::SwapChain(Devices &deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous)
-    : m_device{deviceRef}, m_windowExtent{extent}, m_oldSwapChain{previous} {
+}
+
+SwapChain::SwapChain(Devices &deviceRef, VkExtent2D extent, std::shared_ptr<SwapChain> previous,
+                     const Settings& settings)
+    : m_device{deviceRef}, m_windowExtent{extent}, m_oldSwapChain{previous}, m_settings{settings} {
+  // Frame numbers keep counting across recreations so anything keyed on them stays valid. The renderer waits for
+  // the device to be idle before recreating so every submitted frame is done by now
+  m_frameNumber = previous->m_frameNumber;
+  m_completedFrameNumber = previous->m_frameNumber;
+  if (m_settings.useTimelineSemaphore) {
+    std::swap(m_timeline, previous->m_timeline);
+  }
+
   Init();
 
   m_oldSwapChain = nullptr;
 }
 
 void SwapChain::Init() {
+  m_framesInFlight = std::clamp<uint32_t>(m_settings.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
   CreateSwapChain();
   CreateImageViews();
   CreateRenderPass();
@@ -43,22 +55,69 @@ SwapChain::~SwapChain() {
   }
 
   vkDestroyRenderPass(m_device.device(), m_renderPass, nullptr);
+  vkDestroyRenderPass(m_device.device(), m_resumeRenderPass, nullptr);
 
   // cleanup synchronization objects
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+  for (size_t i = 0; i < m_framesInFlight; i++) {
     vkDestroySemaphore(m_device.device(), m_renderFinishedSemaphores[i], nullptr);
     vkDestroySemaphore(m_device.device(), m_imageAvailableSemaphores[i], nullptr);
-    vkDestroyFence(m_device.device(), m_inFlightFences[i], nullptr);
   }
+  for (auto fence : m_inFlightFences) {
+    vkDestroyFence(m_device.device(), fence, nullptr);
+  }
+  if (m_timeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(m_device.device(), m_timeline, nullptr);
+  }
+}
+
+uint64_t SwapChain::GetCompletedFrameNumber() {
+  if (m_timeline != VK_NULL_HANDLE) {
+    vkGetSemaphoreCounterValue(m_device.device(), m_timeline, &m_completedFrameNumber);
+  }
+  return m_completedFrameNumber;
+}
+
+void SwapChain::WaitForLastFrame() {
+  if (m_timeline != VK_NULL_HANDLE) {
+    WaitForFrame(m_frameNumber);
+    return;
+  }
+  if (m_frameNumber == 0) return;
+
+  // The last submit used the fence of the previous frame index
+  size_t last = (m_currentFrame + m_framesInFlight - 1) % m_framesInFlight;
+  vkWaitForFences(m_device.device(), 1, &m_inFlightFences[last], VK_TRUE, std::numeric_limits<uint64_t>::max());
+  m_completedFrameNumber = std::max(m_completedFrameNumber, m_fenceFrameNumbers[last]);
+}
+
+void SwapChain::WaitForFrame(uint64_t frameNumber) {
+  if (frameNumber == 0 || frameNumber <= m_completedFrameNumber) return;
+
+  VkSemaphoreWaitInfo waitInfo{};
+  waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+  waitInfo.semaphoreCount = 1;
+  waitInfo.pSemaphores = &m_timeline;
+  waitInfo.pValues = &frameNumber;
+  vkWaitSemaphores(m_device.device(), &waitInfo, std::numeric_limits<uint64_t>::max());
+  m_completedFrameNumber = std::max(m_completedFrameNumber, frameNumber);
 }
 
 VkResult SwapChain::AcquireNextImage(uint32_t *imageIndex) {
-  vkWaitForFences(
-      m_device.device(),
-      1,
-      &m_inFlightFences[m_currentFrame],
-      VK_TRUE,
-      std::numeric_limits<uint64_t>::max());
+  if (m_timeline != VK_NULL_HANDLE) {
+    // The next frame reuses the resources of the frame submitted framesInFlight frames ago
+    uint64_t nextFrame = m_frameNumber + 1;
+    if (nextFrame > m_framesInFlight) {
+      WaitForFrame(nextFrame - m_framesInFlight);
+    }
+  } else {
+    vkWaitForFences(
+        m_device.device(),
+        1,
+        &m_inFlightFences[m_currentFrame],
+        VK_TRUE,
+        std::numeric_limits<uint64_t>::max());
+    m_completedFrameNumber = std::max(m_completedFrameNumber, m_fenceFrameNumbers[m_currentFrame]);
+  }
 
   VkResult result = vkAcquireNextImageKHR(
       m_device.device(),
@@ -73,10 +132,18 @@ VkResult SwapChain::AcquireNextImage(uint32_t *imageIndex) {
 
 VkResult SwapChain::SubmitCommandBuffers(
     const VkCommandBuffer *buffers, uint32_t *imageIndex) {
-  if (m_imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
-    vkWaitForFences(m_device.device(), 1, &m_imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+  const uint64_t frameNumber = m_frameNumber + 1;
+  if (m_timeline != VK_NULL_HANDLE) {
+    // Usually already done, only blocks if the driver hands images out of order
+    WaitForFrame(m_imageFrameNumbers[*imageIndex]);
+    m_imageFrameNumbers[*imageIndex] = frameNumber;
+  } else {
+    if (m_imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
+      vkWaitForFences(m_device.device(), 1, &m_imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+    }
+    m_imagesInFlight[*imageIndex] = m_inFlightFences[m_currentFrame];
+    m_fenceFrameNumbers[m_currentFrame] = frameNumber;
   }
-  m_imagesInFlight[*imageIndex] = m_inFlightFences[m_currentFrame];
 
   VkSubmitInfo submitInfo = {};
   submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
@@ -90,15 +157,32 @@ VkResult SwapChain::SubmitCommandBuffers(
   submitInfo.commandBufferCount = 1;
   submitInfo.pCommandBuffers = buffers;
 
-  VkSemaphore signalSemaphores[] = {m_renderFinishedSemaphores[m_currentFrame]};
+  VkSemaphore signalSemaphores[] = {m_renderFinishedSemaphores[m_currentFrame], m_timeline};
   submitInfo.signalSemaphoreCount = 1;
   submitInfo.pSignalSemaphores = signalSemaphores;
 
-  vkResetFences(m_device.device(), 1, &m_inFlightFences[m_currentFrame]);
-  if (vkQueueSubmit(m_device.graphicsQueue(), 1, &submitInfo, m_inFlightFences[m_currentFrame]) !=
-      VK_SUCCESS) {
+  VkFence fence = VK_NULL_HANDLE;
+  // Binary semaphores ignore their value, only the timeline one uses it
+  uint64_t waitValues[] = {0};
+  uint64_t signalValues[] = {0, frameNumber};
+  VkTimelineSemaphoreSubmitInfo timelineInfo{};
+  if (m_timeline != VK_NULL_HANDLE) {
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 2;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.signalSemaphoreCount = 2;
+  } else {
+    fence = m_inFlightFences[m_currentFrame];
+    vkResetFences(m_device.device(), 1, &fence);
+  }
+
+  if (vkQueueSubmit(m_device.graphicsQueue(), 1, &submitInfo, fence) != VK_SUCCESS) {
     throw std::runtime_error("failed to submit draw command buffer!");
   }
+  m_frameNumber = frameNumber;
 
   VkPresentInfoKHR presentInfo = {};
   presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -114,7 +198,7 @@ VkResult SwapChain::SubmitCommandBuffers(
 
   auto result = vkQueuePresentKHR(m_device.presentQueue(), &presentInfo);
 
-  m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+  m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
 
   return result;
 }
@@ -124,6 +208,7 @@ void SwapChain::CreateSwapChain() {
 
   VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
   VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.presentModes);
+  m_presentMode = presentMode;
   VkExtent2D extent = ChooseSwapExtent(swapChainSupport.capabilities);
 
   uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -142,6 +227,11 @@ void SwapChain::CreateSwapChain() {
   createInfo.imageExtent = extent;
   createInfo.imageArrayLayers = 1;
   createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+  // Lets frames be captured, almost every driver allows it
+  m_supportsReadback = swapChainSupport.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  if (m_supportsReadback) {
+    createInfo.imageUsage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+  }
 
   QueueFamilyIndices indices = m_device.findPhysicalQueueFamilies();
   uint32_t queueFamilyIndices[] = {indices.graphicsFamily, indices.presentFamily};
@@ -206,7 +296,8 @@ void SwapChain::CreateRenderPass() {
   depthAttachment.format = FindDepthFormat();
   depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
   depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  // Only stored when something reads it afterwards, tilers skip writing it back otherwise
+  depthAttachment.storeOp = m_settings.sampledDepth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
   depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
   depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -260,6 +351,19 @@ void SwapChain::CreateRenderPass() {
   if (vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
     throw std::runtime_error("failed to create render pass!");
   }
+
+  // Resuming keeps what was drawn, the attachments come back in the layouts the first pass left them in
+  attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[0].initialLayout = colorAttachment.finalLayout;
+  attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+  attachments[1].initialLayout = depthAttachment.finalLayout;
+  dependency.srcStageMask |= VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+  dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+
+  if (vkCreateRenderPass(m_device.device(), &renderPassInfo, nullptr, &m_resumeRenderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create resume render pass!");
+  }
 }
 
 void SwapChain::CreateFramebuffers() {
@@ -309,6 +413,7 @@ void SwapChain::CreateDepthResources() {
     imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
     imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (m_settings.sampledDepth) imageInfo.usage |= VK_IMAGE_USAGE_SAMPLED_BIT;
     imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     imageInfo.flags = 0;
@@ -337,24 +442,54 @@ void SwapChain::CreateDepthResources() {
 }
 
 void SwapChain::CreateSyncObjects() {
-  m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-  m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
-  m_imagesInFlight.resize(ImageCount(), VK_NULL_HANDLE);
+  m_imageAvailableSemaphores.resize(m_framesInFlight);
+  m_renderFinishedSemaphores.resize(m_framesInFlight);
 
   VkSemaphoreCreateInfo semaphoreInfo = {};
   semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
+  for (size_t i = 0; i < m_framesInFlight; i++) {
+    if (vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) !=
+            VK_SUCCESS ||
+        vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) !=
+            VK_SUCCESS) {
+      throw std::runtime_error("failed to create synchronization objects for a frame!");
+    }
+  }
+
+  if (m_settings.useTimelineSemaphore && m_device.supportsTimelineSemaphore()) {
+    m_imageFrameNumbers.resize(ImageCount(), 0);
+    // Might have been inherited from the previous swap chain
+    if (m_timeline != VK_NULL_HANDLE) return;
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = m_frameNumber;
+    VkSemaphoreCreateInfo timelineInfo = {};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineInfo.pNext = &typeInfo;
+    if (vkCreateSemaphore(m_device.device(), &timelineInfo, nullptr, &m_timeline) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create timeline semaphore!");
+    }
+    return;
+  }
+
+  if (m_timeline != VK_NULL_HANDLE) {
+    vkDestroySemaphore(m_device.device(), m_timeline, nullptr);
+    m_timeline = VK_NULL_HANDLE;
+  }
+
+  m_inFlightFences.resize(m_framesInFlight);
+  m_imagesInFlight.resize(ImageCount(), VK_NULL_HANDLE);
+  m_fenceFrameNumbers.resize(m_framesInFlight, 0);
+
   VkFenceCreateInfo fenceInfo = {};
   fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
   fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-  for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-    if (vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateSemaphore(m_device.device(), &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) !=
-            VK_SUCCESS ||
-        vkCreateFence(m_device.device(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
+  for (size_t i = 0; i < m_framesInFlight; i++) {
+    if (vkCreateFence(m_device.device(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
       throw std::runtime_error("failed to create synchronization objects for a frame!");
     }
   }
@@ -374,24 +509,43 @@ VkSurfaceFormatKHR SwapChain::ChooseSwapSurfaceFormat(
 
 VkPresentModeKHR SwapChain::ChooseSwapPresentMode(
     const std::vector<VkPresentModeKHR> &availablePresentModes) {
-  for (const auto &availablePresentMode : availablePresentModes) {
-    if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-      BLOOM_LOG("Present mode: Mailbox");
-      return VK_PRESENT_MODE_MAILBOX_KHR;
-    }
+  // Requested mode first, then the closest one in latency, FIFO is the only mode the spec guarantees
+  std::vector<VkPresentModeKHR> preferred;
+  switch (m_settings.presentMode) {
+    case PresentMode::Immediate:
+      preferred = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+      break;
+    case PresentMode::Mailbox:
+      preferred = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR};
+      break;
+    case PresentMode::FifoRelaxed:
+      preferred = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+      break;
+    case PresentMode::Fifo:
+      break;
   }
 
-  // for (const auto &availablePresentMode : availablePresentModes) {
-  //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-  //     BLOOM_LOG("Present mode: Immediate");
-  //     return availablePresentMode;
-  //   }
-  // }
+  for (auto mode : preferred) {
+    if (std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end()) {
+      BLOOM_LOG("Present mode: {0}", PresentModeName(mode));
+      return mode;
+    }
+  }
 
   BLOOM_LOG("Present mode: V-Sync");
   return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+const char* SwapChain::PresentModeName(VkPresentModeKHR mode) {
+  switch (mode) {
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "Relaxed V-Sync";
+    case VK_PRESENT_MODE_FIFO_KHR: return "V-Sync";
+    default: return "Unknown";
+  }
+}
+
 VkExtent2D SwapChain::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilities) {
   if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
     return capabilities.currentExtent;
@@ -409,10 +563,11 @@ VkExtent2D SwapChain::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR &capabilit
 }
 
 VkFormat SwapChain::FindDepthFormat() {
+  // Sampleable even without sampledDepth, so the render pass stays compatible with the pipelines when it's toggled
   return m_device.findSupportedFormat(
       {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
       VK_IMAGE_TILING_OPTIMAL,
-      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
 }
 
 }  // namespace lve
@@ -9,37 +9,80 @@
 #pragma once
 
 #include "devices.hpp"
+#include "render_target.hpp"
 #include <bloom_header.hpp>
 
 namespace bloom::render {
 
-class SwapChain {
+class SwapChain : public RenderTarget {
 public:
+  /// Upper bound for the frames in flight, per frame resources can be sized with it
   static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
-  SwapChain(Devices &deviceRef, VkExtent2D windowExtent);
-  SwapChain(Devices &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous);
+  /**
+   * @struct Settings
+   * @brief Runtime configuration of the swap chain, changing it requires recreating the swap chain
+   */
+  struct Settings {
+    uint32_t framesInFlight = MAX_FRAMES_IN_FLIGHT; ///< Clamped to [1, MAX_FRAMES_IN_FLIGHT]
+    bool useTimelineSemaphore = true;               ///< Ignored if the device doesn't support them
+    PresentMode presentMode = PresentMode::Fifo;    ///< Falls back to the closest mode the surface supports
+    bool sampledDepth = false;                      ///< Stores the depth so shaders can sample it afterwards
+  };
+
+  SwapChain(Devices &deviceRef, VkExtent2D windowExtent, const Settings& settings);
+  SwapChain(Devices &deviceRef, VkExtent2D windowExtent, std::shared_ptr<SwapChain> previous,
+            const Settings& settings);
   ~SwapChain();
 
   SwapChain(const SwapChain &) = delete;
   SwapChain& operator=(const SwapChain &) = delete;
 
-  VkFramebuffer GetFrameBuffer(int index) { return m_swapChainFramebuffers[index]; }
-  VkRenderPass GetRenderPass() { return m_renderPass; }
+  VkFramebuffer GetFrameBuffer(int index) override { return m_swapChainFramebuffers[index]; }
+  VkRenderPass GetRenderPass() override { return m_renderPass; }
+  VkRenderPass GetResumeRenderPass() override { return m_resumeRenderPass; }
   VkImageView GetImageView(int index) { return m_swapChainImageViews[index]; }
   size_t ImageCount() { return m_swapChainImages.size(); }
   VkFormat GetSwapChainImageFormat() { return m_swapChainImageFormat; }
   VkExtent2D GetSwapChainExtent() { return m_swapChainExtent; }
+  VkExtent2D GetExtent() override { return m_swapChainExtent; }
+  VkImage GetColorImage(int index) override { return m_swapChainImages[index]; }
+  VkFormat GetColorFormat() override { return m_swapChainImageFormat; }
+  VkImageLayout GetColorLayout() override { return VK_IMAGE_LAYOUT_PRESENT_SRC_KHR; }
+  bool SupportsReadback() override { return m_supportsReadback; }
+  bool HasSampledDepth() override { return m_settings.sampledDepth; }
+  DepthAttachment GetDepthAttachment(int index) override {
+    return {m_depthImages[index], m_depthImageViews[index], m_swapChainDepthFormat};
+  }
   uint32_t width() { return m_swapChainExtent.width; }
   uint32_t height() { return m_swapChainExtent.height; }
 
-  float ExtentAspectRatio() {
-    return static_cast<float>(m_swapChainExtent.width) / static_cast<float>(m_swapChainExtent.height);
-  }
   VkFormat FindDepthFormat();
 
-  VkResult AcquireNextImage(uint32_t *imageIndex);
-  VkResult SubmitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex);
+  VkResult AcquireNextImage(uint32_t *imageIndex) override;
+  VkResult SubmitCommandBuffers(const VkCommandBuffer *buffers, uint32_t *imageIndex) override;
+
+  uint32_t GetFramesInFlight() const { return m_framesInFlight; }
+  /// Index of the frame in flight that will be recorded next, in [0, GetFramesInFlight())
+  uint32_t GetFrameIndex() const override { return static_cast<uint32_t>(m_currentFrame); }
+  bool UsesTimelineSemaphore() const { return m_timeline != VK_NULL_HANDLE; }
+  /**
+   * @brief Number of the last submitted frame, frames are numbered from 1
+   *
+   * The counter survives swap chain recreation so resources can be recycled by frame number
+   */
+  uint64_t GetFrameNumber() const override { return m_frameNumber; }
+  /**
+   * @brief Number of the last frame the GPU finished executing
+   */
+  uint64_t GetCompletedFrameNumber() override;
+  /**
+   * @brief Blocks until the GPU finishes the last submitted frame
+   */
+  void WaitForLastFrame() override;
+  /// Present mode actually in use, might differ from the requested one
+  VkPresentModeKHR GetPresentMode() const { return m_presentMode; }
+  static const char* PresentModeName(VkPresentModeKHR mode);
 
   bool compareSwapFormats(const SwapChain& swapChain) const {
     return swapChain.m_swapChainDepthFormat == m_swapChainDepthFormat &&
@@ -54,6 +97,7 @@ private:
   void CreateRenderPass();
   void CreateFramebuffers();
   void CreateSyncObjects();
+  void WaitForFrame(uint64_t frameNumber);
 
   // Helper functions
   VkSurfaceFormatKHR ChooseSwapSurfaceFormat(
@@ -65,9 +109,12 @@ private:
   VkFormat m_swapChainImageFormat;
   VkFormat m_swapChainDepthFormat;
   VkExtent2D m_swapChainExtent;
+  VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
+  bool m_supportsReadback = false;
 
   std::vector<VkFramebuffer> m_swapChainFramebuffers;
   VkRenderPass m_renderPass;
+  VkRenderPass m_resumeRenderPass = VK_NULL_HANDLE;
 
   std::vector<VkImage> m_depthImages;
   std::vector<VkDeviceMemory> m_depthImageMemories;
@@ -81,11 +128,23 @@ private:
   VkSwapchainKHR m_swapChain;
   std::shared_ptr<SwapChain> m_oldSwapChain;
 
+  Settings m_settings;
+  uint32_t m_framesInFlight;
   std::vector<VkSemaphore> m_imageAvailableSemaphores;
   std::vector<VkSemaphore> m_renderFinishedSemaphores;
+  size_t m_currentFrame = 0;
+
+  uint64_t m_frameNumber = 0;
+  uint64_t m_completedFrameNumber = 0;
+
+  // Fence pacing, used when timeline semaphores are not available
   std::vector<VkFence> m_inFlightFences;
   std::vector<VkFence> m_imagesInFlight;
-  size_t m_currentFrame = 0;
+  std::vector<uint64_t> m_fenceFrameNumbers;
+
+  // Timeline pacing, the semaphore value is the number of the last finished frame
+  VkSemaphore m_timeline = VK_NULL_HANDLE;
+  std::vector<uint64_t> m_imageFrameNumbers;
 };
 
 }  // namespace lve
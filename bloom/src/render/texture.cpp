@@ -2,10 +2,15 @@
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#include <atomic>
 
 namespace bloom::render {
 
-  Texture::Texture(Devices *device, const std::string &path) : m_device(device) {
+  namespace {
+    std::atomic<uint64_t> s_nextUniqueId = 1;
+  }
+
+  Texture::Texture(Devices *device, const std::string &path) : m_device(device), m_uniqueId(s_nextUniqueId++) {
     m_data = stbi_load(path.c_str(), &m_dimensions.width, &m_dimensions.height, &m_dimensions.pixelSize, STBI_rgb_alpha);
 
     VkBuffer stagingBuffer;
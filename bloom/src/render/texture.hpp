@@ -28,10 +28,15 @@ public:
   VkSampler GetSampler() const { return m_sampler; }
   VkImageView GetImageView() const { return m_imageView; }
   VkImageLayout GetImageLayout() const { return m_imageLayout; }
+  /**
+   * @brief Identifies this texture for its whole life, unlike its address it's never given to another one
+   */
+  uint64_t GetUniqueId() const { return m_uniqueId; }
 private:
   void TransitionImageLayout(VkImageLayout oldLayout, VkImageLayout newLayout);
 
   Devices* m_device;
+  const uint64_t m_uniqueId;
 
   unsigned char* m_data;
   Dimensions m_dimensions;
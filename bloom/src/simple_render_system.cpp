@@ -1,14 +1,17 @@
 #include "simple_render_system.hpp"
+#include "profiler.hpp"
+#include "render/swap_chain.hpp"
 #include "glm/gtc/constants.hpp"
 
 namespace bloom {
 
 struct SimplePushConstantData {
-  glm::mat4 transform = glm::mat4(1.0f);
+  glm::mat4 modelMatrix = glm::mat4(1.0f);
   alignas(16) glm::vec3 color;
 };
 
-SimpleRenderSystem::SimpleRenderSystem(render::Devices* devices) : m_devices(devices) { }
+SimpleRenderSystem::SimpleRenderSystem(render::Devices* devices, VkDescriptorSetLayout globalSetLayout) :
+    m_devices(devices), m_globalSetLayout(globalSetLayout) { }
 SimpleRenderSystem::~SimpleRenderSystem() {
   vkDestroyPipelineLayout(m_devices->device(), m_pipelineLayout, nullptr);
 }
@@ -19,14 +22,15 @@ void SimpleRenderSystem::Begin(VkRenderPass renderPass) {
       });
 
   CreateDescriptorPool();
-  CreateDescriptorSets();
   CreatePipelineLayout();
-  CreatePipeline(renderPass);
+  m_renderPass = renderPass;
+  GetPipeline({});
 }
 
 void SimpleRenderSystem::CreatePipelineLayout() {
 
-  std::array<VkDescriptorSetLayout, 1> descriptorSetLayouts = {
+  std::array<VkDescriptorSetLayout, 2> descriptorSetLayouts = {
+    m_globalSetLayout,
     m_textureLayout->getDescriptorSetLayout()
   };
 
@@ -48,28 +52,116 @@ void SimpleRenderSystem::CreatePipelineLayout() {
   }
 }
 
-void SimpleRenderSystem::CreatePipeline(VkRenderPass renderPass) {
+render::Pipeline* SimpleRenderSystem::GetPipeline(const render::Model::Layout& layout, PassType pass, bool indirect) {
+  auto& pipeline = m_pipelines[layout.Key() | static_cast<uint32_t>(pass) << 16 | (indirect ? BIT(20) : 0)];
+  if (pipeline != nullptr) return pipeline.get();
+
   if (m_pipelineLayout == nullptr) BLOOM_CRITICAL("Pipeline layout is null");
   render::PipelineConfiguration pipelineConfig{};
   render::Pipeline::defaultPipelineConfig(pipelineConfig);
+  pipelineConfig.bindingDescriptions = render::Model::GetBindingDescriptions(layout);
+  pipelineConfig.attributeDescriptions = render::Model::GetAttributeDescriptions(layout);
   // Tells what layout to expect to the render buffer
-  pipelineConfig.renderPass = renderPass;
-  pipelineConfig.pipelineLayout = m_pipelineLayout;
-  m_pipeline = std::make_unique<render::Pipeline>(*m_devices, "resources/shaders/default.vert.spv", "resources/shaders/default.frag.spv", pipelineConfig);
-}
+  pipelineConfig.renderPass = m_renderPass;
+  pipelineConfig.pipelineLayout = indirect ? m_gpuScene->GetPipelineLayout() : m_pipelineLayout;
 
-void SimpleRenderSystem::RenderObjects(VkCommandBuffer commandBuffer, std::vector<Object>& objects, const Camera& camera) {
-  m_pipeline->Bind(commandBuffer);
+  if (pass == PassType::DepthOnly) {
+    pipelineConfig.bindingDescriptions = render::Model::GetPositionBindingDescriptions(layout);
+    pipelineConfig.attributeDescriptions = render::Model::GetPositionAttributeDescriptions(layout);
+    pipelineConfig.colorBlendAttachment.colorWriteMask = 0;
+    pipeline = std::make_unique<render::Pipeline>(*m_devices, indirect ? "resources/shaders/indirect_depth.vert.spv"
+                                                                       : "resources/shaders/depth.vert.spv",
+                                                  "", pipelineConfig);
+    return pipeline.get();
+  }
 
-  auto projectionView = camera.GetProjection() * camera.GetView();
+  if (pass == PassType::DepthEqual) {
+    pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_EQUAL;
+    pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;
+  }
+  if (indirect) {
+    pipeline = std::make_unique<render::Pipeline>(*m_devices, "resources/shaders/indirect.vert.spv", "resources/shaders/indirect.frag.spv", pipelineConfig);
+    return pipeline.get();
+  }
+  pipeline = std::make_unique<render::Pipeline>(*m_devices, "resources/shaders/default.vert.spv", "resources/shaders/default.frag.spv", pipelineConfig);
+  return pipeline.get();
+}
 
+void SimpleRenderSystem::Prepare(const render::FrameInfo& frameInfo, std::vector<Object>& objects, bool sampledDepth) {
+  BLOOM_PROFILE_FUNCTION();
+  m_frameNumber++;
   for (auto& obj : objects) {
     obj.transform.rotation.y = glm::mod(obj.transform.rotation.y + 0.0001f, glm::two_pi<float>());
     obj.transform.rotation.x = glm::mod(obj.transform.rotation.x + 0.00005f, glm::two_pi<float>());
+  }
 
+  m_gpuSceneActive = false;
+  if (m_gpuDriven && m_gpuScene == nullptr) {
+    if (m_devices->supportsGpuDrivenRendering()) {
+      m_gpuScene = std::make_unique<render::GpuScene>(m_devices, m_globalSetLayout);
+    } else {
+      BLOOM_WARN("GPU driven rendering isn't supported by the device, objects are drawn one by one");
+      m_gpuDriven = false;
+    }
+  }
+  if (m_gpuDriven) {
+    m_gpuScene->Update(frameInfo, objects);
+    m_gpuScene->Cull(frameInfo, m_lodPixelError, m_lodHysteresis, m_occlusionCulling && sampledDepth);
+    m_gpuSceneActive = true;
+  }
+
+  // Picked once so the pre-pass and the colour pass draw the same triangles
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (!IsGpuDrawn(i)) SelectLod(frameInfo, objects[i]);
+  }
+}
+
+void SimpleRenderSystem::RenderObjects(const render::FrameInfo& frameInfo, std::vector<Object>& objects) {
+  BLOOM_PROFILE_FUNCTION();
+  auto commandBuffer = frameInfo.commandBuffer;
+
+  // Every pipeline shares the same layout so set 0 stays bound across pipeline changes
+  vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                          &frameInfo.globalDescriptorSet, 0, nullptr);
+
+  if (m_depthPrepass) {
+    DrawDepthPrepass(frameInfo, objects);
+  }
+
+  BLOOM_GPU_SCOPE(frameInfo.gpuProfiler, commandBuffer, "Opaque");
+  render::PipelineStatistics::Scope statistics(frameInfo.pipelineStatistics, commandBuffer, "Opaque");
+  const PassType pass = m_depthPrepass ? PassType::DepthEqual : PassType::Color;
+  if (m_gpuSceneActive) {
+    DrawGpuScene(frameInfo, pass);
+    // The GPU scene bound its own set 0 with a layout the per object pipelines aren't compatible with
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                            &frameInfo.globalDescriptorSet, 0, nullptr);
+  }
+
+  render::Pipeline* boundPipeline = nullptr;
+  render::GeometryPool* boundPool = nullptr;
+  m_triangleCount = 0;
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (IsGpuDrawn(i)) continue;
+    auto& obj = objects[i];
+    if (obj.texture == nullptr) continue;
+    const VkDescriptorSet textureSet = GetTextureSet(obj.texture);
+    if (textureSet == VK_NULL_HANDLE) {
+      BLOOM_WARN_THROTTLED(5000, "Out of texture descriptor sets, objects with new textures aren't drawn");
+      continue;
+    }
+    // Only rebind when the vertex layout changes between objects
+    auto pipeline = GetPipeline(obj.model->GetLayout(), pass);
+    const bool layoutChanged = pipeline != boundPipeline;
+    if (layoutChanged) {
+      pipeline->Bind(commandBuffer);
+      boundPipeline = pipeline;
+    }
+
+    // Has to match the pre-pass bit by bit or the EQUAL depth test fails
     SimplePushConstantData push{};
     push.color = obj.color;
-    push.transform = projectionView * obj.transform.mat4();
+    push.modelMatrix = obj.transform.mat4() * obj.model->GetDequantization();
 
     vkCmdPushConstants(
       commandBuffer,
@@ -80,60 +172,168 @@ void SimpleRenderSystem::RenderObjects(VkCommandBuffer commandBuffer, std::vecto
       &push
     );
 
-    VkDescriptorImageInfo imageInfo{};
-    if (obj.texture != nullptr) {
-      imageInfo.imageLayout = obj.texture->GetImageLayout();
-      imageInfo.imageView = obj.texture->GetImageView();
-      imageInfo.sampler = obj.texture->GetSampler();
-
-      VkWriteDescriptorSet descriptorWrite{};
-      descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-      descriptorWrite.dstSet = m_globalDescriptorSets[obj.GetID()];
-      descriptorWrite.dstBinding = 0;
-      descriptorWrite.dstArrayElement = 0;
-      descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-      descriptorWrite.descriptorCount = 1;
-      descriptorWrite.pImageInfo = &imageInfo;
-      vkDeviceWaitIdle(m_devices->device());
-      vkUpdateDescriptorSets(m_devices->device(), 1, &descriptorWrite, 0, nullptr);
+    // TODO: I should wrap all vulkan calls on DescriptorSet class
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 1, 1, &textureSet, 0, nullptr);
+
+    // Pooled models with the same layout share their buffers
+    if (layoutChanged || obj.model->GetPool() == nullptr || obj.model->GetPool() != boundPool) {
+      obj.model->Bind(commandBuffer);
+      boundPool = obj.model->GetPool();
     }
+    obj.model->Draw(commandBuffer, obj.lod);
+    m_triangleCount += obj.model->GetTriangleCount(obj.lod);
+  }
+}
 
-    // TODO: I should wrap all vulkan calls on DescriptorSet class
-    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_globalDescriptorSets[obj.GetID()], 0, nullptr);
+void SimpleRenderSystem::CullOccluded(const render::FrameInfo& frameInfo, const render::DepthAttachment& depth) {
+  if (HasLatePass()) m_gpuScene->CullOccluded(frameInfo, depth);
+}
 
-    obj.model->Bind(commandBuffer);
-    obj.model->Draw(commandBuffer);
+void SimpleRenderSystem::RenderLateObjects(const render::FrameInfo& frameInfo) {
+  BLOOM_PROFILE_FUNCTION();
+  if (!HasLatePass()) return;
+  auto commandBuffer = frameInfo.commandBuffer;
+  BLOOM_GPU_SCOPE(frameInfo.gpuProfiler, commandBuffer, "Disoccluded");
+  render::PipelineStatistics::Scope statistics(frameInfo.pipelineStatistics, commandBuffer, "Disoccluded");
+  // Same passes as the early draws, the depth they left is loaded back
+  if (m_depthPrepass) {
+    DrawGpuScene(frameInfo, PassType::DepthOnly, true);
   }
+  DrawGpuScene(frameInfo, m_depthPrepass ? PassType::DepthEqual : PassType::Color, true);
 }
 
-void SimpleRenderSystem::CreateDescriptorPool() {
-  std::vector<VkDescriptorPoolSize> poolSizes{};
-  poolSizes.resize(1);
-  poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-  poolSizes[0].descriptorCount = static_cast<unsigned int>(m_poolSizes.imageSampler);
+void SimpleRenderSystem::DrawDepthPrepass(const render::FrameInfo& frameInfo, std::vector<Object>& objects) {
+  BLOOM_PROFILE_FUNCTION();
+  auto commandBuffer = frameInfo.commandBuffer;
+  BLOOM_GPU_SCOPE(frameInfo.gpuProfiler, commandBuffer, "Depth pre-pass");
+  render::PipelineStatistics::Scope statistics(frameInfo.pipelineStatistics, commandBuffer, "Depth pre-pass");
+  if (m_gpuSceneActive) {
+    DrawGpuScene(frameInfo, PassType::DepthOnly);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+                            &frameInfo.globalDescriptorSet, 0, nullptr);
+  }
+
+  render::Pipeline* boundPipeline = nullptr;
+  render::GeometryPool* boundPool = nullptr;
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (IsGpuDrawn(i)) continue;
+    auto& obj = objects[i];
+    // Same objects as the colour pass, which can't draw them without a texture
+    if (obj.texture == nullptr) continue;
+    auto pipeline = GetPipeline(obj.model->GetLayout(), PassType::DepthOnly);
+    const bool layoutChanged = pipeline != boundPipeline;
+    if (layoutChanged) {
+      pipeline->Bind(commandBuffer);
+      boundPipeline = pipeline;
+    }
 
-  m_globalPool = std::make_unique<render::DescriptorPool>(m_devices, static_cast<unsigned int>(poolSizes.size()));
+    SimplePushConstantData push{};
+    push.color = obj.color;
+    push.modelMatrix = obj.transform.mat4() * obj.model->GetDequantization();
+
+    vkCmdPushConstants(
+      commandBuffer,
+      m_pipelineLayout,
+      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+      0,
+      sizeof(SimplePushConstantData),
+      &push
+    );
+
+    if (layoutChanged || obj.model->GetPool() == nullptr || obj.model->GetPool() != boundPool) {
+      obj.model->Bind(commandBuffer, true);
+      boundPool = obj.model->GetPool();
+    }
+    obj.model->Draw(commandBuffer, obj.lod);
+  }
 }
 
-void SimpleRenderSystem::CreateDescriptorSets() {
-  m_globalDescriptorSets.resize(1);
-  for (size_t i = 0; i < 1; i++) {
-    m_globalDescriptorSets[i] = AllocateDescriptorSet(m_textureLayout->getDescriptorSetLayout());
+void SimpleRenderSystem::DrawGpuScene(const render::FrameInfo& frameInfo, PassType pass, bool late) {
+  const auto& batches = m_gpuScene->GetBatches();
+  if (batches.empty()) return;
+
+  m_gpuScene->Bind(frameInfo);
+  for (uint32_t i = 0; i < batches.size(); i++) {
+    GetPipeline(batches[i].layout, pass, true)->Bind(frameInfo.commandBuffer);
+    batches[i].pool->Bind(frameInfo.commandBuffer, batches[i].layout, pass == PassType::DepthOnly);
+    m_gpuScene->Draw(frameInfo, i, late);
   }
 }
 
-VkDescriptorSet SimpleRenderSystem::AllocateDescriptorSet(VkDescriptorSetLayout layout) {
-  VkDescriptorSetAllocateInfo allocInfo{};
-  allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-  allocInfo.descriptorPool = m_globalPool->getDescriptorPool();
-  allocInfo.descriptorSetCount = 1;
-  allocInfo.pSetLayouts = &layout;
-  VkDescriptorSet descriptorSet;
-  auto result = vkAllocateDescriptorSets(m_devices->device(), &allocInfo, &descriptorSet);
-  if (result != VK_SUCCESS) {
-    BLOOM_CRITICAL("Failed to allocate descriptor set");
+void SimpleRenderSystem::SelectLod(const render::FrameInfo& frameInfo, Object& obj) const {
+  const uint32_t count = obj.model->GetLodCount();
+  if (count <= 1 || frameInfo.extent.height == 0) {
+    obj.lod = 0;
+    return;
   }
-  return descriptorSet;
+
+  const auto& projection = frameInfo.camera.GetProjection();
+  const glm::vec4 sphere = obj.model->GetBoundingSphere();
+  const float scale = glm::max(glm::abs(obj.transform.scale.x),
+                               glm::max(glm::abs(obj.transform.scale.y), glm::abs(obj.transform.scale.z)));
+  // Pixels covered by one model unit at the distance of the closest point of the bounding sphere
+  float pixelsPerUnit = scale * glm::abs(projection[1][1]) * 0.5f * static_cast<float>(frameInfo.extent.height);
+  const bool orthographic = projection[3][3] == 1.0f;
+  if (!orthographic) {
+    const glm::vec3 center = obj.transform.mat4() * glm::vec4(glm::vec3(sphere), 1.0f);
+    const float distance = glm::length(center - frameInfo.camera.GetPosition()) - sphere.w * scale;
+    pixelsPerUnit /= glm::max(distance, 0.01f);
+  }
+
+  const float threshold = m_lodPixelError / pixelsPerUnit;
+  uint32_t lod = glm::min(obj.lod, count - 1);
+  while (lod + 1 < count && obj.model->GetLod(lod + 1).error <= threshold * (1.0f - m_lodHysteresis)) lod++;
+  while (lod > 0 && obj.model->GetLod(lod).error > threshold) lod--;
+  obj.lod = lod;
+}
+
+void SimpleRenderSystem::CreateDescriptorPool() {
+  m_globalPool = std::make_unique<render::DescriptorPool>(m_devices, m_poolSizes.imageSampler);
+}
+
+VkDescriptorSet SimpleRenderSystem::GetTextureSet(const render::Texture* texture) {
+  auto it = m_textureSetIndices.find(texture);
+  if (it != m_textureSetIndices.end()) {
+    TextureSet& entry = m_textureSets[it->second];
+    if (entry.id == texture->GetUniqueId()) {
+      entry.lastUsed = m_frameNumber;
+      return entry.set;
+    }
+    // Another texture at the address of a destroyed one, its set may still be read by a frame in flight
+    entry.texture = nullptr;
+    m_textureSetIndices.erase(it);
+  }
+
+  uint32_t index = 0;
+  while (index < m_textureSets.size() &&
+         m_textureSets[index].lastUsed + render::SwapChain::MAX_FRAMES_IN_FLIGHT >= m_frameNumber) {
+    index++;
+  }
+  if (index == m_textureSets.size()) {
+    VkDescriptorSet set;
+    if (!m_globalPool->allocateDescriptorSet(m_textureLayout->getDescriptorSetLayout(), set)) return VK_NULL_HANDLE;
+    m_textureSets.push_back({nullptr, 0, set, 0});
+  } else if (m_textureSets[index].texture != nullptr) {
+    m_textureSetIndices.erase(m_textureSets[index].texture);
+  }
+
+  TextureSet& entry = m_textureSets[index];
+  entry.texture = texture;
+  entry.id = texture->GetUniqueId();
+  entry.lastUsed = m_frameNumber;
+  m_textureSetIndices.emplace(texture, index);
+
+  VkDescriptorImageInfo imageInfo{texture->GetSampler(), texture->GetImageView(), texture->GetImageLayout()};
+  VkWriteDescriptorSet descriptorWrite{};
+  descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+  descriptorWrite.dstSet = entry.set;
+  descriptorWrite.dstBinding = 0;
+  descriptorWrite.dstArrayElement = 0;
+  descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+  descriptorWrite.descriptorCount = 1;
+  descriptorWrite.pImageInfo = &imageInfo;
+  vkUpdateDescriptorSets(m_devices->device(), 1, &descriptorWrite, 0, nullptr);
+  return entry.set;
 }
 
-}
\ No newline at end of file
+}
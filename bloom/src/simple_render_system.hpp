@@ -10,32 +10,141 @@
 #include "object.hpp"
 #include "render/devices.hpp"
 #include "render/pipeline.hpp"
+#include "render/geometry_pool.hpp"
+#include "render/gpu_scene.hpp"
 #include "render/descriptor_set_layout.hpp"
 #include "render/descriptor_pool.hpp"
+#include "render/frame_info.hpp"
 #include "camera.hpp"
 
 namespace bloom {
 
 class BLOOM_API SimpleRenderSystem {
 public:
-  SimpleRenderSystem(render::Devices* devices);
+  /**
+   * @param devices Device used to create the pipelines
+   * @param globalSetLayout Layout of set 0, holding the @c GlobalUbo
+   */
+  SimpleRenderSystem(render::Devices* devices, VkDescriptorSetLayout globalSetLayout);
   virtual ~SimpleRenderSystem();
 
   SimpleRenderSystem(const SimpleRenderSystem&) = delete;
   SimpleRenderSystem& operator=(const SimpleRenderSystem&) = delete;
 
   void Begin(VkRenderPass renderPass);
-  void RenderObjects(VkCommandBuffer commandBuffer, std::vector<Object> &objects, const Camera &camera);
+  /**
+   * @brief Per object work of the frame (LOD selection, GPU culling), has to be recorded before the render pass
+   * @param sampledDepth Whether the render target keeps a depth occlusion culling can read, it's skipped otherwise
+   */
+  void Prepare(const render::FrameInfo& frameInfo, std::vector<Object> &objects, bool sampledDepth);
+  void RenderObjects(const render::FrameInfo& frameInfo, std::vector<Object> &objects);
+  /**
+   * @brief Whether the frame needs @c CullOccluded() and @c RenderLateObjects() after @c RenderObjects()
+   */
+  bool HasLatePass() const { return m_gpuSceneActive && m_gpuScene->GetOcclusion(); }
+  /**
+   * @brief Culls the objects not drawn by @c RenderObjects() against its depth, has to be outside of the render pass
+   */
+  void CullOccluded(const render::FrameInfo& frameInfo, const render::DepthAttachment& depth);
+  /**
+   * @brief Draws what @c CullOccluded() found visible, in the render pass resumed after it
+   */
+  void RenderLateObjects(const render::FrameInfo& frameInfo);
+
+  /**
+   * @brief Enables the depth pre-pass for the scene
+   *
+   * When enabled, opaque objects are first drawn position only to fill the depth buffer and then shaded with the
+   * depth test set to @c EQUAL and depth writes off, so every pixel is shaded once no matter the overdraw. It pays
+   * off on scenes with a lot of overlapping geometry and expensive fragments, on light scenes the extra vertex work
+   * makes it slower.
+   */
+  void SetDepthPrepass(bool enabled) { m_depthPrepass = enabled; }
+  bool GetDepthPrepass() const { return m_depthPrepass; }
+
+  /**
+   * @brief Sets how levels of detail are picked
+   *
+   * Every object draws the coarsest level whose error, projected on screen, stays under @c pixelError. Going back to a
+   * coarser level requires the error to drop a @c hysteresis fraction below the threshold, so objects sitting right at
+   * a switch distance don't flicker between two levels.
+   */
+  void SetLodSettings(float pixelError, float hysteresis) {
+    m_lodPixelError = pixelError;
+    m_lodHysteresis = hysteresis;
+  }
+  /// Triangles drawn by the colour pass last frame, only counts the objects drawn one by one
+  uint64_t GetTriangleCount() const { return m_triangleCount; }
+
+  /**
+   * @brief Draws the objects with pooled models through a @c render::GpuScene
+   *
+   * Culling and LOD selection move to a compute shader and all of those objects are drawn with one indirect call per
+   * vertex layout, so recording the frame no longer depends on how many there are. Models split in meshlets, see
+   * @c render::MeshOptimizer::Settings::buildMeshlets, are culled cluster by cluster at their finest level. Ignored on
+   * devices without multi draw indirect.
+   */
+  void SetGpuDriven(bool enabled) { m_gpuDriven = enabled; }
+  bool GetGpuDriven() const { return m_gpuDriven; }
+
+  /**
+   * @brief Skips the objects of the GPU scene hidden behind others, see @c render::GpuScene
+   *
+   * Splits the frame in two: objects visible last frame are drawn first, the rest are tested against a depth pyramid
+   * built from those draws and drawn after. Pays off when most of the scene is hidden, like indoors or between
+   * buildings, on open scenes it only adds the cost of the pyramid. Needs @c SetGpuDriven() and a render target with
+   * sampled depth, see @c render::Renderer::SetSampledDepth().
+   */
+  void SetOcclusionCulling(bool enabled) { m_occlusionCulling = enabled; }
+  bool GetOcclusionCulling() const { return m_occlusionCulling; }
+  /// Whether occlusion culling is on and can run, the render target needs sampled depth only then
+  bool NeedsSampledDepth() const { return m_occlusionCulling && m_gpuDriven; }
 
   constexpr static unsigned int MAX_OBJECTS = 1024;
 
 protected:
+  /**
+   * @enum PassType
+   * @brief Kind of pass a pipeline is created for
+   */
+  enum class PassType {
+    Color,      ///< Regular pass, depth test @c LESS with writes
+    DepthOnly,  ///< Depth pre-pass, positions only and no colour writes
+    DepthEqual, ///< Colour pass after the pre-pass, depth test @c EQUAL without writes
+  };
+
   void CreatePipelineLayout();
-  void CreatePipeline(VkRenderPass renderPass);
+  /**
+   * @brief Gets the pipeline able to draw models with the given vertex layout, creating it on first use
+   */
+  render::Pipeline* GetPipeline(const render::Model::Layout& layout, PassType pass = PassType::Color,
+                                bool indirect = false);
+  void DrawDepthPrepass(const render::FrameInfo& frameInfo, std::vector<Object> &objects);
+  /**
+   * @brief Draws every batch of the GPU scene with the pipelines of @c pass
+   * @param late Draw the objects found by the late occlusion culling
+   */
+  void DrawGpuScene(const render::FrameInfo& frameInfo, PassType pass, bool late = false);
+  /// Whether the object at @c index is drawn by the GPU scene this frame
+  bool IsGpuDrawn(size_t index) const { return m_gpuSceneActive && m_gpuScene->IsDrawn(index); }
+  /**
+   * @brief Updates @c Object::lod from the projected size of the object
+   */
+  void SelectLod(const render::FrameInfo& frameInfo, Object& obj) const;
 
   render::Devices* m_devices = nullptr;
-  std::unique_ptr<render::Pipeline> m_pipeline = nullptr;
+  VkRenderPass m_renderPass = VK_NULL_HANDLE;
+  std::unordered_map<uint32_t, std::unique_ptr<render::Pipeline>> m_pipelines;
   VkPipelineLayout m_pipelineLayout;
+  VkDescriptorSetLayout m_globalSetLayout;
+  bool m_depthPrepass = false;
+  float m_lodPixelError = 1.0f;
+  float m_lodHysteresis = 0.15f;
+  uint64_t m_triangleCount = 0;
+  bool m_gpuDriven = false;
+  bool m_gpuSceneActive = false; ///< The GPU scene was updated this frame
+  bool m_occlusionCulling = false;
+  std::unique_ptr<render::GpuScene> m_gpuScene;
 
   std::unique_ptr<render::DescriptorSetLayout> m_textureLayout;
 
@@ -44,11 +153,30 @@ protected:
   };
   DescriptorSetPoolSizes m_poolSizes;
   std::unique_ptr<render::DescriptorPool> m_globalPool = nullptr;
-  std::vector<VkDescriptorSet> m_globalDescriptorSets;
+
+  /**
+   * @struct TextureSet
+   * @brief Set 1 of the objects drawn one by one, one per texture, written once when the texture is first drawn
+   */
+  struct TextureSet {
+    const render::Texture* texture = nullptr; ///< nullptr once its texture is gone or replaced
+    uint64_t id = 0;                          ///< @c Texture::GetUniqueId(), a new texture can reuse the address
+    VkDescriptorSet set = VK_NULL_HANDLE;
+    uint64_t lastUsed = 0;                    ///< @c m_frameNumber of the last frame that bound it
+  };
+  std::vector<TextureSet> m_textureSets;
+  std::unordered_map<const render::Texture*, uint32_t> m_textureSetIndices;
+  uint64_t m_frameNumber = 0; ///< Frames prepared so far
 
   void CreateDescriptorPool();
-  void CreateDescriptorSets();
-  VkDescriptorSet AllocateDescriptorSet(VkDescriptorSetLayout layout);
+  /**
+   * @brief Set holding @c texture, writing it the first time the texture is seen
+   *
+   * Sets are never rewritten while a frame in flight may still read them, the ones of textures not drawn for longer
+   * than that are given to new textures.
+   * @return @c VK_NULL_HANDLE when the pool is out of sets
+   */
+  VkDescriptorSet GetTextureSet(const render::Texture* texture);
 };
 
 }
@@ -1,9 +1,5 @@
 #include "window.hpp"
 
-#include "events/game_event.hpp"
-#include "events/key_event.hpp"
-#include "events/mouse_event.hpp"
-
 namespace bloom {
 
 Window::Window(int width, int height, std::string title)
@@ -45,32 +41,27 @@ void Window::OnInit() {
     WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
     data.width = width;
     data.height = height;
-    WindowResizeEvent event(width, height);
-    data.callback(event);
+    if (data.queue) data.queue->Push(WindowResizeEvent(width, height));
   });
 
   glfwSetWindowCloseCallback(_window, [](GLFWwindow* window) {
     WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
-    WindowCloseEvent event;
-    data.callback(event);
+    if (data.queue) data.queue->Push(WindowCloseEvent());
   });
 
   glfwSetKeyCallback(_window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
     WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
     switch(action) {
       case GLFW_PRESS: {
-        KeyPressedEvent event(key,0);
-        data.callback(event);
+        if (data.queue && data.inputEnabled) data.queue->Push(KeyPressedEvent(key,0));
         break;
       }
       case GLFW_RELEASE: {
-        KeyReleasedEvent event(key);
-        data.callback(event);
+        if (data.queue && data.inputEnabled) data.queue->Push(KeyReleasedEvent(key));
         break;
       }
       case GLFW_REPEAT: {
-        KeyPressedEvent event(key, 1);
-        data.callback(event);
+        if (data.queue && data.inputEnabled) data.queue->Push(KeyPressedEvent(key, 1));
         break;
       }
     }
@@ -80,13 +71,11 @@ void Window::OnInit() {
     WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
     switch(action) {
       case GLFW_PRESS: {
-        MouseButtonPressedEvent event(button);
-        data.callback(event);
+        if (data.queue && data.inputEnabled) data.queue->Push(MouseButtonPressedEvent(button));
         break;
       }
       case GLFW_RELEASE: {
-        MouseButtonReleasedEvent event(button);
-        data.callback(event);
+        if (data.queue && data.inputEnabled) data.queue->Push(MouseButtonReleasedEvent(button));
         break;
       }
     }
@@ -94,14 +83,12 @@ void Window::OnInit() {
 
   glfwSetScrollCallback(_window, [](GLFWwindow* window, double xOffset, double yOffset) {
     WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
-    MouseScrolledEvent event((float)xOffset, (float)yOffset);
-    data.callback(event);
+    if (data.queue && data.inputEnabled) data.queue->Push(MouseScrolledEvent((float)xOffset, (float)yOffset));
   });
 
   glfwSetCursorPosCallback(_window, [](GLFWwindow* window, double xPos, double yPos) {
     WindowData& data = *(WindowData*)glfwGetWindowUserPointer(window);
-    MouseMovedEvent event((float)xPos, (float)yPos);
-    data.callback(event);
+    if (data.queue && data.inputEnabled) data.queue->Push(MouseMovedEvent((float)xPos, (float)yPos));
   });
 
 #pragma endregion
@@ -114,11 +101,13 @@ void Window::OnTick() {
 }
 
 void Window::SetVSync(bool enabled) {
-  // This is OpenGL specific
-  /* if(enabled) glfwSwapInterval(1);
-  else glfwSwapInterval(0);
+  SetPresentMode(enabled ? PresentMode::Fifo : PresentMode::Immediate);
+}
 
-  _data.vsync = enabled;*/
+void Window::SetPresentMode(PresentMode mode) {
+  // Vulkan has no swap interval, the renderer picks this up and recreates the swap chain
+  m_data.presentMode = mode;
+  m_data.vsync = mode == PresentMode::Fifo || mode == PresentMode::FifoRelaxed;
 }
 
 double Window::GetDeltaTime() {
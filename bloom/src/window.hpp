@@ -8,16 +8,25 @@
 
 #pragma once
 #include "bloom_header.hpp"
-#include "events/event.hpp"
+#include "events/event_queue.hpp"
 #include <GLFW/glfw3.h>
 
 namespace bloom {
 
+/**
+ * @enum PresentMode
+ * @brief How finished frames are handed to the display, maps to @c VkPresentModeKHR
+ */
+enum class PresentMode {
+  Fifo,        ///< V-Sync, lowest power, up to a frame of queueing latency
+  FifoRelaxed, ///< V-Sync that tears instead of stuttering when a frame is late
+  Mailbox,     ///< Renders uncapped and shows the newest frame on the next v-blank, no tearing
+  Immediate,   ///< No synchronization at all, lowest latency, tears
+};
+
 class BLOOM_API Window {
 
 public:
-  using EventCalbackFn = std::function<void(Event&)>;
-
   Window(int width, int height, std::string title);
   ~Window();
 
@@ -26,9 +35,26 @@ public:
   void OnTick();
   void CloseWindow();
 
-  inline void SetEventCallback(const EventCalbackFn& callback) { m_data.callback = callback; };
+  /**
+   * @brief Sets the queue the window pushes its events into while polling, nullptr drops them
+   */
+  inline void SetEventQueue(EventQueue* queue) { m_data.queue = queue; };
+  /**
+   * @brief Stops queueing keyboard and mouse events, window events still go through. Used by input playback
+   */
+  inline void SetInputEnabled(bool enabled) { m_data.inputEnabled = enabled; }
+  /**
+   * @brief Enables or disables V-Sync
+   *
+   * Disabling it picks @c PresentMode::Immediate, the renderer falls back to Mailbox if the driver doesn't have it
+   */
   void SetVSync(bool enabled);
   inline bool IsVSync() const { return m_data.vsync; };
+  /**
+   * @brief Selects the present mode, the renderer recreates the swap chain at the start of the next frame
+   */
+  void SetPresentMode(PresentMode mode);
+  PresentMode GetPresentMode() const { return m_data.presentMode; }
   inline bool ShouldClose() const { return glfwWindowShouldClose(_window); };
   VkExtent2D GetExtent() { return {static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height)}; }
   double GetDeltaTime();
@@ -56,7 +82,9 @@ private:
     std::string title;
     int width, height;
     bool vsync;
-    EventCalbackFn callback;
+    PresentMode presentMode = PresentMode::Fifo;
+    EventQueue* queue = nullptr;
+    bool inputEnabled = true;
   }m_data;
 
   static void GLFWErrorCallback(int error, const char* description);
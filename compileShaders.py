@@ -4,7 +4,7 @@ shaderdir = "./resources/shaders"
 outdir = "./bin/debug/sandbox/resources/shaders"
 
 shaders = os.listdir(shaderdir)
-shaders = [shaderdir + '/' + shader for shader in shaders if shader.endswith('.frag') or shader.endswith('.vert')]
+shaders = [shaderdir + '/' + shader for shader in shaders if shader.endswith('.frag') or shader.endswith('.vert') or shader.endswith('.comp')]
 
 if not os.path.exists(outdir):
     print (f"Output directory doesn't exist, creating {outdir}...")
@@ -5,9 +5,9 @@ layout (location = 1) in vec4 fragColor;
 
 layout (location = 0) out vec4 outColor;
 
-layout (set = 0, binding = 0) uniform sampler2D texSampler;
+layout (set = 1, binding = 0) uniform sampler2D texSampler;
 layout(push_constant) uniform Push {
-	mat4 transform;
+	mat4 modelMatrix;
 	vec3 color;
 } push;
 
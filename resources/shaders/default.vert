@@ -7,13 +7,23 @@ layout(location = 2) in vec4 color;
 layout(location = 0) out vec2 fragTexCoord;
 layout(location = 1) out vec4 fragColor;
 
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform Global {
+    mat4 projection;
+    mat4 view;
+    mat4 projectionView;
+    vec4 cameraPosition;
+    float time;
+} global;
+
 layout(push_constant) uniform Push {
-    mat4 transform;
+    mat4 modelMatrix;
     vec3 color;
 } push;
 
 void main() {
-    gl_Position = push.transform * vec4(position, 1.0);
+    gl_Position = global.projectionView * push.modelMatrix * vec4(position, 1.0);
     fragColor = color;
     fragTexCoord = texCoord;
 }
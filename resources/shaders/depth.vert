@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+// Must be computed exactly like default.vert so the colour pass can use an EQUAL depth test
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform Global {
+    mat4 projection;
+    mat4 view;
+    mat4 projectionView;
+    vec4 cameraPosition;
+    float time;
+} global;
+
+layout(push_constant) uniform Push {
+    mat4 modelMatrix;
+    vec3 color;
+} push;
+
+void main() {
+    gl_Position = global.projectionView * push.modelMatrix * vec4(position, 1.0);
+}
@@ -0,0 +1,14 @@
+#version 450
+
+layout (location = 0) in vec2 fragTexCoord;
+layout (location = 1) in vec4 fragColor;
+layout (location = 2) flat in uint fragTexture;
+
+layout (location = 0) out vec4 outColor;
+
+// Must match GpuScene::MAX_TEXTURES, the index is the same for a whole draw
+layout (set = 1, binding = 0) uniform sampler2D textures[64];
+
+void main() {
+	outColor = texture(textures[fragTexture], fragTexCoord) * fragColor;
+}
@@ -0,0 +1,33 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+// default.vert for draws generated by cull.comp, the object comes from firstInstance instead of push constants
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec2 texCoord;
+layout(location = 2) in vec4 color;
+
+layout(location = 0) out vec2 fragTexCoord;
+layout(location = 1) out vec4 fragColor;
+layout(location = 2) flat out uint fragTexture;
+
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform Global {
+    mat4 projection;
+    mat4 view;
+    mat4 projectionView;
+    vec4 cameraPosition;
+    float time;
+} global;
+
+#include "object.glsl"
+
+layout(std430, set = 2, binding = 0) readonly buffer Objects { Object objects[]; };
+
+void main() {
+    Object object = objects[gl_InstanceIndex];
+    gl_Position = global.projectionView * object.model * vec4(position, 1.0);
+    fragColor = color;
+    fragTexCoord = texCoord;
+    fragTexture = object.texture;
+}
@@ -0,0 +1,23 @@
+#version 450
+#extension GL_GOOGLE_include_directive : require
+
+layout(location = 0) in vec3 position;
+
+// Must be computed exactly like indirect.vert so the colour pass can use an EQUAL depth test
+invariant gl_Position;
+
+layout(set = 0, binding = 0) uniform Global {
+    mat4 projection;
+    mat4 view;
+    mat4 projectionView;
+    vec4 cameraPosition;
+    float time;
+} global;
+
+#include "object.glsl"
+
+layout(std430, set = 2, binding = 0) readonly buffer Objects { Object objects[]; };
+
+void main() {
+    gl_Position = global.projectionView * objects[gl_InstanceIndex].model * vec4(position, 1.0);
+}
@@ -0,0 +1,14 @@
+// Object of the GPU scene, GpuScene::GpuObject (std430). Included by indirect.vert, indirect_depth.vert, cull.comp and
+// cluster_cull.comp, compileShaders.py only compiles the stages themselves
+struct Object {
+    mat4 model;
+    vec4 sphere; // World space bounding sphere
+    uint mesh;
+    uint texture;
+    uint drawOffset; // First draw of the batch in the draw buffer
+    uint batch;
+    float scale; // Largest axis scale of the model matrix
+    uint clusterOffset; // First cluster draw of the batch, INVALID if the object isn't drawn by clusters
+    uint flags;
+    uint state; // LOD and visibility slot of the object, kept while the object is in the scene
+};